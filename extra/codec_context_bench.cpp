@@ -0,0 +1,169 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdlib.h>
+#include <vector>
+
+#include "math/size.hpp"
+#include "plugins/jpeg.hpp"
+#include "plugins/mem_jpeg_compressor.hpp"
+#include "plugins/mem_jpeg_decompressor.hpp"
+#include "plugins/png.hpp"
+#include "util/software_surface.hpp"
+
+// Count heap allocations by interposing the glibc allocator, this
+// catches the allocations done inside libjpeg/libpng as well as
+// operator new
+namespace {
+unsigned long g_allocations = 0;
+} // namespace
+
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t nmemb, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size)
+{
+  g_allocations += 1;
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size)
+{
+  g_allocations += 1;
+  return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+  g_allocations += 1;
+  return __libc_realloc(ptr, size);
+}
+
+} // extern "C"
+
+namespace {
+
+SoftwareSurfacePtr create_test_tile(SoftwareSurface::Format format)
+{
+  SoftwareSurfacePtr surface = SoftwareSurface::create(format, Size(256, 256));
+  uint8_t* data = surface->get_data();
+  for(int y = 0; y < surface->get_height(); ++y)
+  {
+    for(int x = 0; x < surface->get_pitch(); ++x)
+    {
+      // smooth gradient with some noise, roughly photo-like
+      data[y * surface->get_pitch() + x] = static_cast<uint8_t>(x / 3 + y + (rand() % 16));
+    }
+  }
+  return surface;
+}
+
+void run(const std::string& name, int iterations, const std::function<void ()>& func)
+{
+  func(); // warm up, so one time setup doesn't show in the numbers
+
+  unsigned long allocations = g_allocations;
+  auto start = std::chrono::steady_clock::now();
+  for(int i = 0; i < iterations; ++i)
+  {
+    func();
+  }
+  double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  allocations = g_allocations - allocations;
+
+  std::cout << std::left << std::setw(28) << name
+            << std::right << std::fixed << std::setprecision(1)
+            << std::setw(12) << 1000000.0 * time / iterations
+            << std::setw(14) << static_cast<double>(allocations) / iterations
+            << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  int iterations = (argc > 1) ? atoi(argv[1]) : 1000;
+
+  SoftwareSurfacePtr rgb_tile  = create_test_tile(SoftwareSurface::RGB_FORMAT);
+  SoftwareSurfacePtr rgba_tile = create_test_tile(SoftwareSurface::RGBA_FORMAT);
+  BlobPtr jpeg_blob = JPEG::save(rgb_tile, 75);
+  BlobPtr png_blob  = PNG::save(rgba_tile);
+
+  std::cout << iterations << " iterations on a 256x256 tile\n" << std::endl;
+  std::cout << std::left << std::setw(28) << "benchmark"
+            << std::right << std::setw(12) << "usec/op"
+            << std::setw(14) << "allocs/op" << std::endl;
+
+  run("jpeg encode, fresh context", iterations, [&]{
+      std::vector<uint8_t> data;
+      MemJPEGCompressor compressor(data);
+      compressor.save(rgb_tile, 75);
+      Blob::copy(data);
+    });
+
+  {
+    std::vector<uint8_t> data;
+    data.reserve(64 * 1024);
+    MemJPEGCompressor compressor(data);
+    run("jpeg encode, reused context", iterations, [&]{
+        data.clear();
+        compressor.save(rgb_tile, 75);
+        Blob::copy(data);
+      });
+  }
+
+  run("jpeg decode, fresh context", iterations, [&]{
+      MemJPEGDecompressor loader(jpeg_blob->get_data(), jpeg_blob->size());
+      loader.read_image(1, NULL);
+    });
+
+  {
+    MemJPEGDecompressor loader(NULL, 0);
+    run("jpeg decode, reused context", iterations, [&]{
+        loader.reset(jpeg_blob->get_data(), jpeg_blob->size());
+        loader.read_image(1, NULL);
+      });
+  }
+
+  run("JPEG::save()", iterations, [&]{
+      JPEG::save(rgb_tile, 75);
+    });
+
+  run("JPEG::load_from_mem()", iterations, [&]{
+      JPEG::load_from_mem(jpeg_blob->get_data(), jpeg_blob->size());
+    });
+
+  run("PNG::save()", iterations, [&]{
+      PNG::save(rgba_tile);
+    });
+
+  run("PNG::load_from_mem()", iterations, [&]{
+      PNG::load_from_mem(png_blob->get_data(), png_blob->size());
+    });
+
+  return 0;
+}
+
+/* EOF */
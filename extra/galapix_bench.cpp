@@ -0,0 +1,675 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <math.h>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include <jpeglib.h>
+
+#include "database/database.hpp"
+#include "galapix/database_thread.hpp"
+#include "galapix/tile.hpp"
+#include "job/job.hpp"
+#include "job/job_manager.hpp"
+#include "math/quad_tree.hpp"
+#include "math/rect.hpp"
+#include "math/rgba.hpp"
+#include "math/size.hpp"
+#include "plugins/jpeg.hpp"
+#include "plugins/png.hpp"
+#include "util/software_surface.hpp"
+#include "util/url.hpp"
+
+namespace {
+
+/** Small deterministic PRNG, so that every run and every machine
+    benchmarks exactly the same input */
+class Random
+{
+private:
+  uint32_t m_state;
+
+public:
+  Random(uint32_t seed) : m_state(seed) {}
+
+  uint32_t next()
+  {
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 17;
+    m_state ^= m_state << 5;
+    return m_state;
+  }
+
+  float uniform(float min, float max)
+  {
+    return min + (max - min) * static_cast<float>(next() % 1000000) / 1000000.0f;
+  }
+};
+
+Size megapixel_size(int megapixel)
+{
+  // 4:3 like most cameras
+  int width = static_cast<int>(sqrt(megapixel * 1000000.0 * 4.0 / 3.0));
+  return Size(width, megapixel * 1000000 / width);
+}
+
+/** Smooth gradients with some structure and a bit of noise, which
+    compresses roughly like a photo */
+SoftwareSurfacePtr create_test_image(SoftwareSurface::Format format, const Size& size, uint32_t seed)
+{
+  Random rnd(seed);
+  SoftwareSurfacePtr surface = SoftwareSurface::create(format, size);
+  const int bpp = surface->get_bytes_per_pixel();
+  for(int y = 0; y < size.height; ++y)
+  {
+    uint8_t* row = surface->get_row_data(y);
+    for(int x = 0; x < size.width; ++x)
+    {
+      int noise = static_cast<int>(rnd.next() % 16);
+      int wave  = static_cast<int>(32.0f * sinf(static_cast<float>(x) / 37.0f) * cosf(static_cast<float>(y) / 23.0f));
+      row[bpp*x + 0] = static_cast<uint8_t>(x * 255 / size.width + wave + noise);
+      row[bpp*x + 1] = static_cast<uint8_t>(y * 255 / size.height - wave + noise);
+      row[bpp*x + 2] = static_cast<uint8_t>((x + y) / 8 + noise);
+      if (bpp == 4)
+      {
+        row[bpp*x + 3] = static_cast<uint8_t>(255 - x * 255 / size.width);
+      }
+    }
+  }
+  return surface;
+}
+
+/** SoftwareSurface has no grayscale format, so a single channel JPEG
+    is written with libjpeg directly to cover the grayscale decode
+    path */
+BlobPtr create_gray_jpeg(const SoftwareSurfacePtr& surface, int quality)
+{
+  jpeg_compress_struct cinfo;
+  jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+
+  unsigned char* buffer = 0;
+  unsigned long  len = 0;
+  jpeg_mem_dest(&cinfo, &buffer, &len);
+
+  cinfo.image_width  = static_cast<JDIMENSION>(surface->get_width());
+  cinfo.image_height = static_cast<JDIMENSION>(surface->get_height());
+  cinfo.input_components = 1;
+  cinfo.in_color_space = JCS_GRAYSCALE;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, quality, TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+
+  std::vector<JSAMPLE> row(static_cast<size_t>(surface->get_width()));
+  while(cinfo.next_scanline < cinfo.image_height)
+  {
+    const uint8_t* src = surface->get_row_data(static_cast<int>(cinfo.next_scanline));
+    for(int x = 0; x < surface->get_width(); ++x)
+    {
+      row[static_cast<size_t>(x)] = src[3*x];
+    }
+    JSAMPROW rowptr = &row[0];
+    jpeg_write_scanlines(&cinfo, &rowptr, 1);
+  }
+
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+
+  BlobPtr blob = Blob::copy(buffer, static_cast<int>(len));
+  free(buffer);
+  return blob;
+}
+
+std::string json_escape(const std::string& str)
+{
+  std::string out;
+  for(std::string::const_iterator i = str.begin(); i != str.end(); ++i)
+  {
+    if (*i == '"' || *i == '\\')
+    {
+      out += '\\';
+    }
+    out += *i;
+  }
+  return out;
+}
+
+class NullJob : public Job
+{
+public:
+  NullJob() : Job(JobHandle::create()) {}
+  void run() {}
+};
+
+class Benchmark
+{
+private:
+  struct Result
+  {
+    std::string name;
+    std::string unit;
+    double work;
+    std::vector<double> times;
+  };
+
+  std::string m_filter;
+  double m_min_time;
+  std::vector<Result> m_results;
+
+public:
+  Benchmark(const std::string& filter, double min_time) :
+    m_filter(filter),
+    m_min_time(min_time),
+    m_results()
+  {}
+
+  bool enabled(const std::string& name) const
+  {
+    return m_filter.empty() || name.find(m_filter) != std::string::npos;
+  }
+
+  /** Calls \a func repeatedly, at least three times and for at least
+      m_min_time seconds. \a work is the amount of \a unit processed
+      by a single call, e.g. megapixels or tiles. */
+  void run(const std::string& name, double work, const std::string& unit,
+           const std::function<void ()>& func)
+  {
+    if (!enabled(name))
+      return;
+
+    Result result;
+    result.name = name;
+    result.unit = unit;
+    result.work = work;
+
+    func(); // warm up
+
+    double total = 0.0;
+    while((total < m_min_time || result.times.size() < 3) && result.times.size() < 10000)
+    {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      func();
+      double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      result.times.push_back(t);
+      total += t;
+    }
+
+    std::sort(result.times.begin(), result.times.end());
+    std::cerr << name << ": " << work / median(result) << " " << unit << std::endl;
+    m_results.push_back(result);
+  }
+
+  void write_json(std::ostream& out, const std::string& config) const
+  {
+    out << "{\n"
+        << "  \"config\": " << config << ",\n"
+        << "  \"benchmarks\": [";
+    for(std::vector<Result>::const_iterator i = m_results.begin(); i != m_results.end(); ++i)
+    {
+      double mean = 0.0;
+      for(std::vector<double>::const_iterator t = i->times.begin(); t != i->times.end(); ++t)
+      {
+        mean += *t;
+      }
+      mean /= static_cast<double>(i->times.size());
+
+      out << (i == m_results.begin() ? "\n" : ",\n")
+          << "    { \"name\": \"" << json_escape(i->name) << "\""
+          << ", \"iterations\": " << i->times.size()
+          << ", \"min_s\": " << i->times.front()
+          << ", \"median_s\": " << median(*i)
+          << ", \"mean_s\": " << mean
+          << ", \"max_s\": " << i->times.back()
+          << ", \"throughput\": " << i->work / median(*i)
+          << ", \"unit\": \"" << json_escape(i->unit) << "\" }";
+    }
+    out << "\n  ]\n}" << std::endl;
+  }
+
+private:
+  static double median(const Result& result)
+  {
+    return result.times[result.times.size() / 2];
+  }
+};
+
+void bench_jpeg(Benchmark& bench, const std::vector<int>& megapixels)
+{
+  for(std::vector<int>::const_iterator mp = megapixels.begin(); mp != megapixels.end(); ++mp)
+  {
+    Size size = megapixel_size(*mp);
+    SoftwareSurfacePtr image = create_test_image(SoftwareSurface::RGB_FORMAT, size, 1);
+
+    struct { const char* name; BlobPtr blob; } inputs[] = {
+      { "rgb",  JPEG::save(image, 85) },
+      { "gray", create_gray_jpeg(image, 85) }
+    };
+
+    for(size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i)
+    {
+      BlobPtr blob = inputs[i].blob;
+      for(int scale = 1; scale <= 8; scale *= 2)
+      {
+        std::ostringstream name;
+        name << "jpeg_decode/" << inputs[i].name << "/" << *mp << "mp/1:" << scale;
+        bench.run(name.str(), *mp, "MPix/s", [blob, scale]{
+            JPEG::load_from_mem(blob->get_data(), blob->size(), scale);
+          });
+      }
+    }
+  }
+}
+
+void bench_png(Benchmark& bench, const std::vector<int>& megapixels)
+{
+  for(std::vector<int>::const_iterator mp = megapixels.begin(); mp != megapixels.end(); ++mp)
+  {
+    Size size = megapixel_size(*mp);
+    struct { const char* name; SoftwareSurface::Format format; } inputs[] = {
+      { "rgb",  SoftwareSurface::RGB_FORMAT },
+      { "rgba", SoftwareSurface::RGBA_FORMAT }
+    };
+
+    for(size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i)
+    {
+      std::ostringstream name;
+      name << "png_decode/" << inputs[i].name << "/" << *mp << "mp";
+      if (!bench.enabled(name.str()))
+        continue;
+
+      BlobPtr blob = PNG::save(create_test_image(inputs[i].format, size, 2));
+      bench.run(name.str(), *mp, "MPix/s", [blob]{
+          PNG::load_from_mem(blob->get_data(), blob->size());
+        });
+    }
+  }
+}
+
+void bench_surface(Benchmark& bench, int megapixel)
+{
+  Size size = megapixel_size(megapixel);
+  struct { const char* name; SoftwareSurface::Format format; } inputs[] = {
+    { "rgb",  SoftwareSurface::RGB_FORMAT },
+    { "rgba", SoftwareSurface::RGBA_FORMAT }
+  };
+
+  for(size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i)
+  {
+    SoftwareSurfacePtr image = create_test_image(inputs[i].format, size, 3);
+    std::string suffix = std::string("/") + inputs[i].name;
+
+    bench.run("surface/halve" + suffix, megapixel, "MPix/s", [image]{
+        image->halve();
+      });
+
+    bench.run("surface/scale" + suffix, megapixel, "MPix/s", [image, size]{
+        image->scale(Size(size.width / 3, size.height / 3));
+      });
+
+    bench.run("surface/crop" + suffix, megapixel, "MPix/s", [image, size]{
+        for(int y = 0; y < size.height; y += 256)
+          for(int x = 0; x < size.width; x += 256)
+          {
+            image->crop(Rect(Vector2i(x, y), Size(256, 256)));
+          }
+      });
+
+    SoftwareSurfacePtr tile = image->crop(Rect(Vector2i(0, 0), Size(256, 256)));
+    SoftwareSurfacePtr target = SoftwareSurface::create(inputs[i].format, size);
+    bench.run("surface/blit" + suffix, megapixel, "MPix/s", [tile, target, size]() mutable {
+        for(int y = 0; y < size.height; y += 256)
+          for(int x = 0; x < size.width; x += 256)
+          {
+            tile->blit(target, Vector2i(x, y));
+          }
+      });
+  }
+}
+
+void create_tiles(int count, std::vector<SoftwareSurfacePtr>& tiles_out)
+{
+  SoftwareSurfacePtr image = create_test_image(SoftwareSurface::RGB_FORMAT, Size(256 * 8, 256 * ((count + 7) / 8)), 4);
+  for(int i = 0; i < count; ++i)
+  {
+    tiles_out.push_back(image->crop(Rect(Vector2i(256 * (i % 8), 256 * (i / 8)), Size(256, 256))));
+  }
+}
+
+void bench_tile_encode(Benchmark& bench)
+{
+  std::vector<SoftwareSurfacePtr> tiles;
+  create_tiles(64, tiles);
+
+  const char* specs[] = { "jpeg", "png" };
+  for(size_t i = 0; i < sizeof(specs) / sizeof(specs[0]); ++i)
+  {
+    TileCodecPtr codec = TileCodec::from_string(specs[i]);
+    const TileCodec* codec_ptr = codec.get();
+    bench.run(std::string("tile_encode/") + specs[i], static_cast<double>(tiles.size()), "tiles/s",
+              [&tiles, codec_ptr]{
+                for(std::vector<SoftwareSurfacePtr>::const_iterator t = tiles.begin(); t != tiles.end(); ++t)
+                {
+                  codec_ptr->encode(*t);
+                }
+              });
+  }
+}
+
+void bench_database(Benchmark& bench, int num_files)
+{
+  if (!bench.enabled("tile_db") && !bench.enabled("database_thread"))
+    return;
+
+  char dirname[] = "/tmp/galapix_bench.XXXXXX";
+  if (!mkdtemp(dirname))
+  {
+    throw std::runtime_error("mkdtemp() failed");
+  }
+
+  {
+    Database database(dirname);
+
+    std::vector<SoftwareSurfacePtr> surfaces;
+    create_tiles(64, surfaces);
+
+    std::vector<FileEntry> files;
+    for(int i = 0; i < num_files; ++i)
+    {
+      std::ostringstream filename;
+      filename << "/bench/" << i << ".jpg";
+      FileEntry entry = FileEntry::create_without_fileid(URL::from_filename(filename.str()), 0, 0, 2048, 2048,
+                                                         FileEntry::JPEG_FORMAT);
+      files.push_back(database.get_files().store_file_entry_without_cache(entry));
+    }
+
+    // encode once, so that only the database itself is measured
+    std::vector<TileEntry> tiles;
+    for(int i = 0; i < 64; ++i)
+    {
+      TileEntry tile(files.front(), 0, Vector2i(i % 8, i / 8), surfaces[static_cast<size_t>(i)]);
+      database.get_tile_codec().encode(tile);
+      tile.set_surface(SoftwareSurfacePtr());
+      tiles.push_back(tile);
+    }
+
+    int next_file = 0;
+    bench.run("tile_db/store", static_cast<double>(tiles.size()), "tiles/s", [&]{
+        for(std::vector<TileEntry>::iterator t = tiles.begin(); t != tiles.end(); ++t)
+        {
+          t->set_file_entry(files[static_cast<size_t>(next_file % num_files)]);
+        }
+        database.get_tiles().store_tiles(tiles);
+        next_file += 1;
+      });
+
+    // make sure every file has its tiles, no matter how often store ran
+    for(int i = next_file; i < num_files; ++i)
+    {
+      for(std::vector<TileEntry>::iterator t = tiles.begin(); t != tiles.end(); ++t)
+      {
+        t->set_file_entry(files[static_cast<size_t>(i)]);
+      }
+      database.get_tiles().store_tiles(tiles);
+    }
+
+    Random rnd(5);
+    bench.run("tile_db/get", 64, "tiles/s", [&]{
+        for(int i = 0; i < 64; ++i)
+        {
+          TileEntry tile;
+          if (!database.get_tiles().get_tile(files[rnd.next() % files.size()], 0,
+                                             Vector2i(static_cast<int>(rnd.next() % 8),
+                                                      static_cast<int>(rnd.next() % 8)),
+                                             tile))
+          {
+            throw std::runtime_error("tile_db/get: tile missing");
+          }
+        }
+      });
+
+    if (bench.enabled("database_thread"))
+    {
+      JobManager job_manager(1);
+      DatabaseThread database_thread(database, job_manager);
+      database_thread.start_thread();
+      job_manager.start_thread();
+
+      bench.run("database_thread/request_tile", 1, "requests/s", [&]{
+          database_thread.request_tile(files[rnd.next() % files.size()], 0,
+                                       Vector2i(static_cast<int>(rnd.next() % 8),
+                                                static_cast<int>(rnd.next() % 8)),
+                                       std::function<void (Tile)>()).wait();
+        });
+
+      job_manager.stop_thread();
+      database_thread.stop_thread();
+      job_manager.join_thread();
+      database_thread.join_thread();
+    }
+  }
+
+  unlink((std::string(dirname) + "/cache3.sqlite3").c_str());
+  unlink((std::string(dirname) + "/cache3_tiles.sqlite3").c_str());
+  rmdir(dirname);
+}
+
+void bench_job_manager(Benchmark& bench, int num_threads)
+{
+  if (!bench.enabled("job_manager"))
+    return;
+
+  JobManager job_manager(num_threads);
+  job_manager.start_thread();
+
+  const int num_jobs = 1000;
+  std::mutex mutex;
+  std::condition_variable cond;
+  int finished = 0;
+
+  bench.run("job_manager/dispatch", num_jobs, "jobs/s", [&]{
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished = 0;
+      }
+
+      for(int i = 0; i < num_jobs; ++i)
+      {
+        job_manager.request(std::make_shared<NullJob>(), [&](std::shared_ptr<Job>, bool){
+            std::unique_lock<std::mutex> lock(mutex);
+            finished += 1;
+            cond.notify_one();
+          });
+      }
+
+      std::unique_lock<std::mutex> lock(mutex);
+      cond.wait(lock, [&]{ return finished == num_jobs; });
+    });
+
+  job_manager.stop_thread();
+  job_manager.join_thread();
+}
+
+void bench_quad_tree(Benchmark& bench, int num_items)
+{
+  if (!bench.enabled("quad_tree"))
+    return;
+
+  const float world = 100000.0f;
+  Random rnd(6);
+  std::vector<Rectf> rects;
+  for(int i = 0; i < num_items; ++i)
+  {
+    float x = rnd.uniform(0.0f, world - 256.0f);
+    float y = rnd.uniform(0.0f, world - 256.0f);
+    rects.push_back(Rectf(x, y, x + rnd.uniform(16.0f, 256.0f), y + rnd.uniform(16.0f, 256.0f)));
+  }
+
+  bench.run("quad_tree/build", num_items, "items/s", [&rects, world]{
+      QuadTree<int> tree(Rectf(0.0f, 0.0f, world, world));
+      for(size_t i = 0; i < rects.size(); ++i)
+      {
+        tree.add(rects[i], static_cast<int>(i));
+      }
+    });
+
+  QuadTree<int> tree(Rectf(0.0f, 0.0f, world, world));
+  for(size_t i = 0; i < rects.size(); ++i)
+  {
+    tree.add(rects[i], static_cast<int>(i));
+  }
+
+  const int num_queries = 1000;
+  bench.run("quad_tree/query", num_queries, "queries/s", [&tree, &rnd, world]{
+      for(int i = 0; i < num_queries; ++i)
+      {
+        // roughly a screen full of thumbnails
+        float x = rnd.uniform(0.0f, world - 2000.0f);
+        float y = rnd.uniform(0.0f, world - 1500.0f);
+        tree.get_items_at(Rectf(x, y, x + 2000.0f, y + 1500.0f));
+      }
+    });
+}
+
+void print_usage(const char* arg0)
+{
+  std::cout << "Usage: " << arg0 << " [OPTIONS]\n"
+            << "Runs benchmarks of galapix's hot paths on synthetic input and writes the\n"
+            << "results as JSON to stdout, progress goes to stderr\n"
+            << "\n"
+            << "Options:\n"
+            << "  --quick            Small inputs and short runs, for smoke testing\n"
+            << "  --filter STRING    Only run benchmarks whose name contains STRING\n"
+            << "  --min-time SEC     Run each benchmark at least SEC seconds (default: 0.5)\n"
+            << "  --output FILE      Write the JSON to FILE instead of stdout\n"
+            << "  --threads N        Worker threads for the JobManager benchmark (default: 2)" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  bool quick = false;
+  std::string filter;
+  std::string output;
+  double min_time = 0.5;
+  int threads = 2;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--quick") == 0)
+    {
+      quick = true;
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--filter") == 0)
+    {
+      filter = argv[++i];
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--min-time") == 0)
+    {
+      min_time = atof(argv[++i]);
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--output") == 0)
+    {
+      output = argv[++i];
+    }
+    else if (i + 1 < argc && strcmp(argv[i], "--threads") == 0)
+    {
+      threads = atoi(argv[++i]);
+    }
+    else
+    {
+      print_usage(argv[0]);
+      return (strcmp(argv[i], "--help") == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  if (quick)
+  {
+    min_time = std::min(min_time, 0.05);
+  }
+
+  std::vector<int> megapixels;
+  megapixels.push_back(1);
+  if (!quick)
+  {
+    megapixels.push_back(4);
+    megapixels.push_back(16);
+  }
+
+  // the database code reports on std::cout, keep that out of the JSON
+  std::streambuf* stdout_buf = std::cout.rdbuf(std::cerr.rdbuf());
+  std::ostream json_out(stdout_buf);
+
+  try
+  {
+    Benchmark bench(filter, min_time);
+
+    bench_jpeg(bench, megapixels);
+    bench_png(bench, megapixels);
+    bench_surface(bench, quick ? 1 : 4);
+    bench_tile_encode(bench);
+    bench_database(bench, quick ? 16 : 256);
+    bench_job_manager(bench, threads);
+    bench_quad_tree(bench, quick ? 10000 : 100000);
+
+    std::ostringstream config;
+    config << "{ \"quick\": " << (quick ? "true" : "false")
+           << ", \"min_time_s\": " << min_time
+           << ", \"threads\": " << threads
+           << ", \"compiler\": \"" << json_escape(__VERSION__) << "\" }";
+
+    if (output.empty())
+    {
+      bench.write_json(json_out, config.str());
+    }
+    else
+    {
+      std::ofstream out(output.c_str());
+      bench.write_json(out, config.str());
+      if (!out)
+      {
+        throw std::runtime_error(output + ": couldn't write file");
+      }
+    }
+  }
+  catch(const std::exception& err)
+  {
+    std::cerr << "Error: " << err.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* EOF */
@@ -26,14 +26,19 @@ int main(int argc, char** argv)
   if (argc == 1)
   {
     std::cout << "Usage: " << argv[0] << " FILE..." << std::endl;
-    std::cout << "Displays the size of the given JPEGs" << std::endl;
+    std::cout << "Displays the size, orientation, colour space and encoding of the given JPEGs" << std::endl;
   }
   else
   {
     for(int i = 1; i < argc; ++i)
     {
-      Size img_size = JPEG::get_size(argv[i]);
-      std::cout << img_size.width << "x" << img_size.height << "\t" << argv[i] << std::endl;
+      JPEGInfo info = JPEG::probe(argv[i]);
+      std::cout << info.size.width << "x" << info.size.height
+                << "\torientation:" << info.orientation
+                << "\tcolorspace:" << info.color_space
+                << "\tcomponents:" << info.num_components
+                << "\t" << (info.progressive ? "progressive" : "baseline")
+                << "\t" << argv[i] << std::endl;
     }
   }
   return 0;
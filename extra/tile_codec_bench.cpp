@@ -0,0 +1,137 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "database/tile_codec.hpp"
+#include "math/rect.hpp"
+#include "util/software_surface.hpp"
+#include "util/software_surface_factory.hpp"
+#include "util/url.hpp"
+
+namespace {
+
+double seconds_since(const std::chrono::steady_clock::time_point& start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void cut_into_tiles(const SoftwareSurfacePtr& surface, std::vector<SoftwareSurfacePtr>& tiles_out)
+{
+  for(int y = 0; y < surface->get_height(); y += 256)
+    for(int x = 0; x < surface->get_width(); x += 256)
+    {
+      tiles_out.push_back(surface->crop(Rect(x, y,
+                                             std::min(x + 256, surface->get_width()),
+                                             std::min(y + 256, surface->get_height()))));
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  if (argc == 1)
+  {
+    std::cout << "Usage: " << argv[0] << " FILE..." << std::endl;
+    std::cout << "Cuts the given images into 256x256 tiles and reports encode/decode speed\n"
+              << "and size for each tile codec" << std::endl;
+    return 0;
+  }
+
+  SoftwareSurfaceFactory factory;
+
+  std::vector<SoftwareSurfacePtr> tiles;
+  for(int i = 1; i < argc; ++i)
+  {
+    try
+    {
+      cut_into_tiles(factory.from_url(URL::from_filename(argv[i])), tiles);
+    }
+    catch(const std::exception& err)
+    {
+      std::cout << argv[i] << ": " << err.what() << std::endl;
+    }
+  }
+
+  if (tiles.empty())
+  {
+    std::cout << "no tiles to benchmark" << std::endl;
+    return 1;
+  }
+
+  double raw_bytes = 0;
+  for(const auto& tile : tiles)
+  {
+    raw_bytes += tile->get_pitch() * tile->get_height();
+  }
+
+  std::cout << tiles.size() << " tiles, " << raw_bytes / (1024 * 1024) << " MB of raw pixel data\n" << std::endl;
+  std::cout << std::left
+            << std::setw(10) << "codec"
+            << std::right
+            << std::setw(14) << "encode MB/s"
+            << std::setw(14) << "decode MB/s"
+            << std::setw(14) << "bytes/tile"
+            << std::setw(10) << "ratio" << std::endl;
+
+  const char* specs[] = { "jpeg:75", "jpeg:90", "png", "qoi" };
+  for(const auto& spec : specs)
+  {
+    TileCodecPtr codec = TileCodec::from_string(spec);
+
+    std::vector<BlobPtr> blobs;
+    blobs.reserve(tiles.size());
+
+    auto start = std::chrono::steady_clock::now();
+    for(const auto& tile : tiles)
+    {
+      blobs.push_back(codec->encode(tile));
+    }
+    double encode_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for(const auto& blob : blobs)
+    {
+      codec->decode(blob);
+    }
+    double decode_time = seconds_since(start);
+
+    double encoded_bytes = 0;
+    for(const auto& blob : blobs)
+    {
+      encoded_bytes += blob->size();
+    }
+
+    std::cout << std::left
+              << std::setw(10) << codec->get_name()
+              << std::right << std::fixed << std::setprecision(1)
+              << std::setw(14) << raw_bytes / (1024 * 1024) / encode_time
+              << std::setw(14) << raw_bytes / (1024 * 1024) / decode_time
+              << std::setw(14) << encoded_bytes / tiles.size()
+              << std::setw(10) << std::setprecision(3) << encoded_bytes / raw_bytes
+              << std::endl;
+  }
+
+  return 0;
+}
+
+/* EOF */
@@ -0,0 +1,219 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdlib.h>
+#include <vector>
+
+#include "database/database.hpp"
+#include "database/tile_codec.hpp"
+#include "galapix/tile.hpp"
+#include "math/rgb.hpp"
+#include "util/filesystem.hpp"
+#include "util/software_surface.hpp"
+#include "util/url.hpp"
+
+namespace {
+
+double seconds_since(const std::chrono::steady_clock::time_point& start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** A tile with some structure and some noise, so that it compresses
+    to a realistic size */
+SoftwareSurfacePtr make_tile(std::mt19937& rng)
+{
+  SoftwareSurfacePtr surface = SoftwareSurface::create(SoftwareSurface::RGB_FORMAT, Size(256, 256));
+  std::uniform_int_distribution<int> noise(0, 31);
+  for(int y = 0; y < 256; ++y)
+    for(int x = 0; x < 256; ++x)
+    {
+      surface->put_pixel(x, y, RGB(static_cast<uint8_t>(x + noise(rng)),
+                                   static_cast<uint8_t>(y + noise(rng)),
+                                   static_cast<uint8_t>((x ^ y) + noise(rng))));
+    }
+  return surface;
+}
+
+uint64_t get_disk_usage(const std::string& directory)
+{
+  std::vector<std::string> files;
+  Filesystem::open_directory_recursivly(directory, files);
+
+  uint64_t size = 0;
+  for(std::vector<std::string>::iterator i = files.begin(); i != files.end(); ++i)
+  {
+    size += Filesystem::get_size(*i);
+  }
+  return size;
+}
+
+void print_result(const std::string& what, int count, double seconds)
+{
+  std::cout << "  " << std::left << std::setw(20) << what
+            << std::right << std::fixed << std::setprecision(1)
+            << std::setw(12) << count / seconds << " ops/s"
+            << std::setw(12) << seconds * 1000.0 << " ms" << std::endl;
+}
+
+void run_benchmark(const std::string& store, const std::string& directory,
+                   int num_files, int tiles_per_file, int num_lookups,
+                   const std::vector<BlobPtr>& blobs, TileEntry::Format format)
+{
+  std::cout << store << ":" << std::endl;
+
+  std::vector<FileEntry> file_entries;
+  {
+    auto start = std::chrono::steady_clock::now();
+    Database database(directory, "jpeg", 0, store);
+    for(int i = 0; i < num_files; ++i)
+    {
+      std::ostringstream url;
+      url << "/bench/image" << i << ".jpg";
+      FileEntry file_entry = FileEntry::create_without_fileid(URL::from_filename(url.str()), 0, 0,
+                                                              256 * tiles_per_file, 256, FileEntry::JPEG_FORMAT);
+      database.get_files().store_file_entry(file_entry);
+      file_entries.push_back(file_entry);
+    }
+    database.get_files().flush_cache();
+
+    std::vector<TileEntry> tiles;
+    for(std::vector<FileEntry>::iterator i = file_entries.begin(); i != file_entries.end(); ++i)
+    {
+      for(int x = 0; x < tiles_per_file; ++x)
+      {
+        tiles.push_back(TileEntry(*i, 0, Vector2i(x, 0), blobs[tiles.size() % blobs.size()], format));
+      }
+
+      if (tiles.size() >= 256)
+      {
+        database.get_tiles().store_tiles(tiles);
+        tiles.clear();
+      }
+    }
+    database.get_tiles().store_tiles(tiles);
+    database.get_tiles().flush_cache();
+    print_result("store", num_files * tiles_per_file, seconds_since(start));
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  Database database(directory, "jpeg", 0, store);
+  std::cout << "  " << std::left << std::setw(20) << "open"
+            << std::right << std::setw(30) << seconds_since(start) * 1000.0 << " ms" << std::endl;
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> pick_file(0, num_files - 1);
+  std::uniform_int_distribution<int> pick_tile(0, tiles_per_file - 1);
+
+  start = std::chrono::steady_clock::now();
+  int hits = 0;
+  for(int i = 0; i < num_lookups; ++i)
+  {
+    hits += database.get_tiles().has_tile(file_entries[pick_file(rng)], Vector2i(pick_tile(rng), 0), 0);
+  }
+  print_result("has_tile", num_lookups, seconds_since(start));
+
+  start = std::chrono::steady_clock::now();
+  for(int i = 0; i < num_lookups; ++i)
+  {
+    int min_scale;
+    int max_scale;
+    hits += database.get_tiles().get_min_max_scale(file_entries[pick_file(rng)], min_scale, max_scale);
+  }
+  print_result("get_min_max_scale", num_lookups, seconds_since(start));
+
+  start = std::chrono::steady_clock::now();
+  for(int i = 0; i < num_lookups; ++i)
+  {
+    TileEntry tile;
+    hits += database.get_tiles().get_tile(file_entries[pick_file(rng)], 0, Vector2i(pick_tile(rng), 0), tile);
+  }
+  print_result("get_tile (+decode)", num_lookups, seconds_since(start));
+
+  start = std::chrono::steady_clock::now();
+  for(int i = 0; i < num_files; i += 2)
+  {
+    database.get_tiles().delete_tiles(file_entries[i].get_fileid());
+  }
+  database.get_tiles().flush_cache();
+  print_result("delete_tiles", (num_files + 1) / 2, seconds_since(start));
+
+  if (hits != 3 * num_lookups)
+  {
+    std::cout << "  error: " << 3 * num_lookups - hits << " lookups failed" << std::endl;
+  }
+
+  std::cout << "  " << std::left << std::setw(20) << "disk usage"
+            << std::right << std::setw(30) << get_disk_usage(directory) / (1024 * 1024) << " MB" << std::endl;
+
+  start = std::chrono::steady_clock::now();
+  database.cleanup();
+  print_result("cleanup", 1, seconds_since(start));
+
+  std::cout << "  " << std::left << std::setw(20) << "disk usage"
+            << std::right << std::setw(30) << get_disk_usage(directory) / (1024 * 1024) << " MB\n" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    std::cout << "Usage: " << argv[0] << " DIRECTORY [FILES] [TILES_PER_FILE] [LOOKUPS]" << std::endl;
+    std::cout << "Stores synthetic tiles in the sqlite and the pack tile store below DIRECTORY,\n"
+              << "which must not exist yet, and reports store, lookup, delete and cleanup speed" << std::endl;
+    return 0;
+  }
+
+  const std::string directory = argv[1];
+  const int num_files      = argc > 2 ? atoi(argv[2]) : 1000;
+  const int tiles_per_file = argc > 3 ? atoi(argv[3]) : 20;
+  const int num_lookups    = argc > 4 ? atoi(argv[4]) : 10000;
+
+  if (Filesystem::exist(directory))
+  {
+    std::cout << directory << ": already exists" << std::endl;
+    return 1;
+  }
+  Filesystem::mkdir(directory);
+
+  // tiles are encoded once up front, so that only the store is measured
+  std::mt19937 rng(23);
+  TileCodecPtr codec = TileCodec::from_string("jpeg");
+  std::vector<BlobPtr> blobs;
+  for(int i = 0; i < 16; ++i)
+  {
+    blobs.push_back(codec->encode(make_tile(rng)));
+  }
+
+  std::cout << num_files << " files, " << num_files * tiles_per_file << " tiles, "
+            << blobs.front()->size() << " bytes/tile\n" << std::endl;
+
+  run_benchmark("sqlite", directory + "/sqlite", num_files, tiles_per_file, num_lookups, blobs, codec->get_format());
+  run_benchmark("pack", directory + "/pack", num_files, tiles_per_file, num_lookups, blobs, codec->get_format());
+
+  return 0;
+}
+
+/* EOF */
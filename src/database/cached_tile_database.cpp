@@ -49,16 +49,13 @@ CachedTileDatabase::has_tile(const FileEntry& file_entry, const Vector2i& pos, i
 bool
 CachedTileDatabase::get_tile(const FileEntry& file_entry, int scale, const Vector2i& pos, TileEntry& tile_out)
 {
-  if (file_entry.get_fileid())
+  if (m_tile_cache->get_tile(file_entry, scale, pos, tile_out))
   {
-    if (m_tile_cache->get_tile(file_entry, scale, pos, tile_out))
-    {
-      return true;
-    }
-    else
-    {
-      return m_tile_database->get_tile(file_entry, scale, pos, tile_out);
-    }
+    return true;
+  }
+  else if (file_entry.get_fileid())
+  {
+    return m_tile_database->get_tile(file_entry, scale, pos, tile_out);
   }
   else
   {
@@ -76,27 +73,21 @@ CachedTileDatabase::get_tiles(const FileEntry& file_entry, std::vector<TileEntry
 bool
 CachedTileDatabase::get_min_max_scale(const FileEntry& file_entry, int& min_scale_out, int& max_scale_out)
 {
-  if (file_entry.get_fileid())
+  if (m_tile_cache->get_min_max_scale(file_entry, min_scale_out, max_scale_out))
   {
-    if (m_tile_cache->get_min_max_scale(file_entry, min_scale_out, max_scale_out))
-    {
-      int min_scale = 0;
-      int max_scale = 0;
-      if (m_tile_database->get_min_max_scale(file_entry, min_scale, max_scale))
-      {
-        min_scale_out = std::min(min_scale_out, min_scale);
-        max_scale_out = std::max(max_scale_out, max_scale);
-        return true;
-      }
-      else
-      {    
-        return true;
-      }
-    }
-    else
+    int min_scale = 0;
+    int max_scale = 0;
+    if (file_entry.get_fileid() &&
+        m_tile_database->get_min_max_scale(file_entry, min_scale, max_scale))
     {
-      return false;
+      min_scale_out = std::min(min_scale_out, min_scale);
+      max_scale_out = std::max(max_scale_out, max_scale);
     }
+    return true;
+  }
+  else if (file_entry.get_fileid())
+  {
+    return m_tile_database->get_min_max_scale(file_entry, min_scale_out, max_scale_out);
   }
   else
   {
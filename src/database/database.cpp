@@ -18,31 +18,194 @@
 
 #include "database/database.hpp"
 
-#include "database/file_tile_database.hpp"
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "database/pack_tile_database.hpp"
+#include "database/sharded_tile_database.hpp"
 #include "database/tile_database.hpp"
 #include "database/cached_tile_database.hpp"
+#include "sqlite/statement.hpp"
 #include "util/filesystem.hpp"
+#include "util/log.hpp"
 
-Database::Database(const std::string& prefix) :
+namespace {
+
+/** Number of consecutive tile shard files found in \a prefix */
+int count_tile_shards(const std::string& prefix)
+{
+  int num_shards = 0;
+  while(Filesystem::exist(ShardedTileDatabase::get_shard_filename(prefix, num_shards)))
+  {
+    num_shards += 1;
+  }
+  return num_shards;
+}
+
+/** Number of tile shards recorded in the main database, -1 for
+    databases that haven't recorded it yet */
+int get_recorded_tile_shards(SQLiteConnection& db)
+{
+  db.exec("CREATE TABLE IF NOT EXISTS meta ( key TEXT PRIMARY KEY, value TEXT );");
+
+  SQLiteStatement stmt(db, "SELECT value FROM meta WHERE key = 'tile_shards';");
+  SQLiteReader reader = stmt.execute_query();
+  if (reader.next())
+  {
+    return reader.get_int(0);
+  }
+  else
+  {
+    return -1;
+  }
+}
+
+void set_recorded_tile_shards(SQLiteConnection& db, int num_shards)
+{
+  SQLiteStatement stmt(db, "INSERT OR REPLACE INTO meta ( key, value ) VALUES ( 'tile_shards', ?1 );");
+  stmt.bind_int(1, num_shards);
+  stmt.execute();
+}
+
+} // namespace
+
+Database::Database(const std::string& prefix, const std::string& tile_codec, int tile_shards,
+                   const std::string& tile_store) :
+  m_prefix(prefix),
   m_db(),
-  m_tile_db(),
+  m_tile_store(kSQLiteTileStore),
+  m_tile_shards(0),
+  m_tile_dbs(),
+  m_tile_codec(TileCodec::from_string(tile_codec)),
   m_files(),
-  m_tiles()
+  m_tiles(),
+  m_pack_tiles(0)
 {
+  if (!tile_store.empty() && tile_store != "sqlite" && tile_store != "pack")
+  {
+    throw std::runtime_error("Database: unknown tile store: " + tile_store);
+  }
+
   Filesystem::mkdir(prefix);
 
   m_db.reset(new SQLiteConnection(prefix + "/cache3.sqlite3"));
-  m_tile_db.reset(new SQLiteConnection(prefix + "/cache3_tiles.sqlite3"));
+
+  // the store and the shard a tile lands in can't change once a
+  // database has been created, the number of shards is recorded in
+  // the main database, as a missing shard file would otherwise send
+  // tiles into the wrong shards
+  int recorded_shards = get_recorded_tile_shards(*m_db);
+  int existing_shards = count_tile_shards(prefix);
+  bool existing_sqlite = existing_shards > 0 || Filesystem::exist(prefix + "/cache3_tiles.sqlite3");
+  bool existing_pack   = Filesystem::exist(prefix + "/tiles.pack");
+
+  if (existing_pack || (!existing_sqlite && tile_store == "pack"))
+  {
+    if (tile_store == "sqlite" || tile_shards > 0)
+    {
+      log_warning << prefix << ": tiles are stored in a pack, ignoring requested tile store" << std::endl;
+    }
+    m_tile_store = kPackTileStore;
+  }
+  else
+  {
+    if (tile_store == "pack")
+    {
+      log_warning << prefix << ": tiles are stored in sqlite, ignoring requested tile store" << std::endl;
+    }
+
+    if (recorded_shards >= 0)
+    {
+      if (existing_shards != recorded_shards)
+      {
+        std::ostringstream out;
+        out << "Database: " << prefix << ": tiles are recorded to be in " << recorded_shards
+            << " shards, but " << existing_shards << " consecutive shard files were found";
+        throw std::runtime_error(out.str());
+      }
+
+      if (tile_shards > 0 && tile_shards != recorded_shards)
+      {
+        log_warning << prefix << ": tiles are in " << recorded_shards << " shards, ignoring requested "
+                    << tile_shards << " shards" << std::endl;
+      }
+      m_tile_shards = recorded_shards;
+    }
+    else if (existing_shards > 0)
+    {
+      // created before the number of shards got recorded
+      if (tile_shards != 0 && tile_shards != existing_shards)
+      {
+        log_warning << prefix << ": tiles are in " << existing_shards << " shards, ignoring requested "
+                    << tile_shards << " shards" << std::endl;
+      }
+      m_tile_shards = existing_shards;
+    }
+    else if (tile_shards > 0 && existing_sqlite)
+    {
+      log_warning << prefix << ": tiles are stored unsharded, ignoring requested "
+                  << tile_shards << " shards" << std::endl;
+    }
+    else
+    {
+      m_tile_shards = std::max(0, tile_shards);
+    }
+  }
+
+  if (m_tile_store == kSQLiteTileStore)
+  {
+    if (recorded_shards != m_tile_shards)
+    {
+      set_recorded_tile_shards(*m_db, m_tile_shards);
+    }
+
+    if (m_tile_shards == 0)
+    {
+      m_tile_dbs.push_back(std::unique_ptr<SQLiteConnection>(new SQLiteConnection(prefix + "/cache3_tiles.sqlite3")));
+    }
+    else
+    {
+      for(int i = 0; i < m_tile_shards; ++i)
+      {
+        m_tile_dbs.push_back(std::unique_ptr<SQLiteConnection>(
+                               new SQLiteConnection(ShardedTileDatabase::get_shard_filename(prefix, i))));
+      }
+    }
+  }
+
+  // with a write-ahead log the DatabaseReaders keep reading while a
+  // large transaction is being written
+  m_db->exec("PRAGMA journal_mode = WAL;");
+  for(std::vector<std::unique_ptr<SQLiteConnection> >::iterator i = m_tile_dbs.begin(); i != m_tile_dbs.end(); ++i)
+  {
+    (*i)->exec("PRAGMA journal_mode = WAL;");
+  }
 
   m_files.reset(new FileDatabase(*m_db));
 
-  if (true)
+  if (m_tile_store == kPackTileStore)
   {
-    m_tiles.reset(new TileDatabase(*m_tile_db, *m_files));
+    m_pack_tiles = new PackTileDatabase(prefix + "/tiles.pack", *m_tile_codec);
+    m_tiles.reset(new CachedTileDatabase(*this, m_pack_tiles));
+  }
+  else if (m_tile_shards > 0)
+  {
+    std::vector<SQLiteConnection*> tile_dbs;
+    for(std::vector<std::unique_ptr<SQLiteConnection> >::iterator i = m_tile_dbs.begin(); i != m_tile_dbs.end(); ++i)
+    {
+      tile_dbs.push_back(i->get());
+    }
+    m_tiles.reset(new ShardedTileDatabase(tile_dbs, *m_files, *m_tile_codec));
   }
   else
   {
-    m_tiles.reset(new CachedTileDatabase(*this, new FileTileDatabase(prefix + "/tiles")));
+    m_tiles.reset(new TileDatabase(*m_tile_dbs.front(), *m_files, *m_tile_codec));
   }
 }
 
@@ -55,8 +218,14 @@ Database::delete_file_entry(const FileId& fileid)
 {
   std::cout << "Begin Delete" << std::endl;
   m_db->exec("BEGIN;");
-  m_tiles->delete_tiles(fileid);
+  FileEntry entry = m_files->get_file_entry(fileid);
+  FileId tile_fileid = entry ? entry.get_tile_fileid() : fileid;
   m_files->delete_file_entry(fileid);
+  // tiles shared with an identical file are kept for that one
+  if (!m_files->has_tile_users(tile_fileid))
+  {
+    m_tiles->delete_tiles(tile_fileid);
+  }
   m_db->exec("END;");
   std::cout << "End Delete" << std::endl;
 }
@@ -65,6 +234,184 @@ void
 Database::cleanup()
 {
   m_db->vacuum();
+  for_each_tile_db([](SQLiteConnection& db, const std::string& name){
+      // shared blobs whose tiles have all been deleted
+      db.exec("DELETE FROM blobs WHERE hash NOT IN (SELECT blobid FROM tiles WHERE blobid IS NOT NULL);");
+      db.vacuum();
+      log_info << name << ": vacuum done" << std::endl;
+    });
+
+  if (m_pack_tiles)
+  {
+    m_tiles->flush_cache();
+    m_pack_tiles->compact();
+  }
 }
-
+
+bool
+Database::check()
+{
+  m_files->check();
+
+  std::mutex mutex;
+  bool ok = true;
+  auto check_db = [&mutex, &ok](SQLiteConnection& db, const std::string& name){
+    std::vector<std::string> errors;
+    if (!db.integrity_check(errors))
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      ok = false;
+      for(std::vector<std::string>::iterator i = errors.begin(); i != errors.end(); ++i)
+      {
+        log_error << name << ": " << *i << std::endl;
+      }
+    }
+  };
+
+  check_db(*m_db, m_prefix + "/cache3.sqlite3");
+  for_each_tile_db(check_db);
+
+  report_dedup();
+
+  if (m_pack_tiles)
+  {
+    std::vector<std::string> errors;
+    if (!m_pack_tiles->check(errors))
+    {
+      ok = false;
+      for(std::vector<std::string>::iterator i = errors.begin(); i != errors.end(); ++i)
+      {
+        log_error << *i << std::endl;
+      }
+    }
+  }
+
+  return ok;
+}
+
+void
+Database::report_dedup()
+{
+  // number of files sharing the tiles stored under a FileId
+  std::map<int64_t, int> duplicates;
+  int num_duplicates = 0;
+  {
+    SQLiteStatement stmt(*m_db, "SELECT tileid, COUNT(*) FROM files WHERE tileid IS NOT NULL GROUP BY tileid;");
+    SQLiteReader reader = stmt.execute_query();
+    while(reader.next())
+    {
+      duplicates[reader.get_int64(0)] = reader.get_int(1);
+      num_duplicates += reader.get_int(1);
+    }
+  }
+
+  std::mutex mutex;
+  int64_t duplicate_bytes  = 0;
+  int64_t referenced_bytes = 0;
+  int64_t stored_bytes     = 0;
+  for_each_tile_db([&](SQLiteConnection& db, const std::string&){
+      int64_t duplicate  = 0;
+      int64_t referenced = 0;
+      int64_t stored     = 0;
+
+      if (!duplicates.empty())
+      {
+        SQLiteStatement stmt(db,
+                             "SELECT tiles.fileid, SUM(LENGTH(COALESCE(tiles.data, blobs.data))) "
+                             "FROM tiles LEFT JOIN blobs ON blobs.hash = tiles.blobid GROUP BY tiles.fileid;");
+        SQLiteReader reader = stmt.execute_query();
+        while(reader.next())
+        {
+          std::map<int64_t, int>::const_iterator it = duplicates.find(reader.get_int64(0));
+          if (it != duplicates.end())
+          {
+            duplicate += reader.get_int64(1) * it->second;
+          }
+        }
+      }
+
+      {
+        SQLiteStatement stmt(db, "SELECT SUM(LENGTH(blobs.data)) FROM tiles JOIN blobs ON blobs.hash = tiles.blobid;");
+        SQLiteReader reader = stmt.execute_query();
+        if (reader.next())
+        {
+          referenced = reader.get_int64(0);
+        }
+      }
+
+      {
+        SQLiteStatement stmt(db, "SELECT SUM(LENGTH(data)) FROM blobs;");
+        SQLiteReader reader = stmt.execute_query();
+        if (reader.next())
+        {
+          stored = reader.get_int64(0);
+        }
+      }
+
+      std::unique_lock<std::mutex> lock(mutex);
+      duplicate_bytes  += duplicate;
+      referenced_bytes += referenced;
+      stored_bytes     += stored;
+    });
+
+  std::cout << "Deduplication:" << std::endl;
+  std::cout << "  " << num_duplicates << " files share the tiles of an identical file";
+  if (!m_tile_dbs.empty())
+  {
+    std::cout << ", saving " << duplicate_bytes / 1024 << " KB";
+  }
+  std::cout << std::endl;
+  if (!m_tile_dbs.empty())
+  {
+    std::cout << "  shared tile blobs: " << referenced_bytes / 1024 << " KB referenced, "
+              << stored_bytes / 1024 << " KB stored, saving "
+              << (referenced_bytes - stored_bytes) / 1024 << " KB" << std::endl;
+  }
+}
+
+void
+Database::for_each_tile_db(const std::function<void (SQLiteConnection&, const std::string&)>& func)
+{
+  std::vector<std::exception_ptr> errors(m_tile_dbs.size());
+  std::vector<std::thread> threads;
+  for(size_t i = 0; i < m_tile_dbs.size(); ++i)
+  {
+    std::string name;
+    if (m_tile_shards == 0)
+    {
+      name = m_prefix + "/cache3_tiles.sqlite3";
+    }
+    else
+    {
+      name = ShardedTileDatabase::get_shard_filename(m_prefix, static_cast<int>(i));
+    }
+
+    SQLiteConnection& db = *m_tile_dbs[i];
+    std::exception_ptr& error = errors[i];
+    threads.push_back(std::thread([&func, &db, &error, name]{
+          try
+          {
+            func(db, name);
+          }
+          catch(...)
+          {
+            error = std::current_exception();
+          }
+        }));
+  }
+
+  for(std::vector<std::thread>::iterator i = threads.begin(); i != threads.end(); ++i)
+  {
+    i->join();
+  }
+
+  for(std::vector<std::exception_ptr>::iterator i = errors.begin(); i != errors.end(); ++i)
+  {
+    if (*i)
+    {
+      std::rethrow_exception(*i);
+    }
+  }
+}
+
 /* EOF */
@@ -19,32 +19,81 @@
 #ifndef HEADER_GALAPIX_DATABASE_DATABASE_HPP
 #define HEADER_GALAPIX_DATABASE_DATABASE_HPP
 
+#include <functional>
 #include <memory>
+#include <vector>
 
 #include "database/tile_database_interface.hpp"
 #include "database/file_database.hpp"
 #include "database/tile_cache.hpp"
+#include "database/tile_codec.hpp"
 
+class PackTileDatabase;
+
 /** */
 class Database
 {
+public:
+  enum TileStore { kSQLiteTileStore, kPackTileStore };
+
 private:
+  std::string m_prefix;
   std::unique_ptr<SQLiteConnection> m_db;
-  std::unique_ptr<SQLiteConnection> m_tile_db;
+  TileStore m_tile_store;
+  int m_tile_shards;
+  std::vector<std::unique_ptr<SQLiteConnection> > m_tile_dbs;
+  TileCodecPtr m_tile_codec;
   std::unique_ptr<FileDatabase> m_files;
   std::unique_ptr<TileDatabaseInterface> m_tiles;
 
+  /** Points into m_tiles when the tiles are stored in a pack */
+  PackTileDatabase* m_pack_tiles;
+
 public:
-  Database(const std::string& prefix);
+  /** @param tile_codec codec used for newly stored tiles, see
+      TileCodec::from_string()
+      @param tile_shards number of files the tiles are spread over
+      when creating a new database, 0 keeps them all in one file
+      @param tile_store "sqlite" or "pack" for a new database, empty
+      for the default, see PackTileDatabase
+
+      An existing database is always opened with the layout it was
+      created with. */
+  Database(const std::string& prefix, const std::string& tile_codec = "jpeg", int tile_shards = 0,
+           const std::string& tile_store = std::string());
   ~Database();
 
+  /** The directory holding the database files, DatabaseReader opens
+      its own connections to them */
+  const std::string& get_prefix() const { return m_prefix; }
+
+  TileStore get_tile_store() const { return m_tile_store; }
+
+  /** Number of tile shards, 0 if the tiles are in a single file */
+  int get_tile_shards() const { return m_tile_shards; }
+
   FileDatabase& get_files() { return *m_files; }
   TileDatabaseInterface& get_tiles() { return *m_tiles; }
+  const TileCodec& get_tile_codec() const { return *m_tile_codec; }
 
   void delete_file_entry(const FileId& fileid);
 
+  /** VACUUM the database files, the tile shards are done in
+      parallel, a tile pack gets compacted */
   void cleanup();
 
+  /** Check the consistency of the database, returns false if
+      problems were found */
+  bool check();
+
+private:
+  /** Print the space saved by sharing the tiles of identical files
+      and by storing identical tile blobs once */
+  void report_dedup();
+
+  /** Run \a func on every tile connection, each in a thread of its own */
+  void for_each_tile_db(const std::function<void (SQLiteConnection&, const std::string&)>& func);
+
 private:
   Database (const Database&);
   Database& operator= (const Database&);
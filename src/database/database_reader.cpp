@@ -0,0 +1,106 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "database/database_reader.hpp"
+
+#include "database/database.hpp"
+#include "database/sharded_tile_database.hpp"
+
+DatabaseReader::DatabaseReader(const Database& database) :
+  m_db(database.get_prefix() + "/cache3.sqlite3"),
+  m_file_entry_get_all(m_db),
+  m_file_entry_get_by_pattern(m_db),
+  m_file_entry_get_by_url(m_db),
+  m_num_tile_shards(database.get_tile_shards()),
+  m_tile_shards()
+{
+  const std::string& prefix = database.get_prefix();
+
+  if (database.get_tile_store() != Database::kSQLiteTileStore)
+  {
+    // PackTileDatabase isn't safe to read from other threads
+  }
+  else if (m_num_tile_shards == 0)
+  {
+    m_tile_shards.push_back(std::unique_ptr<TileShard>(new TileShard(prefix + "/cache3_tiles.sqlite3")));
+  }
+  else
+  {
+    for(int i = 0; i < m_num_tile_shards; ++i)
+    {
+      m_tile_shards.push_back(std::unique_ptr<TileShard>(
+                                new TileShard(ShardedTileDatabase::get_shard_filename(prefix, i))));
+    }
+  }
+}
+
+DatabaseReader::~DatabaseReader()
+{
+}
+
+FileEntry
+DatabaseReader::get_file_entry(const URL& url)
+{
+  return m_file_entry_get_by_url(url);
+}
+
+void
+DatabaseReader::get_file_entries(std::vector<FileEntry>& entries_out)
+{
+  m_file_entry_get_all(entries_out);
+}
+
+void
+DatabaseReader::get_file_entries(const std::string& pattern, std::vector<FileEntry>& entries_out)
+{
+  m_file_entry_get_by_pattern(pattern, entries_out);
+}
+
+bool
+DatabaseReader::has_tile(const FileEntry& file_entry, const Vector2i& pos, int scale)
+{
+  if (m_tile_shards.empty())
+    return false;
+
+  return get_tile_shard(file_entry).tile_entry_has(file_entry, pos, scale);
+}
+
+bool
+DatabaseReader::get_tile(const FileEntry& file_entry, int scale, const Vector2i& pos, TileEntry& tile_out)
+{
+  if (m_tile_shards.empty())
+    return false;
+
+  return get_tile_shard(file_entry).tile_entry_get_by_file_entry(file_entry, scale, pos, tile_out);
+}
+
+DatabaseReader::TileShard&
+DatabaseReader::get_tile_shard(const FileEntry& file_entry)
+{
+  if (m_num_tile_shards == 0 || !file_entry.get_tile_fileid())
+  {
+    // without a FileId the statements return nothing anyway
+    return *m_tile_shards.front();
+  }
+  else
+  {
+    return *m_tile_shards[ShardedTileDatabase::get_shard(file_entry.get_tile_fileid(), m_num_tile_shards)];
+  }
+}
+
+/* EOF */
@@ -0,0 +1,93 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_DATABASE_DATABASE_READER_HPP
+#define HEADER_GALAPIX_DATABASE_DATABASE_READER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sqlite/connection.hpp"
+#include "sqlite/statement.hpp"
+#include "math/vector2i.hpp"
+#include "database/file_entry.hpp"
+#include "database/tile_entry.hpp"
+#include "database/file_entry_get_all_statement.hpp"
+#include "database/file_entry_get_by_pattern_statement.hpp"
+#include "database/file_entry_get_by_url_statement.hpp"
+#include "database/tile_entry_get_by_file_entry_statement.hpp"
+#include "database/tile_entry_has_statement.hpp"
+
+class Database;
+
+/** Read-only access to the database through connections of its own,
+    so that lookups can run in other threads than the one owning the
+    Database. Entries still waiting in the write cache of the Database
+    aren't visible here, a miss has to be checked there as well. Tiles
+    are only read from SQLite, with a tile pack every tile lookup is a
+    miss. */
+class DatabaseReader
+{
+private:
+  struct TileShard
+  {
+    SQLiteConnection                 db;
+    TileEntryGetByFileEntryStatement tile_entry_get_by_file_entry;
+    TileEntryHasStatement            tile_entry_has;
+
+    TileShard(const std::string& filename) :
+      db(filename),
+      tile_entry_get_by_file_entry(db),
+      tile_entry_has(db)
+    {}
+  };
+
+private:
+  SQLiteConnection m_db;
+
+  FileEntryGetAllStatement         m_file_entry_get_all;
+  FileEntryGetByPatternStatement   m_file_entry_get_by_pattern;
+  FileEntryGetByUrlStatement       m_file_entry_get_by_url;
+
+  int m_num_tile_shards;
+  std::vector<std::unique_ptr<TileShard> > m_tile_shards;
+
+public:
+  /** Opens the same files as \a database */
+  DatabaseReader(const Database& database);
+  ~DatabaseReader();
+
+  FileEntry get_file_entry(const URL& url);
+  void get_file_entries(std::vector<FileEntry>& entries_out);
+  void get_file_entries(const std::string& pattern, std::vector<FileEntry>& entries_out);
+
+  bool has_tile(const FileEntry& file_entry, const Vector2i& pos, int scale);
+  bool get_tile(const FileEntry& file_entry, int scale, const Vector2i& pos, TileEntry& tile_out);
+
+private:
+  TileShard& get_tile_shard(const FileEntry& file_entry);
+
+private:
+  DatabaseReader(const DatabaseReader&);
+  DatabaseReader& operator=(const DatabaseReader&);
+};
+
+#endif
+
+/* EOF */
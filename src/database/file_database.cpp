@@ -19,22 +19,48 @@
 #include "database/file_database.hpp"
 
 #include <iostream>
+#include <map>
 
 #include "database/file_entry.hpp"
 #include "database/database.hpp"
 #include "util/software_surface.hpp"
 #include "util/software_surface_factory.hpp"
 #include "util/filesystem.hpp"
+#include "util/log.hpp"
 
+namespace {
+
+/** Batches with fewer urls in a directory than this look them up
+    one by one, as the prefix query for the directory also returns
+    everything below it */
+const size_t kMinPrefixQuery = 32;
+
+std::string get_directory(const std::string& url)
+{
+  std::string::size_type slash = url.rfind('/');
+  if (slash == std::string::npos)
+  {
+    return std::string();
+  }
+  else
+  {
+    return url.substr(0, slash + 1);
+  }
+}
+
+} // namespace
+
 FileDatabase::FileDatabase(SQLiteConnection& db) :
   m_db(db),
   m_file_table(m_db),
   m_file_entry_get_all(m_db),
   m_file_entry_get_by_fileid(m_db),
   m_file_entry_get_by_pattern(m_db),
+  m_file_entry_get_by_prefix(m_db),
   m_file_entry_get_by_url(m_db),
   m_file_entry_store(m_db),
   m_file_entry_delete(m_db),
+  m_file_entry_has_tile_users(m_db),
   m_file_entry_cache()
 {
 }
@@ -62,8 +88,19 @@ FileDatabase::store_file_entry(const URL& url, const Size& size, int format)
 }
 
 FileEntry
-FileDatabase::store_file_entry_without_cache(const FileEntry& entry)
+FileDatabase::store_file_entry_without_cache(const FileEntry& entry_)
 {
+  // FileEntry shares its data between copies, the TileEntrys waiting
+  // for this entry see the fileids set here
+  FileEntry entry = entry_;
+
+  // the file with the same content was looked up before the entry
+  // got here, see TileOwnerLookup, it might have been deleted since
+  if (entry.get_tile_fileid() && !m_file_entry_has_tile_users(entry.get_tile_fileid()))
+  {
+    entry.set_tile_fileid(FileId());
+  }
+
   m_file_entry_store(entry);
   return entry;
 }
@@ -74,12 +111,59 @@ FileDatabase::get_file_entry(const URL& url)
   return m_file_entry_get_by_url(url);
 }
 
+FileEntry
+FileDatabase::get_file_entry(const FileId& fileid)
+{
+  return m_file_entry_get_by_fileid(fileid);
+}
+
 void
 FileDatabase::get_file_entries(const std::string& pattern, std::vector<FileEntry>& entries_out)
 {
   m_file_entry_get_by_pattern(pattern, entries_out);
 }
 
+void
+FileDatabase::get_file_entries_by_prefix(const std::string& prefix, std::vector<FileEntry>& entries_out)
+{
+  m_file_entry_get_by_prefix(prefix, entries_out);
+}
+
+void
+FileDatabase::get_file_entries(const std::vector<URL>& urls, std::vector<FileEntry>& entries_out)
+{
+  // entries waiting in the cache aren't visible to the query otherwise
+  flush_cache();
+
+  // a single query for the common prefix would load the whole table
+  // when the urls come from unrelated directories, so the urls are
+  // grouped by directory instead
+  std::map<std::string, std::vector<URL> > directories;
+  for(std::vector<URL>::const_iterator i = urls.begin(); i != urls.end(); ++i)
+  {
+    directories[get_directory(i->str())].push_back(*i);
+  }
+
+  for(std::map<std::string, std::vector<URL> >::const_iterator dir = directories.begin(); dir != directories.end(); ++dir)
+  {
+    if (dir->second.size() >= kMinPrefixQuery && !dir->first.empty())
+    {
+      m_file_entry_get_by_prefix(dir->first, entries_out);
+    }
+    else
+    {
+      for(std::vector<URL>::const_iterator i = dir->second.begin(); i != dir->second.end(); ++i)
+      {
+        FileEntry entry = m_file_entry_get_by_url(*i);
+        if (entry)
+        {
+          entries_out.push_back(entry);
+        }
+      }
+    }
+  }
+}
+
 void
 FileDatabase::get_file_entries(std::vector<FileEntry>& entries_out)
 {
@@ -119,6 +203,12 @@ FileDatabase::delete_file_entry(const FileId& fileid)
   m_file_entry_delete(fileid);
 }
 
+bool
+FileDatabase::has_tile_users(const FileId& tile_fileid)
+{
+  return m_file_entry_has_tile_users(tile_fileid);
+}
+
 void
 FileDatabase::flush_cache()
 {
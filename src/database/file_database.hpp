@@ -29,7 +29,9 @@
 #include "database/file_entry_get_by_file_id_statement.hpp"
 #include "database/file_entry_store_statement.hpp"
 #include "database/file_entry_get_by_pattern_statement.hpp"
+#include "database/file_entry_get_by_prefix_statement.hpp"
 #include "database/file_entry_delete_statement.hpp"
+#include "database/file_entry_has_tile_users_statement.hpp"
 
 class URL;
 class FileEntry;
@@ -53,9 +55,11 @@ private:
   FileEntryGetAllStatement       m_file_entry_get_all;
   FileEntryGetByFileIdStatement  m_file_entry_get_by_fileid;
   FileEntryGetByPatternStatement m_file_entry_get_by_pattern;
+  FileEntryGetByPrefixStatement  m_file_entry_get_by_prefix;
   FileEntryGetByUrlStatement     m_file_entry_get_by_url;
   FileEntryStoreStatement        m_file_entry_store;
   FileEntryDeleteStatement       m_file_entry_delete;
+  FileEntryHasTileUsersStatement m_file_entry_has_tile_users;
 
   std::vector<FileEntry> m_file_entry_cache;
 
@@ -76,15 +80,30 @@ public:
       @return true if lookup was successful, false otherwise, in which case entry stays untouched
   */
   FileEntry get_file_entry(const URL& url);
+  FileEntry get_file_entry(const FileId& fileid);
   void get_file_entries(std::vector<FileEntry>& entries_out);
   void get_file_entries(const std::string& pattern, std::vector<FileEntry>& entries_out);
 
+  /** Fetch all FileEntrys whose url starts with \a prefix in a single query */
+  void get_file_entries_by_prefix(const std::string& prefix, std::vector<FileEntry>& entries_out);
+
+  /** Fetch the FileEntrys for \a urls, with one query per directory
+      that holds many of them and single lookups for the rest. The
+      result can contain entries below those directories that weren't
+      asked for. */
+  void get_file_entries(const std::vector<URL>& urls, std::vector<FileEntry>& entries_out);
+
   FileEntry store_file_entry(const FileEntry& entry);
   FileEntry store_file_entry(const URL& url, const Size& size, int format);
   FileEntry store_file_entry_without_cache(const FileEntry& entry);
 
   void delete_file_entry(const FileId& fileid);
 
+  /** Returns true if a file still has its tiles stored under
+      \a tile_fileid, which is the case for the file itself and any
+      file found to have the same content */
+  bool has_tile_users(const FileId& tile_fileid);
+
   void check();
   void flush_cache();
 
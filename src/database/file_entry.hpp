@@ -21,6 +21,7 @@
 
 #include <memory>
 #include <assert.h>
+#include <stdint.h>
 
 #include "database/file_id.hpp"
 #include "math/math.hpp"
@@ -46,6 +47,13 @@ public:
 
   int thumbnail_size;
 
+  /** xxHash64 of the file content, 0 if unknown */
+  uint64_t hash;
+
+  /** FileId under which the tiles of this file are stored, files
+      with identical content share the tiles of the first one */
+  FileId tile_fileid;
+
   FileEntryImpl() :
     fileid(),
     url(),
@@ -53,7 +61,9 @@ public:
     format(),
     file_size(),
     file_mtime(),
-    thumbnail_size()
+    thumbnail_size(),
+    hash(),
+    tile_fileid()
   {}
 };
 
@@ -66,7 +76,9 @@ private:
             int mtime,
             int width,
             int height,
-            int format) :
+            int format,
+            uint64_t hash,
+            const FileId& tile_fileid) :
     impl(new FileEntryImpl())
   {
     impl->fileid     = fileid;
@@ -75,6 +87,8 @@ private:
     impl->file_size  = size;
     impl->format     = format;
     impl->file_mtime = mtime;
+    impl->hash       = hash;
+    impl->tile_fileid = tile_fileid;
 
     int s = Math::max(width, height);
     impl->thumbnail_size = 0;
@@ -105,7 +119,7 @@ public:
                                          int height,
                                          int format)
   {
-    return FileEntry(FileId(), url, size, mtime, width, height, format);
+    return FileEntry(FileId(), url, size, mtime, width, height, format, 0, FileId());
   }
 
   static FileEntry create(const FileId& fileid, 
@@ -114,9 +128,11 @@ public:
                           int mtime,
                           int width,
                           int height,
-                          int format)
+                          int format,
+                          uint64_t hash = 0,
+                          const FileId& tile_fileid = FileId())
   {
-    return FileEntry(fileid, url, size, mtime, width, height, format);
+    return FileEntry(fileid, url, size, mtime, width, height, format, hash, tile_fileid);
   }
 
   void        set_fileid(const FileId& fileid) { impl->fileid = fileid; }
@@ -132,6 +148,15 @@ public:
 
   int get_thumbnail_scale() const { return impl->thumbnail_size; }
 
+  void     set_hash(uint64_t hash) { impl->hash = hash; }
+  uint64_t get_hash() const { return impl->hash; }
+
+  /** The FileId the tiles of this file are stored under, which is
+      the FileId of another file when both have identical content */
+  void   set_tile_fileid(const FileId& fileid) { impl->tile_fileid = fileid; }
+  FileId get_tile_fileid() const { return impl->tile_fileid ? impl->tile_fileid : impl->fileid; }
+  bool   is_duplicate() const { return impl->tile_fileid && !(impl->tile_fileid == impl->fileid); }
+
   operator void*() const { return impl.get(); }
   bool operator==(const FileEntry& rhs) const
   {
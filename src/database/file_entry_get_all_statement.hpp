@@ -44,7 +44,9 @@ public:
                                           reader.get_int(3),
                                           reader.get_int(4),  // width
                                           reader.get_int(5), // height
-                                          reader.get_int(6));
+                                          reader.get_int(6),
+                                          reader.get_int64(7), // hash
+                                          FileId(reader.get_int64(8))); // tile fileid
       entries_out.push_back(entry);
     }
   }
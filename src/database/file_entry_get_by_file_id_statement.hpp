@@ -29,6 +29,29 @@ public:
     m_stmt(db, "SELECT * FROM files WHERE fileid = ?1;")
   {}
 
+  FileEntry operator()(const FileId& fileid)
+  {
+    m_stmt.bind_int64(1, fileid.get_id());
+    SQLiteReader reader = m_stmt.execute_query();
+
+    if (reader.next())
+    {
+      return FileEntry::create(FileId(reader.get_int64(0)),  // fileid
+                               URL::from_string(reader.get_text(1)),  // url
+                               reader.get_int(2), // file size
+                               reader.get_int(3), // mtime
+                               reader.get_int(4), // width
+                               reader.get_int(5), // height
+                               reader.get_int(6),
+                               reader.get_int64(7), // hash
+                               FileId(reader.get_int64(8))); // tile fileid
+    }
+    else
+    {
+      return FileEntry();
+    }
+  }
+
 private:
   FileEntryGetByFileIdStatement(const FileEntryGetByFileIdStatement&);
   FileEntryGetByFileIdStatement& operator=(const FileEntryGetByFileIdStatement&);
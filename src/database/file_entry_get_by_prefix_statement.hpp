@@ -0,0 +1,88 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_DATABASE_FILE_ENTRY_GET_BY_PREFIX_STATEMENT_HPP
+#define HEADER_GALAPIX_DATABASE_FILE_ENTRY_GET_BY_PREFIX_STATEMENT_HPP
+
+#include "database/file_entry.hpp"
+
+/** Fetches all FileEntrys whose url starts with a given prefix. Unlike
+    GLOB this is done as a range query, so it can use the url index
+    and doesn't need escaping of wildcard characters in the prefix */
+class FileEntryGetByPrefixStatement
+{
+private:
+  SQLiteStatement m_stmt;
+
+public:
+  FileEntryGetByPrefixStatement(SQLiteConnection& db) :
+    m_stmt(db, "SELECT * FROM files WHERE url >= ?1 AND url < ?2;")
+  {}
+
+  void operator()(const std::string& prefix, std::vector<FileEntry>& entries_out)
+  {
+    m_stmt.bind_text(1, prefix);
+    m_stmt.bind_text(2, get_upper_bound(prefix));
+    SQLiteReader reader = m_stmt.execute_query();
+
+    while (reader.next())  
+    {
+      FileEntry entry = FileEntry::create(FileId(reader.get_int(0)),  // fileid
+                                          URL::from_string(reader.get_text(1)),  // url
+                                          reader.get_int(2), // file size
+                                          reader.get_int(3), // mtime
+                                          reader.get_int(4), // width
+                                          reader.get_int(5), // height
+                                          reader.get_int(6),
+                                          reader.get_int64(7), // hash
+                                          FileId(reader.get_int64(8))); // tile fileid
+      entries_out.push_back(entry);
+    } 
+  }
+
+private:
+  /** Returns the smallest string that is larger than all strings
+      starting with \a prefix */
+  static std::string get_upper_bound(std::string prefix)
+  {
+    while(!prefix.empty() && static_cast<unsigned char>(prefix[prefix.size()-1]) == 0xff)
+    {
+      prefix.erase(prefix.size()-1);
+    }
+
+    if (prefix.empty())
+    {
+      // everything matches, no text sorts after a lone 0xff byte in
+      // a valid UTF-8 database
+      return std::string(1, '\xff');
+    }
+    else
+    {
+      prefix[prefix.size()-1] = static_cast<char>(static_cast<unsigned char>(prefix[prefix.size()-1]) + 1);
+      return prefix;
+    }
+  }
+
+private:
+  FileEntryGetByPrefixStatement(const FileEntryGetByPrefixStatement&);
+  FileEntryGetByPrefixStatement& operator=(const FileEntryGetByPrefixStatement&);
+};
+
+#endif
+
+/* EOF */
@@ -42,7 +42,9 @@ public:
                                reader.get_int(3), // mtime
                                reader.get_int(4), // width
                                reader.get_int(5), // height
-                               reader.get_int(6));
+                               reader.get_int(6),
+                               reader.get_int64(7), // hash
+                               FileId(reader.get_int64(8))); // tile fileid
     }
     else
     {
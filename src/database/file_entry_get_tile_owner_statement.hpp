@@ -0,0 +1,61 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_DATABASE_FILE_ENTRY_GET_TILE_OWNER_STATEMENT_HPP
+#define HEADER_GALAPIX_DATABASE_FILE_ENTRY_GET_TILE_OWNER_STATEMENT_HPP
+
+class FileEntryGetTileOwnerStatement
+{
+private:
+  SQLiteStatement m_stmt;
+
+public:
+  FileEntryGetTileOwnerStatement(SQLiteConnection& db) :
+    m_stmt(db,
+           "SELECT COALESCE(tileid, fileid), url FROM files "
+           "WHERE hash = ?1 AND width = ?2 AND height = ?3 AND size = ?4 AND url != ?5;")
+  {}
+
+  /** Collects the files that match \a file_entry in hash, size and
+      image size, along with the FileId their tiles are stored under.
+      The caller still has to compare the content, as the hash alone
+      doesn't rule out a collision. */
+  void operator()(const FileEntry& file_entry, std::vector<std::pair<FileId, URL> >& candidates_out)
+  {
+    m_stmt.bind_int64(1, static_cast<int64_t>(file_entry.get_hash()));
+    m_stmt.bind_int  (2, file_entry.get_width());
+    m_stmt.bind_int  (3, file_entry.get_height());
+    m_stmt.bind_int  (4, file_entry.get_size());
+    m_stmt.bind_text (5, file_entry.get_url().str());
+
+    SQLiteReader reader = m_stmt.execute_query();
+    while (reader.next())
+    {
+      candidates_out.push_back(std::make_pair(FileId(reader.get_int64(0)),
+                                              URL::from_string(reader.get_text(1))));
+    }
+  }
+
+private:
+  FileEntryGetTileOwnerStatement(const FileEntryGetTileOwnerStatement&);
+  FileEntryGetTileOwnerStatement& operator=(const FileEntryGetTileOwnerStatement&);
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,49 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_DATABASE_FILE_ENTRY_HAS_TILE_USERS_STATEMENT_HPP
+#define HEADER_GALAPIX_DATABASE_FILE_ENTRY_HAS_TILE_USERS_STATEMENT_HPP
+
+class FileEntryHasTileUsersStatement
+{
+private:
+  SQLiteStatement m_stmt;
+
+public:
+  FileEntryHasTileUsersStatement(SQLiteConnection& db) :
+    m_stmt(db, "SELECT fileid FROM files WHERE fileid = ?1 OR tileid = ?1 LIMIT 1;")
+  {}
+
+  /** Returns true if any file still has its tiles stored under
+      \a tile_fileid */
+  bool operator()(const FileId& tile_fileid)
+  {
+    m_stmt.bind_int64(1, tile_fileid.get_id());
+
+    SQLiteReader reader = m_stmt.execute_query();
+    return reader.next();
+  }
+
+private:
+  FileEntryHasTileUsersStatement(const FileEntryHasTileUsersStatement&);
+  FileEntryHasTileUsersStatement& operator=(const FileEntryHasTileUsersStatement&);
+};
+
+#endif
+
+/* EOF */
@@ -31,7 +31,7 @@ private:
 public:
   FileEntryStoreStatement(SQLiteConnection& db) :
     m_db(db),
-    m_stmt(db, "INSERT OR REPLACE INTO files (url, size, mtime, width, height) VALUES (?1, ?2, ?3, ?4, ?5);")
+    m_stmt(db, "INSERT OR REPLACE INTO files (url, size, mtime, width, height, hash, tileid) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7);")
   {}
 
   void operator()(FileEntry file_entry)
@@ -47,6 +47,22 @@ public:
     m_stmt.bind_int (3, file_entry.get_mtime());
     m_stmt.bind_int (4, file_entry.get_width());
     m_stmt.bind_int (5, file_entry.get_height());
+    if (file_entry.get_hash())
+    {
+      m_stmt.bind_int64(6, static_cast<int64_t>(file_entry.get_hash()));
+    }
+    else
+    {
+      m_stmt.bind_null(6);
+    }
+    if (file_entry.get_tile_fileid())
+    {
+      m_stmt.bind_int64(7, file_entry.get_tile_fileid().get_id());
+    }
+    else
+    {
+      m_stmt.bind_null(7);
+    }
 
     m_stmt.execute();
   
@@ -36,10 +36,36 @@ public:
            
               "width     INTEGER, "
               "height    INTEGER, "
-              "format    INTEGER"   // format of the data (0: JPEG, 1: PNG)
+              "format    INTEGER, "   // format of the data (0: JPEG, 1: PNG)
+              "hash      INTEGER, "   // xxHash64 of the file content
+              "tileid    INTEGER"     // fileid the tiles are stored under, NULL for the own one
               ");");
 
+    // databases from before content hashing lack the last two columns
+    if (!has_column("hash"))
+    {
+      m_db.exec("ALTER TABLE files ADD COLUMN hash INTEGER;");
+      m_db.exec("ALTER TABLE files ADD COLUMN tileid INTEGER;");
+    }
+
     m_db.exec("CREATE UNIQUE INDEX IF NOT EXISTS files_index ON files ( url );");
+    m_db.exec("CREATE INDEX IF NOT EXISTS files_hash_index ON files ( hash );");
+    m_db.exec("CREATE INDEX IF NOT EXISTS files_tileid_index ON files ( tileid );");
+  }
+
+private:
+  bool has_column(const std::string& name)
+  {
+    SQLiteStatement stmt(m_db, "PRAGMA table_info(files);");
+    SQLiteReader reader = stmt.execute_query();
+    while(reader.next())
+    {
+      if (reader.get_text(1) == name)
+      {
+        return true;
+      }
+    }
+    return false;
   }
 
 private:
@@ -0,0 +1,861 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "database/pack_tile_database.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "database/tile_codec.hpp"
+#include "galapix/tile.hpp"
+#include "util/filesystem.hpp"
+#include "util/log.hpp"
+#include "util/mapped_file.hpp"
+#include "util/raise_exception.hpp"
+
+namespace {
+
+/** Segments are started anew once they reach this size, compact()
+    works on whole segments, so they shouldn't be too big either */
+const uint64_t kMaxSegmentSize = 256 * 1024 * 1024;
+
+/** Number of entries that are allowed to pile up in memory before
+    the index is rewritten, it is also the most that has to be
+    replayed on startup */
+const size_t kMaxNewEntries = 64 * 1024;
+
+/** A record with this scale deletes all tiles of its fileid */
+const int kDeleteScale = -1;
+
+const uint32_t kRecordMagic = 0x4b505447; // "GTPK"
+const char kIndexMagic[8] = { 'G', 'P', 'X', 'I', 'N', 'D', 'E', 'X' };
+const uint32_t kIndexVersion = 1;
+
+/** Header in front of every tile in a segment, in host byte order */
+struct RecordHeader
+{
+  uint32_t magic;
+  uint32_t length;
+  int64_t  fileid;
+  int32_t  scale;
+  int32_t  x;
+  int32_t  y;
+  int32_t  format;
+};
+
+struct IndexHeader
+{
+  char     magic[8];
+  uint32_t version;
+  /** Position in the segments up to which the index is complete */
+  uint32_t tail_segment;
+  uint64_t tail_offset;
+  uint64_t num_entries;
+};
+
+/** Returns false if the file ended before \a len bytes could be read */
+bool pread_all(int fd, void* buf, size_t len, uint64_t offset)
+{
+  uint8_t* ptr = static_cast<uint8_t*>(buf);
+  while(len > 0)
+  {
+    ssize_t ret = pread(fd, ptr, len, static_cast<off_t>(offset));
+    if (ret < 0)
+    {
+      if (errno == EINTR) continue;
+      raise_exception(std::runtime_error, strerror(errno));
+    }
+    else if (ret == 0)
+    {
+      return false;
+    }
+    ptr += ret;
+    len -= ret;
+    offset += ret;
+  }
+  return true;
+}
+
+void pwrite_all(int fd, const void* buf, size_t len, uint64_t offset)
+{
+  const uint8_t* ptr = static_cast<const uint8_t*>(buf);
+  while(len > 0)
+  {
+    ssize_t ret = pwrite(fd, ptr, len, static_cast<off_t>(offset));
+    if (ret < 0)
+    {
+      if (errno == EINTR) continue;
+      raise_exception(std::runtime_error, strerror(errno));
+    }
+    ptr += ret;
+    len -= ret;
+    offset += ret;
+  }
+}
+
+} // namespace
+
+PackTileDatabase::PackTileDatabase(const std::string& directory, const TileCodec& codec) :
+  m_directory(directory),
+  m_codec(codec),
+  m_index_file(),
+  m_index(0),
+  m_index_size(0),
+  m_new_entries(),
+  m_deleted(),
+  m_segments(),
+  m_unsynced_segments(),
+  m_tail_segment(0),
+  m_tail_offset(0),
+  m_buffer()
+{
+  static_assert(sizeof(RecordHeader) == 32, "RecordHeader must not contain padding");
+  static_assert(sizeof(IndexHeader) == 32, "IndexHeader must not contain padding");
+  static_assert(sizeof(IndexEntry) == 40, "IndexEntry must not contain padding");
+
+  Filesystem::mkdir(m_directory);
+
+  open_segments();
+  load_index();
+  replay();
+}
+
+PackTileDatabase::~PackTileDatabase()
+{
+  try
+  {
+    if (!m_new_entries.empty() || !m_deleted.empty())
+    {
+      write_index();
+    }
+  }
+  catch(const std::exception& err)
+  {
+    log_error << m_directory << ": " << err.what() << std::endl;
+  }
+
+  for(std::map<uint32_t, int>::iterator i = m_segments.begin(); i != m_segments.end(); ++i)
+  {
+    close(i->second);
+  }
+}
+
+PackTileDatabase::Key
+PackTileDatabase::get_key(const IndexEntry& entry)
+{
+  Key key = { entry.fileid, entry.scale, entry.x, entry.y };
+  return key;
+}
+
+PackTileDatabase::Location
+PackTileDatabase::get_location(const IndexEntry& entry)
+{
+  Location location = { entry.segment, entry.length, entry.offset, static_cast<TileEntry::Format>(entry.format) };
+  return location;
+}
+
+void
+PackTileDatabase::open_segments()
+{
+  std::vector<std::string> files = Filesystem::open_directory(m_directory);
+  for(std::vector<std::string>::const_iterator i = files.begin(); i != files.end(); ++i)
+  {
+    std::string basename = i->substr(i->rfind('/') + 1);
+    unsigned int segment;
+    char trailing;
+    if (sscanf(basename.c_str(), "segment-%u.pack%c", &segment, &trailing) == 1)
+    {
+      int fd = open(i->c_str(), O_RDWR | O_CLOEXEC);
+      if (fd < 0)
+      {
+        raise_exception(std::runtime_error, *i << ": " << strerror(errno));
+      }
+      m_segments[segment] = fd;
+    }
+  }
+
+  if (m_segments.empty())
+  {
+    start_segment(0);
+  }
+
+  // without an index everything is replayed from the start
+  m_tail_segment = m_segments.begin()->first;
+  m_tail_offset  = 0;
+}
+
+void
+PackTileDatabase::load_index()
+{
+  std::string filename = m_directory + "/index";
+  if (!Filesystem::exist(filename))
+  {
+    return;
+  }
+
+  std::unique_ptr<MappedFile> file(new MappedFile(filename, MappedFile::kRandom));
+
+  const IndexHeader* header = reinterpret_cast<const IndexHeader*>(file->get_data());
+  if (file->size() < sizeof(IndexHeader) ||
+      memcmp(header->magic, kIndexMagic, sizeof(kIndexMagic)) != 0 ||
+      header->version != kIndexVersion ||
+      file->size() != sizeof(IndexHeader) + header->num_entries * sizeof(IndexEntry))
+  {
+    log_warning << filename << ": index is broken, rebuilding it from the segments" << std::endl;
+  }
+  else
+  {
+    m_index = reinterpret_cast<const IndexEntry*>(file->get_data() + sizeof(IndexHeader));
+    m_index_size = static_cast<size_t>(header->num_entries);
+    m_tail_segment = header->tail_segment;
+    m_tail_offset  = header->tail_offset;
+    m_index_file = std::move(file);
+  }
+}
+
+void
+PackTileDatabase::replay()
+{
+  const uint32_t first_segment = m_tail_segment;
+  const uint64_t first_offset  = m_tail_offset;
+
+  for(std::map<uint32_t, int>::iterator i = m_segments.lower_bound(first_segment); i != m_segments.end(); ++i)
+  {
+    std::map<uint32_t, int>::iterator next = i;
+    ++next;
+    const bool last = (next == m_segments.end());
+
+    uint64_t offset = (i->first == first_segment) ? first_offset : 0;
+    if (!replay_segment(i->first, offset) && !last)
+    {
+      log_warning << get_segment_filename(i->first) << ": damaged record, skipping the rest of the segment" << std::endl;
+    }
+  }
+
+  m_tail_segment = m_segments.rbegin()->first;
+  m_tail_offset  = get_segment_size(m_tail_segment);
+
+  if (!m_new_entries.empty() || !m_deleted.empty())
+  {
+    log_info << m_directory << ": replayed " << m_new_entries.size() << " tiles and "
+             << m_deleted.size() << " deletions not yet in the index" << std::endl;
+  }
+}
+
+bool
+PackTileDatabase::replay_segment(uint32_t segment, uint64_t offset)
+{
+  const int fd = get_segment_fd(segment);
+  const uint64_t size = get_segment_size(segment);
+
+  while(offset + sizeof(RecordHeader) <= size)
+  {
+    RecordHeader header;
+    if (!pread_all(fd, &header, sizeof(header), offset) ||
+        header.magic != kRecordMagic ||
+        offset + sizeof(RecordHeader) + header.length > size)
+    {
+      break;
+    }
+
+    if (header.scale == kDeleteScale)
+    {
+      Key first = { header.fileid, std::numeric_limits<int>::min(), 0, 0 };
+      Key last  = { header.fileid + 1, std::numeric_limits<int>::min(), 0, 0 };
+      m_new_entries.erase(m_new_entries.lower_bound(first), m_new_entries.lower_bound(last));
+      m_deleted.insert(header.fileid);
+    }
+    else
+    {
+      Key key = { header.fileid, header.scale, header.x, header.y };
+      Location location = { segment, header.length, offset, static_cast<TileEntry::Format>(header.format) };
+      m_new_entries[key] = location;
+    }
+
+    offset += sizeof(RecordHeader) + header.length;
+  }
+
+  if (offset == size)
+  {
+    return true;
+  }
+  else
+  {
+    if (segment == m_segments.rbegin()->first)
+    {
+      // most likely a write that got interrupted by a crash
+      log_warning << get_segment_filename(segment) << ": truncating incomplete record at " << offset << std::endl;
+      if (ftruncate(fd, static_cast<off_t>(offset)) < 0)
+      {
+        raise_exception(std::runtime_error, get_segment_filename(segment) << ": " << strerror(errno));
+      }
+    }
+    return false;
+  }
+}
+
+bool
+PackTileDatabase::lookup(const Key& key, Location& location_out) const
+{
+  Entries::const_iterator it = m_new_entries.find(key);
+  if (it != m_new_entries.end())
+  {
+    location_out = it->second;
+    return true;
+  }
+  else if (m_deleted.find(key.fileid) != m_deleted.end())
+  {
+    return false;
+  }
+  else
+  {
+    const IndexEntry* end = m_index + m_index_size;
+    const IndexEntry* entry = std::lower_bound(m_index, end, key,
+                                               [](const IndexEntry& lhs, const Key& rhs) {
+                                                 return get_key(lhs) < rhs;
+                                               });
+    if (entry != end &&
+        entry->fileid == key.fileid && entry->scale == key.scale &&
+        entry->x == key.x && entry->y == key.y)
+    {
+      location_out = get_location(*entry);
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+}
+
+void
+PackTileDatabase::for_each_entry(const std::function<void (const Key&, const Location&)>& func, int64_t fileid) const
+{
+  const IndexEntry* index_it  = m_index;
+  const IndexEntry* index_end = m_index + m_index_size;
+  Entries::const_iterator new_it  = m_new_entries.begin();
+  Entries::const_iterator new_end = m_new_entries.end();
+
+  if (fileid)
+  {
+    Key first = { fileid, std::numeric_limits<int>::min(), 0, 0 };
+    Key last  = { fileid + 1, std::numeric_limits<int>::min(), 0, 0 };
+    auto less = [](const IndexEntry& lhs, const Key& rhs) { return get_key(lhs) < rhs; };
+    index_it  = std::lower_bound(index_it, index_end, first, less);
+    index_end = std::lower_bound(index_it, index_end, last, less);
+    new_it  = m_new_entries.lower_bound(first);
+    new_end = m_new_entries.lower_bound(last);
+  }
+
+  // merge the index with the new entries, new entries replace those
+  // with the same key in the index
+  while(index_it != index_end || new_it != new_end)
+  {
+    if (new_it == new_end || (index_it != index_end && get_key(*index_it) < new_it->first))
+    {
+      if (m_deleted.find(index_it->fileid) == m_deleted.end())
+      {
+        func(get_key(*index_it), get_location(*index_it));
+      }
+      ++index_it;
+    }
+    else
+    {
+      if (index_it != index_end && !(new_it->first < get_key(*index_it)))
+      {
+        ++index_it;
+      }
+      func(new_it->first, new_it->second);
+      ++new_it;
+    }
+  }
+}
+
+bool
+PackTileDatabase::has_tile(const FileEntry& file_entry, const Vector2i& pos, int scale)
+{
+  if (!file_entry.get_tile_fileid())
+  {
+    return false;
+  }
+  else
+  {
+    Key key = { file_entry.get_tile_fileid().get_id(), scale, pos.x, pos.y };
+    Location location;
+    return lookup(key, location);
+  }
+}
+
+bool
+PackTileDatabase::get_tile(const FileEntry& file_entry, int scale, const Vector2i& pos, TileEntry& tile_out)
+{
+  if (!file_entry.get_tile_fileid())
+  {
+    return false;
+  }
+
+  Key key = { file_entry.get_tile_fileid().get_id(), scale, pos.x, pos.y };
+  Location location;
+  if (!lookup(key, location))
+  {
+    return false;
+  }
+
+  BlobPtr blob = read(location);
+  if (!blob)
+  {
+    log_warning << get_segment_filename(location.segment) << ": tile missing at " << location.offset << std::endl;
+    return false;
+  }
+
+  tile_out = TileEntry(file_entry, scale, pos, blob, location.format);
+  TileCodec::decode(tile_out);
+  return true;
+}
+
+void
+PackTileDatabase::get_tiles(const FileEntry& file_entry, std::vector<TileEntry>& tiles)
+{
+  if (file_entry.get_tile_fileid())
+  {
+    std::vector<std::pair<Key, Location> > entries;
+    for_each_entry([&entries](const Key& key, const Location& location) {
+        entries.push_back(std::make_pair(key, location));
+      }, file_entry.get_tile_fileid().get_id());
+
+    for(std::vector<std::pair<Key, Location> >::iterator i = entries.begin(); i != entries.end(); ++i)
+    {
+      BlobPtr blob = read(i->second);
+      if (blob)
+      {
+        TileEntry tile(file_entry, i->first.scale, Vector2i(i->first.x, i->first.y), blob, i->second.format);
+        TileCodec::decode(tile);
+        tiles.push_back(tile);
+      }
+    }
+  }
+}
+
+bool
+PackTileDatabase::get_min_max_scale(const FileEntry& file_entry, int& min_scale_out, int& max_scale_out)
+{
+  if (!file_entry.get_tile_fileid())
+  {
+    return false;
+  }
+
+  int min_scale = std::numeric_limits<int>::max();
+  int max_scale = std::numeric_limits<int>::min();
+  for_each_entry([&min_scale, &max_scale](const Key& key, const Location&) {
+      min_scale = std::min(min_scale, key.scale);
+      max_scale = std::max(max_scale, key.scale);
+    }, file_entry.get_tile_fileid().get_id());
+
+  if (min_scale > max_scale)
+  {
+    return false;
+  }
+  else
+  {
+    min_scale_out = min_scale;
+    max_scale_out = max_scale;
+    return true;
+  }
+}
+
+void
+PackTileDatabase::store_tile(const FileEntry& file_entry, const Tile& tile)
+{
+  store(TileEntry(file_entry, tile.get_scale(), tile.get_pos(), tile.get_surface()));
+
+  if (m_new_entries.size() >= kMaxNewEntries)
+  {
+    write_index();
+  }
+}
+
+void
+PackTileDatabase::store_tiles(const std::vector<TileEntry>& tiles)
+{
+  for(std::vector<TileEntry>::const_iterator i = tiles.begin(); i != tiles.end(); ++i)
+  {
+    store(*i);
+  }
+
+  if (m_new_entries.size() >= kMaxNewEntries)
+  {
+    write_index();
+  }
+}
+
+void
+PackTileDatabase::store(TileEntry tile)
+{
+  assert(tile.get_file_entry().get_tile_fileid());
+
+  Key key = { tile.get_file_entry().get_tile_fileid().get_id(), tile.get_scale(), tile.get_pos().x, tile.get_pos().y };
+
+  Location location;
+  if (tile.get_file_entry().is_duplicate() && lookup(key, location))
+  {
+    // an identical file already stored this tile
+    return;
+  }
+
+  if (!tile.get_blob())
+  {
+    m_codec.encode(tile);
+  }
+
+  m_new_entries[key] = append(key, tile.get_format(), tile.get_blob()->get_data(), tile.get_blob()->size());
+}
+
+void
+PackTileDatabase::delete_tiles(const FileId& fileid)
+{
+  Key key = { fileid.get_id(), kDeleteScale, 0, 0 };
+  append(key, TileEntry::UNKNOWN_FORMAT, 0, 0);
+
+  Key first = { fileid.get_id(), std::numeric_limits<int>::min(), 0, 0 };
+  Key last  = { fileid.get_id() + 1, std::numeric_limits<int>::min(), 0, 0 };
+  m_new_entries.erase(m_new_entries.lower_bound(first), m_new_entries.lower_bound(last));
+  m_deleted.insert(fileid.get_id());
+}
+
+PackTileDatabase::Location
+PackTileDatabase::append(const Key& key, TileEntry::Format format, const uint8_t* data, uint32_t length)
+{
+  const uint64_t record_size = sizeof(RecordHeader) + length;
+  if (m_tail_offset > 0 && m_tail_offset + record_size > kMaxSegmentSize)
+  {
+    start_segment(m_tail_segment + 1);
+  }
+
+  RecordHeader header = { kRecordMagic, length, key.fileid, key.scale, key.x, key.y, format };
+
+  // header and data go out in a single write, so that a crash can
+  // only leave an incomplete record at the very end of the segment
+  m_buffer.resize(record_size);
+  memcpy(m_buffer.data(), &header, sizeof(header));
+  if (length > 0)
+  {
+    memcpy(m_buffer.data() + sizeof(header), data, length);
+  }
+  pwrite_all(get_segment_fd(m_tail_segment), m_buffer.data(), m_buffer.size(), m_tail_offset);
+
+  Location location = { m_tail_segment, length, m_tail_offset, format };
+  m_tail_offset += record_size;
+  m_unsynced_segments.insert(m_tail_segment);
+
+  return location;
+}
+
+void
+PackTileDatabase::start_segment(uint32_t segment)
+{
+  std::string filename = get_segment_filename(segment);
+  int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0)
+  {
+    raise_exception(std::runtime_error, filename << ": " << strerror(errno));
+  }
+
+  m_segments[segment] = fd;
+  m_tail_segment = segment;
+  m_tail_offset  = get_segment_size(segment);
+}
+
+BlobPtr
+PackTileDatabase::read(const Location& location)
+{
+  int fd = get_segment_fd(location.segment);
+  if (fd < 0)
+  {
+    return BlobPtr();
+  }
+
+  BlobPtr blob = Blob::create(location.length);
+  if (!pread_all(fd, blob->get_data(), location.length, location.offset + sizeof(RecordHeader)))
+  {
+    return BlobPtr();
+  }
+  return blob;
+}
+
+void
+PackTileDatabase::flush_cache()
+{
+  for(std::unordered_set<uint32_t>::iterator i = m_unsynced_segments.begin(); i != m_unsynced_segments.end(); ++i)
+  {
+    int fd = get_segment_fd(*i);
+    if (fd >= 0)
+    {
+      fdatasync(fd);
+    }
+  }
+  m_unsynced_segments.clear();
+
+  if (m_new_entries.size() + m_deleted.size() >= kMaxNewEntries)
+  {
+    write_index();
+  }
+}
+
+void
+PackTileDatabase::write_index()
+{
+  // the index must never point to data that isn't on disk yet
+  for(std::unordered_set<uint32_t>::iterator i = m_unsynced_segments.begin(); i != m_unsynced_segments.end(); ++i)
+  {
+    int fd = get_segment_fd(*i);
+    if (fd >= 0)
+    {
+      fdatasync(fd);
+    }
+  }
+  m_unsynced_segments.clear();
+
+  std::string filename = m_directory + "/index";
+  std::string tmp_filename = filename + ".tmp";
+
+  int fd = open(tmp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+  {
+    raise_exception(std::runtime_error, tmp_filename << ": " << strerror(errno));
+  }
+
+  try
+  {
+    IndexHeader header;
+    memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+    header.version      = kIndexVersion;
+    header.tail_segment = m_tail_segment;
+    header.tail_offset  = m_tail_offset;
+    header.num_entries  = 0;
+
+    uint64_t offset = sizeof(IndexHeader);
+    std::vector<IndexEntry> chunk;
+    chunk.reserve(4096);
+
+    auto write_chunk = [&]{
+      pwrite_all(fd, chunk.data(), chunk.size() * sizeof(IndexEntry), offset);
+      offset += chunk.size() * sizeof(IndexEntry);
+      header.num_entries += chunk.size();
+      chunk.clear();
+    };
+
+    for_each_entry([&](const Key& key, const Location& location) {
+        IndexEntry entry = { key.fileid, key.scale, key.x, key.y,
+                             location.segment, location.offset, location.length, location.format };
+        chunk.push_back(entry);
+        if (chunk.size() == chunk.capacity())
+        {
+          write_chunk();
+        }
+      });
+    write_chunk();
+
+    pwrite_all(fd, &header, sizeof(header), 0);
+
+    if (fsync(fd) < 0)
+    {
+      raise_exception(std::runtime_error, tmp_filename << ": " << strerror(errno));
+    }
+  }
+  catch(...)
+  {
+    close(fd);
+    throw;
+  }
+  close(fd);
+
+  if (rename(tmp_filename.c_str(), filename.c_str()) < 0)
+  {
+    raise_exception(std::runtime_error, filename << ": " << strerror(errno));
+  }
+
+  // make the rename itself durable
+  int dir_fd = open(m_directory.c_str(), O_RDONLY | O_CLOEXEC);
+  if (dir_fd >= 0)
+  {
+    fsync(dir_fd);
+    close(dir_fd);
+  }
+
+  m_index_file.reset();
+  m_index = 0;
+  m_index_size = 0;
+  m_new_entries.clear();
+  m_deleted.clear();
+
+  load_index();
+}
+
+void
+PackTileDatabase::compact()
+{
+  std::map<uint32_t, uint64_t> live_bytes;
+  for_each_entry([&live_bytes](const Key&, const Location& location) {
+      live_bytes[location.segment] += sizeof(RecordHeader) + location.length;
+    });
+
+  std::vector<uint32_t> candidates;
+  for(std::map<uint32_t, int>::iterator i = m_segments.begin(); i != m_segments.end(); ++i)
+  {
+    // the tail segment is still being written to, it gets its turn
+    // once it is full
+    if (i->first != m_tail_segment && live_bytes[i->first] * 2 < get_segment_size(i->first))
+    {
+      candidates.push_back(i->first);
+    }
+  }
+
+  uint64_t freed_bytes  = 0;
+  uint64_t copied_bytes = 0;
+  for(std::vector<uint32_t>::iterator seg = candidates.begin(); seg != candidates.end(); ++seg)
+  {
+    const int fd = get_segment_fd(*seg);
+    const uint64_t size = get_segment_size(*seg);
+
+    uint64_t offset = 0;
+    RecordHeader header;
+    while(offset + sizeof(RecordHeader) <= size &&
+          pread_all(fd, &header, sizeof(header), offset) &&
+          header.magic == kRecordMagic)
+    {
+      if (header.scale != kDeleteScale)
+      {
+        // only copy the record if it is the one the index points to
+        Key key = { header.fileid, header.scale, header.x, header.y };
+        Location location;
+        if (lookup(key, location) && location.segment == *seg && location.offset == offset)
+        {
+          BlobPtr blob = read(location);
+          if (blob)
+          {
+            m_new_entries[key] = append(key, location.format, blob->get_data(), location.length);
+            copied_bytes += sizeof(RecordHeader) + location.length;
+          }
+        }
+      }
+
+      offset += sizeof(RecordHeader) + header.length;
+    }
+
+    freed_bytes += size;
+  }
+
+  if (candidates.empty())
+  {
+    log_info << m_directory << ": nothing to compact" << std::endl;
+  }
+  else
+  {
+    // only once the index no longer refers to the old segments can
+    // they be removed
+    write_index();
+
+    for(std::vector<uint32_t>::iterator seg = candidates.begin(); seg != candidates.end(); ++seg)
+    {
+      close(m_segments[*seg]);
+      m_segments.erase(*seg);
+      Filesystem::remove(get_segment_filename(*seg));
+    }
+
+    log_info << m_directory << ": compacted " << candidates.size() << " segments, "
+             << (freed_bytes - copied_bytes) / (1024 * 1024) << " MB freed, "
+             << copied_bytes / (1024 * 1024) << " MB copied" << std::endl;
+  }
+}
+
+bool
+PackTileDatabase::check(std::vector<std::string>& errors_out)
+{
+  size_t num_errors = errors_out.size();
+
+  for_each_entry([this, &errors_out](const Key& key, const Location& location) {
+      std::ostringstream out;
+      out << get_segment_filename(location.segment) << ":" << location.offset << ": ";
+
+      int fd = get_segment_fd(location.segment);
+      RecordHeader header;
+      if (fd < 0)
+      {
+        errors_out.push_back(out.str() + "segment missing");
+      }
+      else if (location.offset + sizeof(RecordHeader) + location.length > get_segment_size(location.segment) ||
+               !pread_all(fd, &header, sizeof(header), location.offset))
+      {
+        errors_out.push_back(out.str() + "record past the end of the segment");
+      }
+      else if (header.magic  != kRecordMagic ||
+               header.length != location.length ||
+               header.fileid != key.fileid ||
+               header.scale  != key.scale ||
+               header.x      != key.x ||
+               header.y      != key.y ||
+               header.format != location.format)
+      {
+        errors_out.push_back(out.str() + "record doesn't match the index");
+      }
+    });
+
+  return errors_out.size() == num_errors;
+}
+
+std::string
+PackTileDatabase::get_segment_filename(uint32_t segment) const
+{
+  char name[32];
+  snprintf(name, sizeof(name), "/segment-%06u.pack", segment);
+  return m_directory + name;
+}
+
+uint64_t
+PackTileDatabase::get_segment_size(uint32_t segment) const
+{
+  struct stat st;
+  if (fstat(get_segment_fd(segment), &st) < 0)
+  {
+    raise_exception(std::runtime_error, get_segment_filename(segment) << ": " << strerror(errno));
+  }
+  return static_cast<uint64_t>(st.st_size);
+}
+
+int
+PackTileDatabase::get_segment_fd(uint32_t segment) const
+{
+  std::map<uint32_t, int>::const_iterator it = m_segments.find(segment);
+  if (it == m_segments.end())
+  {
+    return -1;
+  }
+  else
+  {
+    return it->second;
+  }
+}
+
+/* EOF */
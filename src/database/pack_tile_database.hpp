@@ -0,0 +1,175 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_DATABASE_PACK_TILE_DATABASE_HPP
+#define HEADER_GALAPIX_DATABASE_PACK_TILE_DATABASE_HPP
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "database/tile_database_interface.hpp"
+#include "database/tile_entry.hpp"
+
+class MappedFile;
+class TileCodec;
+
+/** Stores tiles in append-only segment files, each record being a
+    small header followed by the encoded tile. A sorted index of
+    (fileid, scale, x, y) -> (segment, offset, length) is kept in a
+    file of its own and mmap()'ed. Entries added or deleted since the
+    index was last written are kept in memory and, as the segments
+    are append-only, are replayed from the segments when the index is
+    out of date on startup, e.g. after a crash. Space of deleted or
+    overwritten tiles is reclaimed by compact().
+
+    Tiles can only be stored for FileEntrys that have a FileId, wrap
+    in a CachedTileDatabase for the others. */
+class PackTileDatabase : public TileDatabaseInterface
+{
+private:
+  struct Key
+  {
+    int64_t fileid;
+    int scale;
+    int x;
+    int y;
+
+    bool operator<(const Key& rhs) const
+    {
+      if (fileid != rhs.fileid) return fileid < rhs.fileid;
+      if (scale  != rhs.scale)  return scale  < rhs.scale;
+      if (x      != rhs.x)      return x      < rhs.x;
+      return y < rhs.y;
+    }
+  };
+
+  struct Location
+  {
+    uint32_t segment;
+    uint32_t length;
+    uint64_t offset;
+    TileEntry::Format format;
+  };
+
+  /** Entries of the index file, sorted by key */
+  struct IndexEntry
+  {
+    int64_t  fileid;
+    int32_t  scale;
+    int32_t  x;
+    int32_t  y;
+    uint32_t segment;
+    uint64_t offset;
+    uint32_t length;
+    int32_t  format;
+  };
+
+  typedef std::map<Key, Location> Entries;
+
+private:
+  std::string m_directory;
+  const TileCodec& m_codec;
+
+  std::unique_ptr<MappedFile> m_index_file;
+  const IndexEntry* m_index;
+  size_t m_index_size;
+
+  /** Entries stored since the index was written, these override the
+      ones in the index */
+  Entries m_new_entries;
+
+  /** Files whose tiles got deleted since the index was written */
+  std::unordered_set<int64_t> m_deleted;
+
+  /** File descriptors of the segments by segment number */
+  std::map<uint32_t, int> m_segments;
+  std::unordered_set<uint32_t> m_unsynced_segments;
+
+  uint32_t m_tail_segment;
+  uint64_t m_tail_offset;
+
+  std::vector<uint8_t> m_buffer;
+
+public:
+  PackTileDatabase(const std::string& directory, const TileCodec& codec);
+  ~PackTileDatabase();
+
+  bool has_tile(const FileEntry& file_entry, const Vector2i& pos, int scale);
+  bool get_tile(const FileEntry& file_entry, int scale, const Vector2i& pos, TileEntry& tile_out);
+  void get_tiles(const FileEntry& file_entry, std::vector<TileEntry>& tiles);
+  bool get_min_max_scale(const FileEntry& file_entry, int& min_scale_out, int& max_scale_out);
+
+  void store_tile(const FileEntry& file_entry, const Tile& tile);
+  void store_tiles(const std::vector<TileEntry>& tiles);
+
+  void delete_tiles(const FileId& fileid);
+
+  /** Syncs the segments to disk, the index is only rewritten once
+      enough new entries have piled up */
+  void flush_cache();
+
+  /** Rewrite the index, so that nothing has to be replayed on the
+      next startup */
+  void write_index();
+
+  /** Copy the live tiles out of segments that are mostly garbage and
+      remove those segments */
+  void compact();
+
+  /** Verify that every entry of the index points to a matching
+      record, returns false if problems were found */
+  bool check(std::vector<std::string>& errors_out);
+
+private:
+  static Key get_key(const IndexEntry& entry);
+  static Location get_location(const IndexEntry& entry);
+
+  void load_index();
+  void open_segments();
+  void replay();
+  bool replay_segment(uint32_t segment, uint64_t offset);
+
+  bool lookup(const Key& key, Location& location_out) const;
+
+  /** Calls \a func for all live entries in key order, the range can
+      be limited to a single file with \a fileid */
+  void for_each_entry(const std::function<void (const Key&, const Location&)>& func, int64_t fileid = 0) const;
+
+  void store(TileEntry tile);
+  Location append(const Key& key, TileEntry::Format format, const uint8_t* data, uint32_t length);
+  void start_segment(uint32_t segment);
+
+  BlobPtr read(const Location& location);
+
+  std::string get_segment_filename(uint32_t segment) const;
+  uint64_t get_segment_size(uint32_t segment) const;
+  int get_segment_fd(uint32_t segment) const;
+
+private:
+  PackTileDatabase(const PackTileDatabase&);
+  PackTileDatabase& operator=(const PackTileDatabase&);
+};
+
+#endif
+
+/* EOF */
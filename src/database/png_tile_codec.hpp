@@ -0,0 +1,56 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_DATABASE_PNG_TILE_CODEC_HPP
+#define HEADER_GALAPIX_DATABASE_PNG_TILE_CODEC_HPP
+
+#include "database/tile_codec.hpp"
+#include "plugins/png.hpp"
+
+class PNGTileCodec : public TileCodec
+{
+public:
+  PNGTileCodec() {}
+
+  std::string get_name() const { return "png"; }
+  std::string get_extension() const { return "png"; }
+  TileEntry::Format get_format() const { return TileEntry::PNG_FORMAT; }
+
+  bool can_encode(SoftwareSurface::Format format) const
+  {
+    return true;
+  }
+
+  BlobPtr encode(const SoftwareSurfacePtr& surface) const
+  {
+    return PNG::save(surface);
+  }
+
+  SoftwareSurfacePtr decode(const BlobPtr& blob) const
+  {
+    return PNG::load_from_mem(blob->get_data(), blob->size());
+  }
+
+private:
+  PNGTileCodec(const PNGTileCodec&);
+  PNGTileCodec& operator=(const PNGTileCodec&);
+};
+
+#endif
+
+/* EOF */
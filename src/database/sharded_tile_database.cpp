@@ -0,0 +1,231 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "database/sharded_tile_database.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <future>
+#include <sstream>
+#include <thread>
+
+#include "database/file_database.hpp"
+#include "database/tile_database.hpp"
+#include "job/thread_message_queue2.hpp"
+
+struct ShardedTileDatabase::Worker
+{
+  ThreadMessageQueue2<std::function<void ()> > queue;
+  std::thread thread;
+
+  Worker() :
+    queue(),
+    thread()
+  {
+    thread = std::thread([this]{
+        std::function<void ()> task;
+        while(queue.wait_and_pop_until_closed(task))
+        {
+          task();
+        }
+      });
+  }
+
+  ~Worker()
+  {
+    queue.close();
+    thread.join();
+  }
+};
+
+std::string
+ShardedTileDatabase::get_shard_filename(const std::string& prefix, int shard)
+{
+  std::ostringstream out;
+  out << prefix << "/cache3_tiles_" << shard << ".sqlite3";
+  return out.str();
+}
+
+int
+ShardedTileDatabase::get_shard(const FileId& fileid, int num_shards)
+{
+  // FileIds are handed out sequentially, so mix the bits up a
+  // little, files added together should still spread over all shards
+  uint64_t hash = static_cast<uint64_t>(fileid.get_id()) * UINT64_C(0x9E3779B97F4A7C15);
+  return static_cast<int>((hash >> 32) % static_cast<uint64_t>(num_shards));
+}
+
+ShardedTileDatabase::ShardedTileDatabase(const std::vector<SQLiteConnection*>& tile_dbs, FileDatabase& files,
+                                         const TileCodec& codec) :
+  m_files(files),
+  m_shards(),
+  m_workers(),
+  m_cache()
+{
+  assert(!tile_dbs.empty());
+
+  for(std::vector<SQLiteConnection*>::const_iterator i = tile_dbs.begin(); i != tile_dbs.end(); ++i)
+  {
+    m_shards.push_back(std::unique_ptr<TileDatabase>(new TileDatabase(**i, files, codec)));
+    m_workers.push_back(std::unique_ptr<Worker>(new Worker));
+  }
+}
+
+ShardedTileDatabase::~ShardedTileDatabase()
+{
+  flush_cache();
+}
+
+TileDatabase&
+ShardedTileDatabase::get_shard(const FileId& fileid)
+{
+  return *m_shards[get_shard(fileid, static_cast<int>(m_shards.size()))];
+}
+
+bool
+ShardedTileDatabase::has_tile(const FileEntry& file_entry, const Vector2i& pos, int scale)
+{
+  if (file_entry.get_tile_fileid() && get_shard(file_entry.get_tile_fileid()).has_tile(file_entry, pos, scale))
+  {
+    return true;
+  }
+  else
+  {
+    return m_cache.has_tile(file_entry, pos, scale);
+  }
+}
+
+bool
+ShardedTileDatabase::get_tile(const FileEntry& file_entry, int scale, const Vector2i& pos, TileEntry& tile_out)
+{
+  if (file_entry.get_tile_fileid() && get_shard(file_entry.get_tile_fileid()).get_tile(file_entry, scale, pos, tile_out))
+  {
+    return true;
+  }
+  else
+  {
+    return m_cache.get_tile(file_entry, scale, pos, tile_out);
+  }
+}
+
+void
+ShardedTileDatabase::get_tiles(const FileEntry& file_entry, std::vector<TileEntry>& tiles_out)
+{
+  if (file_entry.get_tile_fileid())
+  {
+    get_shard(file_entry.get_tile_fileid()).get_tiles(file_entry, tiles_out);
+  }
+
+  m_cache.get_tiles(file_entry, tiles_out);
+}
+
+bool
+ShardedTileDatabase::get_min_max_scale(const FileEntry& file_entry, int& min_scale_out, int& max_scale_out)
+{
+  int min_scale_cache = -1;
+  int max_scale_cache = -1;
+  bool in_cache = m_cache.get_min_max_scale(file_entry, min_scale_cache, max_scale_cache);
+
+  if (file_entry.get_tile_fileid() &&
+      get_shard(file_entry.get_tile_fileid()).get_min_max_scale(file_entry, min_scale_out, max_scale_out))
+  {
+    if (in_cache)
+    {
+      min_scale_out = std::min(min_scale_out, min_scale_cache);
+      max_scale_out = std::max(max_scale_out, max_scale_cache);
+    }
+    return true;
+  }
+  else if (in_cache)
+  {
+    min_scale_out = min_scale_cache;
+    max_scale_out = max_scale_cache;
+    return true;
+  }
+  else
+  {
+    return false;
+  }
+}
+
+void
+ShardedTileDatabase::store_tile(const FileEntry& file_entry, const Tile& tile)
+{
+  m_cache.store_tile(file_entry, tile);
+
+  if (m_cache.size() > 256)
+    flush_cache();
+}
+
+void
+ShardedTileDatabase::store_tiles(const std::vector<TileEntry>& tiles)
+{
+  std::vector<std::vector<TileEntry> > shard_tiles(m_shards.size());
+  for(std::vector<TileEntry>::const_iterator i = tiles.begin(); i != tiles.end(); ++i)
+  {
+    shard_tiles[get_shard(i->get_file_entry().get_tile_fileid(), static_cast<int>(m_shards.size()))].push_back(*i);
+  }
+
+  // each shard has its own connection and its own write lock, so
+  // they can be written at the same time
+  std::vector<std::future<void> > results;
+  for(size_t i = 0; i < m_shards.size(); ++i)
+  {
+    if (!shard_tiles[i].empty())
+    {
+      TileDatabase& shard = *m_shards[i];
+      const std::vector<TileEntry>& entries = shard_tiles[i];
+      std::shared_ptr<std::packaged_task<void ()> > task =
+        std::make_shared<std::packaged_task<void ()> >([&shard, &entries]{
+            shard.store_tiles(entries);
+          });
+      results.push_back(task->get_future());
+      m_workers[i]->queue.wait_and_push([task]{ (*task)(); });
+    }
+  }
+
+  // all shards have to be done before an error is passed on, as the
+  // tasks refer to shard_tiles
+  for(std::vector<std::future<void> >::iterator i = results.begin(); i != results.end(); ++i)
+  {
+    i->wait();
+  }
+
+  for(std::vector<std::future<void> >::iterator i = results.begin(); i != results.end(); ++i)
+  {
+    i->get();
+  }
+}
+
+void
+ShardedTileDatabase::delete_tiles(const FileId& fileid)
+{
+  m_cache.delete_tiles(fileid);
+  get_shard(fileid).delete_tiles(fileid);
+}
+
+void
+ShardedTileDatabase::flush_cache()
+{
+  // FileIds of the cached tiles are only known after this
+  m_files.flush_cache();
+  m_cache.flush(*this);
+}
+
+/* EOF */
@@ -0,0 +1,91 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_DATABASE_SHARDED_TILE_DATABASE_HPP
+#define HEADER_GALAPIX_DATABASE_SHARDED_TILE_DATABASE_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "database/tile_cache.hpp"
+#include "database/tile_database_interface.hpp"
+
+class FileDatabase;
+class FileId;
+class SQLiteConnection;
+class TileCodec;
+class TileDatabase;
+
+/** Spreads the tiles over multiple SQLite files, picked by a hash of
+    the FileId, so that no single file grows to multiple GB and each
+    shard can be written, vacuumed and checked on its own. Tiles of
+    FileEntrys that don't have a FileId yet wait in a shared cache,
+    on flush they are sorted into their shards and the shards are
+    written in parallel, each by a worker thread of its own. */
+class ShardedTileDatabase : public TileDatabaseInterface
+{
+private:
+  struct Worker;
+
+private:
+  FileDatabase& m_files;
+  std::vector<std::unique_ptr<TileDatabase> > m_shards;
+
+  /** One per shard, they live as long as the database, so that
+      store_tiles() doesn't start new threads on every call */
+  std::vector<std::unique_ptr<Worker> > m_workers;
+
+  TileCache m_cache;
+
+public:
+  /** Filename of shard \a shard in the database directory \a prefix */
+  static std::string get_shard_filename(const std::string& prefix, int shard);
+
+  /** The shard holding the tiles of \a fileid */
+  static int get_shard(const FileId& fileid, int num_shards);
+
+public:
+  /** \a tile_dbs holds one connection per shard, they must outlive
+      the ShardedTileDatabase */
+  ShardedTileDatabase(const std::vector<SQLiteConnection*>& tile_dbs, FileDatabase& files, const TileCodec& codec);
+  ~ShardedTileDatabase();
+
+  bool has_tile(const FileEntry& file_entry, const Vector2i& pos, int scale);
+  bool get_tile(const FileEntry& file_entry, int scale, const Vector2i& pos, TileEntry& tile_out);
+  void get_tiles(const FileEntry& file_entry, std::vector<TileEntry>& tiles);
+  bool get_min_max_scale(const FileEntry& file_entry, int& min_scale_out, int& max_scale_out);
+
+  void store_tile(const FileEntry& file_entry, const Tile& tile);
+  void store_tiles(const std::vector<TileEntry>& tiles);
+
+  void delete_tiles(const FileId& fileid);
+
+  void flush_cache();
+
+private:
+  TileDatabase& get_shard(const FileId& fileid);
+
+private:
+  ShardedTileDatabase(const ShardedTileDatabase&);
+  ShardedTileDatabase& operator=(const ShardedTileDatabase&);
+};
+
+#endif
+
+/* EOF */
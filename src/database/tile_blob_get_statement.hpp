@@ -0,0 +1,56 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_DATABASE_TILE_BLOB_GET_STATEMENT_HPP
+#define HEADER_GALAPIX_DATABASE_TILE_BLOB_GET_STATEMENT_HPP
+
+class TileBlobGetStatement
+{
+private:
+  SQLiteStatement m_stmt;
+
+public:
+  TileBlobGetStatement(SQLiteConnection& db) :
+    m_stmt(db, "SELECT data FROM blobs WHERE hash = ?1;")
+  {}
+
+  /** Returns the shared blob stored under \a hash or an empty
+      BlobPtr if there is none */
+  BlobPtr operator()(int64_t hash)
+  {
+    m_stmt.bind_int64(1, hash);
+
+    SQLiteReader reader = m_stmt.execute_query();
+    if (reader.next())
+    {
+      return reader.get_blob(0);
+    }
+    else
+    {
+      return BlobPtr();
+    }
+  }
+
+private:
+  TileBlobGetStatement(const TileBlobGetStatement&);
+  TileBlobGetStatement& operator=(const TileBlobGetStatement&);
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,46 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_DATABASE_TILE_BLOB_STORE_STATEMENT_HPP
+#define HEADER_GALAPIX_DATABASE_TILE_BLOB_STORE_STATEMENT_HPP
+
+class TileBlobStoreStatement
+{
+private:
+  SQLiteStatement m_stmt;
+
+public:
+  TileBlobStoreStatement(SQLiteConnection& db) :
+    m_stmt(db, "INSERT INTO blobs (hash, data) VALUES (?1, ?2);")
+  {}
+
+  void operator()(int64_t hash, const BlobPtr& blob)
+  {
+    m_stmt.bind_int64(1, hash);
+    m_stmt.bind_blob(2, blob);
+    m_stmt.execute();
+  }
+
+private:
+  TileBlobStoreStatement(const TileBlobStoreStatement&);
+  TileBlobStoreStatement& operator=(const TileBlobStoreStatement&);
+};
+
+#endif
+
+/* EOF */
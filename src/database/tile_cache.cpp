@@ -137,7 +137,7 @@ struct FileIdEqual
 
   bool operator()(const TileEntry& tile_entry) const
   {
-    return tile_entry.get_file_entry().get_fileid() == m_fileid;
+    return tile_entry.get_file_entry().get_tile_fileid() == m_fileid;
   }
 };
 
@@ -0,0 +1,108 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "database/tile_codec.hpp"
+
+#include <assert.h>
+#include <stdexcept>
+#include <stdlib.h>
+
+#include "database/jpeg_tile_codec.hpp"
+#include "database/png_tile_codec.hpp"
+#include "database/qoi_tile_codec.hpp"
+#include "util/trace.hpp"
+
+void
+TileCodec::encode(TileEntry& tile) const
+{
+  TRACE_SPAN("tile", "encode");
+
+  const SoftwareSurfacePtr& surface = tile.get_surface();
+
+  const TileCodec& codec = can_encode(surface->get_format()) ? *this : get(TileEntry::PNG_FORMAT);
+
+  tile.set_blob(codec.encode(surface));
+  tile.set_format(codec.get_format());
+
+  TRACE_VALUE("tile/encoded_bytes", tile.get_blob()->size());
+}
+
+void
+TileCodec::decode(TileEntry& tile)
+{
+  TRACE_SPAN("tile", "decode");
+  tile.set_surface(get(tile.get_format()).decode(tile.get_blob()));
+}
+
+TileCodecPtr
+TileCodec::from_string(const std::string& spec)
+{
+  std::string::size_type colon = spec.find(':');
+  std::string name = spec.substr(0, colon);
+
+  if (name == "jpeg" || name == "jpg")
+  {
+    int quality = 75;
+    if (colon != std::string::npos)
+    {
+      quality = atoi(spec.c_str() + colon + 1);
+      if (quality < 1 || quality > 100)
+      {
+        throw std::runtime_error("TileCodec::from_string(): JPEG quality must be in the range 1-100: " + spec);
+      }
+    }
+    return TileCodecPtr(new JPEGTileCodec(quality));
+  }
+  else if (name == "png")
+  {
+    return TileCodecPtr(new PNGTileCodec);
+  }
+  else if (name == "qoi")
+  {
+    return TileCodecPtr(new QOITileCodec);
+  }
+  else
+  {
+    throw std::runtime_error("TileCodec::from_string(): unknown tile codec: " + spec);
+  }
+}
+
+const TileCodec&
+TileCodec::get(TileEntry::Format format)
+{
+  static const JPEGTileCodec jpeg_codec;
+  static const PNGTileCodec  png_codec;
+  static const QOITileCodec  qoi_codec;
+
+  switch(format)
+  {
+    case TileEntry::JPEG_FORMAT:
+      return jpeg_codec;
+
+    case TileEntry::PNG_FORMAT:
+      return png_codec;
+
+    case TileEntry::QOI_FORMAT:
+      return qoi_codec;
+
+    default:
+      throw std::runtime_error("TileCodec::get(): unknown tile format");
+  }
+}
+
+/* EOF */
@@ -0,0 +1,77 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_DATABASE_TILE_CODEC_HPP
+#define HEADER_GALAPIX_DATABASE_TILE_CODEC_HPP
+
+#include <memory>
+#include <string>
+
+#include "database/tile_entry.hpp"
+#include "util/software_surface.hpp"
+
+class TileCodec;
+
+typedef std::unique_ptr<TileCodec> TileCodecPtr;
+
+/** A TileCodec converts between the SoftwareSurface of a tile and the
+    Blob that is stored in the database. Each codec has its own
+    TileEntry::Format, which is stored in the tiles.format column, so
+    a database can contain tiles of mixed formats and the codec used
+    for new tiles can be changed at any time. */
+class TileCodec
+{
+public:
+  TileCodec() {}
+  virtual ~TileCodec() {}
+
+  virtual std::string get_name() const =0;
+  virtual std::string get_extension() const =0;
+  virtual TileEntry::Format get_format() const =0;
+
+  /** Returns true if the codec can store surfaces of \a format
+      without loss of the alpha channel */
+  virtual bool can_encode(SoftwareSurface::Format format) const =0;
+
+  virtual BlobPtr encode(const SoftwareSurfacePtr& surface) const =0;
+  virtual SoftwareSurfacePtr decode(const BlobPtr& blob) const =0;
+
+  /** Fill the Blob and format of \a tile from its surface, falls
+      back to PNG if the codec can't handle the surface format */
+  void encode(TileEntry& tile) const;
+
+  /** Fill the surface of \a tile from its Blob, using the codec
+      given by the tiles format */
+  static void decode(TileEntry& tile);
+
+public:
+  /** Create a codec from a string of the form NAME[:QUALITY],
+      e.g. "jpeg:85", "png" or "qoi" */
+  static TileCodecPtr from_string(const std::string& spec);
+
+  /** Returns a default instance of the codec handling \a format */
+  static const TileCodec& get(TileEntry::Format format);
+
+private:
+  TileCodec(const TileCodec&);
+  TileCodec& operator=(const TileCodec&);
+};
+
+#endif
+
+/* EOF */
@@ -19,30 +19,53 @@
 #include "database/tile_database.hpp"
 
 #include <iostream>
+#include <string.h>
 
 #include "database/tile_entry.hpp"
 #include "database/file_entry.hpp"
 #include "database/database.hpp"
-#include "plugins/jpeg.hpp"
-#include "plugins/png.hpp"
+#include "util/log.hpp"
 #include "util/software_surface_factory.hpp"
+#include "util/xxhash64.hpp"
+
+namespace {
+
+/** Blank and solid colored tiles compress to a few hundred bytes,
+    tiles up to this size are looked up in the blobs table and stored
+    only once, larger ones are practically never identical */
+const int kMaxSharedBlobSize = 4096;
+
+} // namespace
 
-TileDatabase::TileDatabase(SQLiteConnection& db, FileDatabase& files)
+TileDatabase::TileDatabase(SQLiteConnection& db, FileDatabase& files, const TileCodec& codec)
   : m_db(db),
     m_files(files),
+    m_codec(codec),
     m_tiles_table(m_db),
-    m_tile_entry_store(m_db),
+    m_tile_entry_store(m_db, codec),
     m_tile_entry_get_all_by_file_entry(m_db),
     m_tile_entry_has(m_db),
     m_tile_entry_get_by_file_entry(m_db),
     m_tile_entry_get_min_max_scale(m_db),
     m_tile_entry_delete(m_db),
-    m_cache()
+    m_tile_blob_get(m_db),
+    m_tile_blob_store(m_db),
+    m_cache(),
+    m_shared_tiles(0),
+    m_duplicate_tiles(0),
+    m_saved_bytes(0)
 {}
 
 TileDatabase::~TileDatabase()
 {
   flush_cache();
+
+  if (m_shared_tiles || m_duplicate_tiles)
+  {
+    log_info << m_shared_tiles << " tiles stored as shared blobs, "
+             << m_duplicate_tiles << " tiles of duplicate files skipped, "
+             << m_saved_bytes / 1024 << " KB saved" << std::endl;
+  }
 }
 
 bool
@@ -135,11 +158,71 @@ TileDatabase::store_tiles(const std::vector<TileEntry>& tiles)
   m_db.exec("BEGIN;");
   for(std::vector<TileEntry>::const_iterator i = tiles.begin(); i != tiles.end(); ++i)
   {
-    m_tile_entry_store(*i);
+    TileEntry tile = *i;
+
+    if (tile.get_file_entry().is_duplicate() &&
+        m_tile_entry_has(tile.get_file_entry(), tile.get_pos(), tile.get_scale()))
+    {
+      // an identical file already stored this tile
+      m_duplicate_tiles += 1;
+      if (tile.get_blob())
+      {
+        m_saved_bytes += tile.get_blob()->size();
+      }
+    }
+    else
+    {
+      if (!tile.get_blob())
+      {
+        m_codec.encode(tile);
+      }
+
+      if (tile.get_blob()->size() <= kMaxSharedBlobSize)
+      {
+        store_shared_tile(tile);
+      }
+      else
+      {
+        m_tile_entry_store(tile);
+      }
+    }
   }
   m_db.exec("END;");
 }
 
+void
+TileDatabase::store_shared_tile(const TileEntry& tile)
+{
+  const BlobPtr& blob = tile.get_blob();
+  int64_t hash = static_cast<int64_t>(XXHash64::from_data(blob->get_data(), blob->size()));
+
+  if (hash == 0)
+  {
+    // 0 marks a tile without blobid
+    m_tile_entry_store(tile);
+    return;
+  }
+
+  BlobPtr shared = m_tile_blob_get(hash);
+  if (!shared)
+  {
+    m_tile_blob_store(hash, blob);
+    m_tile_entry_store(tile, hash);
+  }
+  else if (shared->size() == blob->size() &&
+           memcmp(shared->get_data(), blob->get_data(), blob->size()) == 0)
+  {
+    m_tile_entry_store(tile, hash);
+    m_shared_tiles += 1;
+    m_saved_bytes  += blob->size();
+  }
+  else
+  {
+    // hash collision, the tile keeps its data to itself
+    m_tile_entry_store(tile);
+  }
+}
+
 void
 TileDatabase::delete_tiles(const FileId& fileid)
 {
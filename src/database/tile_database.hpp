@@ -23,8 +23,10 @@
 #include "math/vector2i.hpp"
 
 #include "galapix/tile.hpp"
-#include "database/file_tile_database.hpp"
+#include "database/tile_database_interface.hpp"
 #include "database/tiles_table.hpp"
+#include "database/tile_blob_get_statement.hpp"
+#include "database/tile_blob_store_statement.hpp"
 #include "database/tile_entry_get_all_by_file_entry_statement.hpp"
 #include "database/tile_entry_has_statement.hpp"
 #include "database/tile_entry_get_all_statement.hpp"
@@ -36,6 +38,7 @@
 
 class Database;
 class FileDatabase;
+class TileCodec;
 class FileEntry;
 class TileEntry;
 
@@ -44,6 +47,7 @@ class TileDatabase : public TileDatabaseInterface
 private:
   SQLiteConnection& m_db;
   FileDatabase& m_files;
+  const TileCodec& m_codec;
 
   TilesTable m_tiles_table;
   TileEntryStoreStatement             m_tile_entry_store;
@@ -52,11 +56,20 @@ private:
   TileEntryGetByFileEntryStatement    m_tile_entry_get_by_file_entry;
   TileEntryGetMinMaxScaleStatement    m_tile_entry_get_min_max_scale;
   TileEntryDeleteStatement            m_tile_entry_delete;
+  TileBlobGetStatement                m_tile_blob_get;
+  TileBlobStoreStatement              m_tile_blob_store;
   
   TileCache m_cache;
 
+  /** Tiles stored as a reference to an already stored blob and
+      tiles of duplicate files that were already present, along with
+      the bytes that didn't have to be written for them */
+  int     m_shared_tiles;
+  int     m_duplicate_tiles;
+  int64_t m_saved_bytes;
+
 public:
-  TileDatabase(SQLiteConnection& db, FileDatabase& files);
+  TileDatabase(SQLiteConnection& db, FileDatabase& files, const TileCodec& codec);
   ~TileDatabase();
   
   bool has_tile(const FileEntry& file_entry, const Vector2i& pos, int scale);
@@ -71,6 +84,9 @@ public:
 
   void flush_cache();
 
+private:
+  void store_shared_tile(const TileEntry& tile);
+
 private:
   TileDatabase (const TileDatabase&);
   TileDatabase& operator= (const TileDatabase&);
@@ -30,7 +30,8 @@ public:
   {
     UNKNOWN_FORMAT = -1,
     JPEG_FORMAT =  0,
-    PNG_FORMAT  =  1
+    PNG_FORMAT  =  1,
+    QOI_FORMAT  =  2
   };
 
 private:
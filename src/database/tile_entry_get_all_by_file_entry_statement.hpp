@@ -24,8 +24,7 @@
 #include "database/file_entry.hpp"
 #include "database/tile_entry.hpp"
 #include "util/software_surface_factory.hpp"
-#include "plugins/png.hpp"
-#include "plugins/jpeg.hpp"
+#include "database/tile_codec.hpp"
 
 class TileEntryGetAllByFileEntryStatement
 {
@@ -34,14 +33,16 @@ private:
 
 public:
   TileEntryGetAllByFileEntryStatement(SQLiteConnection& db) :
-    m_stmt(db, "SELECT * FROM tiles WHERE fileid = ?1;")
+    m_stmt(db, "SELECT tiles.fileid, tiles.scale, tiles.x, tiles.y, COALESCE(tiles.data, blobs.data), tiles.quality, tiles.format "
+               "FROM tiles LEFT JOIN blobs ON blobs.hash = tiles.blobid "
+               "WHERE tiles.fileid = ?1;")
   {}
 
   void operator()(const FileEntry& file_entry, std::vector<TileEntry>& tiles)
   {
-    if (file_entry.get_fileid())
+    if (file_entry.get_tile_fileid())
     {
-      m_stmt.bind_int64(1, file_entry.get_fileid().get_id());
+      m_stmt.bind_int64(1, file_entry.get_tile_fileid().get_id());
 
       SQLiteReader reader = m_stmt.execute_query();
       while(reader.next())
@@ -56,20 +57,7 @@ public:
         // FIXME: TileEntry shouldn't contain a SoftwareSurface, but a
         // Blob, so we don't do encode/decode when doing a database
         // merge
-        BlobPtr blob = tile.get_blob();
-        switch(tile.get_format())
-        {
-          case TileEntry::JPEG_FORMAT:
-            tile.set_surface(JPEG::load_from_mem(blob->get_data(), blob->size()));
-            break;
-
-          case TileEntry::PNG_FORMAT:
-            tile.set_surface(PNG::load_from_mem(blob->get_data(), blob->size()));
-            break;
-
-          default:
-            assert(!"never reached");
-        }
+        TileCodec::decode(tile);
 
         tiles.push_back(tile);
       }
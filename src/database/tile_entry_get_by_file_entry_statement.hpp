@@ -19,8 +19,7 @@
 #ifndef HEADER_GALAPIX_DATABASE_TILE_ENTRY_GET_BY_FILE_ENTRY_STATEMENT_HPP
 #define HEADER_GALAPIX_DATABASE_TILE_ENTRY_GET_BY_FILE_ENTRY_STATEMENT_HPP
 
-#include "plugins/png.hpp"
-#include "plugins/jpeg.hpp"
+#include "database/tile_codec.hpp"
 
 class TileEntryGetByFileEntryStatement
 {
@@ -29,18 +28,20 @@ private:
 
 public:
   TileEntryGetByFileEntryStatement(SQLiteConnection& db) :
-    m_stmt(db, "SELECT * FROM tiles WHERE fileid = ?1 AND scale = ?2 AND x = ?3 AND y = ?4;")
+    m_stmt(db, "SELECT tiles.fileid, tiles.scale, tiles.x, tiles.y, COALESCE(tiles.data, blobs.data), tiles.quality, tiles.format "
+               "FROM tiles LEFT JOIN blobs ON blobs.hash = tiles.blobid "
+               "WHERE tiles.fileid = ?1 AND tiles.scale = ?2 AND tiles.x = ?3 AND tiles.y = ?4;")
   {}
 
   bool operator()(const FileEntry& file_entry, int scale, const Vector2i& pos, TileEntry& tile)
   {
-    if (!file_entry.get_fileid())
+    if (!file_entry.get_tile_fileid())
     {
       return false;
     }
     else
     {
-      m_stmt.bind_int64(1, file_entry.get_fileid().get_id());
+      m_stmt.bind_int64(1, file_entry.get_tile_fileid().get_id());
       m_stmt.bind_int(2, scale);
       m_stmt.bind_int(3, pos.x);
       m_stmt.bind_int(4, pos.y);
@@ -56,20 +57,7 @@ public:
                          reader.get_blob(4),
                          static_cast<TileEntry::Format>(reader.get_int(6)));
 
-        BlobPtr blob = tile.get_blob();
-        switch(tile.get_format())
-        {
-          case TileEntry::JPEG_FORMAT:
-            tile.set_surface(JPEG::load_from_mem(blob->get_data(), blob->size()));
-            break;
-
-          case TileEntry::PNG_FORMAT:
-            tile.set_surface(PNG::load_from_mem(blob->get_data(), blob->size()));
-            break;
-
-          default:
-            assert(!"never reached");
-        }
+        TileCodec::decode(tile);
       
         return true;
       }
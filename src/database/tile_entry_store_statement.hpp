@@ -21,24 +21,30 @@
 
 #include <iostream>
 
+#include "database/tile_codec.hpp"
+
 class TileEntryStoreStatement
 {
 private:
   SQLiteStatement m_stmt;
+  const TileCodec& m_codec;
 
 public:
-  TileEntryStoreStatement(SQLiteConnection& db) :
-    m_stmt(db, "INSERT into tiles (fileid, scale, x, y, data, quality, format) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7);")
+  TileEntryStoreStatement(SQLiteConnection& db, const TileCodec& codec) :
     // FIXME: This is brute force and doesn't handle collisions
+    m_stmt(db, "INSERT into tiles (fileid, scale, x, y, data, quality, format, blobid) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8);"),
+    m_codec(codec)
   {}
 
-  void operator()(const TileEntry& tile_)
+  /** Stores the tile with its data inline, or, if \a blobid is
+      given, as a reference to that entry in the blobs table */
+  void operator()(const TileEntry& tile_, int64_t blobid = 0)
   {
     TileEntry tile = tile_;
   
     if (0)
       std::cout << "store_tile("
-                << "fileid: " << tile.get_file_entry().get_fileid() 
+                << "fileid: " << tile.get_file_entry().get_tile_fileid() 
                 << ", scale: " << tile.get_scale() 
                 << ", pos: " << tile.get_pos() << ")" << std::endl;
 
@@ -46,33 +52,33 @@ public:
     {
       // Tile doesn't have a Blob, so we assume it has a surface and
       // we generate the Blob from that
-      switch(tile.get_surface()->get_format())
-      {
-        case SoftwareSurface::RGB_FORMAT:
-          tile.set_blob(JPEG::save(tile.get_surface(), 75));
-          tile.set_format(TileEntry::JPEG_FORMAT);
-          break;
-
-        case SoftwareSurface::RGBA_FORMAT:
-          tile.set_blob(PNG::save(tile.get_surface()));
-          tile.set_format(TileEntry::PNG_FORMAT);
-          break;
-
-        default:
-          assert(!"TileDatabase::store_tile: Unhandled format");
-          break;
-      }
+      m_codec.encode(tile);
     }
 
     // FIXME: We need to update a already existing record, instead of
     // just storing a duplicate
-    m_stmt.bind_int64(1, tile.get_file_entry().get_fileid().get_id());
+    m_stmt.bind_int64(1, tile.get_file_entry().get_tile_fileid().get_id());
     m_stmt.bind_int (2, tile.get_scale());
     m_stmt.bind_int (3, tile.get_pos().x);
     m_stmt.bind_int (4, tile.get_pos().y);
-    m_stmt.bind_blob(5, tile.get_blob());
+    if (blobid)
+    {
+      m_stmt.bind_null(5);
+    }
+    else
+    {
+      m_stmt.bind_blob(5, tile.get_blob());
+    }
     m_stmt.bind_int (6, 0);
     m_stmt.bind_int (7, tile.get_format());
+    if (blobid)
+    {
+      m_stmt.bind_int64(8, blobid);
+    }
+    else
+    {
+      m_stmt.bind_null(8);
+    }
 
     m_stmt.execute();
   }
@@ -0,0 +1,73 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "database/tile_owner_lookup.hpp"
+
+#include "database/database.hpp"
+#include "util/filesystem.hpp"
+#include "util/log.hpp"
+
+TileOwnerLookup::TileOwnerLookup(const Database& database) :
+  m_db(database.get_prefix() + "/cache3.sqlite3"),
+  m_file_entry_get_tile_owner(m_db),
+  m_mutex()
+{
+}
+
+TileOwnerLookup::~TileOwnerLookup()
+{
+}
+
+FileId
+TileOwnerLookup::find(const FileEntry& file_entry)
+{
+  if (!file_entry.get_hash() || !file_entry.get_url().has_stdio_name())
+  {
+    return FileId();
+  }
+
+  std::vector<std::pair<FileId, URL> > candidates;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_file_entry_get_tile_owner(file_entry, candidates);
+  }
+
+  for(std::vector<std::pair<FileId, URL> >::const_iterator i = candidates.begin(); i != candidates.end(); ++i)
+  {
+    if (i->second.has_stdio_name())
+    {
+      try
+      {
+        if (Filesystem::has_same_content(file_entry.get_url().get_stdio_name(), i->second.get_stdio_name()))
+        {
+          log_info << file_entry.get_url() << ": identical to fileid " << i->first << ", sharing its tiles" << std::endl;
+          return i->first;
+        }
+      }
+      catch(const std::exception& err)
+      {
+        // a file that can't be read doesn't match anything
+        log_warning << err.what() << std::endl;
+      }
+    }
+  }
+
+  return FileId();
+}
+
+/* EOF */
@@ -0,0 +1,63 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_DATABASE_TILE_OWNER_LOOKUP_HPP
+#define HEADER_GALAPIX_DATABASE_TILE_OWNER_LOOKUP_HPP
+
+#include <mutex>
+
+#include "sqlite/connection.hpp"
+#include "sqlite/statement.hpp"
+#include "database/file_entry.hpp"
+#include "database/file_entry_get_tile_owner_statement.hpp"
+
+class Database;
+
+/** Finds a file with the same content as a new FileEntry, so that
+    the new file can share its tiles. It has a connection of its own
+    and can be used from any thread, the files are compared in the
+    calling thread, not in the one writing the Database. Entries
+    still waiting in the write cache of the Database aren't visible,
+    a file identical to one of them just gets tiles of its own. */
+class TileOwnerLookup
+{
+private:
+  SQLiteConnection m_db;
+  FileEntryGetTileOwnerStatement m_file_entry_get_tile_owner;
+  std::mutex m_mutex;
+
+public:
+  /** Opens the same file table as \a database */
+  TileOwnerLookup(const Database& database);
+  ~TileOwnerLookup();
+
+  /** Returns the FileId the tiles of a file with the same content
+      as \a file_entry are stored under, or an empty FileId if there
+      is none. Only files with the same hash, size and image size get
+      compared and only local ones, the others would have to be
+      fetched again. */
+  FileId find(const FileEntry& file_entry);
+
+private:
+  TileOwnerLookup(const TileOwnerLookup&);
+  TileOwnerLookup& operator=(const TileOwnerLookup&);
+};
+
+#endif
+
+/* EOF */
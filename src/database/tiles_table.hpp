@@ -33,14 +33,43 @@ public:
                "scale   INTEGER, " // zoom level
                "x       INTEGER, " // X position in tiles
                "y       INTEGER, " // Y position in tiles
-               "data    BLOB,    " // the image data, JPEG
+               "data    BLOB,    " // the image data, encoded as given by format
                "quality INTEGER, " // the quality of the tile (default: 0) FIXME: not used
-               "format  INTEGER"   // format of the data (0: JPEG, 1: PNG)
+               "format  INTEGER, " // format of the data (0: JPEG, 1: PNG, 2: QOI)
+               "blobid  INTEGER"   // refers to blobs.hash when data is NULL
                ");");
 
+    // small tiles that come up again and again, blank margins and
+    // solid pages, are stored once and referenced by their hash
+    m_db.exec("CREATE TABLE IF NOT EXISTS blobs ("
+               "hash    INTEGER PRIMARY KEY, " // xxHash64 of data
+               "data    BLOB"
+               ");");
+
+    // databases from before blob sharing lack the blobid column
+    if (!has_blobid_column())
+    {
+      m_db.exec("ALTER TABLE tiles ADD COLUMN blobid INTEGER;");
+    }
+
     m_db.exec("CREATE INDEX IF NOT EXISTS tiles_index ON tiles ( fileid );");
   }
 
+private:
+  bool has_blobid_column()
+  {
+    SQLiteStatement stmt(m_db, "PRAGMA table_info(tiles);");
+    SQLiteReader reader = stmt.execute_query();
+    while(reader.next())
+    {
+      if (reader.get_text(1) == "blobid")
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
 private:
   TilesTable(const TilesTable&);
   TilesTable& operator=(const TilesTable&);
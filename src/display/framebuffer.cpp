@@ -18,6 +18,7 @@
 
 #include "display/framebuffer.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
@@ -26,6 +27,116 @@
 #include "math/rgb.hpp"
 #include "math/rgba.hpp"
 #include "math/rect.hpp"
+#include "math/size.hpp"
+#include "math/vector2f.hpp"
+
+namespace {
+
+/** 5x8 pixel glyphs for the printable ASCII characters, one byte per
+    column, the lowest bit is the top row */
+const uint8_t kFont5x8[95][5] = {
+  { 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+  { 0x00, 0x00, 0x5F, 0x00, 0x00 }, // '!'
+  { 0x00, 0x07, 0x00, 0x07, 0x00 }, // '"'
+  { 0x14, 0x7F, 0x14, 0x7F, 0x14 }, // '#'
+  { 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, // '$'
+  { 0x23, 0x13, 0x08, 0x64, 0x62 }, // '%'
+  { 0x36, 0x49, 0x56, 0x20, 0x50 }, // '&'
+  { 0x00, 0x08, 0x07, 0x03, 0x00 }, // '''
+  { 0x00, 0x1C, 0x22, 0x41, 0x00 }, // '('
+  { 0x00, 0x41, 0x22, 0x1C, 0x00 }, // ')'
+  { 0x2A, 0x1C, 0x7F, 0x1C, 0x2A }, // '*'
+  { 0x08, 0x08, 0x3E, 0x08, 0x08 }, // '+'
+  { 0x00, 0x80, 0x70, 0x30, 0x00 }, // ','
+  { 0x08, 0x08, 0x08, 0x08, 0x08 }, // '-'
+  { 0x00, 0x00, 0x60, 0x60, 0x00 }, // '.'
+  { 0x20, 0x10, 0x08, 0x04, 0x02 }, // '/'
+  { 0x3E, 0x51, 0x49, 0x45, 0x3E }, // '0'
+  { 0x00, 0x42, 0x7F, 0x40, 0x00 }, // '1'
+  { 0x42, 0x61, 0x51, 0x49, 0x46 }, // '2'
+  { 0x21, 0x41, 0x45, 0x4B, 0x31 }, // '3'
+  { 0x18, 0x14, 0x12, 0x7F, 0x10 }, // '4'
+  { 0x27, 0x45, 0x45, 0x45, 0x39 }, // '5'
+  { 0x3C, 0x4A, 0x49, 0x49, 0x31 }, // '6'
+  { 0x41, 0x21, 0x11, 0x09, 0x07 }, // '7'
+  { 0x36, 0x49, 0x49, 0x49, 0x36 }, // '8'
+  { 0x46, 0x49, 0x49, 0x29, 0x1E }, // '9'
+  { 0x00, 0x00, 0x14, 0x00, 0x00 }, // ':'
+  { 0x00, 0x40, 0x34, 0x00, 0x00 }, // ';'
+  { 0x00, 0x08, 0x14, 0x22, 0x41 }, // '<'
+  { 0x14, 0x14, 0x14, 0x14, 0x14 }, // '='
+  { 0x00, 0x41, 0x22, 0x14, 0x08 }, // '>'
+  { 0x02, 0x01, 0x59, 0x09, 0x06 }, // '?'
+  { 0x3E, 0x41, 0x5D, 0x59, 0x4E }, // '@'
+  { 0x7C, 0x12, 0x11, 0x12, 0x7C }, // 'A'
+  { 0x7F, 0x49, 0x49, 0x49, 0x36 }, // 'B'
+  { 0x3E, 0x41, 0x41, 0x41, 0x22 }, // 'C'
+  { 0x7F, 0x41, 0x41, 0x41, 0x3E }, // 'D'
+  { 0x7F, 0x49, 0x49, 0x49, 0x41 }, // 'E'
+  { 0x7F, 0x09, 0x09, 0x09, 0x01 }, // 'F'
+  { 0x3E, 0x41, 0x41, 0x51, 0x73 }, // 'G'
+  { 0x7F, 0x08, 0x08, 0x08, 0x7F }, // 'H'
+  { 0x00, 0x41, 0x7F, 0x41, 0x00 }, // 'I'
+  { 0x20, 0x40, 0x41, 0x3F, 0x01 }, // 'J'
+  { 0x7F, 0x08, 0x14, 0x22, 0x41 }, // 'K'
+  { 0x7F, 0x40, 0x40, 0x40, 0x40 }, // 'L'
+  { 0x7F, 0x02, 0x1C, 0x02, 0x7F }, // 'M'
+  { 0x7F, 0x04, 0x08, 0x10, 0x7F }, // 'N'
+  { 0x3E, 0x41, 0x41, 0x41, 0x3E }, // 'O'
+  { 0x7F, 0x09, 0x09, 0x09, 0x06 }, // 'P'
+  { 0x3E, 0x41, 0x51, 0x21, 0x5E }, // 'Q'
+  { 0x7F, 0x09, 0x19, 0x29, 0x46 }, // 'R'
+  { 0x26, 0x49, 0x49, 0x49, 0x32 }, // 'S'
+  { 0x03, 0x01, 0x7F, 0x01, 0x03 }, // 'T'
+  { 0x3F, 0x40, 0x40, 0x40, 0x3F }, // 'U'
+  { 0x1F, 0x20, 0x40, 0x20, 0x1F }, // 'V'
+  { 0x3F, 0x40, 0x38, 0x40, 0x3F }, // 'W'
+  { 0x63, 0x14, 0x08, 0x14, 0x63 }, // 'X'
+  { 0x03, 0x04, 0x78, 0x04, 0x03 }, // 'Y'
+  { 0x61, 0x59, 0x49, 0x4D, 0x43 }, // 'Z'
+  { 0x00, 0x7F, 0x41, 0x41, 0x41 }, // '['
+  { 0x02, 0x04, 0x08, 0x10, 0x20 }, // '\'
+  { 0x00, 0x41, 0x41, 0x41, 0x7F }, // ']'
+  { 0x04, 0x02, 0x01, 0x02, 0x04 }, // '^'
+  { 0x40, 0x40, 0x40, 0x40, 0x40 }, // '_'
+  { 0x00, 0x03, 0x07, 0x08, 0x00 }, // '`'
+  { 0x20, 0x54, 0x54, 0x78, 0x40 }, // 'a'
+  { 0x7F, 0x28, 0x44, 0x44, 0x38 }, // 'b'
+  { 0x38, 0x44, 0x44, 0x44, 0x28 }, // 'c'
+  { 0x38, 0x44, 0x44, 0x28, 0x7F }, // 'd'
+  { 0x38, 0x54, 0x54, 0x54, 0x18 }, // 'e'
+  { 0x00, 0x08, 0x7E, 0x09, 0x02 }, // 'f'
+  { 0x18, 0xA4, 0xA4, 0x9C, 0x78 }, // 'g'
+  { 0x7F, 0x08, 0x04, 0x04, 0x78 }, // 'h'
+  { 0x00, 0x44, 0x7D, 0x40, 0x00 }, // 'i'
+  { 0x20, 0x40, 0x40, 0x3D, 0x00 }, // 'j'
+  { 0x7F, 0x10, 0x28, 0x44, 0x00 }, // 'k'
+  { 0x00, 0x41, 0x7F, 0x40, 0x00 }, // 'l'
+  { 0x7C, 0x04, 0x78, 0x04, 0x78 }, // 'm'
+  { 0x7C, 0x08, 0x04, 0x04, 0x78 }, // 'n'
+  { 0x38, 0x44, 0x44, 0x44, 0x38 }, // 'o'
+  { 0xFC, 0x24, 0x24, 0x24, 0x18 }, // 'p'
+  { 0x18, 0x24, 0x24, 0x24, 0xFC }, // 'q'
+  { 0x7C, 0x08, 0x04, 0x04, 0x08 }, // 'r'
+  { 0x48, 0x54, 0x54, 0x54, 0x24 }, // 's'
+  { 0x04, 0x04, 0x3F, 0x44, 0x24 }, // 't'
+  { 0x3C, 0x40, 0x40, 0x20, 0x7C }, // 'u'
+  { 0x1C, 0x20, 0x40, 0x20, 0x1C }, // 'v'
+  { 0x3C, 0x40, 0x30, 0x40, 0x3C }, // 'w'
+  { 0x44, 0x28, 0x10, 0x28, 0x44 }, // 'x'
+  { 0x4C, 0x90, 0x90, 0x90, 0x7C }, // 'y'
+  { 0x44, 0x64, 0x54, 0x4C, 0x44 }, // 'z'
+  { 0x00, 0x08, 0x36, 0x41, 0x00 }, // '{'
+  { 0x00, 0x00, 0x77, 0x00, 0x00 }, // '|'
+  { 0x00, 0x41, 0x36, 0x08, 0x00 }, // '}'
+  { 0x02, 0x01, 0x02, 0x04, 0x02 }  // '~'
+};
+
+/** Glyph size including the spacing to the next glyph and line */
+const int kGlyphAdvance    = 6;
+const int kGlyphLineHeight = 10;
+
+} // namespace
 
 Size Framebuffer::size;
 
@@ -119,6 +230,22 @@ Framebuffer::fill_rect(const Rectf& rect, const RGB& rgb)
   glEnd();
 }
 
+void
+Framebuffer::fill_rect(const Rectf& rect, const RGBA& rgba)
+{
+  glDisable(GL_TEXTURE_RECTANGLE_ARB);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  glColor4ub(rgba.r, rgba.g, rgba.b, rgba.a);
+  glBegin(GL_QUADS);
+  glVertex2f(rect.left,  rect.top);
+  glVertex2f(rect.right, rect.top);
+  glVertex2f(rect.right, rect.bottom);
+  glVertex2f(rect.left,  rect.bottom);
+  glEnd();
+}
+
 void
 Framebuffer::draw_grid(int num_cells)
 {
@@ -173,6 +300,77 @@ Framebuffer::draw_grid(const Vector2f& offset, const Sizef& size_, const RGBA& r
   glEnd();  
 }
 
+void
+Framebuffer::draw_text(const Vector2f& pos, const std::string& text, const RGBA& rgba, float pixel_size)
+{
+  glDisable(GL_TEXTURE_RECTANGLE_ARB);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  glColor4ub(rgba.r, rgba.g, rgba.b, rgba.a);
+  glBegin(GL_QUADS);
+
+  float x = pos.x;
+  float y = pos.y;
+  for(std::string::const_iterator c = text.begin(); c != text.end(); ++c)
+  {
+    if (*c == '\n')
+    {
+      x  = pos.x;
+      y += kGlyphLineHeight * pixel_size;
+    }
+    else
+    {
+      int idx = (*c < 32 || *c > 126) ? '?' - 32 : *c - 32;
+
+      for(int col = 0; col < 5; ++col)
+      {
+        for(int row = 0; row < 8; ++row)
+        {
+          if (kFont5x8[idx][col] & (1 << row))
+          {
+            float px = x + col * pixel_size;
+            float py = y + row * pixel_size;
+
+            glVertex2f(px,              py);
+            glVertex2f(px + pixel_size, py);
+            glVertex2f(px + pixel_size, py + pixel_size);
+            glVertex2f(px,              py + pixel_size);
+          }
+        }
+      }
+
+      x += kGlyphAdvance * pixel_size;
+    }
+  }
+
+  glEnd();
+}
+
+Sizef
+Framebuffer::get_text_size(const std::string& text, float pixel_size)
+{
+  int columns = 0;
+  int lines   = 1;
+  int column  = 0;
+  for(std::string::const_iterator c = text.begin(); c != text.end(); ++c)
+  {
+    if (*c == '\n')
+    {
+      lines += 1;
+      column = 0;
+    }
+    else
+    {
+      column += 1;
+      columns = std::max(columns, column);
+    }
+  }
+
+  return Sizef(static_cast<float>(columns * kGlyphAdvance) * pixel_size,
+               static_cast<float>(lines * kGlyphLineHeight) * pixel_size);
+}
+
 int
 Framebuffer::get_width()
 {
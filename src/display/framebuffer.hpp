@@ -23,6 +23,8 @@
 #include <GL/gl.h>
 #include <GL/glu.h>
 
+#include <string>
+
 #include "math/size.hpp"
 #include "util/software_surface.hpp"
 
@@ -55,9 +57,15 @@ public:
   static void clear(const RGBA& rgba);
   static void draw_rect(const Rectf& rect, const RGB& rgb);
   static void fill_rect(const Rectf& rect, const RGB& rgb);
+  static void fill_rect(const Rectf& rect, const RGBA& rgba);
   static void draw_grid(int num_cells);
   static void draw_grid(const Vector2f& offset, const Sizef& size, const RGBA& rgba);
 
+  /** Draws \a text with a built-in 5x8 pixel font, each font pixel
+      becomes a square of \a pixel_size, '\n' starts a new line */
+  static void draw_text(const Vector2f& pos, const std::string& text, const RGBA& rgba, float pixel_size = 1.0f);
+  static Sizef get_text_size(const std::string& text, float pixel_size = 1.0f);
+
   static SoftwareSurfacePtr screenshot();
   static void apply_gamma_ramp(float contrast, float brightness, float gamma);
 };
@@ -22,6 +22,7 @@
 
 #include "math/rect.hpp"
 #include "display/framebuffer.hpp"
+#include "util/trace.hpp"
 
 class TextureImpl
 {
@@ -35,6 +36,9 @@ public:
   {
     assert(src);
 
+    TRACE_SPAN("gl", "texture_upload");
+    TRACE_COUNT("gl/texture_upload_bytes", size.width * size.height * src->get_bytes_per_pixel());
+
     glGenTextures(1, &handle); 
     glBindTexture(GL_TEXTURE_RECTANGLE_ARB, handle);
     glEnable(GL_TEXTURE_RECTANGLE_ARB);
@@ -80,9 +84,13 @@ public:
   }
 };
 
+std::atomic<int64_t> Texture::s_upload_bytes(0);
+
 TexturePtr
 Texture::create(const SoftwareSurfacePtr& src, const Rect& srcrect)
 {
+  s_upload_bytes.fetch_add(static_cast<int64_t>(srcrect.get_width()) * srcrect.get_height() * src->get_bytes_per_pixel(),
+                           std::memory_order_relaxed);
   return TexturePtr(new Texture(src, srcrect));
 }
 
@@ -19,7 +19,9 @@
 #ifndef HEADER_GALAPIX_DISPLAY_TEXTURE_HPP
 #define HEADER_GALAPIX_DISPLAY_TEXTURE_HPP
 
+#include <atomic>
 #include <memory>
+#include <stdint.h>
 
 #include "util/software_surface.hpp"
 
@@ -33,6 +35,13 @@ typedef std::shared_ptr<Texture> TexturePtr;
 
 class Texture
 {
+private:
+  static std::atomic<int64_t> s_upload_bytes;
+
+public:
+  /** Bytes uploaded to OpenGL by all Textures so far */
+  static int64_t get_upload_bytes() { return s_upload_bytes.load(std::memory_order_relaxed); }
+
 private:
   Texture(const SoftwareSurfacePtr& src, const Rect& srcrect);
 
@@ -0,0 +1,165 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "galapix/binary_workspace.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "galapix/image.hpp"
+#include "galapix/image_collection.hpp"
+#include "util/mapped_file.hpp"
+
+namespace {
+
+const char magic[8] = { 'G', 'L', 'P', 'X', 'W', 'K', 'S', 'P' };
+const uint32_t current_version = 1;
+
+struct Header
+{
+  char     magic[8];
+  uint32_t version;
+  uint32_t num_images;
+  uint64_t strings_offset;
+  uint64_t strings_size;
+};
+
+struct Record
+{
+  uint32_t url_offset;
+  uint32_t url_length;
+  float x;
+  float y;
+  float scale;
+  float angle;
+};
+
+static_assert(sizeof(Header) == 32, "binary workspace header must be packed");
+static_assert(sizeof(Record) == 24, "binary workspace record must be packed");
+
+} // namespace
+
+bool
+BinaryWorkspace::is_binary(const std::string& filename)
+{
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  char buf[sizeof(magic)];
+  return in.read(buf, sizeof(buf)) && memcmp(buf, magic, sizeof(magic)) == 0;
+}
+
+void
+BinaryWorkspace::save(std::ostream& out, const ImageCollection& images)
+{
+  std::vector<Record> records;
+  records.reserve(images.size());
+  std::string strings;
+
+  if (images.size() > UINT32_MAX)
+  {
+    throw std::runtime_error("BinaryWorkspace::save(): too many images");
+  }
+
+  for(ImageCollection::const_iterator i = images.begin(); i != images.end(); ++i)
+  {
+    const std::string& url = (*i)->get_url().str();
+
+    // offsets into the string table are only 32 bit wide
+    if (url.size() > UINT32_MAX - strings.size())
+    {
+      throw std::runtime_error("BinaryWorkspace::save(): string table exceeds 4GiB");
+    }
+
+    Record record;
+    record.url_offset = static_cast<uint32_t>(strings.size());
+    record.url_length = static_cast<uint32_t>(url.size());
+    record.x     = (*i)->get_pos().x;
+    record.y     = (*i)->get_pos().y;
+    record.scale = (*i)->get_scale();
+    record.angle = (*i)->get_angle();
+    records.push_back(record);
+
+    strings += url;
+  }
+
+  Header header;
+  memcpy(header.magic, magic, sizeof(magic));
+  header.version    = current_version;
+  header.num_images = static_cast<uint32_t>(records.size());
+  header.strings_offset = sizeof(Header) + records.size() * sizeof(Record);
+  header.strings_size   = strings.size();
+
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+  out.write(strings.data(), strings.size());
+}
+
+void
+BinaryWorkspace::load(const std::string& filename, ImageCollection& images)
+{
+  MappedFile file(filename);
+
+  if (file.size() < sizeof(Header))
+  {
+    throw std::runtime_error("BinaryWorkspace::load(): " + filename + ": file too short");
+  }
+
+  Header header;
+  memcpy(&header, file.get_data(), sizeof(header));
+
+  if (memcmp(header.magic, magic, sizeof(magic)) != 0)
+  {
+    throw std::runtime_error("BinaryWorkspace::load(): " + filename + ": not a binary workspace");
+  }
+
+  if (header.version != current_version)
+  {
+    throw std::runtime_error("BinaryWorkspace::load(): " + filename + ": unsupported version");
+  }
+
+  const uint64_t records_end = sizeof(Header) + static_cast<uint64_t>(header.num_images) * sizeof(Record);
+  if (records_end > header.strings_offset ||
+      header.strings_offset > file.size() ||
+      header.strings_size > file.size() - header.strings_offset)
+  {
+    throw std::runtime_error("BinaryWorkspace::load(): " + filename + ": file is corrupt");
+  }
+
+  const Record* records = reinterpret_cast<const Record*>(file.get_data() + sizeof(Header));
+  const char* strings = reinterpret_cast<const char*>(file.get_data() + header.strings_offset);
+
+  for(uint32_t i = 0; i < header.num_images; ++i)
+  {
+    const Record& record = records[i];
+
+    if (static_cast<uint64_t>(record.url_offset) + record.url_length > header.strings_size)
+    {
+      throw std::runtime_error("BinaryWorkspace::load(): " + filename + ": file is corrupt");
+    }
+
+    ImagePtr image = Image::create(URL::from_string(std::string(strings + record.url_offset, record.url_length)));
+    image->set_pos(Vector2f(record.x, record.y));
+    image->set_scale(record.scale);
+    image->set_angle(record.angle);
+    images.add(image);
+  }
+}
+
+/* EOF */
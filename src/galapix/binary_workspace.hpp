@@ -0,0 +1,58 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_GALAPIX_BINARY_WORKSPACE_HPP
+#define HEADER_GALAPIX_GALAPIX_BINARY_WORKSPACE_HPP
+
+#include <iosfwd>
+#include <string>
+
+class ImageCollection;
+
+/** Compact binary form of a .galapix workspace, the file is mmapped
+    and read in a single pass. Layout, all values in host byte order:
+
+    header:  char magic[8] = "GLPXWKSP", uint32 version, uint32 num_images,
+             uint64 strings_offset, uint64 strings_size
+    records: num_images times { uint32 url_offset, uint32 url_length,
+                                float x, float y, float scale, float angle }
+    strings: the URLs, concatenated without separators
+*/
+class BinaryWorkspace
+{
+public:
+  /** Returns true if \a filename starts with the binary workspace magic */
+  static bool is_binary(const std::string& filename);
+
+  /** Throws std::runtime_error if the URLs don't fit the 32 bit
+      string table offsets */
+  static void save(std::ostream& out, const ImageCollection& images);
+
+  /** Appends the images stored in \a filename to \a images, throws
+      std::runtime_error if the file is truncated or corrupt */
+  static void load(const std::string& filename, ImageCollection& images);
+
+private:
+  BinaryWorkspace();
+  BinaryWorkspace(const BinaryWorkspace&);
+  BinaryWorkspace& operator=(const BinaryWorkspace&);
+};
+
+#endif
+
+/* EOF */
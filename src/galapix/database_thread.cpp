@@ -18,26 +18,118 @@
 
 #include "galapix/database_thread.hpp"
 
+#include <algorithm>
+#include <sys/stat.h>
+#include <thread>
 #include <typeinfo>
+#include <unordered_map>
 
 #include "database/database.hpp"
+#include "database/database_reader.hpp"
+#include "database/tile_owner_lookup.hpp"
 #include "job/job_manager.hpp"
 #include "jobs/file_entry_generation_job.hpp"
 #include "jobs/multiple_tile_generation_job.hpp"
 #include "jobs/tile_generation_job.hpp"
 #include "util/log.hpp"
+#include "util/trace.hpp"
 
+namespace {
+
+struct FileStat
+{
+  bool exists;
+  int  size;
+  int  mtime;
+};
+
+/** Size and mtime as stored in a FileEntry, remote and archive urls
+    report 0 for both, same as URL::get_size() and URL::get_mtime() */
+FileStat stat_url(const URL& url)
+{
+  FileStat result = { true, 0, 0 };
+
+  if (url.has_stdio_name())
+  {
+    struct stat stat_buf;
+    if (stat(url.get_stdio_name().c_str(), &stat_buf) != 0)
+    {
+      result.exists = false;
+    }
+    else
+    {
+      result.size  = static_cast<int>(stat_buf.st_size);
+      result.mtime = static_cast<int>(stat_buf.st_mtime);
+    }
+  }
+
+  return result;
+}
+
+/** stat() all urls, spread over multiple threads, as on a cold cache
+    this is bound by IO latency, not by CPU */
+void stat_urls(const std::vector<URL>& urls, std::vector<FileStat>& stats_out)
+{
+  stats_out.resize(urls.size());
+
+  int num_threads = std::min(8, std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+  if (urls.size() < 1024)
+  {
+    num_threads = 1;
+  }
+
+  auto worker = [&urls, &stats_out, num_threads](int offset) {
+    for(size_t i = offset; i < urls.size(); i += num_threads)
+    {
+      stats_out[i] = stat_url(urls[i]);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for(int i = 1; i < num_threads; ++i)
+  {
+    threads.push_back(std::thread(worker, i));
+  }
+  worker(0);
+
+  for(std::vector<std::thread>::iterator i = threads.begin(); i != threads.end(); ++i)
+  {
+    i->join();
+  }
+}
+
+/** A file that can't be stat()'ed is assumed to be unchanged, so
+    that entries for offline files stay usable */
+bool is_stale(const FileEntry& file_entry, const FileStat& stat)
+{
+  return
+    stat.exists &&
+    (file_entry.get_size()  != stat.size ||
+     file_entry.get_mtime() != stat.mtime);
+}
+
+} // namespace
+
 DatabaseThread* DatabaseThread::current_ = 0;
 
 DatabaseThread::DatabaseThread(Database& database,
-                               JobManager& tile_job_manager) :
+                               JobManager& tile_job_manager,
+                               int num_readers) :
   m_database(database),
   m_tile_job_manager(tile_job_manager),
   m_quit(false),
   m_abort(false),
   m_request_queue(),
   m_receive_queue(256), // FIXME: Make this configurable
-  m_tile_generation_jobs()
+  m_num_readers(std::max(1, num_readers)),
+  m_read_queue(),
+  m_reader_threads(),
+  m_tile_owner_lookup(new TileOwnerLookup(database)),
+  m_wait_stats(),
+  m_tile_generation_jobs(),
+  m_tile_requests_coalesced(0),
+  m_tile_jobs_started(0),
+  m_tile_jobs_duplicate(0)
 {
   assert(current_ == 0);
   current_ = this;
@@ -56,14 +148,13 @@ DatabaseThread::request_tile(const FileEntry& file_entry, int tilescale, const V
 
   JobHandle job_handle_ = JobHandle::create();
 
-  m_request_queue.wait_and_push([this, job_handle_, file_entry, tilescale, pos, callback](){
+  push_read(kTileLookup, [this, job_handle_, file_entry, tilescale, pos, callback](DatabaseReader& reader){
       JobHandle job_handle = job_handle_;
       if (!job_handle.is_aborted())
       {
         TileEntry tile;
-        if (m_database.get_tiles().get_tile(file_entry, tilescale, pos, tile))
+        if (reader.get_tile(file_entry, tilescale, pos, tile))
         {
-          // Tile has been found, so return it and finish up
           if (callback)
           {
             callback(tile);
@@ -72,18 +163,9 @@ DatabaseThread::request_tile(const FileEntry& file_entry, int tilescale, const V
         }
         else
         {
-          // Tile hasn't been found, so we need to generate it
-          if (0)
-            std::cout << "Error: Couldn't get tile: " 
-                      << file_entry.get_fileid() << " "
-                      << pos.x << " "
-                      << pos.y << " "
-                      << tilescale
-                      << std::endl;
-        
-          {
-            DatabaseThread::current()->generate_tile(job_handle, file_entry, tilescale, pos, callback);
-          }
+          m_request_queue.wait_and_push(timed(kWriterRequest, [this, job_handle, file_entry, tilescale, pos, callback]{
+                process_tile_request(job_handle, file_entry, tilescale, pos, callback);
+              }));
         }
       }
     });
@@ -91,13 +173,37 @@ DatabaseThread::request_tile(const FileEntry& file_entry, int tilescale, const V
   return job_handle_;
 }
 
+void
+DatabaseThread::process_tile_request(JobHandle job_handle, const FileEntry& file_entry, int tilescale, const Vector2i& pos,
+                                     const std::function<void (Tile)>& callback)
+{
+  if (!job_handle.is_aborted())
+  {
+    TileEntry tile;
+    if (m_database.get_tiles().get_tile(file_entry, tilescale, pos, tile))
+    {
+      // Tile has been found, so return it and finish up
+      if (callback)
+      {
+        callback(tile);
+      }
+      job_handle.set_finished();
+    }
+    else
+    {
+      // Tile hasn't been found, so we need to generate it
+      generate_tile(job_handle, file_entry, tilescale, pos, callback);
+    }
+  }
+}
+
 JobHandle
 DatabaseThread::request_tiles(const FileEntry& file_entry, int min_scale, int max_scale,
                               const std::function<void (Tile)>& callback)
 {
   JobHandle job_handle = JobHandle::create();
 
-  m_request_queue.wait_and_push([this, job_handle, file_entry, min_scale, max_scale, callback]{
+  m_request_queue.wait_and_push(timed(kWriterRequest, [this, job_handle, file_entry, min_scale, max_scale, callback]{
       if (!job_handle.is_aborted())
       {
         generate_tiles(job_handle,
@@ -105,17 +211,94 @@ DatabaseThread::request_tiles(const FileEntry& file_entry, int min_scale, int ma
                        min_scale, max_scale, 
                        callback);
       }
-    });
+      }));
 
   return job_handle;
 }
 
+JobHandle
+DatabaseThread::request_stored_tile(const FileEntry& file_entry, int tilescale, const Vector2i& pos,
+                                    const std::function<void (Tile)>& callback,
+                                    const std::function<void (JobHandle)>& miss_callback)
+{
+  assert(file_entry);
+
+  JobHandle job_handle_ = JobHandle::create();
+
+  push_read(kTileLookup, [this, job_handle_, file_entry, tilescale, pos, callback, miss_callback](DatabaseReader& reader){
+      JobHandle job_handle = job_handle_;
+      if (!job_handle.is_aborted())
+      {
+        TileEntry tile;
+        if (reader.get_tile(file_entry, tilescale, pos, tile))
+        {
+          if (callback)
+          {
+            callback(tile);
+          }
+          job_handle.set_finished();
+        }
+        else
+        {
+          m_request_queue.wait_and_push(timed(kWriterRequest, [this, job_handle, file_entry, tilescale, pos, callback, miss_callback]{
+                process_stored_tile_request(job_handle, file_entry, tilescale, pos, callback, miss_callback);
+              }));
+        }
+      }
+    });
+
+  return job_handle_;
+}
+
+void
+DatabaseThread::process_stored_tile_request(JobHandle job_handle, const FileEntry& file_entry, int tilescale, const Vector2i& pos,
+                                            const std::function<void (Tile)>& callback,
+                                            const std::function<void (JobHandle)>& miss_callback)
+{
+  if (!job_handle.is_aborted())
+  {
+    TileEntry tile;
+    if (m_database.get_tiles().get_tile(file_entry, tilescale, pos, tile))
+    {
+      if (callback)
+      {
+        callback(tile);
+      }
+      job_handle.set_finished();
+    }
+    else
+    {
+      miss_callback(job_handle);
+    }
+  }
+}
+
+void
+DatabaseThread::request_tile_check(const FileEntry& file_entry, int tilescale, const Vector2i& pos,
+                                   const std::function<void (bool)>& callback)
+{
+  assert(file_entry);
+
+  push_read(kTileLookup, [this, file_entry, tilescale, pos, callback](DatabaseReader& reader){
+      if (reader.has_tile(file_entry, pos, tilescale))
+      {
+        callback(true);
+      }
+      else
+      {
+        m_request_queue.wait_and_push(timed(kWriterRequest, [this, file_entry, tilescale, pos, callback]{
+              callback(m_database.get_tiles().has_tile(file_entry, pos, tilescale));
+            }));
+      }
+    });
+}
+
 void
 DatabaseThread::request_job_removal(std::shared_ptr<Job> job, bool)
 {
-  m_request_queue.wait_and_push([this, job](){
+  m_request_queue.wait_and_push(timed(kWriterRequest, [this, job](){
       remove_job(job);
-    });
+      }));
 }
 
 JobHandle
@@ -128,49 +311,169 @@ DatabaseThread::request_file(const URL& url,
   std::function<void (FileEntry)> file_callback = file_callback_;
   std::function<void (FileEntry, Tile)> tile_callback = tile_callback_;
 
-  m_request_queue.wait_and_push([this, job_handle_, url, file_callback, tile_callback](){
+  push_read(kFileLookup, [this, job_handle_, url, file_callback, tile_callback](DatabaseReader& reader){
       JobHandle job_handle = job_handle_;
       if (!job_handle.is_aborted())
       {
-        FileEntry file_entry = m_database.get_files().get_file_entry(url);
-        if (!file_entry)
-        {
-          // file entry is not in the database, so try to generate it
-          DatabaseThread::current()->generate_file_entry(job_handle, url, 
-                                                         file_callback, tile_callback);
-        }
-        else
+        // the common case of an unchanged file with its thumbnail in
+        // the database is answered right here, everything else goes
+        // to the writer
+        FileEntry file_entry = reader.get_file_entry(url);
+        TileEntry tile_entry;
+        if (file_entry && !is_stale(file_entry, stat_url(url)) &&
+            (!tile_callback ||
+             reader.get_tile(file_entry, file_entry.get_thumbnail_scale(), Vector2i(0, 0), tile_entry)))
         {
-          file_callback(file_entry);
-
-          TileEntry tile_entry;
-          if (m_database.get_tiles().get_tile(file_entry, file_entry.get_thumbnail_scale(), Vector2i(0, 0), tile_entry))
+          if (file_callback)
           {
-            if (tile_callback)
-            {
-              tile_callback(file_entry, tile_entry);
-            }
+            file_callback(file_entry);
           }
-          else
+
+          if (tile_callback)
           {
-            std::cout << "RequestFileDatabaseMessage: " << file_entry << " " << Vector2i(0,0) << file_entry.get_thumbnail_scale() << std::endl;
+            tile_callback(file_entry, tile_entry);
           }
 
           job_handle.set_finished();
         }
+        else
+        {
+          m_request_queue.wait_and_push(timed(kWriterRequest, [this, job_handle, url, file_callback, tile_callback]{
+                process_file_request(job_handle, url, file_callback, tile_callback);
+              }));
+        }
       }
     });
   
   return job_handle_;
 }
 
+void
+DatabaseThread::process_file_request(JobHandle job_handle, const URL& url,
+                                     const std::function<void (FileEntry)>& file_callback,
+                                     const std::function<void (FileEntry, Tile)>& tile_callback)
+{
+  if (!job_handle.is_aborted())
+  {
+    FileEntry file_entry = m_database.get_files().get_file_entry(url);
+    if (!file_entry)
+    {
+      // file entry is not in the database, so try to generate it
+      generate_file_entry(job_handle, url, file_callback, tile_callback);
+    }
+    else if (is_stale(file_entry, stat_url(url)))
+    {
+      regenerate_file_entry(job_handle, file_entry, file_callback, tile_callback);
+    }
+    else
+    {
+      deliver_file_entry(job_handle, file_entry, file_callback, tile_callback);
+    }
+  }
+}
+
+std::vector<JobHandle>
+DatabaseThread::request_files(const std::vector<URL>& urls,
+                              const std::function<void (FileEntry)>& file_callback,
+                              const std::function<void (FileEntry, Tile)>& tile_callback)
+{
+  std::vector<JobHandle> job_handles;
+  job_handles.reserve(urls.size());
+  for(std::vector<URL>::size_type i = 0; i < urls.size(); ++i)
+  {
+    job_handles.push_back(JobHandle::create());
+  }
+
+  // the stat() calls run on a reader thread, so that the writer
+  // doesn't stall the tile stores behind filesystem IO
+  push_read(kQuery, [this, urls, job_handles, file_callback, tile_callback](DatabaseReader&){
+      std::shared_ptr<std::vector<FileStat> > stats = std::make_shared<std::vector<FileStat> >();
+      stat_urls(urls, *stats);
+
+      m_request_queue.wait_and_push(timed(kWriterRequest, [this, urls, stats, job_handles, file_callback, tile_callback](){
+          std::vector<FileEntry> entries;
+          m_database.get_files().get_file_entries(urls, entries);
+
+          std::unordered_map<URL, FileEntry> entry_by_url(entries.size());
+          for(std::vector<FileEntry>::const_iterator i = entries.begin(); i != entries.end(); ++i)
+          {
+            entry_by_url[i->get_url()] = *i;
+          }
+
+          int unchanged = 0;
+          for(std::vector<URL>::size_type i = 0; i < urls.size(); ++i)
+          {
+            JobHandle job_handle = job_handles[i];
+            if (!job_handle.is_aborted())
+            {
+              std::unordered_map<URL, FileEntry>::const_iterator it = entry_by_url.find(urls[i]);
+              if (it == entry_by_url.end())
+              {
+                generate_file_entry(job_handle, urls[i], file_callback, tile_callback);
+              }
+              else if (is_stale(it->second, (*stats)[i]))
+              {
+                regenerate_file_entry(job_handle, it->second, file_callback, tile_callback);
+              }
+              else
+              {
+                deliver_file_entry(job_handle, it->second, file_callback, tile_callback);
+                unchanged += 1;
+              }
+            }
+          }
+
+          log_info << urls.size() << " files, " << unchanged << " unchanged, "
+                   << (urls.size() - unchanged) << " new or modified" << std::endl;
+        }));
+    });
+
+  return job_handles;
+}
+
+void
+DatabaseThread::deliver_file_entry(JobHandle job_handle, const FileEntry& file_entry,
+                                   const std::function<void (FileEntry)>& file_callback,
+                                   const std::function<void (FileEntry, Tile)>& tile_callback)
+{
+  if (file_callback)
+  {
+    file_callback(file_entry);
+  }
+
+  if (tile_callback)
+  {
+    TileEntry tile_entry;
+    if (m_database.get_tiles().get_tile(file_entry, file_entry.get_thumbnail_scale(), Vector2i(0, 0), tile_entry))
+    {
+      tile_callback(file_entry, tile_entry);
+    }
+    else
+    {
+      std::cout << "RequestFileDatabaseMessage: " << file_entry << " " << Vector2i(0,0) << file_entry.get_thumbnail_scale() << std::endl;
+    }
+  }
+
+  job_handle.set_finished();
+}
+
+void
+DatabaseThread::regenerate_file_entry(JobHandle job_handle, const FileEntry& file_entry,
+                                      const std::function<void (FileEntry)>& file_callback,
+                                      const std::function<void (FileEntry, Tile)>& tile_callback)
+{
+  log_info << file_entry.get_url() << ": file has changed, regenerating" << std::endl;
+  m_database.delete_file_entry(file_entry.get_fileid());
+  generate_file_entry(job_handle, file_entry.get_url(), file_callback, tile_callback);
+}
+
 void
 DatabaseThread::request_all_files(const std::function<void (FileEntry)>& callback_)
 {
   std::function<void (FileEntry)> callback = callback_; // FIXME: internal error workaround
-  m_request_queue.wait_and_push([this, callback]{
+  push_read(kQuery, [callback](DatabaseReader& reader){
       std::vector<FileEntry> entries;
-      m_database.get_files().get_file_entries(entries);
+      reader.get_file_entries(entries);
       for(std::vector<FileEntry>::iterator i = entries.begin(); i != entries.end(); ++i)
       {
         callback(*i);
@@ -181,20 +484,20 @@ DatabaseThread::request_all_files(const std::function<void (FileEntry)>& callbac
 void
 DatabaseThread::request_files_by_pattern(const std::function<void (FileEntry)>& callback, const std::string& pattern)
 {
-  m_request_queue.wait_and_push([this, callback, pattern](){
+  push_read(kQuery, [callback, pattern](DatabaseReader& reader){
       std::vector<FileEntry> entries;
-      m_database.get_files().get_file_entries(pattern, entries);
+      reader.get_file_entries(pattern, entries);
       for(std::vector<FileEntry>::iterator i = entries.begin(); i != entries.end(); ++i)
       {
         callback(*i);
-      }               
-      });
+      }
+    });
 }
 
 void
 DatabaseThread::receive_tile(const FileEntry& file_entry, const Tile& tile)
 {
-  m_receive_queue.wait_and_push([this, file_entry, tile](){
+  m_receive_queue.wait_and_push(timed(kStore, [this, file_entry, tile](){
       // FIXME: Make some better error checking in case of loading failure
       if (tile)
       {
@@ -206,15 +509,23 @@ DatabaseThread::receive_tile(const FileEntry& file_entry, const Tile& tile)
       {
         
       }
-    });
+      }));
+}
+
+void
+DatabaseThread::receive_tiles(const std::vector<TileEntry>& tiles)
+{
+  m_receive_queue.wait_and_push(timed(kStore, [this, tiles](){
+      m_database.get_tiles().store_tiles(tiles);
+      }));
 }
 
 void
 DatabaseThread::delete_file_entry(const FileId& fileid)
 {
-  m_request_queue.wait_and_push([this, fileid](){
+  m_request_queue.wait_and_push(timed(kWriterRequest, [this, fileid](){
       m_database.delete_file_entry(fileid);
-    });
+      }));
 }
 
 void
@@ -223,6 +534,7 @@ DatabaseThread::stop_thread()
   m_quit  = true;
   m_request_queue.wakeup();
   m_receive_queue.wakeup();
+  m_read_queue.close();
 }
 
 void
@@ -232,21 +544,125 @@ DatabaseThread::abort_thread()
   m_abort = true;
   m_request_queue.wakeup();
   m_receive_queue.wakeup();
+  m_read_queue.close();
 }
 
 void
 DatabaseThread::run()
 {
+  TRACE_THREAD_NAME("DatabaseThread");
+
   m_quit = false;
+
+  // each reader gets its own connection, so that lookups don't
+  // serialize on a single sqlite handle
+  std::vector<std::unique_ptr<DatabaseReader> > readers;
+  for(int i = 0; i < m_num_readers; ++i)
+  {
+    readers.push_back(std::unique_ptr<DatabaseReader>(new DatabaseReader(m_database)));
+    m_reader_threads.push_back(std::thread(&DatabaseThread::run_reader, this, std::ref(*readers.back())));
+  }
   
   while(!m_quit)
   {
+    TRACE_VALUE("database/request_queue_size", m_request_queue.size());
+    TRACE_VALUE("database/receive_queue_size", m_receive_queue.size());
+    TRACE_VALUE("database/read_queue_size", m_read_queue.size());
+
     // FIXME: This really should be a priority queue
     process_queue(m_receive_queue);
     process_queue(m_request_queue);
     
     usleep(10000); // FIXME: evil busy wait
   }
+
+  m_read_queue.close();
+  for(std::vector<std::thread>::iterator i = m_reader_threads.begin(); i != m_reader_threads.end(); ++i)
+  {
+    i->join();
+  }
+  m_reader_threads.clear();
+
+  log_info << "tile generation: " << m_tile_jobs_started << " jobs, "
+           << m_tile_jobs_duplicate << " duplicate, "
+           << m_tile_requests_coalesced << " requests coalesced" << std::endl;
+  log_wait_stats();
+}
+
+void
+DatabaseThread::run_reader(DatabaseReader& reader)
+{
+  TRACE_THREAD_NAME("DatabaseReader");
+
+  std::function<void (DatabaseReader&)> func;
+  while(!m_abort && m_read_queue.wait_and_pop_until_closed(func))
+  {
+    TRACE_SPAN("database", "read");
+    func(reader);
+  }
+}
+
+std::function<void ()>
+DatabaseThread::timed(RequestClass request_class, const std::function<void ()>& func)
+{
+  std::chrono::steady_clock::time_point queued = std::chrono::steady_clock::now();
+  return [this, request_class, queued, func]{
+    record_wait(request_class, queued);
+    func();
+  };
+}
+
+void
+DatabaseThread::push_read(RequestClass request_class, const std::function<void (DatabaseReader&)>& func)
+{
+  std::chrono::steady_clock::time_point queued = std::chrono::steady_clock::now();
+  m_read_queue.wait_and_push([this, request_class, queued, func](DatabaseReader& reader){
+      record_wait(request_class, queued);
+      func(reader);
+    });
+}
+
+void
+DatabaseThread::record_wait(RequestClass request_class, std::chrono::steady_clock::time_point queued)
+{
+  int64_t usec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - queued).count();
+
+  WaitStats& stats = m_wait_stats[request_class];
+  stats.count += 1;
+  stats.total_usec += usec;
+  int64_t max_usec = stats.max_usec;
+  while(usec > max_usec && !stats.max_usec.compare_exchange_weak(max_usec, usec))
+  {
+  }
+
+  switch(request_class)
+  {
+    case kTileLookup:    TRACE_VALUE("database/wait_tile_lookup_usec", usec); break;
+    case kFileLookup:    TRACE_VALUE("database/wait_file_lookup_usec", usec); break;
+    case kQuery:         TRACE_VALUE("database/wait_query_usec", usec); break;
+    case kWriterRequest: TRACE_VALUE("database/wait_writer_request_usec", usec); break;
+    case kStore:         TRACE_VALUE("database/wait_store_usec", usec); break;
+    case kNumRequestClasses: break;
+  }
+}
+
+void
+DatabaseThread::log_wait_stats() const
+{
+  static const char* names[kNumRequestClasses] = {
+    "tile lookup", "file lookup", "query", "writer request", "store"
+  };
+
+  for(int i = 0; i < kNumRequestClasses; ++i)
+  {
+    const WaitStats& stats = m_wait_stats[i];
+    if (stats.count > 0)
+    {
+      log_info << "queue wait, " << names[i] << ": " << stats.count << " requests, "
+               << static_cast<double>(stats.total_usec) / stats.count / 1000.0 << "ms avg, "
+               << static_cast<double>(stats.max_usec) / 1000.0 << "ms max" << std::endl;
+    }
+  }
 }
 
 void
@@ -256,6 +672,7 @@ DatabaseThread::process_queue(ThreadMessageQueue2<std::function<void()>>& queue)
   while(!m_abort && queue.try_pop(func))
   {
     //std::cout << "DatabaseThread::queue.size(): " << m_queue.size() << " - " << typeid(*msg).name() << std::endl;
+    TRACE_SPAN("database", "message");
     func();
   }
 }
@@ -263,13 +680,14 @@ DatabaseThread::process_queue(ThreadMessageQueue2<std::function<void()>>& queue)
 void
 DatabaseThread::remove_job(std::shared_ptr<Job> job)
 {
-  for(std::list<std::shared_ptr<TileGenerationJob> >::iterator i = m_tile_generation_jobs.begin(); 
-      i != m_tile_generation_jobs.end(); ++i)
+  std::shared_ptr<TileGenerationJob> tile_job = std::dynamic_pointer_cast<TileGenerationJob>(job);
+  if (tile_job)
   {
-    if (*i == job)
+    TileGenerationJobs::iterator it = m_tile_generation_jobs.find(tile_job->get_file_entry().get_tile_fileid().get_id());
+    // a newer job for the same file might have taken the slot already
+    if (it != m_tile_generation_jobs.end() && it->second == tile_job)
     {
-      m_tile_generation_jobs.erase(i);
-      break;
+      m_tile_generation_jobs.erase(it);
     }
   }
 }
@@ -305,19 +723,37 @@ DatabaseThread::generate_tile(const JobHandle& job_handle,
                               const std::function<void (Tile)>& callback)
 { 
 
-  std::list<std::shared_ptr<TileGenerationJob> >::iterator it = 
-    std::find_if(m_tile_generation_jobs.begin(), m_tile_generation_jobs.end(), 
-                 [&file_entry](const std::shared_ptr<TileGenerationJob>& job){ 
-                   return job->get_url() == file_entry.get_url(); 
-                 });
+  assert(file_entry.get_tile_fileid());
+
+  TileGenerationJobs::iterator it = m_tile_generation_jobs.find(file_entry.get_tile_fileid().get_id());
 
   if (it != m_tile_generation_jobs.end() && 
-      (*it)->request_tile(job_handle, tilescale, pos, callback))
+      it->second->request_tile(job_handle, tilescale, pos, callback))
   {
-    // all ok
+    m_tile_requests_coalesced += 1;
   }
   else
   {
+    if (it != m_tile_generation_jobs.end())
+    {
+      // The job is past the requested tile and no longer retains it,
+      // it has been handed to receive_tile() and is likely in the
+      // database by now
+      TileEntry tile_entry;
+      if (m_database.get_tiles().get_tile(file_entry, tilescale, pos, tile_entry))
+      {
+        if (callback)
+        {
+          callback(tile_entry);
+        }
+        JobHandle(job_handle).set_finished();
+        m_tile_requests_coalesced += 1;
+        return;
+      }
+
+      m_tile_jobs_duplicate += 1;
+    }
+
     // job not there or already running, so create a new one
     int min_scale_in_db = -1;
     int max_scale_in_db = -1;
@@ -352,7 +788,8 @@ DatabaseThread::generate_tile(const JobHandle& job_handle,
 
     m_tile_job_manager.request(job_ptr, std::bind(&DatabaseThread::request_job_removal, this, std::placeholders::_1, std::placeholders::_2));
 
-    m_tile_generation_jobs.push_front(job_ptr);
+    m_tile_generation_jobs[file_entry.get_tile_fileid().get_id()] = job_ptr;
+    m_tile_jobs_started += 1;
   }
 }
 
@@ -362,7 +799,7 @@ DatabaseThread::generate_file_entry(const JobHandle& job_handle, const URL& url,
                                     const std::function<void (FileEntry, Tile)>& tile_callback)
 {
   //log_info << " << url << " " << job_handle << std::endl;
-  std::shared_ptr<FileEntryGenerationJob> job_ptr(new FileEntryGenerationJob(job_handle, url));
+  std::shared_ptr<FileEntryGenerationJob> job_ptr(new FileEntryGenerationJob(job_handle, url, m_tile_owner_lookup));
 
   if (file_callback)
   {
@@ -388,7 +825,7 @@ DatabaseThread::store_file_entry(const JobHandle& job_handle_in,
                                  const std::function<void (FileEntry)>& callback)
 {
   
-  m_receive_queue.wait_and_push([this, job_handle_in, url, size, format, callback](){
+  m_receive_queue.wait_and_push(timed(kStore, [this, job_handle_in, url, size, format, callback](){
       JobHandle job_handle = job_handle_in;
       FileEntry file_entry = m_database.get_files().store_file_entry(url, size, format);
       if (callback)
@@ -396,15 +833,15 @@ DatabaseThread::store_file_entry(const JobHandle& job_handle_in,
         callback(file_entry);
       }
       job_handle.set_finished();
-    });
+      }));
 }
 
 void
 DatabaseThread::receive_file(const FileEntry& file_entry)
 {
-  m_receive_queue.wait_and_push([this, file_entry](){
+  m_receive_queue.wait_and_push(timed(kStore, [this, file_entry](){
       m_database.get_files().store_file_entry(file_entry);
-    });
+      }));
 }
 
 /* EOF */
@@ -19,7 +19,13 @@
 #ifndef HEADER_GALAPIX_GALAPIX_DATABASE_THREAD_HPP
 #define HEADER_GALAPIX_GALAPIX_DATABASE_THREAD_HPP
 
-#include <list>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdint.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "database/tile_entry.hpp"
 #include "galapix/tile.hpp"
@@ -31,10 +37,17 @@
 class URL;
 class Database;
 class DatabaseMessage;
+class DatabaseReader;
+class TileOwnerLookup;
 class TileDatabaseMessage;
 class TileGenerationJob;
 class FileEntry;
 
+/** Owns the Database: a single writer thread runs run() and does all
+    inserts, deletes and tile generation bookkeeping, while a pool of
+    reader threads, each with a DatabaseReader of its own, answers
+    tile and file lookups. Lookups that miss in the reader are handed
+    on to the writer, as the entry might still sit in its write cache. */
 class DatabaseThread : public Thread
 {
 private:
@@ -43,7 +56,30 @@ public:
   static DatabaseThread* current() { return current_; }
 
 private:
-  
+  /** Requests are grouped by these for the queue wait statistics */
+  enum RequestClass
+  {
+    kTileLookup,
+    kFileLookup,
+    kQuery,
+    kWriterRequest,
+    kStore,
+    kNumRequestClasses
+  };
+
+  struct WaitStats
+  {
+    std::atomic<int>     count;
+    std::atomic<int64_t> total_usec;
+    std::atomic<int64_t> max_usec;
+
+    WaitStats() :
+      count(0),
+      total_usec(0),
+      max_usec(0)
+    {}
+  };
+
 private:
   Database& m_database;
 
@@ -54,14 +90,37 @@ private:
   
   ThreadMessageQueue2<std::function<void()>> m_request_queue;
   ThreadMessageQueue2<std::function<void()>> m_receive_queue;
-  std::list<std::shared_ptr<TileGenerationJob> > m_tile_generation_jobs;
+
+  /** Lookups, served by any of the reader threads */
+  int m_num_readers;
+  ThreadMessageQueue2<std::function<void (DatabaseReader&)>> m_read_queue;
+  std::vector<std::thread> m_reader_threads;
+
+  /** Shared by the FileEntryGenerationJobs */
+  std::shared_ptr<TileOwnerLookup> m_tile_owner_lookup;
+
+  WaitStats m_wait_stats[kNumRequestClasses];
+
+  /** Running TileGenerationJobs, indexed by the FileId the tiles
+      are stored under, so that identical files share a job */
+  typedef std::unordered_map<int64_t, std::shared_ptr<TileGenerationJob> > TileGenerationJobs;
+  TileGenerationJobs m_tile_generation_jobs;
+
+  /** Number of tile requests that got answered by an already running
+      job, number of jobs started and number of jobs started while
+      another one for the same file was still around */
+  int m_tile_requests_coalesced;
+  int m_tile_jobs_started;
+  int m_tile_jobs_duplicate;
 
 protected: 
   void run();
 
 public:
+  /** @param num_readers number of threads serving lookups */
   DatabaseThread(Database& database,
-                 JobManager& tile_job_manager);
+                 JobManager& tile_job_manager,
+                 int num_readers = 2);
   virtual ~DatabaseThread();
 
   void stop_thread();
@@ -93,6 +152,18 @@ public:
   JobHandle request_tiles(const FileEntry&, int min_scale, int max_scale, 
                           const std::function<void (Tile)>& callback);
 
+  /**
+   *  Request the tile from the database only, if it isn't stored
+   *  there \a miss_callback is called instead of generating it
+   */
+  JobHandle request_stored_tile(const FileEntry&, int tilescale, const Vector2i& pos,
+                                const std::function<void (Tile)>& callback,
+                                const std::function<void (JobHandle)>& miss_callback);
+
+  /** Reports whether the tile is stored in the database, without loading it */
+  void      request_tile_check(const FileEntry&, int tilescale, const Vector2i& pos,
+                               const std::function<void (bool)>& callback);
+
   void      request_job_removal(std::shared_ptr<Job> job, bool);
 
   /** Request the FileEntry for \a filename */
@@ -100,6 +171,14 @@ public:
                          const std::function<void (FileEntry)>& file_callback,
                          const std::function<void (FileEntry, Tile)>& tile_callback = std::function<void (FileEntry, Tile)>());
 
+  /** Request the FileEntrys for all \a urls at once: the database
+      is queried once for the common url prefix and the files are
+      stat()'ed in parallel, only new or modified files get their
+      FileEntry regenerated. One JobHandle per url is returned. */
+  std::vector<JobHandle> request_files(const std::vector<URL>& urls,
+                                       const std::function<void (FileEntry)>& file_callback,
+                                       const std::function<void (FileEntry, Tile)>& tile_callback = std::function<void (FileEntry, Tile)>());
+
   /** Request FileEntrys by glob pattern from the database */
   void      request_files_by_pattern(const std::function<void (FileEntry)>& callback, const std::string& pattern);
 
@@ -119,8 +198,50 @@ public:
   void      delete_file_entry(const FileId& fileid);
   /* @} */
 
+  /* @{ */ // lock-free, for statistics only
+  /** Number of requests waiting for the writer thread */
+  int get_request_queue_size() const { return m_request_queue.size(); }
+
+  /** Number of received tiles and files waiting to be stored */
+  int get_receive_queue_size() const { return m_receive_queue.size(); }
+
+  /** Number of lookups waiting for a reader thread */
+  int get_read_queue_size() const { return m_read_queue.size(); }
+  /* @} */
+
 private:
   void process_queue(ThreadMessageQueue2<std::function<void()>>& queue);
+  void run_reader(DatabaseReader& reader);
+
+  /** Wraps \a func so that the time it spends in a queue is recorded
+      under \a request_class */
+  std::function<void ()> timed(RequestClass request_class, const std::function<void ()>& func);
+  void push_read(RequestClass request_class, const std::function<void (DatabaseReader&)>& func);
+  void record_wait(RequestClass request_class, std::chrono::steady_clock::time_point queued);
+  void log_wait_stats() const;
+
+  /** The part of the requests that has to run in the writer thread,
+      either because it touches the write cache or the tile
+      generation jobs */
+  void process_tile_request(JobHandle job_handle, const FileEntry& file_entry, int tilescale, const Vector2i& pos,
+                            const std::function<void (Tile)>& callback);
+  void process_stored_tile_request(JobHandle job_handle, const FileEntry& file_entry, int tilescale, const Vector2i& pos,
+                                   const std::function<void (Tile)>& callback,
+                                   const std::function<void (JobHandle)>& miss_callback);
+  void process_file_request(JobHandle job_handle, const URL& url,
+                            const std::function<void (FileEntry)>& file_callback,
+                            const std::function<void (FileEntry, Tile)>& tile_callback);
+
+  /** Hands an up to date FileEntry from the database to the callbacks */
+  void deliver_file_entry(JobHandle job_handle, const FileEntry& file_entry,
+                          const std::function<void (FileEntry)>& file_callback,
+                          const std::function<void (FileEntry, Tile)>& tile_callback);
+
+  /** Drops a FileEntry, along with its tiles, whose file has changed
+      since it was stored and generates a new one */
+  void regenerate_file_entry(JobHandle job_handle, const FileEntry& file_entry,
+                             const std::function<void (FileEntry)>& file_callback,
+                             const std::function<void (FileEntry, Tile)>& tile_callback);
 
 private:
   DatabaseThread (const DatabaseThread&);
@@ -25,17 +25,21 @@
 #include <stdlib.h>
 #include <stdexcept>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <Magick++.h>
 
 #include "database/database.hpp"
 #include "display/framebuffer.hpp"
 #include "display/surface.hpp"
+#include "galapix/binary_workspace.hpp"
 #include "galapix/database_thread.hpp"
 #include "galapix/database_tile_provider.hpp"
 #include "galapix/mandelbrot_tile_provider.hpp"
 #include "galapix/options.hpp"
+#include "galapix/thumbgen_pipeline.hpp"
 #include "galapix/viewer.hpp"
 #include "galapix/workspace.hpp"
 #include "galapix/zoomify_tile_provider.hpp"
@@ -46,15 +50,18 @@
 #include "math/rect.hpp"
 #include "math/size.hpp"
 #include "math/vector2i.hpp"
+#include "plugins/curl_fetcher.hpp"
 #include "plugins/imagemagick.hpp"
 #include "plugins/jpeg.hpp"
 #include "plugins/png.hpp"
 #include "plugins/xcf.hpp"
 #include "util/archive_manager.hpp"
 #include "util/filesystem.hpp"
+#include "util/log.hpp"
 #include "util/software_surface.hpp"
 #include "util/software_surface_factory.hpp"
 #include "util/string_util.hpp"
+#include "util/trace.hpp"
 #ifdef GALAPIX_SDL
 #  include "sdl/sdl_viewer.hpp"
 #endif
@@ -65,7 +72,8 @@
 Galapix::Galapix()
   : fullscreen(false),
     geometry(800, 600),
-    anti_aliasing(0)
+    anti_aliasing(0),
+    stats_overlay(false)
 {
   Filesystem::init();
 }
@@ -81,7 +89,7 @@ Galapix::test(const Options& opts,
 {
   std::cout << "Running test case" << std::endl;
 
-  Database database(opts.database);
+  Database database(opts.database, opts.tile_codec, opts.tile_shards, opts.tile_store);
   JobManager job_manager(opts.threads);
   DatabaseThread database_thread(database, job_manager);
 
@@ -142,6 +150,40 @@ Galapix::merge(const std::string& database,
   }
 }
 
+/** Loads the workspace \a input and writes it to \a output in the
+    other format, binary if it was text and text if it was binary */
+void
+Galapix::convert_workspace(const std::string& input, const std::string& output)
+{
+  const bool to_binary = !BinaryWorkspace::is_binary(input);
+
+  Workspace workspace;
+  workspace.load(input);
+
+  std::ofstream out(output.c_str(), std::ios::binary);
+  if (!out)
+  {
+    throw std::runtime_error("Galapix::convert_workspace(): couldn't open " + output);
+  }
+
+  if (to_binary)
+  {
+    workspace.save_binary(out);
+  }
+  else
+  {
+    workspace.save(out);
+  }
+
+  out.close();
+  if (!out)
+  {
+    throw std::runtime_error("Galapix::convert_workspace(): error while writing " + output);
+  }
+
+  std::cout << "Wrote " << (to_binary ? "binary" : "text") << " workspace to " << output << std::endl;
+}
+
 void
 Galapix::export_images(const std::string& database, const std::vector<URL>& url)
 {
@@ -243,27 +285,31 @@ void
 Galapix::check(const std::string& database)
 {
   Database db(database);
-  db.get_files().check();
-  //db.get_tiles().check();
+  if (db.check())
+  {
+    std::cout << "Database is ok" << std::endl;
+  }
 }
 
 void
 Galapix::filegen(const Options& opts,
                  const std::vector<URL>& url)
 {
-  Database database(opts.database);
+  Database database(opts.database, opts.tile_codec, opts.tile_shards, opts.tile_store);
   JobManager job_manager(opts.threads);
   DatabaseThread database_thread(database, job_manager);
 
   job_manager.start_thread();
   database_thread.start_thread();
   
-  for(std::vector<URL>::size_type i = 0; i < url.size(); ++i)
+  JobHandleGroup job_handle_group;
+
+  std::vector<JobHandle> job_handles = database_thread.request_files(url, std::function<void (FileEntry)>());
+  for(std::vector<JobHandle>::const_iterator i = job_handles.begin(); i != job_handles.end(); ++i)
   {
-    database_thread.request_file(url[i], 
-                                 std::function<void (FileEntry)>(), 
-                                 std::function<void (FileEntry, Tile)>());
+    job_handle_group.add(*i);
   }
+  job_handle_group.wait();
 
   job_manager.stop_thread();
   database_thread.stop_thread();
@@ -277,61 +323,17 @@ Galapix::thumbgen(const Options& opts,
                   const std::vector<URL>& urls, 
                   bool generate_all_tiles)
 {
-  Database       database(opts.database);
-  JobManager     job_manager(opts.threads);
-  DatabaseThread database_thread(database, job_manager);
-  
-  database_thread.start_thread();
-  job_manager.start_thread();
-
-  std::vector<FileEntry> file_entries;
-
-  JobHandleGroup job_handle_group;
+  Database database(opts.database, opts.tile_codec, opts.tile_shards, opts.tile_store);
 
-  // gather FileEntries
-  for(std::vector<URL>::const_iterator i = urls.begin(); i != urls.end(); ++i)
-  {
-    job_handle_group.add(database_thread.request_file(*i, 
-                                                      [&file_entries](const FileEntry& entry) { 
-                                                        file_entries.push_back(entry); 
-                                                      },
-                                                      std::function<void (FileEntry, Tile)>())); 
-  }
-  job_handle_group.wait();
-  job_handle_group.clear();
-
-  std::cout << "Got " << file_entries.size() << " files, generating tiles...: "  << generate_all_tiles << std::endl;
-
-  // gather thumbnails
-  for(std::vector<FileEntry>::const_iterator i = file_entries.begin(); i != file_entries.end(); ++i)
-  {
-    int min_scale = 0;
-    int max_scale = i->get_thumbnail_scale();
-
-    if (!generate_all_tiles)
-    {
-      min_scale = std::max(0, max_scale - 3);
-    }
-
-    job_handle_group.add(database_thread.request_tiles(*i, min_scale, max_scale,
-                                                       std::function<void(Tile)>()));
-  }
-
-  job_handle_group.wait();
-  job_handle_group.clear();
-
-  job_manager.stop_thread();
-  database_thread.stop_thread();
-
-  job_manager.join_thread();
-  database_thread.join_thread();
+  ThumbgenPipeline pipeline(database, opts.io_threads, opts.threads, generate_all_tiles);
+  pipeline.process(urls);
 }
 
 void
 Galapix::view(const Options& opts, const std::vector<URL>& urls)
 {
   try {
-  Database       database(opts.database);
+  Database       database(opts.database, opts.tile_codec, opts.tile_shards, opts.tile_store);
   JobManager     job_manager(opts.threads);
   DatabaseThread database_thread(database, job_manager);
 
@@ -381,6 +383,17 @@ Galapix::view(const Options& opts, const std::vector<URL>& urls)
     }
   }
 
+  // look up the FileEntrys of all URLs with a single query
+  std::unordered_map<URL, FileEntry> file_entry_by_url;
+  {
+    std::vector<FileEntry> file_entries;
+    database.get_files().get_file_entries(urls, file_entries);
+    for(std::vector<FileEntry>::const_iterator i = file_entries.begin(); i != file_entries.end(); ++i)
+    {
+      file_entry_by_url[i->get_url()] = *i;
+    }
+  }
+
   // process regular URLs
   for(std::vector<URL>::const_iterator i = urls.begin(); i != urls.end(); ++i)
   {
@@ -395,9 +408,16 @@ Galapix::view(const Options& opts, const std::vector<URL>& urls)
     }
     else if (i->get_protocol() == "builtin" || i->get_protocol() == "buildin")
     {
-      if (i->get_payload() == "mandelbrot")
+      if (i->get_payload() == "mandelbrot" || i->get_payload().compare(0, 11, "mandelbrot?") == 0)
       {
-        workspace.add_image(Image::create(*i, TileProviderPtr(new MandelbrotTileProvider(job_manager))));
+        try
+        {
+          workspace.add_image(Image::create(*i, MandelbrotTileProvider::create(*i, job_manager)));
+        }
+        catch(const std::exception& err)
+        {
+          log_warning << err.what() << ", ignoring" << std::endl;
+        }
       }
       else
       {
@@ -406,18 +426,19 @@ Galapix::view(const Options& opts, const std::vector<URL>& urls)
     }
     else if (Filesystem::has_extension(i->str(), "ImageProperties.xml"))
     {
-      workspace.add_image(Image::create(*i, ZoomifyTileProvider::create(*i, job_manager)));
+      workspace.add_image(Image::create(*i, ZoomifyTileProvider::create(*i, job_manager, &database, opts.prefetch)));
     }
     else
     {
       //database_thread.request_file(*i, std::bind(&Workspace::receive_file, &workspace, _1));
-      FileEntry file_entry = database.get_files().get_file_entry(*i);
-      if (!file_entry)
+      std::unordered_map<URL, FileEntry>::const_iterator it = file_entry_by_url.find(*i);
+      if (it == file_entry_by_url.end())
       {
         workspace.add_image(Image::create(*i));
       }
       else
       {
+        const FileEntry& file_entry = it->second;
         ImagePtr image = Image::create(file_entry.get_url(), DatabaseTileProvider::create(file_entry));
         workspace.add_image(image);
 
@@ -444,12 +465,17 @@ Galapix::view(const Options& opts, const std::vector<URL>& urls)
   viewer.layout_tight();
   viewer.finish_layout();
   viewer.zoom_to_selection();
+  if (stats_overlay)
+  {
+    viewer.toggle_stats_overlay();
+  }
   sdl_viewer.run();
 #endif
 
 #ifdef GALAPIX_GTK
   GtkViewer gtk_viewer;
   gtk_viewer.set_workspace(&workspace);
+  gtk_viewer.set_stats_overlay(stats_overlay);
   gtk_viewer.run();
 #endif
 
@@ -480,6 +506,7 @@ Galapix::print_usage()
             << "       galapix list     [OPTIONS]...\n"
             << "       galapix cleanup  [OPTIONS]...\n"
             << "       galapix merge    [OPTIONS]... [FILES]...\n"
+            << "       galapix convert  INPUT OUTPUT\n"
             << "\n"
             << "Commands:\n"
             << "  view      Display the given files\n"
@@ -490,15 +517,25 @@ Galapix::print_usage()
             << "  check     Checks the database for consistency\n"
             << "  cleanup   Runs garbage collection on the database\n"
             << "  merge     Merges the given databases into the database given by -d FILE\n"
+            << "  convert   Converts a .galapix workspace between the text and the binary format\n"
             << "\n"
             << "Options:\n"
             << "  -d, --database FILE    Use FILE has database (default: none)\n"
             << "  -f, --fullscreen       Start in fullscreen mode\n"
             << "  -t, --threads          Number of worker threads (default: 2)\n"
+            << "  --io-threads N         Number of threads reading files in thumbgen and prepare (default: 4)\n"
+            << "  --trace FILE           Record what the threads are doing and write it as Chrome trace JSON to FILE\n"
+            << "  --stats SECONDS        Print counters and timing histograms every SECONDS\n"
+            << "  --tile-codec CODEC     Store new tiles as jpeg[:QUALITY], png or qoi (default: jpeg)\n"
+            << "  --tile-shards N        Spread the tiles of a new database over N files (default: 0, a single file)\n"
+            << "  --tile-store STORE     Store the tiles of a new database in sqlite or in a pack (default: sqlite)\n"
+            << "  --http-cache DIR       Keep downloaded files in DIR and revalidate them (default: none)\n"
+            << "  --prefetch N           Prefetch up to N tiles around the visible ones of remote images (default: 32)\n"
             << "  -F, --files-from FILE  Get urls from FILE\n"
             << "  -p, --pattern GLOB     Select files from the database via globbing pattern\n"
             << "  -g, --geometry WxH     Start with window size WxH\n"        
             << "  -a, --anti-aliasing N  Anti-aliasing factor 0,2,4 (default: 0)\n"
+            << "  --stats-overlay        Start with the statistics overlay shown, toggle it with 'o'\n"
             << "\n"
             << "Compiled Fetures:\n" 
 #ifdef HAVE_SPACE_NAVIGATOR
@@ -520,9 +557,25 @@ Galapix::main(int argc, char** argv)
   {
     Options opts;
     opts.threads  = 2;
+    opts.io_threads = 4;
     opts.database = Filesystem::get_home() + "/.galapix/cache3";
+    opts.tile_codec = "jpeg";
+    opts.tile_shards = 0;
+    opts.prefetch = 32;
+    opts.stats = 0.0f;
     parse_args(argc, argv, opts);
 
+    if (!opts.trace.empty() || opts.stats > 0.0f)
+    {
+      TRACE_THREAD_NAME("main");
+      Trace::enable(true);
+    }
+
+    if (opts.stats > 0.0f)
+    {
+      Trace::start_stats_dump(opts.stats);
+    }
+
     if (curl_global_init(CURL_GLOBAL_ALL) != 0)
     {
       std::cout << "Galapix::main(): curl_global_init() failed" << std::endl;
@@ -531,13 +584,23 @@ Galapix::main(int argc, char** argv)
     
     Magick::InitializeMagick(*argv);
 
-    ArchiveManager archive_manager;
-    SoftwareSurfaceFactory software_surface_factory;
+    {
+      ArchiveManager archive_manager;
+      SoftwareSurfaceFactory software_surface_factory;
+      CURLFetcher curl_fetcher(8, opts.http_cache);
 
-    run(opts);
+      run(opts);
+    }
 
     curl_global_cleanup();
 
+    Trace::stop_stats_dump();
+    if (!opts.trace.empty())
+    {
+      std::cout << "Writing trace to: " << opts.trace << std::endl;
+      Trace::write_chrome_trace(opts.trace);
+    }
+
     return EXIT_SUCCESS;
   }
   catch(const std::exception& err) 
@@ -607,6 +670,17 @@ Galapix::run(const Options& opts)
     {
       export_images(opts.database, urls);
     }
+    else if (command == "convert")
+    {
+      if (opts.rest.size() != 3)
+      {
+        std::cout << "Galapix::run(): Error: convert needs an INPUT and an OUTPUT file" << std::endl;
+      }
+      else
+      {
+        convert_workspace(opts.rest[1], opts.rest[2]);
+      }
+    }
     else if (command == "merge")
     {
       merge(opts.database, std::vector<std::string>(opts.rest.begin()+1, opts.rest.end()));
@@ -678,6 +752,102 @@ Galapix::parse_args(int argc, char** argv, Options& opts)
           throw std::runtime_error(std::string(argv[i-1]) + " requires an argument");
         }              
       }
+      else if (strcmp(argv[i], "--io-threads") == 0)
+      {
+        ++i;
+        if (i < argc)
+        {
+          opts.io_threads = atoi(argv[i]);
+        }
+        else
+        {
+          throw std::runtime_error(std::string(argv[i-1]) + " requires an argument");
+        }
+      }
+      else if (strcmp(argv[i], "--trace") == 0)
+      {
+        ++i;
+        if (i < argc)
+        {
+          opts.trace = argv[i];
+        }
+        else
+        {
+          throw std::runtime_error(std::string(argv[i-1]) + " requires an argument");
+        }
+      }
+      else if (strcmp(argv[i], "--stats") == 0)
+      {
+        ++i;
+        if (i < argc)
+        {
+          opts.stats = static_cast<float>(atof(argv[i]));
+        }
+        else
+        {
+          throw std::runtime_error(std::string(argv[i-1]) + " requires an argument");
+        }
+      }
+      else if (strcmp(argv[i], "--tile-codec") == 0)
+      {
+        ++i;
+        if (i < argc)
+        {
+          opts.tile_codec = argv[i];
+        }
+        else
+        {
+          throw std::runtime_error(std::string(argv[i-1]) + " requires an argument");
+        }
+      }
+      else if (strcmp(argv[i], "--tile-shards") == 0)
+      {
+        ++i;
+        if (i < argc)
+        {
+          opts.tile_shards = atoi(argv[i]);
+        }
+        else
+        {
+          throw std::runtime_error(std::string(argv[i-1]) + " requires an argument");
+        }
+      }
+      else if (strcmp(argv[i], "--tile-store") == 0)
+      {
+        ++i;
+        if (i < argc)
+        {
+          opts.tile_store = argv[i];
+        }
+        else
+        {
+          throw std::runtime_error(std::string(argv[i-1]) + " requires an argument");
+        }
+      }
+      else if (strcmp(argv[i], "--http-cache") == 0)
+      {
+        ++i;
+        if (i < argc)
+        {
+          opts.http_cache = argv[i];
+        }
+        else
+        {
+          throw std::runtime_error(std::string(argv[i-1]) + " requires an argument");
+        }
+      }
+      else if (strcmp(argv[i], "--prefetch") == 0)
+      {
+        ++i;
+        if (i < argc)
+        {
+          opts.prefetch = atoi(argv[i]);
+        }
+        else
+        {
+          throw std::runtime_error(std::string(argv[i-1]) + " requires an argument");
+        }
+      }
       else if (strcmp(argv[i], "-F") == 0 ||
                strcmp(argv[i], "--files-from") == 0)
       {
@@ -735,6 +905,10 @@ Galapix::parse_args(int argc, char** argv, Options& opts)
       {
         fullscreen = true;
       }
+      else if (strcmp(argv[i], "--stats-overlay") == 0)
+      {
+        stats_overlay = true;
+      }
       else
       {
         throw std::runtime_error("Unknown option " + std::string(argv[i]));
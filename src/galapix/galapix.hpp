@@ -33,6 +33,7 @@ private:
   bool fullscreen;
   Size geometry;
   int  anti_aliasing;
+  bool stats_overlay;
 
 public:
   Galapix();
@@ -54,6 +55,7 @@ public:
                 bool generate_all_tiles);
   void filegen(const Options& opts,
                const std::vector<URL>& urls);
+  void convert_workspace(const std::string& input, const std::string& output);
   void export_images(const std::string& database, const std::vector<URL>& urls);
   void view(const Options& opts, const std::vector<URL>& urls);
 };
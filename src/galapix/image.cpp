@@ -31,6 +31,43 @@
 #include "math/rgb.hpp"
 #include "util/weak_functor.hpp"
 
+struct Image::Resources
+{
+  ImageTileCachePtr cache;
+  std::unique_ptr<ImageRenderer> renderer;
+  Jobs jobs;
+
+  Resources(Image& image, const TileProviderPtr& provider) :
+    cache(),
+    renderer(),
+    jobs()
+  {
+    if (provider)
+    {
+      cache = ImageTileCache::create(provider);
+      renderer.reset(new ImageRenderer(image, cache));
+    }
+  }
+
+  ~Resources()
+  {
+    abort_all_jobs();
+  }
+
+  void abort_all_jobs()
+  {
+    for(Jobs::iterator i = jobs.begin(); i != jobs.end(); ++i)
+    {
+      i->set_aborted();
+    }
+    jobs.clear();
+  }
+
+private:
+  Resources(const Resources&);
+  Resources& operator=(const Resources&);
+};
+
 ImagePtr
 Image::create(const URL& url, TileProviderPtr provider)
 {
@@ -50,6 +87,7 @@ Image::Image(const URL& url, TileProviderPtr provider) :
   m_url(url),
   m_provider(provider),
   m_visible(false),
+  m_hidden_since(0.0f),
   m_image_rect(),
   m_pos(),
   m_last_pos(),
@@ -59,22 +97,34 @@ Image::Image(const URL& url, TileProviderPtr provider) :
   m_target_scale(1.0f),
   m_angle(0.0f),
   m_file_entry_requested(false),
-  m_cache(),
-  m_renderer(),
+  m_resources(),
+  m_queue_mutex(),
   m_file_entry_queue(),
   m_tile_queue(),
-  m_tile_provider_queue(),
-  m_jobs()
+  m_tile_provider_queue()
 {
   set_provider(m_provider);
 }
 
 Image::~Image()
 {
-  for(auto& job: m_jobs)
+}
+
+Image::Resources&
+Image::get_resources()
+{
+  if (!m_resources)
   {
-    job.set_aborted();
+    m_resources.reset(new Resources(*this, m_provider));
   }
+  return *m_resources;
+}
+
+void
+Image::release_resources()
+{
+  m_resources.reset();
+  m_file_entry_requested = false;
 }
 
 Vector2f
@@ -138,6 +188,14 @@ Image::update_pos(float progress)
   }
 }
 
+void
+Image::set_animation_state(const Vector2f& pos, float scale)
+{
+  m_pos   = pos;
+  m_scale = scale;
+  m_image_rect = calc_image_rect();
+}
+
 void
 Image::set_angle(float a)
 {
@@ -207,9 +265,9 @@ Image::get_original_height() const
 void
 Image::clear_cache()
 {
-  if (m_cache)
+  if (m_resources && m_resources->cache)
   {
-    m_cache->clear();
+    m_resources->cache->clear();
   }
   abort_all_jobs();
   m_file_entry_requested = false;
@@ -218,19 +276,18 @@ Image::clear_cache()
 void
 Image::abort_all_jobs()
 {
-  for(Jobs::iterator i = m_jobs.begin(); i != m_jobs.end(); ++i)
+  if (m_resources)
   {
-    i->set_aborted();
+    m_resources->abort_all_jobs();
   }
-  m_jobs.clear();  
 }
 
 void
 Image::cache_cleanup()
 {
-  if (m_cache)
+  if (m_resources && m_resources->cache)
   {
-    m_cache->cleanup();
+    m_resources->cache->cleanup();
   }
   abort_all_jobs();
   m_file_entry_requested = false;
@@ -239,34 +296,42 @@ Image::cache_cleanup()
 void
 Image::process_queues()
 {
+  std::vector<FileEntry> file_entries;
+  std::vector<Tile> tiles;
+  std::vector<TileProviderPtr> tile_providers;
+
+  {
+    std::unique_lock<std::mutex> lock(m_queue_mutex);
+    file_entries.swap(m_file_entry_queue);
+    tiles.swap(m_tile_queue);
+    tile_providers.swap(m_tile_provider_queue);
+  }
+
   // Check if there was an update of the FileEntry
-  FileEntry file_entry;
-  while(m_file_entry_queue.try_pop(file_entry))
+  for(std::vector<FileEntry>::const_iterator i = file_entries.begin(); i != file_entries.end(); ++i)
   {
-    if (file_entry.get_image_size() == Size(0, 0))
+    if (i->get_image_size() == Size(0, 0))
     { // reject images with invalid size
-      std::cout << "Image::Image(): invalid image size: " << file_entry << std::endl;
+      std::cout << "Image::Image(): invalid image size: " << *i << std::endl;
     }
     else
     {
       m_file_entry_requested = false;
-      set_provider(DatabaseTileProvider::create(file_entry));
+      set_provider(DatabaseTileProvider::create(*i));
     }
   }
 
-  Tile tile;
-  while(m_tile_queue.try_pop(tile))
+  if (m_provider)
   {
-    if (m_cache)
+    for(std::vector<Tile>::const_iterator i = tiles.begin(); i != tiles.end(); ++i)
     {
-      m_cache->receive_tile(tile);
+      get_resources().cache->receive_tile(*i);
     }
   }
   
-  TileProviderPtr tile_provider;
-  while(m_tile_provider_queue.try_pop(tile_provider))
+  for(std::vector<TileProviderPtr>::const_iterator i = tile_providers.begin(); i != tile_providers.end(); ++i)
   {
-    set_provider(tile_provider);
+    set_provider(*i);
   }
 }
 
@@ -275,6 +340,8 @@ Image::draw(const Rectf& cliprect, float zoom)
 {
   process_queues();
 
+  Resources& resources = get_resources();
+
   if (!m_provider)
   {
     Framebuffer::fill_rect(Rectf(get_top_left_pos(), Sizef(get_scaled_width(), get_scaled_height())),
@@ -283,15 +350,15 @@ Image::draw(const Rectf& cliprect, float zoom)
     if (!m_file_entry_requested)
     {
       m_file_entry_requested = true;
-      m_jobs.push_back(DatabaseThread::current()->request_file(m_url,
-                                                               weak(std::bind(&Image::receive_file_entry, std::placeholders::_1, std::placeholders::_2), m_self),
-                                                               weak(std::bind(&Image::receive_tile, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), m_self)));
+      resources.jobs.push_back(DatabaseThread::current()->request_file(m_url,
+                                                                       weak(std::bind(&Image::receive_file_entry, std::placeholders::_1, std::placeholders::_2), m_self),
+                                                                       weak(std::bind(&Image::receive_tile, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), m_self)));
     }
   }
   else
   {
-    m_cache->process_queue();
-    m_renderer->draw(cliprect, zoom);
+    resources.cache->process_queue();
+    resources.renderer->draw(cliprect, zoom);
   }
 }
 
@@ -304,20 +371,13 @@ Image::set_provider(TileProviderPtr provider)
   // cleanup the old provider if present
   if (m_provider)        
   {
-    abort_all_jobs();
-
-    m_cache.reset();
-    m_renderer.reset();
+    m_resources.reset();
     m_provider.reset();
   }
 
-  // set the new provider and related data
-  if (provider)
-  {
-    m_provider = provider;
-    m_cache    = ImageTileCache::create(m_provider);
-    m_renderer.reset(new ImageRenderer(*this, m_cache));
-  }
+  // set the new provider, cache and renderer get created on the next
+  // draw()
+  m_provider = provider;
 
   // Fixup the scale to fit into the old constrains more or less (only
   // works with regular layouts)
@@ -351,7 +411,7 @@ Image::refresh(bool force)
 void
 Image::print_info() const
 {
-  std::cout << "  Image: " << this << std::endl;
+  std::cout << "  Image: " << this << (m_resources ? " (resources loaded)" : "") << std::endl;
   //std::cout << "    Cache Size: " << m_cache.size() << std::endl;
   //std::cout << "    Job Size:   " << m_jobs.size() << std::endl;
 }
@@ -402,9 +462,10 @@ Image::on_enter_screen()
 }
 
 void
-Image::on_leave_screen()
+Image::on_leave_screen(float time)
 {
   m_visible = false;
+  m_hidden_since = time;
   //std::cout << "Image::on_leave_screen(): " << this << std::endl;
   cache_cleanup();
 }
@@ -420,20 +481,22 @@ Image::receive_file_entry(const FileEntry& file_entry)
 {
   // std::cout << "Image::receive_file_entry: " << file_entry << std::endl;
   assert(file_entry);
-  m_file_entry_queue.wait_and_push(file_entry);
+  std::unique_lock<std::mutex> lock(m_queue_mutex);
+  m_file_entry_queue.push_back(file_entry);
 }
 
 void
-
 Image::receive_tile(const FileEntry& file_entry, const Tile& tile)
 {
-  m_tile_queue.wait_and_push(tile);
+  std::unique_lock<std::mutex> lock(m_queue_mutex);
+  m_tile_queue.push_back(tile);
 }
 
 void
 Image::receive_tile_provider(TileProviderPtr provider)
 {
-  m_tile_provider_queue.wait_and_push(provider);
+  std::unique_lock<std::mutex> lock(m_queue_mutex);
+  m_tile_provider_queue.push_back(provider);
 }
 
 /* EOF */
@@ -20,28 +20,33 @@
 #define HEADER_GALAPIX_GALAPIX_IMAGE_HPP
 
 #include <memory>
-#include <map>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "database/file_entry.hpp"
 #include "galapix/image_handle.hpp"
 #include "galapix/tile_provider.hpp"
 #include "galapix/tile.hpp"
 #include "job/job_handle.hpp"
-#include "job/thread_message_queue2.hpp"
 #include "math/rect.hpp"
 #include "math/vector2f.hpp"
 #include "util/url.hpp"
 
-class ImageTileCache;
-class ImageRenderer;
 class TileEntry;
 class Image;
 class Rectf;
 
-
+/** An Image is kept for every image in the Workspace, so it only
+    holds what is needed for layouting and hit testing. The tile cache
+    and renderer are created when the image is first drawn and are
+    released again by release_resources(). */
 class Image
 {
+private:
+  typedef std::vector<JobHandle> Jobs;
+  struct Resources;
+
 private:
   std::weak_ptr<Image> m_self;
 
@@ -49,6 +54,10 @@ private:
   TileProviderPtr m_provider;
 
   bool m_visible;
+
+  /** Time at which the image last left the screen */
+  float m_hidden_since;
+
   Rectf m_image_rect;
   
   /** Position refers to the center of the image */
@@ -66,14 +75,15 @@ private:
 
   bool m_file_entry_requested;
 
-  std::shared_ptr<ImageTileCache> m_cache;
-  std::unique_ptr<ImageRenderer>  m_renderer;
+  /** Tile cache, renderer and outstanding jobs, NULL while the image
+      hasn't been drawn */
+  std::unique_ptr<Resources> m_resources;
 
-  ThreadMessageQueue2<FileEntry> m_file_entry_queue;
-  ThreadMessageQueue2<Tile> m_tile_queue;
-  ThreadMessageQueue2<TileProviderPtr> m_tile_provider_queue;
-  typedef std::vector<JobHandle> Jobs;
-  Jobs m_jobs;
+  /** Data received from other threads, handled in process_queues() */
+  std::mutex m_queue_mutex;
+  std::vector<FileEntry> m_file_entry_queue;
+  std::vector<Tile> m_tile_queue;
+  std::vector<TileProviderPtr> m_tile_provider_queue;
 
 private:
   Image(const URL& url, TileProviderPtr provider);
@@ -95,11 +105,18 @@ public:
   // Update stuff
   void update_pos(float progress);
 
+  /** Set the interpolated position and scale while an animation is
+      running, the animation target is left untouched */
+  void set_animation_state(const Vector2f& pos, float scale);
+
   // _____________________________________________________
   // Getter/Setter
   void set_target_pos(const Vector2f& target_pos);
   void set_target_scale(float target_scale);
 
+  Vector2f get_target_pos() const { return m_target_pos; }
+  float get_target_scale() const { return m_target_scale; }
+
   void     set_pos(const Vector2f& pos);
   Vector2f get_pos() const;
 
@@ -133,6 +150,11 @@ public:
   void cache_cleanup();
   void print_info() const;
 
+  /** Frees the tile cache and renderer, they are recreated on the
+      next draw() */
+  void release_resources();
+  bool has_resources() const { return m_resources.get() != 0; }
+
   // _____________________________________________________
   // Query Stuff
   bool overlaps(const Rectf& cliprect) const;
@@ -142,9 +164,10 @@ public:
   Rectf get_image_rect() const;
 
   bool is_visible() const { return m_visible; }
+  float get_hidden_since() const { return m_hidden_since; }
 
   void on_enter_screen();
-  void on_leave_screen();
+  void on_leave_screen(float time);
 
   void on_zoom_level_change();
 
@@ -157,7 +180,12 @@ public:
   void receive_tile_provider(TileProviderPtr provider);
 
 private:
+  Resources& get_resources();
   void process_queues();
+
+private:
+  Image(const Image&);
+  Image& operator=(const Image&);
 };
 
 #endif
@@ -0,0 +1,174 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "galapix/image_animator.hpp"
+
+#include "galapix/image.hpp"
+#include "galapix/image_collection.hpp"
+
+ImageAnimator::ImageAnimator() :
+  m_images(),
+  m_from_x(),
+  m_from_y(),
+  m_from_scale(),
+  m_to_x(),
+  m_to_y(),
+  m_to_scale(),
+  m_x(),
+  m_y(),
+  m_scale(),
+  m_progress(1.0f)
+{
+}
+
+void
+ImageAnimator::clear()
+{
+  m_images.clear();
+
+  m_from_x.clear();
+  m_from_y.clear();
+  m_from_scale.clear();
+
+  m_to_x.clear();
+  m_to_y.clear();
+  m_to_scale.clear();
+
+  m_x.clear();
+  m_y.clear();
+  m_scale.clear();
+}
+
+void
+ImageAnimator::add(const ImagePtr& image)
+{
+  const Vector2f pos    = image->get_pos();
+  const Vector2f target = image->get_target_pos();
+  const float scale        = image->get_scale();
+  const float target_scale = image->get_target_scale();
+
+  if (pos.x != target.x || pos.y != target.y || scale != target_scale)
+  {
+    m_images.push_back(image);
+
+    m_from_x.push_back(pos.x);
+    m_from_y.push_back(pos.y);
+    m_from_scale.push_back(scale);
+
+    m_to_x.push_back(target.x);
+    m_to_y.push_back(target.y);
+    m_to_scale.push_back(target_scale);
+
+    m_x.push_back(pos.x);
+    m_y.push_back(pos.y);
+    m_scale.push_back(scale);
+  }
+}
+
+void
+ImageAnimator::start(const ImageCollection& images)
+{
+  clear();
+
+  for(ImageCollection::const_iterator i = images.begin(); i != images.end(); ++i)
+  {
+    add(*i);
+  }
+
+  m_progress = 0.0f;
+}
+
+void
+ImageAnimator::add(const ImageCollection& images, size_t first)
+{
+  if (m_progress != 0.0f)
+  {
+    // rebase the images already in motion on their current
+    // position, so that restarting the clock doesn't make them jump
+    m_from_x = m_x;
+    m_from_y = m_y;
+    m_from_scale = m_scale;
+  }
+
+  for(size_t i = first; i < images.size(); ++i)
+  {
+    add(images[i]);
+  }
+
+  m_progress = 0.0f;
+}
+
+void
+ImageAnimator::update(float delta)
+{
+  if (m_images.empty())
+  {
+    return;
+  }
+
+  m_progress += delta;
+
+  if (m_progress >= 1.0f)
+  {
+    finish();
+  }
+  else
+  {
+    const float t = m_progress;
+    const size_t n = m_images.size();
+
+    const float* from_x = m_from_x.data();
+    const float* from_y = m_from_y.data();
+    const float* from_scale = m_from_scale.data();
+
+    const float* to_x = m_to_x.data();
+    const float* to_y = m_to_y.data();
+    const float* to_scale = m_to_scale.data();
+
+    float* x = m_x.data();
+    float* y = m_y.data();
+    float* scale = m_scale.data();
+
+    // no aliasing and no branches, so the compiler can vectorize this
+    for(size_t i = 0; i < n; ++i)
+    {
+      x[i] = from_x[i] + (to_x[i] - from_x[i]) * t;
+      y[i] = from_y[i] + (to_y[i] - from_y[i]) * t;
+      scale[i] = from_scale[i] + (to_scale[i] - from_scale[i]) * t;
+    }
+
+    for(size_t i = 0; i < n; ++i)
+    {
+      m_images[i]->set_animation_state(Vector2f(x[i], y[i]), scale[i]);
+    }
+  }
+}
+
+void
+ImageAnimator::finish()
+{
+  for(std::vector<ImagePtr>::iterator i = m_images.begin(); i != m_images.end(); ++i)
+  {
+    (*i)->update_pos(1.0f);
+  }
+
+  clear();
+  m_progress = 1.0f;
+}
+
+/* EOF */
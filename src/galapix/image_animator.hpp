@@ -0,0 +1,85 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_GALAPIX_IMAGE_ANIMATOR_HPP
+#define HEADER_GALAPIX_GALAPIX_IMAGE_ANIMATOR_HPP
+
+#include <stddef.h>
+#include <vector>
+
+#include "galapix/image_handle.hpp"
+
+class ImageCollection;
+
+/** Moves images from their current position and scale to their
+    target, only images whose target differs from their current
+    state are tracked, their positions are kept in packed arrays so
+    that the interpolation runs as a tight loop */
+class ImageAnimator
+{
+private:
+  std::vector<ImagePtr> m_images;
+
+  std::vector<float> m_from_x;
+  std::vector<float> m_from_y;
+  std::vector<float> m_from_scale;
+
+  std::vector<float> m_to_x;
+  std::vector<float> m_to_y;
+  std::vector<float> m_to_scale;
+
+  std::vector<float> m_x;
+  std::vector<float> m_y;
+  std::vector<float> m_scale;
+
+  /** Progress of the animation, from 0 to 1 */
+  float m_progress;
+
+public:
+  ImageAnimator();
+
+  /** Throw away the running animation and start a new one for all
+      images in \a images that aren't at their target */
+  void start(const ImageCollection& images);
+
+  /** Add images[first..] to the running animation, images already
+      in motion continue from their current position */
+  void add(const ImageCollection& images, size_t first);
+
+  /** Advance the animation by \a delta, given as a fraction of the
+      whole animation */
+  void update(float delta);
+
+  /** Move all images to their target */
+  void finish();
+
+  bool is_running() const { return !m_images.empty(); }
+  size_t size() const { return m_images.size(); }
+
+private:
+  void add(const ImagePtr& image);
+  void clear();
+
+private:
+  ImageAnimator(const ImageAnimator&);
+  ImageAnimator& operator=(const ImageAnimator&);
+};
+
+#endif
+
+/* EOF */
@@ -22,9 +22,50 @@
 
 #include "util/weak_functor.hpp"
 #include "math/math.hpp"
-#include "galapix/viewer.hpp"
+#include "math/rect.hpp"
 #include "galapix/database_thread.hpp"
 
+std::atomic<int64_t> ImageTileCache::s_tiles_requested(0);
+std::atomic<int64_t> ImageTileCache::s_tiles_arrived(0);
+std::atomic<int>     ImageTileCache::s_tiles_in_flight(0);
+std::atomic<int>     ImageTileCache::s_tiles_resident(0);
+std::atomic<int64_t> ImageTileCache::s_texels_resident(0);
+
+std::function<void ()> ImageTileCache::s_redraw_callback;
+
+void
+ImageTileCache::set_redraw_callback(const std::function<void ()>& callback)
+{
+  s_redraw_callback = callback;
+}
+
+ImageTileCache::Stats
+ImageTileCache::get_stats()
+{
+  Stats stats;
+  stats.tiles_requested = s_tiles_requested.load(std::memory_order_relaxed);
+  stats.tiles_arrived   = s_tiles_arrived.load(std::memory_order_relaxed);
+  stats.tiles_in_flight = s_tiles_in_flight.load(std::memory_order_relaxed);
+  stats.tiles_resident  = s_tiles_resident.load(std::memory_order_relaxed);
+  stats.texels_resident = s_texels_resident.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void
+ImageTileCache::count_entry(const SurfaceStruct& entry, int sign)
+{
+  if (entry.status == SurfaceStruct::SURFACE_REQUESTED)
+  {
+    s_tiles_in_flight.fetch_add(sign, std::memory_order_relaxed);
+  }
+  else if (entry.surface)
+  {
+    s_tiles_resident.fetch_add(sign, std::memory_order_relaxed);
+    s_texels_resident.fetch_add(sign * static_cast<int64_t>(entry.surface->get_width()) * entry.surface->get_height(),
+                                std::memory_order_relaxed);
+  }
+}
+
 ImageTileCachePtr
 ImageTileCache::create(TileProviderPtr tile_provider)
 {
@@ -49,6 +90,14 @@ ImageTileCache::ImageTileCache(TileProviderPtr tile_provider) :
 {
 }
 
+ImageTileCache::~ImageTileCache()
+{
+  for(Cache::iterator i = m_cache.begin(); i != m_cache.end(); ++i)
+  {
+    count_entry(i->second, -1);
+  }
+}
+
 SurfacePtr
 ImageTileCache::get_tile(int x, int y, int scale)
 {
@@ -96,6 +145,8 @@ ImageTileCache::request_tile(int x, int y, int scale)
                                  SurfaceStruct::SURFACE_REQUESTED,
                                  SurfacePtr());
     m_cache[cache_id] = surface_struct;
+    count_entry(surface_struct, 1);
+    s_tiles_requested.fetch_add(1, std::memory_order_relaxed);
     return surface_struct;
   }
   else
@@ -110,6 +161,7 @@ ImageTileCache::clear()
   for(Cache::iterator i = m_cache.begin(); i != m_cache.end(); ++i)
   {
     i->second.job_handle.set_aborted();
+    count_entry(i->second, -1);
   }
   m_cache.clear();
 }
@@ -123,11 +175,13 @@ ImageTileCache::cleanup()
     if (i->second.status == SurfaceStruct::SURFACE_REQUESTED)
     {
       i->second.job_handle.set_aborted();
+      count_entry(i->second, -1);
       m_cache.erase(i++);
     }
     else if (i->second.status == SurfaceStruct::SURFACE_SUCCEEDED &&
              i->first.get_scale() < m_min_keep_scale)
     {
+      count_entry(i->second, -1);
       m_cache.erase(i++);
     }
     else
@@ -177,15 +231,20 @@ ImageTileCache::process_queue()
     if (i == m_cache.end())
     {
       // std::cout << "ImageTileCache::process_queue(): received unrequested tile" << std::endl;
-      m_cache[tile_id] = SurfaceStruct(JobHandle::create(),
-                                       SurfaceStruct::SURFACE_SUCCEEDED,
-                                       Surface::create(tile.get_surface()));
+      SurfaceStruct& entry = m_cache[tile_id];
+      entry = SurfaceStruct(JobHandle::create(),
+                            SurfaceStruct::SURFACE_SUCCEEDED,
+                            Surface::create(tile.get_surface()));
+      count_entry(entry, 1);
     }
     else
     {
+      count_entry(i->second, -1);
       i->second.surface = Surface::create(tile.get_surface());
       i->second.status  = SurfaceStruct::SURFACE_SUCCEEDED;
+      count_entry(i->second, 1);
     }
+    s_tiles_arrived.fetch_add(1, std::memory_order_relaxed);
   }
 }
 
@@ -208,6 +267,7 @@ ImageTileCache::cancel_jobs(const Rect& rect, int scale)
           (scale != i->first.get_scale() || !rect.contains(i->first.get_pos())))
       {
         i->second.job_handle.set_aborted();
+        count_entry(i->second, -1);
         m_cache.erase(i++);
       }
       else
@@ -223,7 +283,10 @@ ImageTileCache::receive_tile(const Tile& tile)
 {
   m_tile_queue.wait_and_push(tile);
 
-  Viewer::current()->redraw();
+  if (s_redraw_callback)
+  {
+    s_redraw_callback();
+  }
 }
 
 /* EOF */
@@ -19,7 +19,10 @@
 #ifndef HEADER_GALAPIX_GALAPIX_IMAGE_TILE_CACHE_HPP
 #define HEADER_GALAPIX_GALAPIX_IMAGE_TILE_CACHE_HPP
 
+#include <atomic>
+#include <functional>
 #include <map>
+#include <stdint.h>
 #include <vector>
 
 #include "display/surface.hpp"
@@ -63,9 +66,50 @@ public:
     {}
   };
 
+  /** Counters summed over all ImageTileCaches, they are updated
+      with relaxed atomics and can be sampled from any thread */
+  struct Stats
+  {
+    /** Totals since startup */
+    int64_t tiles_requested;
+    int64_t tiles_arrived;
+
+    /** Current state of the caches */
+    int     tiles_in_flight;
+    int     tiles_resident;
+    int64_t texels_resident;
+
+    Stats() :
+      tiles_requested(0),
+      tiles_arrived(0),
+      tiles_in_flight(0),
+      tiles_resident(0),
+      texels_resident(0)
+    {}
+  };
+
+  static Stats get_stats();
+
+  /** \a callback is called from the thread that delivers a tile,
+      whenever one arrives, so that the display can be redrawn. Set
+      it before any tiles are requested. */
+  static void set_redraw_callback(const std::function<void ()>& callback);
+
 private:
   typedef std::map<TileCacheId, SurfaceStruct> Cache; 
 
+  static std::atomic<int64_t> s_tiles_requested;
+  static std::atomic<int64_t> s_tiles_arrived;
+  static std::atomic<int>     s_tiles_in_flight;
+  static std::atomic<int>     s_tiles_resident;
+  static std::atomic<int64_t> s_texels_resident;
+
+  static std::function<void ()> s_redraw_callback;
+
+  /** Adds (\a sign = 1) or removes (\a sign = -1) \a entry from
+      the in flight and resident counts */
+  static void count_entry(const SurfaceStruct& entry, int sign);
+
 public:
   std::weak_ptr<ImageTileCache> m_self;
   Cache m_cache;
@@ -87,6 +131,7 @@ private:
 
 public:
   static ImageTileCachePtr create(TileProviderPtr tile_provider);
+  ~ImageTileCache();
 
   SurfaceStruct request_tile(int x, int y, int scale);
   SurfacePtr get_tile(int x, int y, int scale);
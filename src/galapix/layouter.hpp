@@ -20,6 +20,7 @@
 #define HEADER_GALAPIX_GALAPIX_LAYOUTER_HPP
 
 #include <memory>
+#include <stddef.h>
 
 class ImageCollection;
 
@@ -33,6 +34,15 @@ public:
 
   virtual void layout(const ImageCollection& images, bool animated) =0;
 
+  /** Place images[first..] behind images[0..first), which must have
+      been layouted by this Layouter before. Returns false when the
+      whole collection had to be layouted again instead. */
+  virtual bool append(const ImageCollection& images, size_t first, bool animated)
+  {
+    layout(images, animated);
+    return false;
+  }
+
 private:
   Layouter(const Layouter&);
   Layouter& operator=(const Layouter&);
@@ -19,15 +19,162 @@
 #include "galapix/mandelbrot_tile_job.hpp"
 
 #include <iostream>
+#include <stdint.h>
 
-#include "math/rgb.hpp"
+#if defined(__AVX__)
+#  include <immintrin.h>
+#elif defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+namespace {
+
+/* Each kernel iterates kLanes points at once, as two independent
+   vectors so that the latency of one chain of multiplies is hidden
+   behind the other. A lane stops counting once its point escaped,
+   the loop ends as soon as all lanes did. Escaped lanes keep being
+   iterated until then, they might go to inf or NaN, which compares
+   false and keeps them inactive. */
+
+#if defined(__AVX__)
+
+const int kLanes = 8;
+
+void iterate(const double* x0_in, double y0_in, int max_iteration, int* iteration_out)
+{
+  const __m256d four = _mm256_set1_pd(4.0);
+  const __m256d one  = _mm256_set1_pd(1.0);
+  const __m256d y0   = _mm256_set1_pd(y0_in);
+  const __m256d x0_a = _mm256_loadu_pd(x0_in);
+  const __m256d x0_b = _mm256_loadu_pd(x0_in + 4);
+
+  __m256d x_a = _mm256_setzero_pd(), y_a = x_a, count_a = x_a;
+  __m256d x_b = x_a, y_b = x_a, count_b = x_a;
+  __m256d active_a = _mm256_cmp_pd(x_a, x_a, _CMP_EQ_OQ);
+  __m256d active_b = active_a;
+
+  for(int i = 0; i < max_iteration; ++i)
+  {
+    __m256d x2_a = _mm256_mul_pd(x_a, x_a);
+    __m256d y2_a = _mm256_mul_pd(y_a, y_a);
+    __m256d x2_b = _mm256_mul_pd(x_b, x_b);
+    __m256d y2_b = _mm256_mul_pd(y_b, y_b);
+
+    active_a = _mm256_and_pd(active_a, _mm256_cmp_pd(_mm256_add_pd(x2_a, y2_a), four, _CMP_LE_OQ));
+    active_b = _mm256_and_pd(active_b, _mm256_cmp_pd(_mm256_add_pd(x2_b, y2_b), four, _CMP_LE_OQ));
+    if ((_mm256_movemask_pd(active_a) | _mm256_movemask_pd(active_b)) == 0)
+    {
+      break;
+    }
+
+    count_a = _mm256_add_pd(count_a, _mm256_and_pd(active_a, one));
+    count_b = _mm256_add_pd(count_b, _mm256_and_pd(active_b, one));
+
+    __m256d xy_a = _mm256_mul_pd(x_a, y_a);
+    __m256d xy_b = _mm256_mul_pd(x_b, y_b);
+    y_a = _mm256_add_pd(_mm256_add_pd(xy_a, xy_a), y0);
+    y_b = _mm256_add_pd(_mm256_add_pd(xy_b, xy_b), y0);
+    x_a = _mm256_add_pd(_mm256_sub_pd(x2_a, y2_a), x0_a);
+    x_b = _mm256_add_pd(_mm256_sub_pd(x2_b, y2_b), x0_b);
+  }
+
+  double count[kLanes];
+  _mm256_storeu_pd(count,     count_a);
+  _mm256_storeu_pd(count + 4, count_b);
+  for(int lane = 0; lane < kLanes; ++lane)
+  {
+    iteration_out[lane] = static_cast<int>(count[lane]);
+  }
+}
+
+#elif defined(__SSE2__)
+
+const int kLanes = 4;
+
+void iterate(const double* x0_in, double y0_in, int max_iteration, int* iteration_out)
+{
+  const __m128d four = _mm_set1_pd(4.0);
+  const __m128d one  = _mm_set1_pd(1.0);
+  const __m128d y0   = _mm_set1_pd(y0_in);
+  const __m128d x0_a = _mm_loadu_pd(x0_in);
+  const __m128d x0_b = _mm_loadu_pd(x0_in + 2);
+
+  __m128d x_a = _mm_setzero_pd(), y_a = x_a, count_a = x_a;
+  __m128d x_b = x_a, y_b = x_a, count_b = x_a;
+  __m128d active_a = _mm_cmpeq_pd(x_a, x_a);
+  __m128d active_b = active_a;
+
+  for(int i = 0; i < max_iteration; ++i)
+  {
+    __m128d x2_a = _mm_mul_pd(x_a, x_a);
+    __m128d y2_a = _mm_mul_pd(y_a, y_a);
+    __m128d x2_b = _mm_mul_pd(x_b, x_b);
+    __m128d y2_b = _mm_mul_pd(y_b, y_b);
+
+    active_a = _mm_and_pd(active_a, _mm_cmple_pd(_mm_add_pd(x2_a, y2_a), four));
+    active_b = _mm_and_pd(active_b, _mm_cmple_pd(_mm_add_pd(x2_b, y2_b), four));
+    if ((_mm_movemask_pd(active_a) | _mm_movemask_pd(active_b)) == 0)
+    {
+      break;
+    }
+
+    count_a = _mm_add_pd(count_a, _mm_and_pd(active_a, one));
+    count_b = _mm_add_pd(count_b, _mm_and_pd(active_b, one));
+
+    __m128d xy_a = _mm_mul_pd(x_a, y_a);
+    __m128d xy_b = _mm_mul_pd(x_b, y_b);
+    y_a = _mm_add_pd(_mm_add_pd(xy_a, xy_a), y0);
+    y_b = _mm_add_pd(_mm_add_pd(xy_b, xy_b), y0);
+    x_a = _mm_add_pd(_mm_sub_pd(x2_a, y2_a), x0_a);
+    x_b = _mm_add_pd(_mm_sub_pd(x2_b, y2_b), x0_b);
+  }
+
+  double count[kLanes];
+  _mm_storeu_pd(count,     count_a);
+  _mm_storeu_pd(count + 2, count_b);
+  for(int lane = 0; lane < kLanes; ++lane)
+  {
+    iteration_out[lane] = static_cast<int>(count[lane]);
+  }
+}
+
+#else
+
+const int kLanes = 4;
+
+void iterate(const double* x0, double y0, int max_iteration, int* iteration_out)
+{
+  for(int lane = 0; lane < kLanes; ++lane)
+  {
+    double x = 0;
+    double y = 0;
+    int iteration = 0;
+
+    while(x*x + y*y <= (2*2) &&
+          iteration < max_iteration)
+    {
+      double xtemp = x * x - y * y + x0[lane];
+      y = 2 * x * y + y0;
+      x = xtemp;
+      ++iteration;
+    }
+
+    iteration_out[lane] = iteration;
+  }
+}
+
+#endif
+
+} // namespace
 
 MandelbrotTileJob::MandelbrotTileJob(JobHandle job_handle, const Size& size, int scale, const Vector2i& pos,
+                                     int max_iteration,
                                      const std::function<void (Tile)>& callback) :
   Job(job_handle),
   m_size(size),
   m_scale(scale),
   m_pos(pos),
+  m_max_iteration(max_iteration),
   m_callback(callback)
 {}
 
@@ -44,31 +191,27 @@ MandelbrotTileJob::run()
     if (get_handle().is_aborted())
       return;
 
-    for(int px = 0; px < surface->get_width(); ++px)
-    {
-      double x0 = static_cast<double>(256 * m_pos.x + px) / static_cast<double>(imagesize.width)  * 4.0f - 2.5f;
-      double y0 = static_cast<double>(256 * m_pos.y + py) / static_cast<double>(imagesize.height) * 3.0f - 1.5f;
-
-      double x = 0;
-      double y = 0;
+    double y0 = static_cast<double>(256 * m_pos.y + py) / static_cast<double>(imagesize.height) * 3.0 - 1.5;
+    uint8_t* row = surface->get_row_data(py);
 
-      int iteration = 0;
-      const int max_iteration = 160;
-    
-      while(x*x + y*y <= (2*2) && 
-            iteration < max_iteration)
+    for(int px = 0; px < surface->get_width(); px += kLanes)
+    {
+      double x0[kLanes];
+      for(int lane = 0; lane < kLanes; ++lane)
       {
-        double xtemp = x * x - y * y + x0;
-        y = 2 * x * y + y0;
+        x0[lane] = static_cast<double>(256 * m_pos.x + px + lane) / static_cast<double>(imagesize.width) * 4.0 - 2.5;
+      }
 
-        x = xtemp;
+      int iteration[kLanes];
+      iterate(x0, y0, m_max_iteration, iteration);
 
-        ++iteration;
+      for(int lane = 0; lane < kLanes && px + lane < surface->get_width(); ++lane)
+      {
+        uint8_t value = static_cast<uint8_t>(255 * static_cast<int64_t>(iteration[lane]) / m_max_iteration);
+        row[3 * (px + lane) + 0] = value;
+        row[3 * (px + lane) + 1] = value;
+        row[3 * (px + lane) + 2] = value;
       }
- 
-      surface->put_pixel(px, py, RGB(static_cast<uint8_t>(255 * iteration / max_iteration),
-                                     static_cast<uint8_t>(255 * iteration / max_iteration), 
-                                     static_cast<uint8_t>(255 * iteration / max_iteration)));
     }
   }
   
@@ -26,16 +26,23 @@
 #include "math/vector2i.hpp"
 #include "galapix/tile.hpp"
 
+/** Renders a tile of the Mandelbrot set, the points are iterated
+    four at a time with SSE2, or eight at a time when compiled with
+    AVX enabled */
 class MandelbrotTileJob : public Job
 {
 private:
   Size     m_size;
   int      m_scale;
   Vector2i m_pos;
+  int      m_max_iteration;
   std::function<void (Tile)> m_callback;
 
 public:
+  /** @param max_iteration iteration budget per pixel, the cost of a
+      tile grows linearly with it for tiles inside the set */
   MandelbrotTileJob(JobHandle job_handle, const Size& size, int scale, const Vector2i& pos,
+                    int max_iteration,
                     const std::function<void (Tile)>& callback);
 
   void run();
@@ -18,20 +18,99 @@
 
 #include "galapix/mandelbrot_tile_provider.hpp"
 
+#include <errno.h>
 #include <iostream>
+#include <limits.h>
+#include <sstream>
+#include <stdexcept>
+#include <stdlib.h>
 
 #include "job/job.hpp"
 #include "job/job_manager.hpp"
 #include "galapix/mandelbrot_tile_job.hpp"
+#include "util/raise_exception.hpp"
+#include "util/url.hpp"
 
 // 20 is the maximum value allowed on 32bit, larger values will make
 // the m_size field overflow
 const int c_max_scale = 20;
 
-MandelbrotTileProvider::MandelbrotTileProvider(JobManager& job_manager) :
-  m_size(4 * 256 * Math::pow2(c_max_scale), 
-         3 * 256 * Math::pow2(c_max_scale)),
-  m_max_scale(c_max_scale),
+namespace {
+
+/** Parses the value of the query parameter \a key, the whole value
+    has to be a number that fits into an int */
+int parse_int(const URL& url, const std::string& key, const std::string& value)
+{
+  errno = 0;
+  char* end = 0;
+  long result = strtol(value.c_str(), &end, 10);
+
+  if (value.empty() || *end != '\0')
+  {
+    raise_exception(std::runtime_error, url << ": " << key << " must be a number, got '" << value << "'");
+  }
+
+  if (errno == ERANGE || result < INT_MIN || result > INT_MAX)
+  {
+    raise_exception(std::runtime_error, url << ": " << key << " is out of range: " << value);
+  }
+
+  return static_cast<int>(result);
+}
+
+} // namespace
+
+std::shared_ptr<MandelbrotTileProvider>
+MandelbrotTileProvider::create(const URL& url, JobManager& job_manager)
+{
+  int max_iteration = 160;
+  int max_scale = c_max_scale;
+
+  const std::string& payload = url.get_payload();
+  std::string::size_type query = payload.find('?');
+  if (query != std::string::npos)
+  {
+    std::istringstream in(payload.substr(query + 1));
+    std::string param;
+    while(std::getline(in, param, '&'))
+    {
+      std::string::size_type eq = param.find('=');
+      std::string key   = param.substr(0, eq);
+      std::string value = (eq == std::string::npos) ? std::string() : param.substr(eq + 1);
+
+      if (key == "iterations")
+      {
+        max_iteration = parse_int(url, key, value);
+      }
+      else if (key == "depth")
+      {
+        max_scale = parse_int(url, key, value);
+      }
+      else
+      {
+        raise_exception(std::runtime_error, "unknown parameter in " << url << ": " << key);
+      }
+    }
+  }
+
+  if (max_iteration < 1)
+  {
+    raise_exception(std::runtime_error, url << ": iterations must be at least 1");
+  }
+
+  if (max_scale < 0 || max_scale > c_max_scale)
+  {
+    raise_exception(std::runtime_error, url << ": depth must be between 0 and " << c_max_scale);
+  }
+
+  return std::make_shared<MandelbrotTileProvider>(job_manager, max_iteration, max_scale);
+}
+
+MandelbrotTileProvider::MandelbrotTileProvider(JobManager& job_manager, int max_iteration, int max_scale) :
+  m_size(4 * 256 * Math::pow2(max_scale), 
+         3 * 256 * Math::pow2(max_scale)),
+  m_max_scale(max_scale),
+  m_max_iteration(max_iteration),
   m_job_manager(job_manager)
 {
 }
@@ -46,7 +125,7 @@ MandelbrotTileProvider::request_tile(int scale, const Vector2i& pos,
 {
   //std::cout << "MandelbrotTileProvider::request_tile(): " << scale << " " << pos << std::endl;
   JobHandle job_handle = JobHandle::create();
-  m_job_manager.request(JobPtr(new MandelbrotTileJob(job_handle, m_size, scale, pos, callback)));
+  m_job_manager.request(JobPtr(new MandelbrotTileJob(job_handle, m_size, scale, pos, m_max_iteration, callback)));
   return job_handle;
 }
 
@@ -27,16 +27,34 @@
 #include "job/job_handle.hpp"
 
 class JobManager;
+class URL;
 
+/** Computes the Mandelbrot set on the fly, it needs neither files
+    nor the Database, which makes builtin://mandelbrot a synthetic
+    workload for the JobManager -> tile cache -> render path. The CPU
+    cost per tile is set by the iteration budget, the number of tiles
+    by the zoom depth:
+
+      builtin://mandelbrot?iterations=N&depth=D
+
+    iterations defaults to 160, depth, the number of zoom levels
+    beyond the first tile, to 20, which is also the maximum. The
+    output is deterministic, so runs can be compared. */
 class MandelbrotTileProvider : public TileProvider
 {
+public:
+  /** Create a provider for a builtin://mandelbrot url, parameters
+      are taken from the query part of the url */
+  static std::shared_ptr<MandelbrotTileProvider> create(const URL& url, JobManager& job_manager);
+
 private:
   Size m_size;
   int  m_max_scale;
+  int  m_max_iteration;
   JobManager& m_job_manager;
 
 public:
-  MandelbrotTileProvider(JobManager& job_manager);
+  MandelbrotTileProvider(JobManager& job_manager, int max_iteration = 160, int max_scale = 20);
   ~MandelbrotTileProvider();
   
   JobHandle request_tile(int tilescale, const Vector2i& pos, 
@@ -23,14 +23,30 @@ class Options
 {
 public:
   std::string database;
+  std::string tile_codec;
+  int         tile_shards;
+  std::string tile_store;
+  std::string http_cache;
+  int         prefetch;
+  std::string trace;
+  float       stats;
   std::vector<std::string> patterns;
   int         threads;
+  int         io_threads;
   std::vector<std::string> rest;
 
   Options() :
     database(),
+    tile_codec(),
+    tile_shards(),
+    tile_store(),
+    http_cache(),
+    prefetch(),
+    trace(),
+    stats(),
     patterns(),
     threads(),
+    io_threads(),
     rest()
   {}
 };
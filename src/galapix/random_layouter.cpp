@@ -25,19 +25,50 @@ RandomLayouter::RandomLayouter()
 {
 }
 
+void
+RandomLayouter::layout(Image& image, int width, bool animated)
+{
+  const Vector2f pos(static_cast<float>(rand() % width), 
+                     static_cast<float>(rand() % width));
+
+  // FIXME: Make this relative to image size
+  const float scale = static_cast<float>(rand()%1000) / 1000.0f + 0.25f;
+
+  if (animated)
+  {
+    image.set_target_pos(pos);
+    image.set_target_scale(scale);
+  }
+  else
+  {
+    image.set_pos(pos);
+    image.set_scale(scale);
+  }
+}
+
 void
 RandomLayouter::layout(const ImageCollection& images, bool animated)
 {
-  const int width = static_cast<int>(Math::sqrt(float(images.size())) * 1500.0f);
+  const int width = Math::max(1, static_cast<int>(Math::sqrt(float(images.size())) * 1500.0f));
 
   for(ImageCollection::const_iterator i = images.begin(); i != images.end(); ++i)
   {
-    (*i)->set_target_pos(Vector2f(static_cast<float>(rand() % width), 
-                                  static_cast<float>(rand() % width)));
+    layout(**i, width, animated);
+  }
+}
 
-    // FIXME: Make this relative to image size
-    (*i)->set_target_scale(static_cast<float>(rand()%1000) / 1000.0f + 0.25f); 
+bool
+RandomLayouter::append(const ImageCollection& images, size_t first, bool animated)
+{
+  // only the new images are scattered, over the area the whole
+  // collection would cover
+  const int width = Math::max(1, static_cast<int>(Math::sqrt(float(images.size())) * 1500.0f));
+
+  for(size_t i = first; i < images.size(); ++i)
+  {
+    layout(*images[i], width, animated);
   }
+  return true;
 }
 
 /* EOF */
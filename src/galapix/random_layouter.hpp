@@ -33,6 +33,10 @@ public:
   RandomLayouter();
 
   void layout(const ImageCollection& images, bool animated);
+  bool append(const ImageCollection& images, size_t first, bool animated);
+
+private:
+  void layout(Image& image, int width, bool animated);
 
 private:
   RandomLayouter(const RandomLayouter&);
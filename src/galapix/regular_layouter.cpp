@@ -24,35 +24,82 @@
 
 RegularLayouter::RegularLayouter(float aspect_w, float aspect_h) :
   m_aspect_w(aspect_w),
-  m_aspect_h(aspect_h)
+  m_aspect_h(aspect_h),
+  m_width(0)
 {
 }
 
+int
+RegularLayouter::calc_width(size_t num_images) const
+{
+  return Math::max(1, int(Math::sqrt(m_aspect_w * static_cast<float>(num_images) / m_aspect_h)));
+}
+
+void
+RegularLayouter::layout(Image& image, int i, bool animated)
+{
+  const int w = m_width;
+
+  float target_scale = Math::min(1000.0f / static_cast<float>(image.get_original_width()),
+                                 1000.0f / static_cast<float>(image.get_original_height()));
+
+  Vector2f target_pos;
+  if ((i/w) % 2 == 0)
+  {
+    target_pos = Vector2f(static_cast<float>(i % w) * 1024.0f,
+                          static_cast<float>(i / w) * 1024.0f);
+  }
+  else
+  {
+    target_pos = Vector2f(static_cast<float>(w - (i % w)-1) * 1024.0f,
+                          static_cast<float>(i / w)         * 1024.0f);
+  }
+
+  if (animated)
+  {
+    image.set_target_scale(target_scale);
+    image.set_target_pos(target_pos);
+  }
+  else
+  {
+    image.set_scale(target_scale);
+    image.set_pos(target_pos);
+  }
+}
+
 void
 RegularLayouter::layout(const ImageCollection& images, bool animated)
 {
   if (!images.empty())
   {
-    int w = int(Math::sqrt(m_aspect_w * static_cast<float>(images.size()) / m_aspect_h));
+    m_width = calc_width(images.size());
       
     for(int i = 0; i < int(images.size()); ++i)
     {
-      float target_scale = Math::min(1000.0f / static_cast<float>(images[i]->get_original_width()),
-                                     1000.0f / static_cast<float>(images[i]->get_original_height()));
-
-      images[i]->set_target_scale(target_scale);
-
-      if ((i/w) % 2 == 0)
-      {
-        images[i]->set_target_pos(Vector2f(static_cast<float>(i % w) * 1024.0f,
-                                           static_cast<float>(i / w) * 1024.0f));
-      }
-      else
-      {
-        images[i]->set_target_pos(Vector2f(static_cast<float>(w - (i % w)-1) * 1024.0f,
-                                           static_cast<float>(i / w)         * 1024.0f));
-      }
+      layout(*images[i], i, animated);
+    }
+  }
+}
+
+bool
+RegularLayouter::append(const ImageCollection& images, size_t first, bool animated)
+{
+  // keep the column count until the grid has grown too far beyond
+  // the requested aspect, which keeps the number of full relayouts
+  // logarithmic in the number of appended images
+  const int w = calc_width(images.size());
+  if (m_width == 0 || static_cast<float>(w) > static_cast<float>(m_width) * 1.5f)
+  {
+    layout(images, animated);
+    return false;
+  }
+  else
+  {
+    for(size_t i = first; i < images.size(); ++i)
+    {
+      layout(*images[i], static_cast<int>(i), animated);
     }
+    return true;
   }
 }
 
@@ -21,16 +21,26 @@
 
 #include "galapix/layouter.hpp"
 
+class Image;
+
 class RegularLayouter : public Layouter
 {
 private:
   float m_aspect_w;
   float m_aspect_h;
 
+  /** Number of columns of the current layout */
+  int m_width;
+
 public:
   RegularLayouter(float aspect_w, float aspect_h);
 
   void layout(const ImageCollection& images, bool animated);
+  bool append(const ImageCollection& images, size_t first, bool animated);
+
+private:
+  int calc_width(size_t num_images) const;
+  void layout(Image& image, int i, bool animated);
 
 private:
   RegularLayouter(const RegularLayouter&);
@@ -129,4 +129,15 @@ SpiralLayouter::layout(const ImageCollection& images, bool animated)
   }
 }
 
+bool
+SpiralLayouter::append(const ImageCollection& images, size_t first, bool animated)
+{
+  // the spiral just continues where the last image was placed
+  for(size_t i = first; i < images.size(); ++i)
+  {
+    layout(*images[i], animated);
+  }
+  return true;
+}
+
 /* EOF */
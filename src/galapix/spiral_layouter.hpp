@@ -44,6 +44,7 @@ public:
   SpiralLayouter();
 
   void layout(const ImageCollection& images, bool animated);
+  bool append(const ImageCollection& images, size_t first, bool animated);
   void reset();
   void layout(Image& image, bool animated);
 
@@ -0,0 +1,170 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "galapix/stats_overlay.hpp"
+
+#include <algorithm>
+#include <boost/format.hpp>
+#include <sstream>
+
+#include "display/framebuffer.hpp"
+#include "display/texture.hpp"
+#include "galapix/database_thread.hpp"
+#include "job/job_worker_thread.hpp"
+#include "math/rect.hpp"
+#include "math/rgba.hpp"
+#include "math/vector2f.hpp"
+
+namespace {
+
+/** Seconds between updates of the text, shorter intervals make the
+    rates too jumpy to read */
+const float kSampleInterval = 0.5f;
+
+const float kPixelSize = 2.0f;
+const float kMargin    = 8.0f;
+
+} // namespace
+
+StatsOverlay::StatsOverlay() :
+  m_last_frame(Clock::now()),
+  m_last_sample(m_last_frame),
+  m_frames(0),
+  m_frame_time_sum(0.0f),
+  m_frame_time_max(0.0f),
+  m_upload_bytes_max(0),
+  m_last_upload_bytes(Texture::get_upload_bytes()),
+  m_sample_upload_bytes(m_last_upload_bytes),
+  m_sample_busy_usec(JobWorkerThread::get_busy_usec()),
+  m_sample_cache_stats(ImageTileCache::get_stats()),
+  m_text("collecting statistics...")
+{
+}
+
+void
+StatsOverlay::count_frame()
+{
+  Clock::time_point now = Clock::now();
+
+  float frame_time = std::chrono::duration<float>(now - m_last_frame).count();
+  m_last_frame = now;
+
+  m_frames += 1;
+  m_frame_time_sum += frame_time;
+  m_frame_time_max  = std::max(m_frame_time_max, frame_time);
+
+  int64_t upload_bytes = Texture::get_upload_bytes();
+  m_upload_bytes_max  = std::max(m_upload_bytes_max, upload_bytes - m_last_upload_bytes);
+  m_last_upload_bytes = upload_bytes;
+}
+
+bool
+StatsOverlay::update()
+{
+  Clock::time_point now = Clock::now();
+
+  float interval = std::chrono::duration<float>(now - m_last_sample).count();
+  if (interval < kSampleInterval)
+  {
+    return false;
+  }
+  else
+  {
+    std::string old_text = m_text;
+
+    sample(interval);
+
+    m_last_sample      = now;
+    m_frames           = 0;
+    m_frame_time_sum   = 0.0f;
+    m_frame_time_max   = 0.0f;
+    m_upload_bytes_max = 0;
+
+    return m_text != old_text;
+  }
+}
+
+void
+StatsOverlay::sample(float interval)
+{
+  ImageTileCache::Stats cache_stats = ImageTileCache::get_stats();
+  int64_t upload_bytes = Texture::get_upload_bytes();
+  int64_t busy_usec    = JobWorkerThread::get_busy_usec();
+  int     num_workers  = JobWorkerThread::get_num_workers();
+
+  // busy time is only counted once a job has finished, so a burst of
+  // finishing jobs can briefly push this over 100%
+  float utilization = 0.0f;
+  if (num_workers > 0)
+  {
+    utilization = std::min(100.0f, 100.0f * static_cast<float>(busy_usec - m_sample_busy_usec)
+                           / (interval * 1000000.0f * static_cast<float>(num_workers)));
+  }
+
+  // no frame might have been drawn since the last sample when
+  // nothing on screen changed
+  float frames = static_cast<float>(std::max(1, m_frames));
+
+  std::ostringstream out;
+  out << boost::format("frame  %5.1fms avg %5.1fms max %4.0ffps\n")
+    % (1000.0f * m_frame_time_sum / frames)
+    % (1000.0f * m_frame_time_max)
+    % (static_cast<float>(m_frames) / interval);
+  out << boost::format("tiles  %5.0f/s req %5.0f/s recv %4d wait\n")
+    % (static_cast<float>(cache_stats.tiles_requested - m_sample_cache_stats.tiles_requested) / interval)
+    % (static_cast<float>(cache_stats.tiles_arrived   - m_sample_cache_stats.tiles_arrived)   / interval)
+    % cache_stats.tiles_in_flight;
+  out << boost::format("upload %5.0fKB/frame avg %5.0fKB max\n")
+    % (static_cast<float>(upload_bytes - m_sample_upload_bytes) / 1024.0f / frames)
+    % (static_cast<float>(m_upload_bytes_max) / 1024.0f);
+  out << boost::format("cache  %5d tiles %7.1f MPixel\n")
+    % cache_stats.tiles_resident
+    % (static_cast<float>(cache_stats.texels_resident) / 1000000.0f);
+
+  if (DatabaseThread* database_thread = DatabaseThread::current())
+  {
+    out << boost::format("dbase  %4d write %4d store %4d read\n")
+      % database_thread->get_request_queue_size()
+      % database_thread->get_receive_queue_size()
+      % database_thread->get_read_queue_size();
+  }
+
+  out << boost::format("jobs   %2d/%-2d busy %3.0f%% utilization")
+    % JobWorkerThread::get_num_busy()
+    % num_workers
+    % utilization;
+
+  m_text = out.str();
+
+  m_sample_cache_stats  = cache_stats;
+  m_sample_upload_bytes = upload_bytes;
+  m_sample_busy_usec    = busy_usec;
+}
+
+void
+StatsOverlay::draw()
+{
+  Sizef text_size = Framebuffer::get_text_size(m_text, kPixelSize);
+
+  Framebuffer::fill_rect(Rectf(Vector2f(kMargin, kMargin),
+                               Sizef(text_size.width + 2.0f * kMargin, text_size.height + 2.0f * kMargin)),
+                         RGBA(0, 0, 0, 160));
+  Framebuffer::draw_text(Vector2f(2.0f * kMargin, 2.0f * kMargin), m_text, RGBA(255, 255, 255), kPixelSize);
+}
+
+/* EOF */
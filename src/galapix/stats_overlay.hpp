@@ -0,0 +1,76 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_GALAPIX_STATS_OVERLAY_HPP
+#define HEADER_GALAPIX_GALAPIX_STATS_OVERLAY_HPP
+
+#include <chrono>
+#include <stdint.h>
+#include <string>
+
+#include "galapix/image_tile_cache.hpp"
+
+/** On-screen statistics for diagnosing stutter: frame time, tile
+    throughput, texture uploads, tile cache residency, DatabaseThread
+    queue depths and JobManager utilization. All counters are read
+    lock-free, the text is rebuilt twice a second. */
+class StatsOverlay
+{
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  Clock::time_point m_last_frame;
+  Clock::time_point m_last_sample;
+
+  /** Accumulated over the frames since the last sample */
+  int     m_frames;
+  float   m_frame_time_sum;
+  float   m_frame_time_max;
+  int64_t m_upload_bytes_max;
+
+  int64_t m_last_upload_bytes;
+  int64_t m_sample_upload_bytes;
+  int64_t m_sample_busy_usec;
+  ImageTileCache::Stats m_sample_cache_stats;
+
+  std::string m_text;
+
+public:
+  StatsOverlay();
+
+  /** Call once per drawn frame, measures the frame time */
+  void count_frame();
+
+  /** Call regularly, updates the text when a new sample is due and
+      returns true if it changed and the overlay needs a redraw */
+  bool update();
+
+  /** Draws the overlay in screen coordinates */
+  void draw();
+
+private:
+  void sample(float interval);
+
+private:
+  StatsOverlay(const StatsOverlay&);
+  StatsOverlay& operator=(const StatsOverlay&);
+};
+
+#endif
+
+/* EOF */
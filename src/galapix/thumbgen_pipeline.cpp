@@ -0,0 +1,415 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "galapix/thumbgen_pipeline.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+#include "database/database.hpp"
+#include "database/tile_owner_lookup.hpp"
+#include "jobs/tile_generator.hpp"
+#include "math/math.hpp"
+#include "plugins/jpeg.hpp"
+#include "util/log.hpp"
+#include "util/software_surface_factory.hpp"
+#include "util/trace.hpp"
+#include "util/xxhash64.hpp"
+
+struct ThumbgenPipeline::Item
+{
+  URL url;
+
+  /** Empty for files that aren't in the Database yet */
+  FileEntry file_entry;
+
+  /** FileId of an outdated entry that has to be replaced */
+  FileId stale_fileid;
+
+  /** Range of scales to generate, -1 if not yet known */
+  int min_scale;
+  int max_scale;
+
+  BlobPtr blob;
+  /** xxHash64 of the file content, 0 if it couldn't be read ahead */
+  uint64_t hash;
+  /** surface is kept unoriented, the orientation is applied per tile */
+  SoftwareSurfacePtr surface;
+  SoftwareSurface::Modifier modifier;
+  Size original_size;
+  std::vector<TileEntry> tiles;
+
+  Item(const URL& url_) :
+    url(url_),
+    file_entry(),
+    stale_fileid(),
+    min_scale(-1),
+    max_scale(-1),
+    blob(),
+    hash(0),
+    surface(),
+    modifier(SoftwareSurface::kRot0),
+    original_size(),
+    tiles()
+  {}
+};
+
+namespace {
+
+void set_scale_range(const FileEntry& file_entry, bool generate_all_tiles,
+                     int& min_scale_out, int& max_scale_out)
+{
+  max_scale_out = file_entry.get_thumbnail_scale();
+  min_scale_out = generate_all_tiles ? 0 : std::max(0, max_scale_out - 3);
+}
+
+} // namespace
+
+ThumbgenPipeline::ThumbgenPipeline(Database& database, int io_threads, int cpu_threads, bool generate_all_tiles) :
+  m_database(database),
+  m_generate_all_tiles(generate_all_tiles),
+  m_tile_owner_lookup(new TileOwnerLookup(database)),
+  m_stages(),
+  m_done(0),
+  m_failed(0)
+{
+  using namespace std::placeholders;
+
+  io_threads  = std::max(1, io_threads);
+  cpu_threads = std::max(1, cpu_threads);
+
+  m_stages.push_back(std::unique_ptr<Stage>(new Stage("read",    std::bind(&ThumbgenPipeline::read,    this, _1),
+                                                      io_threads,  2 * io_threads)));
+  m_stages.push_back(std::unique_ptr<Stage>(new Stage("decode",  std::bind(&ThumbgenPipeline::decode,  this, _1),
+                                                      cpu_threads, 2 * cpu_threads)));
+  m_stages.push_back(std::unique_ptr<Stage>(new Stage("pyramid", std::bind(&ThumbgenPipeline::pyramid, this, _1),
+                                                      cpu_threads, 2 * cpu_threads)));
+  m_stages.push_back(std::unique_ptr<Stage>(new Stage("encode",  std::bind(&ThumbgenPipeline::encode,  this, _1),
+                                                      cpu_threads, 2 * cpu_threads)));
+  // SQLite isn't shared between threads, so there is only one committer
+  m_stages.push_back(std::unique_ptr<Stage>(new Stage("commit",  std::bind(&ThumbgenPipeline::commit,  this, _1),
+                                                      1, 16)));
+}
+
+ThumbgenPipeline::~ThumbgenPipeline()
+{
+}
+
+void
+ThumbgenPipeline::process(const std::vector<URL>& urls)
+{
+  std::vector<ItemPtr> items;
+  plan(urls, items);
+  const int total = static_cast<int>(items.size());
+
+  m_done   = 0;
+  m_failed = 0;
+
+  for(size_t i = 0; i < m_stages.size(); ++i)
+  {
+    Stage& stage = *m_stages[i];
+    stage.running = stage.num_threads;
+    for(int j = 0; j < stage.num_threads; ++j)
+    {
+      stage.threads.push_back(std::thread(&ThumbgenPipeline::run_stage, this, i));
+    }
+  }
+
+  std::thread feeder([this, &items]{
+      for(std::vector<ItemPtr>::iterator i = items.begin(); i != items.end(); ++i)
+      {
+        m_stages.front()->queue.wait_and_push(*i);
+        i->reset();
+      }
+      m_stages.front()->queue.close();
+    });
+
+  std::vector<int> last_processed(m_stages.size(), 0);
+  std::chrono::steady_clock::time_point last_time = std::chrono::steady_clock::now();
+  while(m_done < total)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    float seconds = std::chrono::duration<float>(now - last_time).count();
+    if (seconds >= 1.0f)
+    {
+      print_progress(total, last_processed, seconds);
+      last_time = now;
+    }
+  }
+
+  feeder.join();
+  for(size_t i = 0; i < m_stages.size(); ++i)
+  {
+    for(std::vector<std::thread>::iterator j = m_stages[i]->threads.begin(); j != m_stages[i]->threads.end(); ++j)
+    {
+      j->join();
+    }
+    m_stages[i]->threads.clear();
+  }
+
+  std::cout << std::endl;
+  std::cout << urls.size() << " files, " << m_stages.back()->processed << " stored, "
+            << m_failed << " failed" << std::endl;
+}
+
+void
+ThumbgenPipeline::plan(const std::vector<URL>& urls, std::vector<ItemPtr>& items_out)
+{
+  std::vector<FileEntry> entries;
+  m_database.get_files().get_file_entries(urls, entries);
+
+  std::unordered_map<URL, FileEntry> entry_map;
+  for(std::vector<FileEntry>::const_iterator i = entries.begin(); i != entries.end(); ++i)
+  {
+    entry_map[i->get_url()] = *i;
+  }
+
+  items_out.reserve(urls.size());
+  for(std::vector<URL>::const_iterator i = urls.begin(); i != urls.end(); ++i)
+  {
+    ItemPtr item(new Item(*i));
+
+    std::unordered_map<URL, FileEntry>::const_iterator it = entry_map.find(*i);
+    if (it != entry_map.end())
+    {
+      item->file_entry = it->second;
+      set_scale_range(item->file_entry, m_generate_all_tiles, item->min_scale, item->max_scale);
+
+      // skip the tiles that are already in the database, same as MultipleTileGenerationJob
+      int min_scale_in_db = -1;
+      int max_scale_in_db = -1;
+      if (m_database.get_tiles().get_min_max_scale(item->file_entry, min_scale_in_db, max_scale_in_db))
+      {
+        item->min_scale = std::min(item->min_scale, min_scale_in_db);
+        item->max_scale = std::min(item->max_scale, min_scale_in_db - 1);
+      }
+    }
+
+    items_out.push_back(item);
+  }
+}
+
+void
+ThumbgenPipeline::run_stage(size_t stage_idx)
+{
+  Stage& stage = *m_stages[stage_idx];
+  Stage* next_stage = (stage_idx + 1 < m_stages.size()) ? m_stages[stage_idx + 1].get() : 0;
+
+  TRACE_THREAD_NAME(stage.name);
+
+  ItemPtr item;
+  while(stage.queue.wait_and_pop_until_closed(item))
+  {
+    bool pass_on = false;
+    try
+    {
+      TRACE_SPAN_DYNAMIC("thumbgen", stage.name);
+      pass_on = stage.func(*item);
+    }
+    catch(const std::exception& err)
+    {
+      log_error << "Error while processing " << item->url << std::endl;
+      log_error << "  Exception: " << err.what() << std::endl;
+      m_failed += 1;
+    }
+
+    stage.processed += 1;
+
+    if (pass_on && next_stage)
+    {
+      next_stage->queue.wait_and_push(item);
+    }
+    else
+    {
+      m_done += 1;
+    }
+
+    item.reset();
+  }
+
+  if (--stage.running == 0 && next_stage)
+  {
+    next_stage->queue.close();
+  }
+}
+
+void
+ThumbgenPipeline::print_progress(int total, std::vector<int>& last_processed, float seconds)
+{
+  std::ostringstream out;
+  out << "\r[" << std::setw(6) << m_done << "/" << total << "]";
+  for(size_t i = 0; i < m_stages.size(); ++i)
+  {
+    const Stage& stage = *m_stages[i];
+    int processed = stage.processed;
+    out << "  " << stage.name << ": "
+        << std::fixed << std::setprecision(1) << (processed - last_processed[i]) / seconds << "/s "
+        << stage.queue.size() << "/" << stage.queue_size;
+    last_processed[i] = processed;
+  }
+  std::cout << out.str() << std::flush;
+}
+
+bool
+ThumbgenPipeline::read(Item& item)
+{
+  if (item.file_entry)
+  {
+    if (item.file_entry.get_size()  != item.url.get_size() ||
+        item.file_entry.get_mtime() != item.url.get_mtime())
+    {
+      log_info << item.url << ": file has changed, regenerating" << std::endl;
+      item.stale_fileid = item.file_entry.get_fileid();
+      item.file_entry = FileEntry();
+    }
+    else if (item.max_scale < item.min_scale)
+    {
+      // all tiles are already in the database
+      return false;
+    }
+  }
+
+  // Only JPEGs are read ahead, the other loaders do their own I/O
+  if (JPEG::filename_is_jpeg(item.url.str()))
+  {
+    if (item.url.has_stdio_name())
+    {
+      item.blob = Blob::from_file(item.url.get_stdio_name());
+    }
+    else
+    {
+      item.blob = item.url.get_blob();
+    }
+    item.hash = XXHash64::from_data(item.blob->get_data(), item.blob->size());
+  }
+
+  return true;
+}
+
+bool
+ThumbgenPipeline::decode(Item& item)
+{
+  if (item.blob)
+  {
+    // the header is parsed once, the file entry gets created from it
+    // before the image is decoded at the scale it asks for
+    JPEGInfo info;
+    item.surface = JPEG::load_from_mem(item.blob->get_data(), item.blob->size(),
+                                       [&](const JPEGInfo& header) -> int {
+                                         if (!item.file_entry)
+                                         {
+                                           item.file_entry = FileEntry::create_without_fileid(item.url, item.url.get_size(), item.url.get_mtime(),
+                                                                                              header.size.width, header.size.height,
+                                                                                              FileEntry::JPEG_FORMAT);
+                                           set_scale_range(item.file_entry, m_generate_all_tiles, item.min_scale, item.max_scale);
+                                         }
+
+                                         // JPEG can only scale down by 2, 4 and 8 while loading, the rest is done by cut_into_tiles()
+                                         return Math::min(Math::pow2(item.min_scale), 8);
+                                       },
+                                       &info, false);
+    item.original_size = info.size;
+    item.modifier = info.orientation;
+    item.blob.reset();
+  }
+  else
+  {
+    item.surface = SoftwareSurfaceFactory::current().from_url(item.url);
+    item.original_size = item.surface->get_size();
+
+    if (!item.file_entry)
+    {
+      int format = FileEntry::UNKNOWN_FORMAT;
+      switch(item.surface->get_format())
+      {
+        case SoftwareSurface::RGB_FORMAT:
+          format = FileEntry::JPEG_FORMAT;
+          break;
+
+        case SoftwareSurface::RGBA_FORMAT:
+          format = FileEntry::PNG_FORMAT;
+          break;
+      }
+      item.file_entry = FileEntry::create_without_fileid(item.url, item.url.get_size(), item.url.get_mtime(),
+                                                         item.original_size.width, item.original_size.height,
+                                                         format);
+      set_scale_range(item.file_entry, m_generate_all_tiles, item.min_scale, item.max_scale);
+    }
+  }
+
+  if (!item.file_entry.get_fileid() && item.hash)
+  {
+    // the files are compared here, so that the commit stage doesn't
+    // wait for the disk, identical files still in flight don't see
+    // each other and get their own tiles
+    item.file_entry.set_hash(item.hash);
+    item.file_entry.set_tile_fileid(m_tile_owner_lookup->find(item.file_entry));
+  }
+
+  return true;
+}
+
+bool
+ThumbgenPipeline::pyramid(Item& item)
+{
+  TileGenerator::cut_into_tiles(item.surface, item.modifier, item.original_size, item.min_scale, item.max_scale,
+                                [&item](Tile tile) {
+                                  item.tiles.push_back(TileEntry(item.file_entry, tile.get_scale(),
+                                                                 tile.get_pos(), tile.get_surface()));
+                                });
+  item.surface.reset();
+  return true;
+}
+
+bool
+ThumbgenPipeline::encode(Item& item)
+{
+  const TileCodec& codec = m_database.get_tile_codec();
+  for(std::vector<TileEntry>::iterator i = item.tiles.begin(); i != item.tiles.end(); ++i)
+  {
+    codec.encode(*i);
+    i->set_surface(SoftwareSurfacePtr());
+  }
+  return true;
+}
+
+bool
+ThumbgenPipeline::commit(Item& item)
+{
+  if (item.stale_fileid)
+  {
+    m_database.delete_file_entry(item.stale_fileid);
+  }
+
+  if (!item.file_entry.get_fileid())
+  {
+    // assigns the FileId, which the TileEntrys share
+    m_database.get_files().store_file_entry_without_cache(item.file_entry);
+  }
+
+  m_database.get_tiles().store_tiles(item.tiles);
+  item.tiles.clear();
+  return true;
+}
+
+/* EOF */
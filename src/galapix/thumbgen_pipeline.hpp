@@ -0,0 +1,111 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_GALAPIX_THUMBGEN_PIPELINE_HPP
+#define HEADER_GALAPIX_GALAPIX_THUMBGEN_PIPELINE_HPP
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "job/thread_message_queue2.hpp"
+#include "util/url.hpp"
+
+class Database;
+class TileOwnerLookup;
+
+/** Generates the tiles for a list of URLs in a chain of stages (read
+    -> decode -> pyramid -> encode -> commit), each with its own pool
+    of threads and a bounded queue in front of it. A full queue blocks
+    the stage before it, so the number of images in flight, and thus
+    memory use, stays bounded no matter how many files are processed.
+    The commit stage is a single thread and the only one writing to
+    the Database once processing has started. */
+class ThumbgenPipeline
+{
+private:
+  struct Item;
+  typedef std::shared_ptr<Item> ItemPtr;
+
+  struct Stage
+  {
+    const char* name;
+    std::function<bool (Item&)> func;
+    int num_threads;
+    int queue_size;
+    ThreadMessageQueue2<ItemPtr> queue;
+    std::vector<std::thread> threads;
+    std::atomic<int> running;
+    std::atomic<int> processed;
+
+    Stage(const char* name_, const std::function<bool (Item&)>& func_,
+          int num_threads_, int queue_size_) :
+      name(name_),
+      func(func_),
+      num_threads(num_threads_),
+      queue_size(queue_size_),
+      queue(queue_size_),
+      threads(),
+      running(0),
+      processed(0)
+    {}
+  };
+
+private:
+  Database& m_database;
+  bool m_generate_all_tiles;
+  std::unique_ptr<TileOwnerLookup> m_tile_owner_lookup;
+
+  std::vector<std::unique_ptr<Stage> > m_stages;
+  std::atomic<int> m_done;
+  std::atomic<int> m_failed;
+
+public:
+  /** @param io_threads     threads reading the files
+      @param cpu_threads    threads for each of decode, pyramid and encode
+      @param generate_all_tiles generate all scales, not just the ones close to the thumbnail */
+  ThumbgenPipeline(Database& database, int io_threads, int cpu_threads, bool generate_all_tiles);
+  ~ThumbgenPipeline();
+
+  /** Process all \a urls, returns when all tiles are stored in the
+      Database, prints a progress line to stdout while running */
+  void process(const std::vector<URL>& urls);
+
+private:
+  void plan(const std::vector<URL>& urls, std::vector<ItemPtr>& items_out);
+  void run_stage(size_t stage_idx);
+  void print_progress(int total, std::vector<int>& last_processed, float seconds);
+
+  /** The stages, each returns false if the Item is finished and
+      shouldn't be passed on to the next stage */
+  bool read(Item& item);
+  bool decode(Item& item);
+  bool pyramid(Item& item);
+  bool encode(Item& item);
+  bool commit(Item& item);
+
+private:
+  ThumbgenPipeline(const ThumbgenPipeline&);
+  ThumbgenPipeline& operator=(const ThumbgenPipeline&);
+};
+
+#endif
+
+/* EOF */
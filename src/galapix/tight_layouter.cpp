@@ -25,100 +25,140 @@
 
 TightLayouter::TightLayouter(float w, float h) :
   m_aspect_w(w),
-  m_aspect_h(h)
+  m_aspect_h(h),
+  m_spacing(24.0f),
+  m_total_width(0.0f),
+  m_width(0.0f),
+  m_pos(0.0f, 0.0f),
+  m_last_pos(0.0f, 0.0f),
+  m_go_right(true)
 {
 }
 
-void
-TightLayouter::layout(const ImageCollection& images, bool animated)
+float
+TightLayouter::get_row_width(const Image& image) const
 {
-  float spacing = 24.0f;
+  const float scale = (1000.0f + m_spacing) / static_cast<float>(image.get_original_height());
+  return static_cast<float>(image.get_original_width()) * scale;
+}
 
-  float width = 0;  
-  // calculate the total width 
-  for(const auto& image: images)
+float
+TightLayouter::calc_width() const
+{
+  if (m_total_width == 0.0f)
   {
-    const float scale = (1000.0f + spacing) / static_cast<float>(image->get_original_height());
-    width += static_cast<float>(image->get_original_width()) * scale;
+    return 0.0f;
   }
+  return m_total_width / Math::sqrt(m_total_width / ((m_aspect_w / m_aspect_h) * (1000.0f + m_spacing)));
+}
 
-  width /= Math::sqrt(width / ((m_aspect_w / m_aspect_h) * (1000.0f + spacing)));
+void
+TightLayouter::layout(Image& image, bool animated)
+{
+  const float scale = 1000.0f / static_cast<float>(image.get_original_height());
+  const float image_width = static_cast<float>(image.get_original_width()) * scale;
 
-  Vector2f pos(0.0f, 0.0f);
-  Vector2f last_pos(0.0f, 0.0f);
-  bool go_right = true;
-  
-  auto relayout_row = [width, spacing](std::vector<ImagePtr>& row) {
-    float row_width = spacing * static_cast<float>(row.size()-1);
-    for(auto& image: row) { row_width += image->get_scaled_width(); }
+  Vector2f pos;
+  if (m_go_right)
+  {
+    // going right
+    if (m_pos.x + image_width > m_width)
+    {
+      m_pos.x = m_last_pos.x;
+      m_pos.y += 1000.0f + m_spacing;   
+              
+      m_go_right = false;
 
+      pos = m_pos;
+    }
+    else
+    {
+      pos = m_pos;
+      m_pos.x += image_width + m_spacing;
+    }
+  }
+  else
+  { 
+    // going left
+    if (m_pos.x - image_width < 0)
+    {
+      m_pos.y += 1000.0f + m_spacing;   
+      m_go_right = true;
 
-    //std::cout << width << " " << row_width << std::endl;
-    Vector2f offset((width - row_width)/2.0f, 0.0f);
+      pos = m_pos;
+      m_pos.x += image_width + m_spacing;
+    }
+    else
+    {
+      m_pos.x -= image_width + m_spacing;
+      pos = m_pos;
+    }
+  }
 
-    // FIXME: doesn't work because of target pos
-    // center the row
-    //for(auto& image: row) {
-    //image->set_target_pos(image->get_target_pos() - offset);
-    //}
+  m_last_pos = pos;
 
-    row.clear();
-  };
+  const Vector2f target_pos = pos + Vector2f(static_cast<float>(image.get_original_width()),
+                                             static_cast<float>(image.get_original_height())) * scale / 2.0f;
 
-  std::vector<ImagePtr> row;
-  for(const auto& image: images)
+  // FIXME: rows aren't centered
+  if (animated)
+  {
+    image.set_target_scale(scale);
+    image.set_target_pos(target_pos);
+  }
+  else
   {
-    row.push_back(image);
+    image.set_scale(scale);
+    image.set_pos(target_pos);
+  }
+}
 
-    const float scale = 1000.0f / static_cast<float>(image->get_original_height());
-    image->set_target_scale(scale);
+void
+TightLayouter::layout(const ImageCollection& images, bool animated)
+{
+  // calculate the total width 
+  m_total_width = 0.0f;
+  for(const auto& image: images)
+  {
+    m_total_width += get_row_width(*image);
+  }
 
-    auto set_target_pos = [&](const Vector2f& p){
-      last_pos = p;
-      image->set_target_pos(p + Vector2f(static_cast<float>(image->get_original_width()),
-                                         static_cast<float>(image->get_original_height())) * scale / 2.0f);
-    };
+  m_width = calc_width();
 
-    if (go_right)
-    {
-      // going right
-      if (pos.x + (static_cast<float>(image->get_original_width())*scale) > width)
-      {
-        pos.x = last_pos.x;
-        pos.y += 1000.0f + spacing;   
-              
-        go_right = false;
+  m_pos = Vector2f(0.0f, 0.0f);
+  m_last_pos = Vector2f(0.0f, 0.0f);
+  m_go_right = true;
 
-        set_target_pos(pos);
-        relayout_row(row);
-      }
-      else
-      {
-        set_target_pos(pos);
-        pos.x += static_cast<float>(image->get_original_width()) * scale + spacing;
-      }
-    }
-    else
-    { 
-      // going left
-      if (pos.x - (static_cast<float>(image->get_original_width()) * scale) < 0)
-      {
-        pos.y += 1000.0f + spacing;   
-        go_right = true;
+  for(const auto& image: images)
+  {
+    layout(*image, animated);
+  }
+}
 
-        set_target_pos(pos);
-        pos.x += static_cast<float>(image->get_original_width()) * scale + spacing;
+bool
+TightLayouter::append(const ImageCollection& images, size_t first, bool animated)
+{
+  for(size_t i = first; i < images.size(); ++i)
+  {
+    m_total_width += get_row_width(*images[i]);
+  }
 
-        relayout_row(row);
-      }
-      else
-      {
-        pos.x -= static_cast<float>(image->get_original_width()) * scale + spacing;
-        set_target_pos(pos);
-      }
+  // keep the row width until the layout has grown too far beyond the
+  // requested aspect, so that full relayouts only happen a
+  // logarithmic number of times while images stream in
+  if (m_width == 0.0f || calc_width() > m_width * 1.5f)
+  {
+    layout(images, animated);
+    return false;
+  }
+  else
+  {
+    for(size_t i = first; i < images.size(); ++i)
+    {
+      layout(*images[i], animated);
     }
+    return true;
   }
-  relayout_row(row);
 }
 
 void
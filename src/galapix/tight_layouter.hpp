@@ -29,12 +29,29 @@ class TightLayouter : public Layouter
 private:
   float m_aspect_w;
   float m_aspect_h;
+  float m_spacing;
+
+  /** Sum of the widths of all images scaled to the row height */
+  float m_total_width;
+
+  /** Row width of the current layout */
+  float m_width;
+
+  Vector2f m_pos;
+  Vector2f m_last_pos;
+  bool m_go_right;
   
 public:
   TightLayouter(float w, float h);
 
   void layout_zigzag(const ImageCollection& images, bool animated);
   void layout(const ImageCollection& images, bool animated);
+  bool append(const ImageCollection& images, size_t first, bool animated);
+
+private:
+  float calc_width() const;
+  float get_row_width(const Image& image) const;
+  void layout(Image& image, bool animated);
 
 private:
   TightLayouter(const TightLayouter&);
@@ -0,0 +1,73 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "galapix/vertical_layouter.hpp"
+
+#include "galapix/image.hpp"
+#include "galapix/image_collection.hpp"
+
+VerticalLayouter::VerticalLayouter() :
+  m_spacing(10.0f),
+  m_next_pos(0.0f, 0.0f)
+{
+}
+
+void
+VerticalLayouter::layout(Image& image, bool animated)
+{
+  // the position is the center of the image
+  const float height = static_cast<float>(image.get_original_height());
+  const Vector2f pos(m_next_pos.x, m_next_pos.y + height / 2.0f);
+
+  if (animated)
+  {
+    image.set_target_scale(1.0f);
+    image.set_target_pos(pos);
+  }
+  else
+  {
+    image.set_scale(1.0f);
+    image.set_pos(pos);
+  }
+
+  m_next_pos.y += height + m_spacing;
+}
+
+void
+VerticalLayouter::layout(const ImageCollection& images, bool animated)
+{
+  m_next_pos = Vector2f(0.0f, 0.0f);
+
+  for(ImageCollection::const_iterator i = images.begin(); i != images.end(); ++i)
+  {
+    layout(**i, animated);
+  }
+}
+
+bool
+VerticalLayouter::append(const ImageCollection& images, size_t first, bool animated)
+{
+  // the column just continues below the last image
+  for(size_t i = first; i < images.size(); ++i)
+  {
+    layout(*images[i], animated);
+  }
+  return true;
+}
+
+/* EOF */
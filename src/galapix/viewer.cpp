@@ -21,6 +21,8 @@
 #include <boost/format.hpp>
 
 #include "display/framebuffer.hpp"
+#include "galapix/image_tile_cache.hpp"
+#include "galapix/stats_overlay.hpp"
 #include "galapix/viewer.hpp"
 #include "galapix/workspace.hpp"
 #include "math/rect.hpp"
@@ -69,9 +71,11 @@ Viewer::Viewer(Workspace* workspace_) :
   m_background_colors(),
   m_grid_offset(0.0f, 0.0f),
   m_grid_size(400.0f, 300.0f),
-  m_grid_color(255, 0, 0, 255)
+  m_grid_color(255, 0, 0, 255),
+  m_stats_overlay()
 {
   current_ = this;
+  ImageTileCache::set_redraw_callback(std::bind(&Viewer::redraw, this));
 
   pan_tool       = std::shared_ptr<PanTool>(new PanTool(this));
   move_tool      = std::shared_ptr<MoveTool>(new MoveTool(this));
@@ -197,6 +201,12 @@ Viewer::draw()
       Framebuffer::draw_grid(m_grid_offset, m_grid_size, m_grid_color);
     }
   }
+
+  if (m_stats_overlay)
+  {
+    m_stats_overlay->count_frame();
+    m_stats_overlay->draw();
+  }
 }
 
 void
@@ -209,6 +219,11 @@ Viewer::update(float delta)
 
   keyboard_zoom_in_tool ->update(m_mouse_pos, delta);
   keyboard_zoom_out_tool->update(m_mouse_pos, delta);
+
+  if (m_stats_overlay && m_stats_overlay->update())
+  {
+    redraw();
+  }
 }
 
 void
@@ -503,6 +518,21 @@ Viewer::toggle_pinned_grid()
   }
 }
 
+void
+Viewer::toggle_stats_overlay()
+{
+  if (m_stats_overlay)
+  {
+    m_stats_overlay.reset();
+  }
+  else
+  {
+    m_stats_overlay = std::shared_ptr<StatsOverlay>(new StatsOverlay());
+  }
+  log_info << "Stats Overlay: " << static_cast<bool>(m_stats_overlay) << std::endl;
+  redraw();
+}
+
 void
 Viewer::toggle_background_color(bool backwards)
 {
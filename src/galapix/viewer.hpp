@@ -39,6 +39,7 @@ class ViewRotateTool;
 class ZoomRectTool;
 class Workspace;
 class GridTool;
+class StatsOverlay;
 
 class Viewer
 {
@@ -85,6 +86,9 @@ private:
   Sizef    m_grid_size;
   RGBA     m_grid_color;
 
+  /** Only exists while the overlay is shown */
+  std::shared_ptr<StatsOverlay> m_stats_overlay;
+
 public:
   Viewer(Workspace* workspace);
 
@@ -136,6 +140,7 @@ public:
   // Other stuff
   void toggle_grid();
   void toggle_pinned_grid();
+  void toggle_stats_overlay();
   
   void toggle_background_color(bool backwards = false);
 
@@ -23,21 +23,28 @@
 #include <iostream>
 
 #include "database/file_entry.hpp"
+#include "galapix/binary_workspace.hpp"
 #include "galapix/database_thread.hpp"
 #include "galapix/random_layouter.hpp"
 #include "galapix/regular_layouter.hpp"
 #include "galapix/spiral_layouter.hpp"
 #include "galapix/tight_layouter.hpp"
+#include "galapix/vertical_layouter.hpp"
 #include "util/file_reader.hpp"
+#include "util/sexpr_stream_file_reader.hpp"
 #include "util/log.hpp"
-#include "util/string_util.hpp"
 
 Workspace::Workspace() :
   m_images(),
   m_selection(Selection::create()),
-  m_progress(0.0f),
+  m_animator(),
   m_file_queue(),
-  m_layouter()
+  m_layouter(),
+  m_num_layouted(0),
+  m_layout_broken(false),
+  m_overlaps_solved(false),
+  m_time(0.0f),
+  m_hidden_images()
 {
 }
 
@@ -78,7 +85,43 @@ void
 Workspace::start_animation()
 {
   //log_info << "Start Animation" << std::endl;
-  m_progress = 0.0f;  
+  m_animator.start(m_images);
+}
+
+void
+Workspace::relayout()
+{
+  m_layouter->layout(m_images, true);
+  m_num_layouted = m_images.size();
+  m_layout_broken = false;
+  m_overlaps_solved = false;
+  start_animation();
+}
+
+void
+Workspace::layout_new_images()
+{
+  if (m_num_layouted == 0 || m_layout_broken)
+  {
+    relayout();
+  }
+  else if (m_layouter->append(m_images, m_num_layouted, true))
+  {
+    if (m_overlaps_solved)
+    {
+      solve_new_overlaps(m_num_layouted);
+    }
+
+    m_animator.add(m_images, m_num_layouted);
+    m_num_layouted = m_images.size();
+  }
+  else
+  {
+    // everything got placed anew, same as relayout()
+    m_num_layouted = m_images.size();
+    m_overlaps_solved = false;
+    start_animation();
+  }
 }
 
 void
@@ -91,16 +134,8 @@ void
 Workspace::layout_vertical()
 {
   log_info << std::endl;
-  float spacing = 10.0f;
-  Vector2f next_pos(0.0f, 0.0f);
-  for(ImageCollection::iterator i = m_images.begin(); i != m_images.end(); ++i)
-  {
-    (*i)->set_target_scale(1.0f);
-    (*i)->set_target_pos(next_pos);
-    next_pos.y += static_cast<float>((*i)->get_original_height()) + spacing;
-  }
-  
-  start_animation();
+  m_layouter.reset(new VerticalLayouter());
+  relayout();
 }
 
 void
@@ -108,8 +143,7 @@ Workspace::layout_aspect(float aspect_w, float aspect_h)
 {
   log_info << std::endl;
   m_layouter.reset(new RegularLayouter(aspect_w, aspect_h));
-  m_layouter->layout(m_images, true);
-  start_animation();
+  relayout();
 }
 
 void
@@ -117,8 +151,7 @@ Workspace::layout_spiral()
 {
   log_info << std::endl;
   m_layouter.reset(new SpiralLayouter());
-  m_layouter->layout(m_images, true);
-  start_animation();
+  relayout();
 }
 
 void
@@ -126,8 +159,7 @@ Workspace::layout_tight(float aspect_w, float aspect_h)
 {
   log_info << std::endl;
   m_layouter.reset(new TightLayouter(aspect_w, aspect_h));
-  m_layouter->layout(m_images, true);
-  start_animation();
+  relayout();
 }
 
 void
@@ -135,8 +167,7 @@ Workspace::layout_random()
 {
   log_info << std::endl;
   m_layouter.reset(new RandomLayouter());
-  m_layouter->layout(m_images, true);
-  start_animation();
+  relayout();
 }
 
 void
@@ -157,7 +188,8 @@ Workspace::draw(const Rectf& cliprect, float zoom)
     {
       if ((*i)->is_visible())
       {
-        (*i)->on_leave_screen();
+        (*i)->on_leave_screen(m_time);
+        m_hidden_images.push_back(std::make_pair(m_time, std::weak_ptr<Image>(*i)));
       }
     }
   }
@@ -171,24 +203,44 @@ Workspace::draw(const Rectf& cliprect, float zoom)
 void
 Workspace::update(float delta)
 {
-  if (m_progress != 1.0f)
+  m_time += delta;
+  release_hidden_images();
+
+  if (m_layouter && m_num_layouted != m_images.size())
+  {
+    layout_new_images();
+  }
+
+  if (m_animator.is_running())
   {
-    m_progress += delta * 2.0f;
+    m_animator.update(delta * 2.0f);
 
-    if (m_progress > 1.0f)
+    if (!m_animator.is_running())
     {
-      m_progress = 1.0f;
+      animation_finished();
     }
+  }
+}
 
-    for(ImageCollection::iterator i = m_images.begin(); i != m_images.end(); ++i)
-    {
-      (*i)->update_pos(m_progress);
-    }
+void
+Workspace::release_hidden_images()
+{
+  // keep the resources around for a bit, so that panning back and
+  // forth doesn't reload everything
+  const float release_delay = 10.0f;
 
-    if (m_progress == 1.0f)
+  while(!m_hidden_images.empty() &&
+        m_time - m_hidden_images.front().first > release_delay)
+  {
+    // an image that came back and left the screen again meanwhile
+    // has a newer entry further down the queue
+    ImagePtr image = m_hidden_images.front().second.lock();
+    if (image && !image->is_visible() &&
+        image->get_hidden_since() == m_hidden_images.front().first)
     {
-      animation_finished();
+      image->release_resources();
     }
+    m_hidden_images.pop_front();
   }
 }
 
@@ -197,12 +249,11 @@ Workspace::sort()
 {
   std::sort(m_images.begin(), m_images.end(), 
             [](const ImagePtr& lhs, const ImagePtr& rhs) {
-              return StringUtil::numeric_less(lhs->get_url().str(), rhs->get_url().str());
+              return lhs->get_url().get_sort_key() < rhs->get_url().get_sort_key();
             });
   if (m_layouter)
   {
-    m_layouter->layout(m_images, true);
-    start_animation();
+    relayout();
   }
 }
 
@@ -211,12 +262,11 @@ Workspace::sort_reverse()
 {
   std::sort(m_images.rbegin(), m_images.rend(), 
             [](const ImagePtr& lhs, const ImagePtr& rhs) {
-              return StringUtil::numeric_less(lhs->get_url().str(), rhs->get_url().str());
+              return lhs->get_url().get_sort_key() < rhs->get_url().get_sort_key();
             });
   if (m_layouter)
   {
-    m_layouter->layout(m_images, true);
-    start_animation();
+    relayout();
   } 
 }
 
@@ -226,8 +276,7 @@ Workspace::random_shuffle()
   std::random_shuffle(m_images.begin(), m_images.end());
   if (m_layouter)
   {
-    m_layouter->layout(m_images, true);
-    start_animation();
+    relayout();
   }
 }
 
@@ -310,6 +359,10 @@ Workspace::clear()
 {
   m_selection->clear();
   m_images.clear();
+  m_animator.finish();
+  m_num_layouted = 0;
+  m_layout_broken = false;
+  m_overlaps_solved = false;
 }
 
 void
@@ -326,6 +379,9 @@ Workspace::isolate_selection()
 {
   m_images = m_selection->get_images();
   m_selection->clear();
+  m_animator.finish();
+  m_num_layouted = m_images.size();
+  m_layout_broken = true;
 }
 
 void
@@ -342,25 +398,74 @@ Workspace::delete_selection()
                                 }),
                  m_images.end());
   m_selection->clear();
+  m_animator.finish();
+  m_num_layouted = m_images.size();
+  m_layout_broken = true;
 }
 
 void
 Workspace::solve_overlaps()
 {
-  // FIXME: This function is extremely slow and doesn't work
-  // dynamically (no animation on position setting)
-  int num_overlappings = 1;
+  // Works on the target positions, so that the result is animated
+  // like any other layout. Overlapping pairs are found with a sweep
+  // over the images sorted by their left edge, so each pass costs
+  // O(n log n + overlaps) instead of O(n^2).
+  const int max_iterations = 256;
+  const float spacing = 16.0f;
+
+  const size_t n = m_images.size();
 
-  while(num_overlappings)
+  std::vector<Vector2f> pos(n);
+  std::vector<Sizef>    half_size(n);
+  for(size_t i = 0; i < n; ++i)
+  {
+    const Image& image = *m_images[i];
+    pos[i] = image.get_target_pos();
+    half_size[i] = Sizef(static_cast<float>(image.get_original_width())  * image.get_target_scale() / 2.0f,
+                         static_cast<float>(image.get_original_height()) * image.get_target_scale() / 2.0f);
+  }
+
+  auto get_rect = [&](size_t i) -> Rectf {
+    return Rectf(pos[i].x - half_size[i].width,  pos[i].y - half_size[i].height,
+                 pos[i].x + half_size[i].width,  pos[i].y + half_size[i].height);
+  };
+
+  std::vector<size_t> order(n);
+  for(size_t i = 0; i < n; ++i)
+  {
+    order[i] = i;
+  }
+
+  int iteration = 0;
+  int num_overlappings = 1;
+  for(; num_overlappings && iteration < max_iterations; ++iteration)
   {
     num_overlappings = 0;
-    // Use QuadTree to make this fast
-    for(std::vector<ImagePtr>::iterator i = m_images.begin(); i != m_images.end(); ++i)
+
+    // the order only changes a little between passes, which keeps
+    // the sort cheap
+    std::sort(order.begin(), order.end(),
+              [&](size_t lhs, size_t rhs) {
+                return pos[lhs].x - half_size[lhs].width < pos[rhs].x - half_size[rhs].width;
+              });
+
+    for(size_t oi = 0; oi < n; ++oi)
     {
-      for(std::vector<ImagePtr>::iterator j = i+1; j != m_images.end(); ++j)
+      const size_t i = order[oi];
+
+      for(size_t oj = oi+1; oj < n; ++oj)
       {
-        Rectf irect = (*i)->get_image_rect();
-        Rectf jrect = (*j)->get_image_rect();
+        const size_t j = order[oj];
+
+        Rectf irect = get_rect(i);
+        Rectf jrect = get_rect(j);
+
+        // everything further right starts behind i, as far as the
+        // order from the start of this pass is concerned
+        if (jrect.left >= irect.right)
+        {
+          break;
+        }
 
         if (irect.is_overlapped(jrect))
         {
@@ -368,21 +473,113 @@ Workspace::solve_overlaps()
                   
           Rectf clip = irect.clip_to(jrect);
 
-          // FIXME: This only works if one rect isn't completly within the other
           if (clip.get_width() > clip.get_height())
           {
-            (*i)->set_pos((*i)->get_pos() - Vector2f(0.0f, clip.get_height()/2 + 16.0f));
-            (*j)->set_pos((*j)->get_pos() + Vector2f(0.0f, clip.get_height()/2 + 16.0f));
+            const float dir = (pos[i].y <= pos[j].y) ? 1.0f : -1.0f;
+            pos[i].y -= dir * (clip.get_height()/2 + spacing);
+            pos[j].y += dir * (clip.get_height()/2 + spacing);
           }
           else
           {
-            (*i)->set_pos((*i)->get_pos() - Vector2f(clip.get_width()/2 + 16.0f, 0.0f));
-            (*j)->set_pos((*j)->get_pos() + Vector2f(clip.get_width()/2 + 16.0f, 0.0f));
+            const float dir = (pos[i].x <= pos[j].x) ? 1.0f : -1.0f;
+            pos[i].x -= dir * (clip.get_width()/2 + spacing);
+            pos[j].x += dir * (clip.get_width()/2 + spacing);
+          }
+        }
+      }
+    }
+  }
+
+  m_overlaps_solved = true;
+
+  log_info << "solved overlaps in " << iteration << " passes, "
+           << num_overlappings << " remaining" << std::endl;
+
+  for(size_t i = 0; i < n; ++i)
+  {
+    const Vector2f target = m_images[i]->get_target_pos();
+    if (pos[i].x != target.x || pos[i].y != target.y)
+    {
+      m_images[i]->set_target_pos(pos[i]);
+    }
+  }
+
+  start_animation();
+}
+
+void
+Workspace::solve_new_overlaps(size_t first)
+{
+  // Each new image gets pushed out of whatever it overlaps, one image
+  // at a time. The first overlap decides the direction, all further
+  // pushes go the same way, so the image can't bounce between two
+  // neighbours and is free after passing at most all of them.
+  // Nothing else moves, so this costs O(k*n) for k new images instead
+  // of solving the whole workspace again.
+  const float spacing = 16.0f;
+
+  const size_t n = m_images.size();
+
+  std::vector<Rectf> rects(n);
+  for(size_t i = 0; i < n; ++i)
+  {
+    const Image& image = *m_images[i];
+    const Sizef half_size(static_cast<float>(image.get_original_width())  * image.get_target_scale() / 2.0f,
+                          static_cast<float>(image.get_original_height()) * image.get_target_scale() / 2.0f);
+    const Vector2f pos = image.get_target_pos();
+    rects[i] = Rectf(pos.x - half_size.width,  pos.y - half_size.height,
+                     pos.x + half_size.width,  pos.y + half_size.height);
+  }
+
+  for(size_t i = first; i < n; ++i)
+  {
+    Vector2f dir(0.0f, 0.0f);
+    Vector2f offset(0.0f, 0.0f);
+
+    bool moved = true;
+    while(moved)
+    {
+      moved = false;
+
+      for(size_t j = 0; j < i; ++j)
+      {
+        if (rects[i].is_overlapped(rects[j]))
+        {
+          if (dir.x == 0.0f && dir.y == 0.0f)
+          {
+            // leave along the axis with the smaller overlap
+            Rectf clip = rects[i].clip_to(rects[j]);
+            if (clip.get_width() > clip.get_height())
+            {
+              dir.y = (rects[i].top + rects[i].bottom <= rects[j].top + rects[j].bottom) ? -1.0f : 1.0f;
+            }
+            else
+            {
+              dir.x = (rects[i].left + rects[i].right <= rects[j].left + rects[j].right) ? -1.0f : 1.0f;
+            }
           }
+
+          Vector2f step(0.0f, 0.0f);
+          if (dir.x < 0.0f)
+            step.x = rects[j].left - rects[i].right - spacing;
+          else if (dir.x > 0.0f)
+            step.x = rects[j].right - rects[i].left + spacing;
+          else if (dir.y < 0.0f)
+            step.y = rects[j].top - rects[i].bottom - spacing;
+          else
+            step.y = rects[j].bottom - rects[i].top + spacing;
+
+          rects[i] += step;
+          offset   += step;
+          moved = true;
         }
       }
     }
-    std::cout << "NumOverlappings: " << num_overlappings << std::endl; 
+
+    if (offset.x != 0.0f || offset.y != 0.0f)
+    {
+      m_images[i]->set_target_pos(m_images[i]->get_target_pos() + offset);
+    }
   }
 }
 
@@ -409,20 +606,32 @@ Workspace::save(std::ostream& out)
 }
 
 void
-Workspace::finish_animation()
+Workspace::save_binary(std::ostream& out)
 {
-  m_progress = 1.0f;
+  BinaryWorkspace::save(out, m_images);
+}
 
-  for(ImageCollection::iterator i = m_images.begin(); i != m_images.end(); ++i)
+void
+Workspace::finish_animation()
+{
+  if (m_layouter && m_num_layouted != m_images.size())
   {
-    (*i)->update_pos(m_progress);
+    layout_new_images();
   }
+
+  m_animator.finish();
 }
 
 void
 Workspace::load(const std::string& filename)
 {
-  FileReader reader = FileReader::parse(filename);
+  if (BinaryWorkspace::is_binary(filename))
+  {
+    BinaryWorkspace::load(filename, m_images);
+    return;
+  }
+
+  FileReader reader = SExprStreamFileReader::parse(filename);
   
   if (reader.get_name() != "galapix-workspace")
   {
@@ -451,7 +660,7 @@ Workspace::load(const std::string& filename)
         ImagePtr image = Image::create(url);
         image->set_pos(pos);
         image->set_scale(scale);
-        add_image(Image::create(url));
+        add_image(image);
       }
     }
   }
@@ -496,7 +705,7 @@ Workspace::get_bounding_rect() const
 bool
 Workspace::is_animated() const
 {
-  return m_progress != 1.0f;
+  return m_animator.is_running();
 }
 
 /* EOF */
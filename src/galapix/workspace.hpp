@@ -19,14 +19,17 @@
 #ifndef HEADER_GALAPIX_GALAPIX_WORKSPACE_HPP
 #define HEADER_GALAPIX_GALAPIX_WORKSPACE_HPP
 
+#include <deque>
 #include <set>
 
 #include "galapix/image.hpp"
+#include "galapix/image_animator.hpp"
 #include "galapix/image_collection.hpp"
 #include "galapix/layouter.hpp"
 #include "galapix/selection.hpp"
 #include "galapix/spiral_layouter.hpp"
 #include "job/thread_message_queue.hpp"
+#include "job/thread_message_queue2.hpp"
 #include "math/quad_tree.hpp"
 #include "util/url.hpp"
 
@@ -44,14 +47,33 @@ private:
 
   SelectionPtr m_selection;
 
-  /** Progress of the animation when relayouting, must be set to 0 to
-      start animation */
-  float     m_progress;
+  /** Moves the images to the targets set by the last relayout */
+  ImageAnimator m_animator;
 
   ThreadMessageQueue2<FileEntry> m_file_queue;
 
   LayouterPtr m_layouter;
 
+  /** Number of images at the front of m_images that m_layouter has
+      placed, images added later get appended on the next update() */
+  size_t m_num_layouted;
+
+  /** Set when images got removed from the layout, the layouter would
+      append new images behind the gaps, so they trigger a full
+      relayout instead */
+  bool m_layout_broken;
+
+  /** Set by solve_overlaps(), images appended later get pushed out
+      of the way of the others as well */
+  bool m_overlaps_solved;
+
+  /** Time since the Workspace was created */
+  float m_time;
+
+  /** Images that left the screen along with the time they did so,
+      their tile cache and renderer get released after a while */
+  std::deque<std::pair<float, std::weak_ptr<Image> > > m_hidden_images;
+
 public:
   Workspace();
   // ---------------------------------------------
@@ -110,8 +132,10 @@ public:
   void print_images(const Rectf& rect);
 
   // ---------------------------------------------
+  /** Loads both the s-expression and the binary workspace format */
   void load(const std::string& filename);
   void save(std::ostream& out);
+  void save_binary(std::ostream& out);
 
   Rectf get_bounding_rect() const;
 
@@ -119,7 +143,14 @@ public:
 
 private:
   void start_animation();
+  void relayout();
+  void layout_new_images();
+
+  /** Moves images[first..] until they no longer overlap any image
+      before them, the images before \a first stay where they are */
+  void solve_new_overlaps(size_t first);
   void animation_finished();
+  void release_hidden_images();
 
 private:
   Workspace (const Workspace&);
@@ -27,11 +27,16 @@
 #include "galapix/tile.hpp"
 #include "plugins/curl.hpp"
 #include "plugins/jpeg.hpp"
+#include "util/blob.hpp"
 
 class ZoomifyTileJob : public Job
 {
 private:
   URL m_url;
+
+  /** Already downloaded tile data, decoded instead of fetching m_url */
+  BlobPtr m_blob;
+
   int m_scale;
   Vector2i m_pos;
   std::function<void (Tile)> m_callback;
@@ -42,6 +47,19 @@ public:
                  const std::function<void (Tile)>& callback) :
     Job(job_handle), 
     m_url(url),
+    m_blob(),
+    m_scale(scale),
+    m_pos(pos),
+    m_callback(callback)
+  {    
+  }
+
+  ZoomifyTileJob(JobHandle job_handle, const URL& url, const BlobPtr& blob,
+                 int scale, const Vector2i& pos,
+                 const std::function<void (Tile)>& callback) :
+    Job(job_handle), 
+    m_url(url),
+    m_blob(blob),
     m_scale(scale),
     m_pos(pos),
     m_callback(callback)
@@ -52,7 +70,13 @@ public:
   {
     try 
     {
-      if (m_url.has_stdio_name())
+      if (m_blob)
+      {
+        SoftwareSurfacePtr surface = JPEG::load_from_mem(m_blob->get_data(), m_blob->size());
+        m_callback(Tile(m_scale, m_pos, surface));
+        get_handle().set_finished();
+      }
+      else if (m_url.has_stdio_name())
       {
         SoftwareSurfacePtr surface = JPEG::load_from_file(m_url.get_stdio_name());
         m_callback(Tile(m_scale, m_pos, surface));
@@ -22,10 +22,13 @@
 #include <iostream>
 #include <stdio.h>
 
+#include "database/database.hpp"
+#include "galapix/database_thread.hpp"
 #include "job/job_manager.hpp"
 #include "job/job.hpp"
 #include "math/math.hpp"
 #include "plugins/curl.hpp"
+#include "plugins/curl_fetcher.hpp"
 #include "plugins/jpeg.hpp"
 
 namespace {
@@ -44,15 +47,89 @@ int get_max_scale(const Size& size, int tilesize)
   return i;
 }
 
+uint64_t make_tile_key(int scale, const Vector2i& pos)
+{
+  return
+    (static_cast<uint64_t>(scale) << 48) |
+    (static_cast<uint64_t>(pos.y & 0xffffff) << 24) |
+    static_cast<uint64_t>(pos.x & 0xffffff);
+}
+
+/** Hands the downloaded tile over to the tile database, the data is
+    stored as is, without recompressing it */
+void store_tile(const FileEntry& file_entry, int scale, const Vector2i& pos, const BlobPtr& blob)
+{
+  if (file_entry && DatabaseThread::current())
+  {
+    DatabaseThread::current()->receive_tiles(std::vector<TileEntry>(1, TileEntry(file_entry, scale, pos, blob,
+                                                                                 TileEntry::JPEG_FORMAT)));
+  }
+}
+
+/** Decodes the downloaded tile in a JobWorkerThread, so that the
+    CURLFetcher thread can go on with the other transfers */
+void decode_tile(JobManager& job_manager, const JobHandle& job_handle, const URL& url, const BlobPtr& blob,
+                 int scale, const Vector2i& pos,
+                 const std::function<void (Tile)>& callback)
+{
+  job_manager.request(std::shared_ptr<Job>(new ZoomifyTileJob(job_handle, url, blob, scale, pos, callback)));
+}
+
+void download_tile(JobManager& job_manager, JobHandle job_handle, const URL& url, const FileEntry& file_entry,
+                   int scale, const Vector2i& pos,
+                   const std::function<void (Tile)>& callback,
+                   const std::function<void ()>& release)
+{
+  // remote tiles are downloaded asynchronously, so that slow
+  // servers don't block the JobWorkerThreads
+  CURLFetcher::current().request(
+    url.str(),
+    [&job_manager, job_handle, url, file_entry, scale, pos, callback, release](const CURLFetcher::Response& response) mutable {
+      // the tile is either stored by now or failed and may be
+      // requested again
+      if (release)
+      {
+        release();
+      }
+
+      if (!response.ok())
+      {
+        std::cout << "ZoomifyTileProvider: " << response.url << ": " << response.error << std::endl;
+        job_handle.set_failed();
+      }
+      else
+      {
+        try
+        {
+          // only the header is read here, make sure that only valid
+          // JPEGs end up in the database
+          JPEG::get_size(response.data->get_data(), response.data->size());
+          store_tile(file_entry, scale, pos, response.data);
+          decode_tile(job_manager, job_handle, url, response.data, scale, pos, callback);
+        }
+        catch(const std::exception& err)
+        {
+          std::cout << "ZoomifyTileProvider: " << err.what() << std::endl;
+          job_handle.set_failed();
+        }
+      }
+    },
+    [job_handle]() { return job_handle.is_aborted(); });
+}
+
 } // namespace
 
-ZoomifyTileProvider::ZoomifyTileProvider(const std::string& basedir, const Size& size, int tilesize, JobManager& job_manager) :
+ZoomifyTileProvider::ZoomifyTileProvider(const std::string& basedir, const Size& size, int tilesize, JobManager& job_manager,
+                                         const FileEntry& file_entry, int prefetch_budget) :
   m_size(size),
   m_tilesize(tilesize),
   m_basedir(basedir),
   m_max_scale(::get_max_scale(size, tilesize)),
   m_info(m_max_scale+1),
-  m_job_manager(job_manager)
+  m_job_manager(job_manager),
+  m_file_entry(file_entry),
+  m_prefetch_budget(prefetch_budget),
+  m_prefetches(std::make_shared<Prefetches>())
 {
   for(int i = m_max_scale; i >= 0; --i)
   {
@@ -74,7 +151,8 @@ ZoomifyTileProvider::ZoomifyTileProvider(const std::string& basedir, const Size&
 }
 
 std::shared_ptr<ZoomifyTileProvider> 
-ZoomifyTileProvider::create(const URL& url, JobManager& job_manager)
+ZoomifyTileProvider::create(const URL& url, JobManager& job_manager,
+                            Database* database, int prefetch_budget)
 {
   std::string content = url.get_blob()->str();
 
@@ -95,7 +173,31 @@ ZoomifyTileProvider::create(const URL& url, JobManager& job_manager)
   }
   else
   {
-    return std::shared_ptr<ZoomifyTileProvider>(new ZoomifyTileProvider(basedir, size, tilesize, job_manager));
+    FileEntry file_entry;
+
+    if (database && url.is_remote())
+    {
+      // The tiles are stored under a synthetic FileEntry for the
+      // ImageProperties.xml, a change in its content or in the image
+      // size invalidates the stored tiles
+      file_entry = database->get_files().get_file_entry(url);
+      if (file_entry &&
+          (file_entry.get_image_size() != size ||
+           file_entry.get_size() != static_cast<int>(content.size())))
+      {
+        database->delete_file_entry(file_entry.get_fileid());
+        file_entry = FileEntry();
+      }
+
+      if (!file_entry)
+      {
+        file_entry = database->get_files().store_file_entry_without_cache(
+          FileEntry::create_without_fileid(url, static_cast<int>(content.size()), 0, size.width, size.height, FileEntry::JPEG_FORMAT));
+      }
+    }
+
+    return std::shared_ptr<ZoomifyTileProvider>(new ZoomifyTileProvider(basedir, size, tilesize, job_manager,
+                                                                        file_entry, prefetch_budget));
   }
 }
 
@@ -107,9 +209,8 @@ ZoomifyTileProvider::get_tile_group(int scale, const Vector2i& pos)
   return tilenum / 256;
 }
 
-JobHandle
-ZoomifyTileProvider::request_tile(int scale, const Vector2i& pos, 
-                                  const std::function<void (Tile)>& callback)
+URL
+ZoomifyTileProvider::get_tile_url(int scale, const Vector2i& pos)
 {
   int tile_group = get_tile_group(scale, pos);
 
@@ -118,9 +219,234 @@ ZoomifyTileProvider::request_tile(int scale, const Vector2i& pos,
   out << m_basedir << "TileGroup" << tile_group << "/" 
       << (m_max_scale - scale) << "-" << pos.x << "-" << pos.y << ".jpg";
 
-  JobHandle job_handle = JobHandle::create();
-  m_job_manager.request(std::shared_ptr<Job>(new ZoomifyTileJob(job_handle, URL::from_string(out.str()), scale, pos, callback)));
-  return job_handle;
+  return URL::from_string(out.str());
+}
+
+JobHandle
+ZoomifyTileProvider::request_tile(int scale, const Vector2i& pos, 
+                                  const std::function<void (Tile)>& callback)
+{
+  URL url = get_tile_url(scale, pos);
+
+  if (!url.is_remote() || !CURLFetcher::has_current())
+  {
+    JobHandle job_handle = JobHandle::create();
+    m_job_manager.request(std::shared_ptr<Job>(new ZoomifyTileJob(job_handle, url, scale, pos, callback)));
+    return job_handle;
+  }
+  else
+  {
+    std::function<void ()> release = mark_requested(scale, pos);
+
+    JobHandle job_handle = JobHandle::create();
+    if (!wait_for_prefetch(scale, pos, job_handle, callback))
+    {
+      job_handle = request_remote_tile(url, scale, pos, callback, release);
+    }
+
+    // queued after the requested tile, so that it gets downloaded first
+    prefetch(scale, pos);
+
+    return job_handle;
+  }
+}
+
+JobHandle
+ZoomifyTileProvider::request_remote_tile(const URL& url, int scale, const Vector2i& pos,
+                                         const std::function<void (Tile)>& callback,
+                                         const std::function<void ()>& release)
+{
+  JobManager& job_manager = m_job_manager;
+
+  if (m_file_entry && DatabaseThread::current())
+  {
+    FileEntry file_entry = m_file_entry;
+    return DatabaseThread::current()->request_stored_tile(
+      m_file_entry, scale, pos,
+      [callback, release](Tile tile) {
+        release();
+        callback(tile);
+      },
+      [&job_manager, url, file_entry, scale, pos, callback, release](JobHandle job_handle) {
+        download_tile(job_manager, job_handle, url, file_entry, scale, pos, callback, release);
+      });
+  }
+  else
+  {
+    JobHandle job_handle = JobHandle::create();
+    download_tile(job_manager, job_handle, url, m_file_entry, scale, pos, callback, release);
+    return job_handle;
+  }
+}
+
+bool
+ZoomifyTileProvider::is_valid_tile(int scale, const Vector2i& pos) const
+{
+  return
+    scale >= 0 && scale <= m_max_scale &&
+    pos.x >= 0 && pos.x < m_info[scale].m_size.width &&
+    pos.y >= 0 && pos.y < m_info[scale].m_size.height;
+}
+
+void
+ZoomifyTileProvider::prefetch(int scale, const Vector2i& pos)
+{
+  if (m_file_entry && m_prefetch_budget > 0 && DatabaseThread::current())
+  {
+    // the parent comes first, as it is needed when zooming out and
+    // covers the most area
+    Vector2i candidates[] = {
+      Vector2i(pos.x / 2, pos.y / 2),
+      Vector2i(pos.x - 1, pos.y - 1), Vector2i(pos.x, pos.y - 1), Vector2i(pos.x + 1, pos.y - 1),
+      Vector2i(pos.x - 1, pos.y),                                 Vector2i(pos.x + 1, pos.y),
+      Vector2i(pos.x - 1, pos.y + 1), Vector2i(pos.x, pos.y + 1), Vector2i(pos.x + 1, pos.y + 1)
+    };
+
+    for(size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); ++i)
+    {
+      int candidate_scale = (i == 0) ? scale + 1 : scale;
+      if (is_valid_tile(candidate_scale, candidates[i]))
+      {
+        {
+          std::lock_guard<std::mutex> lock(m_prefetches->mutex);
+          if (static_cast<int>(m_prefetches->pending.size()) >= m_prefetch_budget)
+            break;
+
+          if (!m_prefetches->requested.insert(make_tile_key(candidate_scale, candidates[i])).second)
+            continue;
+        }
+
+        prefetch_tile(candidate_scale, candidates[i]);
+      }
+    }
+  }
+}
+
+void
+ZoomifyTileProvider::prefetch_tile(int scale, const Vector2i& pos)
+{
+  std::shared_ptr<Prefetches> prefetches = m_prefetches;
+  uint64_t key = make_tile_key(scale, pos);
+  {
+    std::lock_guard<std::mutex> lock(prefetches->mutex);
+    prefetches->pending[key];
+  }
+
+  URL url = get_tile_url(scale, pos);
+  FileEntry file_entry = m_file_entry;
+  JobManager& job_manager = m_job_manager;
+
+  // takes the prefetch out of the pending and requested sets and
+  // returns the renderer requests that got attached to it meanwhile
+  auto finish = [prefetches, key]() -> std::vector<Prefetches::Waiter> {
+    std::lock_guard<std::mutex> lock(prefetches->mutex);
+    prefetches->requested.erase(key);
+    std::vector<Prefetches::Waiter> waiters;
+    auto it = prefetches->pending.find(key);
+    if (it != prefetches->pending.end())
+    {
+      waiters.swap(it->second);
+      prefetches->pending.erase(it);
+    }
+    return waiters;
+  };
+
+  // prefetched tiles only go into the database, they are decoded
+  // when the renderer requests them
+  DatabaseThread::current()->request_tile_check(
+    m_file_entry, scale, pos,
+    [&job_manager, finish, url, file_entry, scale, pos](bool stored) {
+      if (stored)
+      {
+        std::vector<Prefetches::Waiter> waiters = finish();
+        for(auto& waiter : waiters)
+        {
+          std::function<void (Tile)> callback = waiter.callback;
+          JobHandle job_handle = waiter.job_handle;
+          DatabaseThread::current()->request_stored_tile(
+            file_entry, scale, pos,
+            [job_handle, callback](Tile tile) mutable {
+              callback(tile);
+              job_handle.set_finished();
+            },
+            [&job_manager, job_handle, url, file_entry, scale, pos, callback](JobHandle) {
+              download_tile(job_manager, job_handle, url, file_entry, scale, pos, callback,
+                            std::function<void ()>());
+            });
+        }
+      }
+      else
+      {
+        CURLFetcher::current().request(url.str(), [&job_manager, finish, url, file_entry, scale, pos](const CURLFetcher::Response& response) {
+            bool stored_tile = false;
+            if (response.ok())
+            {
+              try
+              {
+                // make sure that only valid JPEGs end up in the database
+                JPEG::get_size(response.data->get_data(), response.data->size());
+                store_tile(file_entry, scale, pos, response.data);
+                stored_tile = true;
+              }
+              catch(const std::exception& err)
+              {
+                std::cout << "ZoomifyTileProvider: prefetch: " << err.what() << std::endl;
+              }
+            }
+
+            // the tile is queued for storage before the prefetch
+            // leaves the pending set, so later requests find it in the
+            // database instead of downloading it a second time
+            std::vector<Prefetches::Waiter> waiters = finish();
+            for(auto& waiter : waiters)
+            {
+              if (stored_tile)
+              {
+                decode_tile(job_manager, waiter.job_handle, url, response.data, scale, pos, waiter.callback);
+              }
+              else
+              {
+                // the prefetch failed, the renderer still wants the tile
+                download_tile(job_manager, waiter.job_handle, url, file_entry, scale, pos, waiter.callback,
+                              std::function<void ()>());
+              }
+            }
+          });
+      }
+    });
+}
+
+std::function<void ()>
+ZoomifyTileProvider::mark_requested(int scale, const Vector2i& pos)
+{
+  std::shared_ptr<Prefetches> prefetches = m_prefetches;
+  uint64_t key = make_tile_key(scale, pos);
+  {
+    std::lock_guard<std::mutex> lock(prefetches->mutex);
+    prefetches->requested.insert(key);
+  }
+
+  return [prefetches, key]() {
+    std::lock_guard<std::mutex> lock(prefetches->mutex);
+    prefetches->requested.erase(key);
+  };
+}
+
+bool
+ZoomifyTileProvider::wait_for_prefetch(int scale, const Vector2i& pos, const JobHandle& job_handle,
+                                       const std::function<void (Tile)>& callback)
+{
+  std::lock_guard<std::mutex> lock(m_prefetches->mutex);
+  auto it = m_prefetches->pending.find(make_tile_key(scale, pos));
+  if (it == m_prefetches->pending.end())
+  {
+    return false;
+  }
+  else
+  {
+    it->second.push_back(Prefetches::Waiter(job_handle, callback));
+    return true;
+  }
 }
   
 /* EOF */
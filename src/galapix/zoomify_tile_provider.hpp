@@ -19,10 +19,18 @@
 #ifndef HEADER_GALAPIX_GALAPIX_ZOOMIFY_TILE_PROVIDER_HPP
 #define HEADER_GALAPIX_GALAPIX_ZOOMIFY_TILE_PROVIDER_HPP
 
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+#include "database/file_entry.hpp"
 #include "math/size.hpp"
 #include "galapix/zoomify_tile_job.hpp"
 #include "galapix/tile_provider.hpp"
 
+class Database;
 class JobManager;
 
 class ZoomifyTileProvider : public TileProvider
@@ -48,6 +56,36 @@ private:
     {}
   };
 
+  /** Prefetch downloads that haven't completed yet, along with the
+      renderer requests that came in for the same tile meanwhile and
+      that are answered by the prefetch instead of a second download */
+  struct Prefetches
+  {
+    struct Waiter
+    {
+      JobHandle job_handle;
+      std::function<void (Tile)> callback;
+
+      Waiter(const JobHandle& job_handle_, const std::function<void (Tile)>& callback_) :
+        job_handle(job_handle_),
+        callback(callback_)
+      {}
+    };
+
+    std::mutex mutex;
+    std::map<uint64_t, std::vector<Waiter> > pending;
+
+    /** Tiles with a renderer request or a prefetch in flight, they
+        leave the set once the request completes or fails */
+    std::set<uint64_t> requested;
+
+    Prefetches() :
+      mutex(),
+      pending(),
+      requested()
+    {}
+  };
+
 private:
   Size        m_size;
   int         m_tilesize;
@@ -56,13 +94,31 @@ private:
   std::vector<Info> m_info;
   JobManager& m_job_manager;
 
+  /** Synthetic FileEntry under which downloaded tiles are kept in
+      the tile database, invalid when tiles aren't stored */
+  FileEntry m_file_entry;
+
+  /** Maximum number of prefetch downloads in flight */
+  int m_prefetch_budget;
+
+  /** Shared with the download callbacks, which can outlive the
+      provider */
+  std::shared_ptr<Prefetches> m_prefetches;
+
 private:
-  ZoomifyTileProvider(const std::string& basedir, const Size& size, int tilesize, JobManager& job_manager);
+  ZoomifyTileProvider(const std::string& basedir, const Size& size, int tilesize, JobManager& job_manager,
+                      const FileEntry& file_entry, int prefetch_budget);
 
 public:
-  static std::shared_ptr<ZoomifyTileProvider> create(const URL& url, JobManager& job_manager);
+  /** Creates a provider for the ImageProperties.xml at \a url. When
+      a \a database is given, remote tiles are kept in its tile table
+      and up to \a prefetch_budget tiles around the requested ones are
+      downloaded ahead of time. */
+  static std::shared_ptr<ZoomifyTileProvider> create(const URL& url, JobManager& job_manager,
+                                                     Database* database = NULL, int prefetch_budget = 0);
 
   int get_tile_group(int scale, const Vector2i& pos);
+  URL get_tile_url(int scale, const Vector2i& pos);
   JobHandle request_tile(int scale, const Vector2i& pos, 
                          const std::function<void (Tile)>& callback);
 
@@ -70,6 +126,24 @@ public:
   int  get_tilesize()  const { return m_tilesize; }
   int  get_overlap()   const { return 0; }
   Size get_size()      const { return m_size; }
+
+private:
+  JobHandle request_remote_tile(const URL& url, int scale, const Vector2i& pos,
+                                const std::function<void (Tile)>& callback,
+                                const std::function<void ()>& release);
+  bool is_valid_tile(int scale, const Vector2i& pos) const;
+  void prefetch(int scale, const Vector2i& pos);
+  void prefetch_tile(int scale, const Vector2i& pos);
+
+  /** Attaches \a job_handle and \a callback to a prefetch of the
+      tile that is still in flight, returns false if there is none */
+  /** Marks the tile as requested and returns a function that takes
+      it out of the requested set again, to be called once the request
+      is done */
+  std::function<void ()> mark_requested(int scale, const Vector2i& pos);
+
+  bool wait_for_prefetch(int scale, const Vector2i& pos, const JobHandle& job_handle,
+                         const std::function<void (Tile)>& callback);
   
 private:
   ZoomifyTileProvider(const ZoomifyTileProvider&);
@@ -28,6 +28,7 @@
 
 GtkViewer::GtkViewer()
   : workspace(),
+    stats_overlay(false),
     pan_tool_button(),
     zoom_tool_button(),
     grid_tool_button(),
@@ -72,6 +73,10 @@ GtkViewer::run()
   viewer.reset(new Viewer(workspace));
 
   viewer->set_grid(Vector2f(0,0), Sizef(256.0f, 256.0f));
+  if (stats_overlay)
+  {
+    viewer->toggle_stats_overlay();
+  }
   //viewer->toggle_grid();
   //viewer->toggle_pinned_grid();
 
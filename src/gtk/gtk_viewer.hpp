@@ -28,6 +28,7 @@ class GtkViewer
 {
 private:
   Workspace* workspace;
+  bool stats_overlay;
   
   Gtk::RadioToolButton* pan_tool_button;
   Gtk::RadioToolButton* zoom_tool_button;
@@ -53,6 +54,7 @@ public:
 
   void run();
   void set_workspace(Workspace* workspace_) { workspace = workspace_; }
+  void set_stats_overlay(bool stats_overlay_) { stats_overlay = stats_overlay_; }
 
   void on_pan_tool_toggled();
   void on_zoom_tool_toggled();
@@ -215,6 +215,10 @@ GtkViewerWidget::key_press(GdkEventKey* ev)
       viewer->toggle_pinned_grid();
       break;
 
+    case GDK_o:
+      viewer->toggle_stats_overlay();
+      break;
+
     default:
       break;
   }
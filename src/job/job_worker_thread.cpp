@@ -18,28 +18,39 @@
 
 #include "job/job_worker_thread.hpp"
 
+#include <chrono>
 #include <iostream>
+#include <typeinfo>
 
 #include "job/job.hpp"
+#include "util/trace.hpp"
 
+std::atomic<int>     JobWorkerThread::s_num_workers(0);
+std::atomic<int>     JobWorkerThread::s_num_busy(0);
+std::atomic<int64_t> JobWorkerThread::s_busy_usec(0);
+
 JobWorkerThread::JobWorkerThread()
   : m_queue(),
     m_quit(false),
     m_abort(false)
 {
+  s_num_workers.fetch_add(1, std::memory_order_relaxed);
 }
 
 JobWorkerThread::~JobWorkerThread()
 {
   assert(m_quit);
+  s_num_workers.fetch_sub(1, std::memory_order_relaxed);
 }
 
 void
 JobWorkerThread::run()
 {
+  TRACE_THREAD_NAME("JobWorkerThread");
+
   while(!m_quit)
   {
-    m_queue.wait_for_pop([this]{ return m_abort; });
+    m_queue.wait_for_pop([this]{ return m_abort || m_quit; });
 
     Task task;
     while(!m_abort && m_queue.try_pop(task))
@@ -48,14 +59,23 @@ JobWorkerThread::run()
       if (!task.job->is_aborted())
       {
         //std::cout << "start job: " << task.job << std::endl;
+        s_num_busy.fetch_add(1, std::memory_order_relaxed);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
         try 
         {
+          TRACE_SPAN("job", "run");
+          TRACE_SPAN_DYNAMIC("job", typeid(*task.job).name());
           task.job->run();
+          TRACE_COUNT("job/completed", 1);
         }
         catch(const std::exception& err)
         {
           std::cout << "JobWorkerThread:run: Job failed: " << err.what() << std::endl;
+          TRACE_COUNT("job/failed", 1);
         }
+        s_busy_usec.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count(),
+                              std::memory_order_relaxed);
+        s_num_busy.fetch_sub(1, std::memory_order_relaxed);
 
         if (task.callback)
         {
@@ -68,6 +88,7 @@ JobWorkerThread::run()
       }
       else
       {
+        TRACE_COUNT("job/aborted", 1);
         if (task.callback)
         {
           task.callback(task.job, false);
@@ -19,8 +19,10 @@
 #ifndef HEADER_GALAPIX_JOB_JOB_WORKER_THREAD_HPP
 #define HEADER_GALAPIX_JOB_JOB_WORKER_THREAD_HPP
 
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <stdint.h>
 
 #include "job/thread_message_queue2.hpp"
 #include "job/thread.hpp"
@@ -30,6 +32,20 @@ class Job;
 
 class JobWorkerThread : public Thread
 {
+private:
+  /** Summed over the workers of all JobManagers, so that the
+      utilization can be sampled without knowing about the managers */
+  static std::atomic<int>     s_num_workers;
+  static std::atomic<int>     s_num_busy;
+  static std::atomic<int64_t> s_busy_usec;
+
+public:
+  static int     get_num_workers() { return s_num_workers.load(std::memory_order_relaxed); }
+  /** Number of workers currently running a job */
+  static int     get_num_busy()    { return s_num_busy.load(std::memory_order_relaxed); }
+  /** Time spent running jobs, counted once a job has finished */
+  static int64_t get_busy_usec()   { return s_busy_usec.load(std::memory_order_relaxed); }
+
 private:
   struct Task 
   {
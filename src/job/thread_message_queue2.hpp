@@ -20,6 +20,7 @@
 #define HEADER_GALAPIX_JOB_THREAD_MESSAGE_QUEUE2_HPP
 
 #include <assert.h>
+#include <atomic>
 #include <condition_variable>
 #include <functional>
 #include <mutex>
@@ -31,6 +32,11 @@ class ThreadMessageQueue2
 private:
   std::queue<Data> m_queue;
   int              m_max_size;
+  bool             m_closed;
+
+  /** Copy of m_queue.size(), so that size() can be polled without
+      taking the lock */
+  std::atomic<int> m_size;
 
   mutable std::mutex     m_mutex;
   std::condition_variable m_queue_not_empty_cond;
@@ -40,6 +46,8 @@ public:
   ThreadMessageQueue2(int max_size = -1) :
     m_queue(),
     m_max_size(max_size),
+    m_closed(false),
+    m_size(0),
     m_mutex(),
     m_queue_not_empty_cond(),
     m_queue_not_full_cond()
@@ -55,10 +63,11 @@ public:
     return m_queue.size() == m_max_size;
   }
 
+  /** Lock-free, the result might already be outdated when it is
+      returned, which is fine for statistics */
   int size() const
   {
-    std::unique_lock<std::mutex> lock(m_mutex);
-    return m_queue.size();
+    return m_size.load(std::memory_order_relaxed);
   }
 
   bool empty() const
@@ -80,6 +89,7 @@ public:
     {
       // push the data to the queue
       m_queue.push(data);
+      m_size.store(static_cast<int>(m_queue.size()), std::memory_order_relaxed);
 
       // notify that the queue is no longer empty
       lock.unlock();
@@ -99,6 +109,7 @@ public:
 
     // push the data to the queue    
     m_queue.push(data);
+    m_size.store(static_cast<int>(m_queue.size()), std::memory_order_relaxed);
 
     // notify that the queue is no longer empty
     lock.unlock();
@@ -127,6 +138,7 @@ public:
       // pop the data
       data_out = m_queue.front();
       m_queue.pop();
+      m_size.store(static_cast<int>(m_queue.size()), std::memory_order_relaxed);
 
       // notify that the queue is no longer full
       lock.unlock();
@@ -146,12 +158,51 @@ public:
     // pop the data
     data_out = m_queue.front();
     m_queue.pop();
+    m_size.store(static_cast<int>(m_queue.size()), std::memory_order_relaxed);
 
     // notify that the queue is no longer full
     lock.unlock();
     m_queue_not_full_cond.notify_one();
   }
 
+  /** Pop data from the queue, if it's empty, wait till data is
+      available or the queue got closed, returns false once the queue
+      is closed and empty */
+  bool wait_and_pop_until_closed(Data& data_out)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_queue_not_empty_cond.wait(lock, [this]{ return !m_queue.empty() || m_closed; });
+
+    if (m_queue.empty())
+    {
+      return false;
+    }
+    else
+    {
+      // pop the data
+      data_out = m_queue.front();
+      m_queue.pop();
+      m_size.store(static_cast<int>(m_queue.size()), std::memory_order_relaxed);
+
+      // notify that the queue is no longer full
+      lock.unlock();
+      m_queue_not_full_cond.notify_one();
+
+      return true;
+    }
+  }
+
+  /** Signal that no more data will be pushed, data already in the
+      queue can still be popped */
+  void close()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_closed = true;
+    lock.unlock();
+    m_queue_not_empty_cond.notify_all();
+  }
+
   /** wait till the queue allows a pop */
   void wait_for_pop(std::function<bool ()> abort_condition)
   {
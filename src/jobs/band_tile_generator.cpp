@@ -0,0 +1,234 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "jobs/band_tile_generator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+
+#include "math/math.hpp"
+#include "util/raise_exception.hpp"
+#include "util/trace.hpp"
+
+BandTileGenerator::BandTileGenerator(int min_scale, int max_scale,
+                                     const std::function<void (Tile)>& callback) :
+  m_min_scale(min_scale),
+  m_max_scale(max_scale),
+  m_callback(callback),
+  m_modifier(SoftwareSurface::kRot0),
+  m_original_size(),
+  m_format(SoftwareSurface::RGB_FORMAT),
+  m_bytes_per_pixel(3),
+  m_levels()
+{
+}
+
+void
+BandTileGenerator::set_orientation(SoftwareSurface::Modifier modifier, const Size& original_size)
+{
+  m_modifier = modifier;
+  m_original_size = original_size;
+}
+
+void
+BandTileGenerator::begin(SoftwareSurface::Format format, const Size& size)
+{
+  TRACE_SPAN("tile", "band_begin");
+
+  m_format = format;
+  m_bytes_per_pixel = (format == SoftwareSurface::RGBA_FORMAT) ? 4 : 3;
+
+  // full size of the image in the orientation the rows come in
+  const Size raw_size = (m_original_size == Size())
+    ? size
+    : SoftwareSurface::transform_size(m_modifier, m_original_size);
+
+  // figure out at which scale the rows are delivered, JPEGs might
+  // be prescaled and be a pixel larger than the exact 1/2^scale
+  int input_scale = 0;
+  int best_error = -1;
+  for(int scale = 0; scale <= m_min_scale; ++scale)
+  {
+    int error = abs(size.width  - (raw_size.width  >> scale)) +
+                abs(size.height - (raw_size.height >> scale));
+    if (best_error < 0 || error < best_error)
+    {
+      best_error  = error;
+      input_scale = scale;
+    }
+  }
+
+  const int last_scale = Math::max(m_min_scale, m_max_scale);
+
+  m_levels.clear();
+  m_levels.resize(last_scale - input_scale + 1);
+
+  Size level_size = size;
+  for(size_t i = 0; i < m_levels.size(); ++i)
+  {
+    Level& level = m_levels[i];
+    level.scale = input_scale + static_cast<int>(i);
+
+    if (i > 0)
+    {
+      level_size = Size(level_size.width / 2, level_size.height / 2);
+    }
+
+    if (level.scale >= m_min_scale)
+    {
+      // same as the target_size of cut_into_tiles(), anything
+      // larger is cut off instead of scaled
+      level_size = Size(Math::min(level_size.width,  raw_size.width  >> level.scale),
+                        Math::min(level_size.height, raw_size.height >> level.scale));
+    }
+
+    level.size = level_size;
+
+    if (level.scale >= m_min_scale)
+    {
+      // the tile grid is laid out in oriented space, each tile
+      // remembers where its pixels come from in the unoriented rows
+      Size oriented_size = SoftwareSurface::transform_size(m_modifier, level.size);
+      int band_height = 0;
+      for(int y = 0; 256*y < oriented_size.height; ++y)
+        for(int x = 0; 256*x < oriented_size.width; ++x)
+        {
+          Rect rect(x * 256, y * 256,
+                    Math::min((x + 1) * 256, oriented_size.width),
+                    Math::min((y + 1) * 256, oriented_size.height));
+          level.tiles.push_back(TileRect(Vector2i(x, y),
+                                         SoftwareSurface::transform_rect_inverse(m_modifier, level.size, rect)));
+          band_height = Math::max(band_height, level.tiles.back().rect.get_height());
+        }
+
+      std::stable_sort(level.tiles.begin(), level.tiles.end(),
+                       [](const TileRect& lhs, const TileRect& rhs) {
+                         return lhs.rect.top < rhs.rect.top;
+                       });
+
+      if (!level.tiles.empty())
+      {
+        level.band = SoftwareSurface::create(m_format, Size(level.size.width, band_height));
+      }
+    }
+
+    if (i + 1 < m_levels.size())
+    {
+      level.pending.resize(level.size.width * m_bytes_per_pixel);
+      level.halved.resize((level.size.width / 2) * m_bytes_per_pixel);
+    }
+  }
+}
+
+void
+BandTileGenerator::add_row(const uint8_t* row)
+{
+  push_row(0, row);
+}
+
+void
+BandTileGenerator::end()
+{
+  if (!m_levels.empty() && m_levels.front().row < m_levels.front().size.height)
+  {
+    raise_exception(std::runtime_error,
+                    "BandTileGenerator: image ended after " << m_levels.front().row
+                    << " of " << m_levels.front().size.height << " rows");
+  }
+}
+
+void
+BandTileGenerator::push_row(size_t level_idx, const uint8_t* row)
+{
+  Level& level = m_levels[level_idx];
+
+  if (level.row >= level.size.height)
+  {
+    return;
+  }
+
+  const int y = level.row;
+  level.row += 1;
+
+  if (level.band)
+  {
+    memcpy(level.band->get_row_data(y - level.band_top), row,
+           level.size.width * m_bytes_per_pixel);
+
+    if (level.next_tile < level.tiles.size() &&
+        level.tiles[level.next_tile].rect.bottom == level.row)
+    {
+      flush_band(level);
+    }
+  }
+
+  if (level_idx + 1 < m_levels.size())
+  {
+    if (y % 2 == 0)
+    {
+      memcpy(&level.pending[0], row, level.pending.size());
+    }
+    else
+    {
+      // same box filter as SoftwareSurface::halve()
+      const uint8_t* top = &level.pending[0];
+      const uint8_t* bottom = row;
+      const int bpp = m_bytes_per_pixel;
+      const int width = m_levels[level_idx + 1].size.width;
+      for(int x = 0; x < width; ++x)
+      {
+        for(int c = 0; c < bpp; ++c)
+        {
+          const int i = 2*x*bpp + c;
+          level.halved[x*bpp + c] = static_cast<uint8_t>((top[i] + top[i + bpp] + bottom[i] + bottom[i + bpp]) / 4);
+        }
+      }
+
+      push_row(level_idx + 1, level.halved.empty() ? row : &level.halved[0]);
+    }
+  }
+}
+
+void
+BandTileGenerator::flush_band(Level& level)
+{
+  TRACE_SPAN("tile", "flush_band");
+
+  while(level.next_tile < level.tiles.size() &&
+        level.tiles[level.next_tile].rect.bottom <= level.row)
+  {
+    const TileRect& tile = level.tiles[level.next_tile];
+
+    SoftwareSurfacePtr surface = level.band->crop(Rect(tile.rect.left,  tile.rect.top    - level.band_top,
+                                                       tile.rect.right, tile.rect.bottom - level.band_top));
+    if (m_modifier != SoftwareSurface::kRot0)
+    {
+      surface = surface->transform(m_modifier);
+    }
+
+    m_callback(Tile(level.scale, tile.pos, surface));
+
+    level.next_tile += 1;
+  }
+
+  level.band_top = level.row;
+}
+
+/* EOF */
@@ -0,0 +1,131 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_JOBS_BAND_TILE_GENERATOR_HPP
+#define HEADER_GALAPIX_JOBS_BAND_TILE_GENERATOR_HPP
+
+#include <functional>
+#include <vector>
+
+#include "galapix/tile.hpp"
+#include "math/rect.hpp"
+#include "util/scanline_sink.hpp"
+
+/** Builds the tile pyramid from an image that arrives row by row.
+    Each scale keeps a band of at most 256 rows, when a band is
+    complete its tiles are cut and handed to the callback, while every
+    pair of rows is halved and passed on to the next scale. Memory use
+    is thus O(width * 256 * scales) instead of O(width * height).
+
+    The result is the same as TileGenerator::cut_into_tiles(). The
+    rows are expected unoriented, the orientation is applied to each
+    tile as it is cut out. */
+class BandTileGenerator : public ScanlineSink
+{
+private:
+  struct TileRect
+  {
+    Vector2i pos;
+
+    /** Source rect in the unoriented image of the scale */
+    Rect rect;
+
+    TileRect(const Vector2i& pos_, const Rect& rect_) :
+      pos(pos_),
+      rect(rect_)
+    {}
+  };
+
+  struct Level
+  {
+    int  scale;
+
+    /** Unoriented size, rows and columns beyond it are dropped */
+    Size size;
+
+    /** Number of rows received so far */
+    int  row;
+
+    /** Tiles sorted by the top of their source rect, next_tile is
+        the first one not yet handed out */
+    std::vector<TileRect> tiles;
+    size_t next_tile;
+
+    /** Rows band_top..row of the current band */
+    SoftwareSurfacePtr band;
+    int band_top;
+
+    /** Even row waiting for its partner and the halved output row */
+    std::vector<uint8_t> pending;
+    std::vector<uint8_t> halved;
+
+    Level() :
+      scale(),
+      size(),
+      row(0),
+      tiles(),
+      next_tile(0),
+      band(),
+      band_top(0),
+      pending(),
+      halved()
+    {}
+  };
+
+private:
+  int m_min_scale;
+  int m_max_scale;
+  std::function<void (Tile)> m_callback;
+
+  SoftwareSurface::Modifier m_modifier;
+  Size m_original_size;
+
+  SoftwareSurface::Format m_format;
+  int m_bytes_per_pixel;
+  std::vector<Level> m_levels;
+
+public:
+  /** min_scale/max_scale are the exact range for which tiles are
+      generated, same as in TileGenerator::cut_into_tiles() */
+  BandTileGenerator(int min_scale, int max_scale,
+                    const std::function<void (Tile)>& callback);
+
+  /** Tells the generator the size of the full image after
+      orientation and the orientation to apply to the tiles. If not
+      called the rows are taken as the image at full size. Has to be
+      called before begin(). */
+  void set_orientation(SoftwareSurface::Modifier modifier, const Size& original_size);
+
+  /** \a size may be the image prescaled by any power of two up to
+      2^min_scale, as JPEG decoders deliver it */
+  void begin(SoftwareSurface::Format format, const Size& size);
+  void add_row(const uint8_t* row);
+  void end();
+
+private:
+  void push_row(size_t level_idx, const uint8_t* row);
+  void flush_band(Level& level);
+
+private:
+  BandTileGenerator(const BandTileGenerator&);
+  BandTileGenerator& operator=(const BandTileGenerator&);
+};
+
+#endif
+
+/* EOF */
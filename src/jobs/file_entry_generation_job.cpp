@@ -18,15 +18,19 @@
 
 #include "jobs/file_entry_generation_job.hpp"
 
+#include "database/tile_owner_lookup.hpp"
 #include "jobs/tile_generator.hpp"
 #include "plugins/jpeg.hpp"
 #include "util/filesystem.hpp"
 #include "util/log.hpp"
 #include "util/software_surface_factory.hpp"
+#include "util/xxhash64.hpp"
 
-FileEntryGenerationJob::FileEntryGenerationJob(const JobHandle& job_handle, const URL& url) :
+FileEntryGenerationJob::FileEntryGenerationJob(const JobHandle& job_handle, const URL& url,
+                                               const std::shared_ptr<TileOwnerLookup>& tile_owner_lookup) :
   Job(job_handle),
   m_url(url),
+  m_tile_owner_lookup(tile_owner_lookup),
   m_sig_file_callback(),
   m_sig_tile_callback()
 {
@@ -39,6 +43,7 @@ FileEntryGenerationJob::run()
   {
     SoftwareSurfacePtr surface;
     Size size;
+    SoftwareSurface::Modifier modifier = SoftwareSurface::kRot0;
     int min_scale;
     int max_scale;
     FileEntry file_entry;
@@ -46,40 +51,34 @@ FileEntryGenerationJob::run()
     // FIXME: JPEG::filename_is_jpeg() is ugly
     if (!m_url.is_remote() && JPEG::filename_is_jpeg(m_url.str()))
     {
-      BlobPtr blob;
+      // the file entry decides which scale to decode at, so it is
+      // created from the header info in between reading the header
+      // and decoding the image, both from the same open file
+      auto choose_scale = [&](const JPEGInfo& info) -> int {
+        // FIXME: On http:// transfer mtime and size must be got from the transfer itself, not afterwards
+        file_entry = FileEntry::create_without_fileid(m_url, m_url.get_size(), m_url.get_mtime(), 
+                                                      info.size.width, info.size.height, FileEntry::JPEG_FORMAT);
 
-      if (m_url.has_stdio_name())
-      {
-        size = JPEG::get_size(m_url.get_stdio_name());
-      }
-      else
-      {
-        blob = m_url.get_blob();
-        size = JPEG::get_size(blob->get_data(), blob->size());
-      }
+        // FIXME: here we are just guessing which tiles might be useful,
+        // there might be a better way to pick \a min_scale
+        min_scale = std::max(0, file_entry.get_thumbnail_scale() - 3);
+        max_scale = file_entry.get_thumbnail_scale();
 
-      // FIXME: On http:// transfer mtime and size must be got from the transfer itself, not afterwards
-      file_entry = FileEntry::create_without_fileid(m_url, m_url.get_size(), m_url.get_mtime(), 
-                                                    size.width, size.height, FileEntry::JPEG_FORMAT);
-
-      // FIXME: here we are just guessing which tiles might be useful,
-      // there might be a better way to pick \a min_scale
-      min_scale = std::max(0, file_entry.get_thumbnail_scale() - 3);
-      max_scale = file_entry.get_thumbnail_scale();
+        // 2^3 is the highest scale JPEG supports, so we limit the
+        // min_scale to that
+        min_scale = Math::min(min_scale, 3);
 
-      // 2^3 is the highest scale JPEG supports, so we limit the
-      // min_scale to that
-      min_scale = Math::min(min_scale, 3);
+        return Math::pow2(min_scale);
+      };
 
-      // FIXME: recalc min_scale from jpeg scale
-      if (!blob)
-      {
-        surface = JPEG::load_from_file(m_url.get_stdio_name(), Math::pow2(min_scale));
-      }
-      else
-      {
-        surface = JPEG::load_from_mem(blob->get_data(), blob->size(), Math::pow2(min_scale));
-      }
+      // the file is read once, the hash comes from the same blob
+      // the image is decoded from
+      BlobPtr blob = m_url.has_stdio_name() ? Blob::from_file(m_url.get_stdio_name()) : m_url.get_blob();
+      JPEGInfo info;
+      surface = JPEG::load_from_mem(blob->get_data(), blob->size(), choose_scale, &info, false);
+      file_entry.set_hash(XXHash64::from_data(blob->get_data(), blob->size()));
+      size = info.size;
+      modifier = info.orientation;
     }
     else
     {
@@ -101,11 +100,22 @@ FileEntryGenerationJob::run()
                                                     size.width, size.height, format);
       min_scale = 0;
       max_scale = file_entry.get_thumbnail_scale();
+
+      // the loaders do their own I/O, hashing the file would read it
+      // a second time, so it is left without a hash and doesn't share
+      // tiles with identical files
+    }
+
+    // the files are compared here and not in the DatabaseThread, so
+    // that the thread writing the database doesn't wait for the disk
+    if (m_tile_owner_lookup)
+    {
+      file_entry.set_tile_fileid(m_tile_owner_lookup->find(file_entry));
     }
 
     m_sig_file_callback(file_entry);
     
-    TileGenerator::cut_into_tiles(surface, size, min_scale, max_scale, 
+    TileGenerator::cut_into_tiles(surface, modifier, size, min_scale, max_scale, 
                                   std::bind(&FileEntryGenerationJob::process_tile, this, file_entry, std::placeholders::_1));
   }
   catch(const std::exception& err)
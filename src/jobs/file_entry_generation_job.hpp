@@ -20,6 +20,7 @@
 #define HEADER_GALAPIX_JOBS_FILE_ENTRY_GENERATION_JOB_HPP
 
 #include <functional>
+#include <memory>
 #include <boost/signals2/signal.hpp>
 
 #include "util/url.hpp"
@@ -27,16 +28,22 @@
 #include "database/file_entry.hpp"
 #include "galapix/tile.hpp"
 
+class TileOwnerLookup;
+
 class FileEntryGenerationJob : public Job
 {
 private:
   URL m_url;
+  std::shared_ptr<TileOwnerLookup> m_tile_owner_lookup;
 
   boost::signals2::signal<void (FileEntry)>       m_sig_file_callback;
   boost::signals2::signal<void (FileEntry, Tile)> m_sig_tile_callback;
 
 public:
-  FileEntryGenerationJob(const JobHandle& job_handle, const URL& url);
+  /** @param tile_owner_lookup finds a file with the same content to
+      share the tiles with, nullptr to not look for one */
+  FileEntryGenerationJob(const JobHandle& job_handle, const URL& url,
+                         const std::shared_ptr<TileOwnerLookup>& tile_owner_lookup = std::shared_ptr<TileOwnerLookup>());
 
   void run();
 
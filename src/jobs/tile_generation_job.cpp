@@ -25,7 +25,8 @@
 #include "jobs/tile_generator.hpp"
 #include "database/tile_entry.hpp"
 
-TileGenerationJob::TileGenerationJob(const FileEntry& file_entry, int min_scale_in_db, int max_scale_in_db) :
+TileGenerationJob::TileGenerationJob(const FileEntry& file_entry, int min_scale_in_db, int max_scale_in_db,
+                                     size_t max_retained_bytes) :
   Job(JobHandle::create()),
   m_state_mutex(),
   m_state(kWaiting),
@@ -38,6 +39,9 @@ TileGenerationJob::TileGenerationJob(const FileEntry& file_entry, int min_scale_
   m_tile_requests(),
   m_late_tile_requests(),
   m_tiles(),
+  m_tile_order(),
+  m_retained_bytes(0),
+  m_max_retained_bytes(max_retained_bytes),
   m_sig_file_callback(),
   m_sig_tile_callback()
 {
@@ -67,8 +71,23 @@ TileGenerationJob::request_tile(const JobHandle& job_handle, int scale, const Ve
     case kRunning:
       if (m_min_scale <= scale && scale <= m_max_scale)
       {
-        m_late_tile_requests.push_back(TileRequest(job_handle, scale, pos, callback));
-        return true;
+        Tiles::const_iterator it = m_tiles.find(tile_key(scale, pos));
+        if (it == m_tiles.end())
+        {
+          // not generated yet, process_tile() will take care of it
+          m_late_tile_requests.push_back(TileRequest(job_handle, scale, pos, callback));
+          return true;
+        }
+        else if (it->second)
+        {
+          callback(it->second);
+          return true;
+        }
+        else
+        {
+          // tile was generated, but is no longer retained
+          return false;
+        }
       }
       else
       {
@@ -81,20 +100,10 @@ TileGenerationJob::request_tile(const JobHandle& job_handle, int scale, const Ve
     case kDone:
       if (m_min_scale <= scale && scale <= m_max_scale)
       {
-        Tiles::iterator tile_it = m_tiles.end();
-        for(Tiles::iterator i = m_tiles.begin(); i != m_tiles.end(); ++i)
+        Tile tile;
+        if (find_tile(scale, pos, tile))
         {
-          if (scale == i->get_scale() &&
-              pos   == i->get_pos())
-          {
-            tile_it = i;
-            break;
-          }
-        }
-
-        if (tile_it != m_tiles.end())
-        {
-          callback(*tile_it);
+          callback(tile);
           return true;
         }
         else
@@ -113,11 +122,60 @@ TileGenerationJob::request_tile(const JobHandle& job_handle, int scale, const Ve
   }
 }
 
+uint64_t
+TileGenerationJob::tile_key(int scale, const Vector2i& pos)
+{
+  return
+    (static_cast<uint64_t>(scale & 0xff) << 56) |
+    (static_cast<uint64_t>(pos.x & 0x0fffffff) << 28) |
+    (static_cast<uint64_t>(pos.y & 0x0fffffff));
+}
+
+bool
+TileGenerationJob::find_tile(int scale, const Vector2i& pos, Tile& tile_out) const
+{
+  Tiles::const_iterator it = m_tiles.find(tile_key(scale, pos));
+  if (it != m_tiles.end() && it->second)
+  {
+    tile_out = it->second;
+    return true;
+  }
+  else
+  {
+    return false;
+  }
+}
+
 void
-TileGenerationJob::process_tile(const Tile& tile)
+TileGenerationJob::retain_tile(const Tile& tile)
 {
-  m_tiles.push_back(tile);
+  SoftwareSurfacePtr surface = tile.get_surface();
+  size_t bytes = surface ? surface->get_pitch() * surface->get_height() : 0;
+
+  uint64_t key = tile_key(tile.get_scale(), tile.get_pos());
+  m_tiles[key] = tile;
+  m_tile_order.push_back(key);
+  m_retained_bytes += bytes;
 
+  // Drop the oldest tiles, the entry itself stays as an invalid Tile
+  // so that request_tile() can tell them apart from tiles that still
+  // have to be generated
+  while(m_retained_bytes > m_max_retained_bytes && m_tile_order.size() > 1)
+  {
+    Tile& old_tile = m_tiles[m_tile_order.front()];
+    SoftwareSurfacePtr old_surface = old_tile.get_surface();
+    if (old_surface)
+    {
+      m_retained_bytes -= old_surface->get_pitch() * old_surface->get_height();
+    }
+    old_tile = Tile();
+    m_tile_order.pop_front();
+  }
+}
+
+void
+TileGenerationJob::process_tile(const Tile& tile)
+{
   m_sig_tile_callback(m_file_entry, tile);
 
   for(TileRequests::iterator i = m_tile_requests.begin(); i != m_tile_requests.end(); ++i)
@@ -129,6 +187,29 @@ TileGenerationJob::process_tile(const Tile& tile)
       i->callback(tile);
     }
   }
+
+  std::unique_lock<std::mutex> lock(m_state_mutex);
+
+  retain_tile(tile);
+
+  // answer the requests that came in while the job was running
+  TileRequests::iterator j = m_late_tile_requests.begin();
+  while(j != m_late_tile_requests.end())
+  {
+    if (j->pos   == tile.get_pos() &&
+        j->scale == tile.get_scale())
+    {
+      if (!j->job_handle.is_aborted())
+      {
+        j->callback(tile);
+      }
+      j = m_late_tile_requests.erase(j);
+    }
+    else
+    {
+      ++j;
+    }
+  }
 }
 
 bool
@@ -217,19 +298,8 @@ TileGenerationJob::run()
     assert(m_state == kRunning);
     m_state = kDone;
 
-    for(TileRequests::iterator j = m_late_tile_requests.begin(); j != m_late_tile_requests.end(); ++j)
-    {
-      for(Tiles::iterator i = m_tiles.begin(); i != m_tiles.end(); ++i)
-      {
-        if (j->scale == i->get_scale() &&
-            j->pos   == i->get_pos())
-        {
-          j->callback(*i);
-          break;
-        }
-      }
-    }
-
+    // late requests got answered by process_tile(), whatever is left
+    // was outside of the image or failed to generate
     m_late_tile_requests.clear();
   }
 }
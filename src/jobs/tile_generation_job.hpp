@@ -19,9 +19,12 @@
 #ifndef HEADER_GALAPIX_JOBS_TILE_GENERATION_JOB_HPP
 #define HEADER_GALAPIX_JOBS_TILE_GENERATION_JOB_HPP
 
+#include <deque>
 #include <functional>
 #include <boost/signals2/signal.hpp>
 #include <mutex>
+#include <stdint.h>
+#include <unordered_map>
 
 #include "database/file_entry.hpp"
 #include "galapix/tile.hpp"
@@ -76,14 +79,21 @@ private:
   /** TileRequests that came in when the process was already running */
   TileRequests m_late_tile_requests;
   
-  typedef std::vector<Tile> Tiles;
+  /** Generated tiles, indexed by tile_key(), kept around to answer
+      requests that come in while or after the job runs. The oldest
+      tiles get dropped once m_max_retained_bytes is exceeded. */
+  typedef std::unordered_map<uint64_t, Tile> Tiles;
   Tiles m_tiles;
+  std::deque<uint64_t> m_tile_order;
+  size_t m_retained_bytes;
+  size_t m_max_retained_bytes;
 
   boost::signals2::signal<void (FileEntry)> m_sig_file_callback;
   boost::signals2::signal<void (FileEntry, Tile)> m_sig_tile_callback;
 
 public:
-  TileGenerationJob(const FileEntry& file_entry, int min_scale_in_db, int max_scale_in_db);
+  TileGenerationJob(const FileEntry& file_entry, int min_scale_in_db, int max_scale_in_db,
+                    size_t max_retained_bytes = 16 * 1024 * 1024);
   ~TileGenerationJob();
 
   /** Request a tile to be generated, returns true if the request will
@@ -94,6 +104,7 @@ public:
   void run();
 
   URL get_url() const { return m_url; }
+  FileEntry get_file_entry() const { return m_file_entry; }
 
   bool is_aborted();
 
@@ -102,6 +113,14 @@ public:
 
 private:
   void process_tile(const Tile& tile);
+  void retain_tile(const Tile& tile);
+  bool find_tile(int scale, const Vector2i& pos, Tile& tile_out) const;
+
+  static uint64_t tile_key(int scale, const Vector2i& pos);
+
+private:
+  TileGenerationJob(const TileGenerationJob&);
+  TileGenerationJob& operator=(const TileGenerationJob&);
 };
 
 #endif
@@ -22,11 +22,13 @@
 #include <sstream>
 
 #include "galapix/tile.hpp"
+#include "jobs/band_tile_generator.hpp"
 #include "math/rect.hpp"
 #include "math/vector2i.hpp"
 #include "plugins/jpeg.hpp"
 #include "util/log.hpp"
 #include "util/software_surface.hpp"
+#include "util/trace.hpp"
 
 void
 TileGenerator::generate_old(const URL& url,
@@ -64,37 +66,34 @@ void
 TileGenerator::generate(const URL& url, int min_scale, int max_scale,
                         const std::function<void(Tile)>& callback)
 {
-  // Load the image, try to load an already downsized version if possible
-  Size original_size;
-  SoftwareSurfacePtr surface = load_surface(url, min_scale, &original_size);
-  cut_into_tiles(surface, original_size, min_scale, max_scale, callback);
-}
+  // The image is decoded a band of rows at a time and cut into tiles
+  // as the rows come in, so even huge images only need a few rows of
+  // memory per scale
+  BandTileGenerator generator(min_scale, max_scale, callback);
 
-SoftwareSurfacePtr
-TileGenerator::load_surface(const URL& url, int min_scale, Size* size)
-{
-  // Load the image
   if (JPEG::filename_is_jpeg(url.str())) // FIXME: filename_is_jpeg() is ugly
   {
-    // The JPEG class can only scale down by factor 2,4,8, so we have to
-    // limit things (FIXME: is that true? if so, why?)
+    // JPEGs can be scaled down by 2, 4 and 8 while decoding, the rest
+    // is done by halving the rows
     int jpeg_scale = Math::min(Math::pow2(min_scale), 8);
-              
+    auto choose_scale = [&generator, jpeg_scale](const JPEGInfo& info) -> int {
+      generator.set_orientation(info.orientation, info.size);
+      return jpeg_scale;
+    };
+
     if (url.has_stdio_name())
     {
-      return JPEG::load_from_file(url.get_stdio_name(), jpeg_scale, size);
+      JPEG::stream_from_file(url.get_stdio_name(), choose_scale, generator);
     }
     else
     {
       BlobPtr blob = url.get_blob();
-      return JPEG::load_from_mem(blob->get_data(), blob->size(), jpeg_scale, size);
+      JPEG::stream_from_mem(blob->get_data(), blob->size(), choose_scale, generator);
     }
   }
   else
   {
-    SoftwareSurfacePtr surface = SoftwareSurfaceFactory::current().from_url(url);
-    *size = surface->get_size();
-    return surface;
+    SoftwareSurfaceFactory::current().stream_from_url(url, generator);
   }
 }
 
@@ -104,10 +103,24 @@ TileGenerator::cut_into_tiles(SoftwareSurfacePtr surface,
                               int min_scale, int max_scale,
                               const std::function<void (Tile)>& callback)
 {
+  cut_into_tiles(surface, SoftwareSurface::kRot0, original_size, min_scale, max_scale, callback);
+}
+
+void
+TileGenerator::cut_into_tiles(SoftwareSurfacePtr surface,
+                              SoftwareSurface::Modifier modifier,
+                              const Size& original_size,
+                              int min_scale, int max_scale,
+                              const std::function<void (Tile)>& callback)
+{
+  TRACE_SPAN("tile", "cut_into_tiles");
+
   // Scale the image if loading a downsized version was not possible
-  // or the downscale wasn't enough
-  Size target_size(original_size.width  / Math::pow2(min_scale),
-                   original_size.height / Math::pow2(min_scale));
+  // or the downscale wasn't enough, surface is still unoriented, so
+  // compare against the unoriented target size
+  Size target_size = SoftwareSurface::transform_size(modifier,
+                                                     Size(original_size.width  / Math::pow2(min_scale),
+                                                          original_size.height / Math::pow2(min_scale)));
 
   if (target_size != surface->get_size())
   {
@@ -140,14 +153,35 @@ TileGenerator::cut_into_tiles(SoftwareSurfacePtr surface,
       surface = surface->halve();
     }
 
-    for(int y = 0; 256*y < surface->get_height(); ++y)
-      for(int x = 0; 256*x < surface->get_width(); ++x)
-      {
-        SoftwareSurfacePtr croped_surface = surface->crop(Rect(Vector2i(x * 256, y * 256),
-                                                               Size(256, 256)));
-
-        callback(Tile(scale, Vector2i(x, y), croped_surface));
-      }
+    if (modifier == SoftwareSurface::kRot0)
+    {
+      for(int y = 0; 256*y < surface->get_height(); ++y)
+        for(int x = 0; 256*x < surface->get_width(); ++x)
+        {
+          SoftwareSurfacePtr croped_surface = surface->crop(Rect(Vector2i(x * 256, y * 256),
+                                                                 Size(256, 256)));
+
+          callback(Tile(scale, Vector2i(x, y), croped_surface));
+        }
+    }
+    else
+    {
+      // Tiles are laid out in oriented space, each one is cut from the
+      // matching part of the unoriented surface and only then transformed
+      Size oriented_size = SoftwareSurface::transform_size(modifier, surface->get_size());
+      for(int y = 0; 256*y < oriented_size.height; ++y)
+        for(int x = 0; 256*x < oriented_size.width; ++x)
+        {
+          Rect rect(x * 256, y * 256,
+                    Math::min((x + 1) * 256, oriented_size.width),
+                    Math::min((y + 1) * 256, oriented_size.height));
+
+          SoftwareSurfacePtr croped_surface
+            = surface->crop(SoftwareSurface::transform_rect_inverse(modifier, surface->get_size(), rect));
+
+          callback(Tile(scale, Vector2i(x, y), croped_surface->transform(modifier)));
+        }
+    }
 
     scale += 1;
   }
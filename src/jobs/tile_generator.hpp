@@ -21,6 +21,7 @@
 
 #include <functional>
 
+#include "util/software_surface.hpp"
 #include "util/software_surface_factory.hpp"
 #include "galapix/tile.hpp"
 
@@ -35,11 +36,12 @@ public:
                            int min_scale, int max_scale,
                            const std::function<void (Tile)>& callback);
 
+  /** Decodes the image at \a url and streams its rows into a
+      BandTileGenerator, the whole image is only held in memory for
+      formats that can't be decoded row by row */
   static void generate(const URL& url, int min_scale, int max_scale,
                        const std::function<void(Tile)>& callback);
 
-  static SoftwareSurfacePtr load_surface(const URL& url, int min_scale, Size* size);
-
   /** Takes the given surface and cuts it into tiles which are then
       passed to callback. Surface can already be prescaled.
       min_scale/max_scale are the exact range for which tiles are
@@ -49,6 +51,16 @@ public:
                              int min_scale, int max_scale,
                              const std::function<void (Tile)>& callback);
 
+  /** Same as above, but \a surface is stored unoriented and
+      \a modifier is applied to each tile as it is cut out, the full
+      sized oriented image is never created. \a original_size is the
+      size after orientation. */
+  static void cut_into_tiles(SoftwareSurfacePtr surface,
+                             SoftwareSurface::Modifier modifier,
+                             const Size& original_size,
+                             int min_scale, int max_scale,
+                             const std::function<void (Tile)>& callback);
+
 private:
   TileGenerator(const TileGenerator&);
   TileGenerator& operator=(const TileGenerator&);
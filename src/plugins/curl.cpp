@@ -22,16 +22,24 @@
 #include <stdexcept>
 #include <curl/curl.h>
 
+#include "plugins/curl_fetcher.hpp"
+
 static size_t my_curl_write_callback(void* ptr, size_t size, size_t nmemb, void* userdata)
 {
   std::vector<uint8_t>* data = static_cast<std::vector<uint8_t>*>(userdata);
-  std::copy((uint8_t*)ptr, (uint8_t*)ptr + size*nmemb, std::back_inserter(*data)); 
+  data->insert(data->end(), static_cast<uint8_t*>(ptr), static_cast<uint8_t*>(ptr) + size*nmemb);
   return nmemb * size;
 }
 
 BlobPtr
 CURLHandler::get_data(const std::string& url, std::string* mime_type)
 {
+  if (CURLFetcher::has_current())
+  {
+    // share connections and the response cache with the other requests
+    return CURLFetcher::current().get_data(url, mime_type);
+  }
+
   CURL* handle = curl_easy_init();
 
   std::vector<uint8_t> data;
@@ -0,0 +1,561 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "plugins/curl_fetcher.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "util/filesystem.hpp"
+#include "util/log.hpp"
+#include "util/xxhash64.hpp"
+
+struct CURLFetcher::Request
+{
+  std::string url;
+  Callback    callback;
+  AbortCheck  is_aborted;
+
+  CURL* handle;
+  struct curl_slist* headers;
+  char errbuf[CURL_ERROR_SIZE];
+
+  /** data is written directly into the Blob when the server sent a
+      Content-Length, into the vector otherwise */
+  BlobPtr blob;
+  std::vector<uint8_t> data;
+  size_t received;
+
+  std::string etag;
+  std::string last_modified;
+
+  /** set when a conditional request was made for a cached response */
+  bool revalidating;
+  std::string cached_mime_type;
+
+  Request(const std::string& url_, const Callback& callback_, const AbortCheck& is_aborted_) :
+    url(url_),
+    callback(callback_),
+    is_aborted(is_aborted_),
+    handle(NULL),
+    headers(NULL),
+    errbuf(),
+    blob(),
+    data(),
+    received(0),
+    etag(),
+    last_modified(),
+    revalidating(false),
+    cached_mime_type()
+  {}
+
+  ~Request()
+  {
+    curl_slist_free_all(headers);
+  }
+
+private:
+  Request(const Request&);
+  Request& operator=(const Request&);
+};
+
+namespace {
+
+std::string trim_header_value(const char* begin, const char* end)
+{
+  while(begin != end && (*begin == ' ' || *begin == '\t'))
+    ++begin;
+
+  while(end != begin && (end[-1] == '\r' || end[-1] == '\n' || end[-1] == ' '))
+    --end;
+
+  return std::string(begin, end);
+}
+
+/** Returns a pointer to the value of the header \a name or NULL if
+    the header line doesn't match */
+const char* match_header(const char* ptr, size_t len, const char* name)
+{
+  size_t name_len = strlen(name);
+  if (len > name_len && ptr[name_len] == ':' && strncasecmp(ptr, name, name_len) == 0)
+  {
+    return ptr + name_len + 1;
+  }
+  else
+  {
+    return NULL;
+  }
+}
+
+} // namespace
+
+CURLFetcher::CURLFetcher(int max_parallel, const std::string& cache_dir) :
+  m_max_parallel(max_parallel),
+  m_cache_dir(cache_dir),
+  m_multi(curl_multi_init()),
+  m_share(curl_share_init()),
+  m_idle_handles(),
+  m_mutex(),
+  m_queue(),
+  m_quit(false),
+  m_running(),
+  m_thread()
+{
+  if (!m_cache_dir.empty())
+  {
+    Filesystem::mkdir(m_cache_dir);
+  }
+
+  // The connection cache lives in the multi handle, DNS and TLS
+  // sessions are shared between the easy handles. All handles are
+  // only touched from the fetcher thread, so no share locking is
+  // needed.
+  curl_multi_setopt(m_multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, static_cast<long>(m_max_parallel));
+  curl_multi_setopt(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(m_max_parallel));
+  curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+  m_thread = std::thread(&CURLFetcher::run, this);
+}
+
+CURLFetcher::~CURLFetcher()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_quit = true;
+  }
+  curl_multi_wakeup(m_multi);
+  m_thread.join();
+
+  for(std::vector<CURL*>::iterator i = m_idle_handles.begin(); i != m_idle_handles.end(); ++i)
+  {
+    curl_easy_cleanup(*i);
+  }
+
+  curl_multi_cleanup(m_multi);
+  curl_share_cleanup(m_share);
+}
+
+void
+CURLFetcher::request(const std::string& url, const Callback& callback, const AbortCheck& is_aborted)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_quit)
+  {
+    // the fetcher thread is already gone or about to go
+    lock.unlock();
+
+    Response response;
+    response.url   = url;
+    response.error = "fetcher shut down";
+    callback(response);
+  }
+  else
+  {
+    m_queue.push_back(std::unique_ptr<Request>(new Request(url, callback, is_aborted)));
+    lock.unlock();
+
+    curl_multi_wakeup(m_multi);
+  }
+}
+
+CURLFetcher::Response
+CURLFetcher::get(const std::string& url)
+{
+  std::promise<Response> promise;
+  std::future<Response> future = promise.get_future();
+  request(url, [&promise](const Response& response) { promise.set_value(response); });
+  return future.get();
+}
+
+BlobPtr
+CURLFetcher::get_data(const std::string& url, std::string* mime_type)
+{
+  Response response = get(url);
+
+  if (!response.ok())
+  {
+    throw std::runtime_error("CURLFetcher::get_data(): " + url + ": " + response.error);
+  }
+  else
+  {
+    if (mime_type)
+    {
+      *mime_type = response.mime_type;
+    }
+    return response.data;
+  }
+}
+
+size_t
+CURLFetcher::write_callback(char* ptr, size_t size, size_t nmemb, void* userdata)
+{
+  Request* request = static_cast<Request*>(userdata);
+  size_t len = size * nmemb;
+
+  if (!request->blob && request->data.empty())
+  {
+    curl_off_t content_length = -1;
+    if (curl_easy_getinfo(request->handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length) == CURLE_OK &&
+        content_length > 0 && content_length < std::numeric_limits<int>::max())
+    {
+      request->blob = Blob::create(static_cast<int>(content_length));
+    }
+  }
+
+  if (request->blob)
+  {
+    if (request->received + len <= static_cast<size_t>(request->blob->size()))
+    {
+      memcpy(request->blob->get_data() + request->received, ptr, len);
+      request->received += len;
+      return len;
+    }
+    else
+    {
+      // server sent more than announced, continue with the vector
+      request->data.assign(request->blob->get_data(), request->blob->get_data() + request->received);
+      request->blob.reset();
+    }
+  }
+
+  request->data.insert(request->data.end(), ptr, ptr + len);
+  request->received += len;
+  return len;
+}
+
+size_t
+CURLFetcher::header_callback(char* ptr, size_t size, size_t nmemb, void* userdata)
+{
+  Request* request = static_cast<Request*>(userdata);
+  size_t len = size * nmemb;
+  const char* value = NULL;
+
+  if (len > 5 && strncmp(ptr, "HTTP/", 5) == 0)
+  {
+    // start of a new response (i.e. after a redirect)
+    request->etag.clear();
+    request->last_modified.clear();
+  }
+  else if ((value = match_header(ptr, len, "ETag")))
+  {
+    request->etag = trim_header_value(value, ptr + len);
+  }
+  else if ((value = match_header(ptr, len, "Last-Modified")))
+  {
+    request->last_modified = trim_header_value(value, ptr + len);
+  }
+
+  return len;
+}
+
+void
+CURLFetcher::run()
+{
+  while(true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+
+      if (m_quit)
+        break;
+
+      while(static_cast<int>(m_running.size()) < m_max_parallel && !m_queue.empty())
+      {
+        std::unique_ptr<Request> request = std::move(m_queue.front());
+        m_queue.pop_front();
+
+        if (!request->is_aborted || !request->is_aborted())
+        {
+          start_request(std::move(request));
+        }
+      }
+    }
+
+    int running = 0;
+    curl_multi_perform(m_multi, &running);
+
+    int msgs_left = 0;
+    while(CURLMsg* msg = curl_multi_info_read(m_multi, &msgs_left))
+    {
+      if (msg->msg == CURLMSG_DONE)
+      {
+        finish_request(msg->easy_handle, msg->data.result);
+      }
+    }
+
+    curl_multi_poll(m_multi, NULL, 0, 1000, NULL);
+  }
+
+  // fail everything that is still queued or in flight, so that
+  // nobody waits for those requests forever
+  std::vector<std::unique_ptr<Request> > dropped;
+  for(std::vector<std::unique_ptr<Request> >::iterator i = m_running.begin(); i != m_running.end(); ++i)
+  {
+    curl_multi_remove_handle(m_multi, (*i)->handle);
+    curl_easy_cleanup((*i)->handle);
+    dropped.push_back(std::move(*i));
+  }
+  m_running.clear();
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for(std::deque<std::unique_ptr<Request> >::iterator i = m_queue.begin(); i != m_queue.end(); ++i)
+    {
+      dropped.push_back(std::move(*i));
+    }
+    m_queue.clear();
+  }
+
+  for(std::vector<std::unique_ptr<Request> >::iterator i = dropped.begin(); i != dropped.end(); ++i)
+  {
+    Response response;
+    response.url   = (*i)->url;
+    response.error = "fetcher shut down";
+    call_callback(**i, response);
+  }
+}
+
+void
+CURLFetcher::start_request(std::unique_ptr<Request> request)
+{
+  CURL* handle;
+  if (m_idle_handles.empty())
+  {
+    handle = curl_easy_init();
+  }
+  else
+  {
+    handle = m_idle_handles.back();
+    m_idle_handles.pop_back();
+  }
+
+  request->handle = handle;
+
+  curl_easy_setopt(handle, CURLOPT_URL, request->url.c_str());
+  curl_easy_setopt(handle, CURLOPT_SHARE, m_share);
+  curl_easy_setopt(handle, CURLOPT_PRIVATE, request.get());
+  curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &CURLFetcher::write_callback);
+  curl_easy_setopt(handle, CURLOPT_WRITEDATA, request.get());
+  curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, &CURLFetcher::header_callback);
+  curl_easy_setopt(handle, CURLOPT_HEADERDATA, request.get());
+  curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, request->errbuf);
+  curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);
+
+  // Fake the referer
+  curl_easy_setopt(handle, CURLOPT_REFERER, request->url.c_str());
+
+  std::string etag;
+  std::string last_modified;
+  if (read_cache(request->url, etag, last_modified, request->cached_mime_type))
+  {
+    request->revalidating = true;
+
+    if (!etag.empty())
+    {
+      request->headers = curl_slist_append(request->headers, ("If-None-Match: " + etag).c_str());
+    }
+
+    if (!last_modified.empty())
+    {
+      request->headers = curl_slist_append(request->headers, ("If-Modified-Since: " + last_modified).c_str());
+    }
+
+    curl_easy_setopt(handle, CURLOPT_HTTPHEADER, request->headers);
+  }
+
+  curl_multi_add_handle(m_multi, handle);
+  m_running.push_back(std::move(request));
+}
+
+void
+CURLFetcher::finish_request(CURL* handle, CURLcode result)
+{
+  std::vector<std::unique_ptr<Request> >::iterator it =
+    std::find_if(m_running.begin(), m_running.end(),
+                 [handle](const std::unique_ptr<Request>& request) { return request->handle == handle; });
+  assert(it != m_running.end());
+
+  std::unique_ptr<Request> request = std::move(*it);
+  m_running.erase(it);
+
+  curl_multi_remove_handle(m_multi, handle);
+
+  Response response;
+  response.url = request->url;
+  curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response.response_code);
+
+  char* content_type = NULL;
+  curl_easy_getinfo(handle, CURLINFO_CONTENT_TYPE, &content_type);
+  if (content_type)
+  {
+    response.mime_type = content_type;
+  }
+
+  if (result != CURLE_OK)
+  {
+    response.error = request->errbuf[0] ? request->errbuf : curl_easy_strerror(result);
+  }
+  else if (response.response_code == 304 && request->revalidating)
+  {
+    try
+    {
+      response.data = Blob::from_file(get_cache_filename(request->url) + ".data");
+      response.mime_type = request->cached_mime_type;
+      response.from_cache = true;
+    }
+    catch(const std::exception& err)
+    {
+      response.error = err.what();
+    }
+  }
+  else if (response.response_code / 100 == 2)
+  {
+    if (request->blob && request->received != static_cast<size_t>(request->blob->size()))
+    {
+      // connection closed before Content-Length bytes were received,
+      // the data is incomplete and must not end up in the cache
+      std::ostringstream str;
+      str << "transfer closed with " << request->received << " out of "
+          << request->blob->size() << " bytes received";
+      response.error = str.str();
+    }
+    else
+    {
+      if (request->blob)
+      {
+        response.data = request->blob;
+      }
+      else
+      {
+        response.data = Blob::copy(request->data);
+      }
+
+      if (!request->etag.empty() || !request->last_modified.empty())
+      {
+        write_cache(response, request->etag, request->last_modified);
+      }
+    }
+  }
+  else
+  {
+    std::ostringstream str;
+    str << "HTTP Error: " << response.response_code;
+    response.error = str.str();
+  }
+
+  release_handle(handle);
+
+  call_callback(*request, response);
+}
+
+void
+CURLFetcher::call_callback(Request& request, const Response& response)
+{
+  try
+  {
+    request.callback(response);
+  }
+  catch(const std::exception& err)
+  {
+    log_error << request.url << ": " << err.what() << std::endl;
+  }
+}
+
+void
+CURLFetcher::release_handle(CURL* handle)
+{
+  // curl_easy_reset() keeps the handle's connections and caches
+  curl_easy_reset(handle);
+  m_idle_handles.push_back(handle);
+}
+
+std::string
+CURLFetcher::get_cache_filename(const std::string& url) const
+{
+  std::ostringstream out;
+  out << m_cache_dir << "/" << std::setfill('0') << std::setw(16) << std::hex
+      << XXHash64::from_data(url.data(), url.size());
+  return out.str();
+}
+
+bool
+CURLFetcher::read_cache(const std::string& url, std::string& etag, std::string& last_modified, std::string& mime_type) const
+{
+  if (m_cache_dir.empty())
+  {
+    return false;
+  }
+  else
+  {
+    std::string filename = get_cache_filename(url);
+    std::ifstream in((filename + ".meta").c_str());
+
+    std::string cached_url;
+    if (!in ||
+        !std::getline(in, cached_url) ||
+        cached_url != url ||
+        !std::getline(in, etag) ||
+        !std::getline(in, last_modified) ||
+        !std::getline(in, mime_type))
+    {
+      return false;
+    }
+    else
+    {
+      return Filesystem::exist(filename + ".data");
+    }
+  }
+}
+
+void
+CURLFetcher::write_cache(const Response& response, const std::string& etag, const std::string& last_modified) const
+{
+  if (!m_cache_dir.empty())
+  {
+    std::string filename = get_cache_filename(response.url);
+
+    // write to temporary files first, so that an interrupted write
+    // doesn't leave a broken cache entry behind
+    response.data->write_to_file(filename + ".data.tmp");
+    {
+      std::ofstream out((filename + ".meta.tmp").c_str());
+      out << response.url << '\n'
+          << etag << '\n'
+          << last_modified << '\n'
+          << response.mime_type << '\n';
+    }
+
+    if (rename((filename + ".data.tmp").c_str(), (filename + ".data").c_str()) != 0 ||
+        rename((filename + ".meta.tmp").c_str(), (filename + ".meta").c_str()) != 0)
+    {
+      log_warning << "couldn't write cache entry for " << response.url << std::endl;
+    }
+  }
+}
+
+/* EOF */
@@ -0,0 +1,133 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_PLUGINS_CURL_FETCHER_HPP
+#define HEADER_GALAPIX_PLUGINS_CURL_FETCHER_HPP
+
+#include <condition_variable>
+#include <curl/curl.h>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util/blob.hpp"
+#include "util/currenton.hpp"
+
+/** The CURLFetcher downloads URLs in a background thread with a
+    single curl multi handle, so connections and TLS sessions are
+    reused between requests and the number of parallel transfers is
+    bounded. Responses carrying an ETag or Last-Modified header can
+    optionally be kept in an on-disk cache, which is revalidated with
+    a conditional request the next time the URL is requested. */
+class CURLFetcher : public Currenton<CURLFetcher>
+{
+public:
+  struct Response
+  {
+    std::string url;
+    long        response_code;
+    BlobPtr     data;
+    std::string mime_type;
+    std::string error;
+
+    /** true if the data came from the on-disk cache */
+    bool        from_cache;
+
+    Response() :
+      url(),
+      response_code(0),
+      data(),
+      mime_type(),
+      error(),
+      from_cache(false)
+    {}
+
+    bool ok() const { return data && error.empty(); }
+  };
+
+  typedef std::function<void (const Response&)> Callback;
+  typedef std::function<bool ()> AbortCheck;
+
+private:
+  struct Request;
+
+  int         m_max_parallel;
+  std::string m_cache_dir;
+
+  CURLM*  m_multi;
+  CURLSH* m_share;
+  std::vector<CURL*> m_idle_handles;
+
+  std::mutex m_mutex;
+  std::deque<std::unique_ptr<Request> > m_queue;
+  bool m_quit;
+
+  /** transfers currently added to the multi handle, only accessed
+      from the fetcher thread */
+  std::vector<std::unique_ptr<Request> > m_running;
+
+  std::thread m_thread;
+
+public:
+  /** @param max_parallel  maximum number of simultaneous transfers
+      @param cache_dir     directory for the on-disk cache, empty to
+                           disable caching */
+  CURLFetcher(int max_parallel = 8, const std::string& cache_dir = std::string());
+  ~CURLFetcher();
+
+  /** Queue \a url for download, \a callback is called from the
+      fetcher thread once the transfer completed or failed. If \a
+      is_aborted returns true before the transfer started, the request
+      is dropped without calling the callback. Requests still pending
+      when the CURLFetcher is destroyed fail with an error. */
+  void request(const std::string& url, const Callback& callback,
+               const AbortCheck& is_aborted = AbortCheck());
+
+  /** Download \a url and block until it is available, must not be
+      called from within a callback */
+  Response get(const std::string& url);
+
+  /** Like get(), but throws on error */
+  BlobPtr get_data(const std::string& url, std::string* mime_type = NULL);
+
+private:
+  static size_t write_callback(char* ptr, size_t size, size_t nmemb, void* userdata);
+  static size_t header_callback(char* ptr, size_t size, size_t nmemb, void* userdata);
+
+  void run();
+  void start_request(std::unique_ptr<Request> request);
+  void finish_request(CURL* handle, CURLcode result);
+  void call_callback(Request& request, const Response& response);
+  void release_handle(CURL* handle);
+
+  std::string get_cache_filename(const std::string& url) const;
+  bool read_cache(const std::string& url, std::string& etag, std::string& last_modified, std::string& mime_type) const;
+  void write_cache(const Response& response, const std::string& etag, const std::string& last_modified) const;
+
+private:
+  CURLFetcher(const CURLFetcher&);
+  CURLFetcher& operator=(const CURLFetcher&);
+};
+
+#endif
+
+/* EOF */
@@ -24,7 +24,9 @@
 #include <iostream>
 #include <algorithm>
 #include <list>
+#include <vector>
 
+#include "util/surface_scanline_sink.hpp"
 #include "util/url.hpp"
 #include "math/size.hpp"
 
@@ -94,73 +96,74 @@ Imagemagick::get_supported_extensions()
   }
 }
 
-static 
-SoftwareSurfacePtr
-MagickImage2SoftwareSurface(const Magick::Image& image)
+static
+void
+MagickImage2Scanlines(const Magick::Image& image, ScanlineSink& sink)
 {
-  SoftwareSurfacePtr surface;
-
   int width  = image.columns();
   int height = image.rows();
-  int shift = image.depth() - 8;
 
-  if (image.alpha())
-  {
-    surface = SoftwareSurface::create(SoftwareSurface::RGBA_FORMAT, 
-                                      Size(width, height));
+  // rows are taken from the pixel cache one at a time and converted
+  // into a single reused row, no second copy of the image is made
+  const bool alpha = image.alpha();
+  const int bpp = alpha ? 4 : 3;
+  std::vector<uint8_t> row(width * bpp);
 
-    for(int y = 0; y < height; ++y)
-    {
-      using Magick::Quantum; // FIXME: Seriously? There must be a better way to get QuantumRange to work
-      Magick::Quantum const* src_pixel = image.getConstPixels(0, y, width, 1);
-      uint8_t* dst_pixels = surface->get_row_data(y);
+  sink.begin(alpha ? SoftwareSurface::RGBA_FORMAT : SoftwareSurface::RGB_FORMAT,
+             Size(width, height));
 
-      for(int x = 0; x < width; ++x)
-      {
-        dst_pixels[4*x + 0] = static_cast<uint8_t>(255.0f * MagickCore::GetPixelRed(image.constImage(), src_pixel) / QuantumRange);
-        dst_pixels[4*x + 1] = static_cast<uint8_t>(255.0f * MagickCore::GetPixelGreen(image.constImage(), src_pixel) / QuantumRange);
-        dst_pixels[4*x + 2] = static_cast<uint8_t>(255.0f * MagickCore::GetPixelBlue(image.constImage(), src_pixel) / QuantumRange);
-        dst_pixels[4*x + 3] = static_cast<uint8_t>(255.0f * MagickCore::GetPixelAlpha(image.constImage(), src_pixel) / QuantumRange);
-
-        src_pixel += image.channels();
-      }
-    }
-  }
-  else
+  for(int y = 0; y < height; ++y)
   {
-    surface = SoftwareSurface::create(SoftwareSurface::RGB_FORMAT, 
-                                      Size(width, height));
-    for(int y = 0; y < height; ++y)
-    {
-      using Magick::Quantum;
-      Magick::Quantum const* src_pixel = image.getConstPixels(0, y, width, 1);
-      uint8_t* dst_pixels = surface->get_row_data(y);
+    using Magick::Quantum; // FIXME: Seriously? There must be a better way to get QuantumRange to work
+    Magick::Quantum const* src_pixel = image.getConstPixels(0, y, width, 1);
+    uint8_t* dst_pixels = row.data();
 
-      for(int x = 0; x < width; ++x)
+    for(int x = 0; x < width; ++x)
+    {
+      dst_pixels[bpp*x + 0] = static_cast<uint8_t>(255.0f * MagickCore::GetPixelRed(image.constImage(), src_pixel) / QuantumRange);
+      dst_pixels[bpp*x + 1] = static_cast<uint8_t>(255.0f * MagickCore::GetPixelGreen(image.constImage(), src_pixel) / QuantumRange);
+      dst_pixels[bpp*x + 2] = static_cast<uint8_t>(255.0f * MagickCore::GetPixelBlue(image.constImage(), src_pixel) / QuantumRange);
+      if (alpha)
       {
-        dst_pixels[3*x + 0] = static_cast<uint8_t>(255.0f * MagickCore::GetPixelRed(image.constImage(), src_pixel) / QuantumRange);
-        dst_pixels[3*x + 1] = static_cast<uint8_t>(255.0f * MagickCore::GetPixelGreen(image.constImage(), src_pixel) / QuantumRange);
-        dst_pixels[3*x + 2] = static_cast<uint8_t>(255.0f * MagickCore::GetPixelBlue(image.constImage(), src_pixel) / QuantumRange);
-
-        src_pixel += image.channels();
+        dst_pixels[bpp*x + 3] = static_cast<uint8_t>(255.0f * MagickCore::GetPixelAlpha(image.constImage(), src_pixel) / QuantumRange);
       }
+
+      src_pixel += image.channels();
     }
-  }  
 
-  return surface;
+    sink.add_row(dst_pixels);
+  }
+
+  sink.end();
 }
 
 SoftwareSurfacePtr
 Imagemagick::load_from_mem(void* data, int len)
 {
-  // FIXME: Magick::Blob creates an unneeded copy of the data
-  return MagickImage2SoftwareSurface(Magick::Image(Magick::Blob(data, len))); 
+  SurfaceScanlineSink sink;
+  stream_from_mem(data, len, sink);
+  return sink.get_surface();
 }
 
 SoftwareSurfacePtr
 Imagemagick::load_from_file(const std::string& filename)
 {
-  return MagickImage2SoftwareSurface(Magick::Image(filename));
+  SurfaceScanlineSink sink;
+  stream_from_file(filename, sink);
+  return sink.get_surface();
 }
-
+
+void
+Imagemagick::stream_from_mem(void* data, int len, ScanlineSink& sink)
+{
+  // FIXME: Magick::Blob creates an unneeded copy of the data
+  MagickImage2Scanlines(Magick::Image(Magick::Blob(data, len)), sink);
+}
+
+void
+Imagemagick::stream_from_file(const std::string& filename, ScanlineSink& sink)
+{
+  MagickImage2Scanlines(Magick::Image(filename), sink);
+}
+
 /* EOF */
@@ -21,6 +21,7 @@
 
 #include <string>
 
+#include "util/scanline_sink.hpp"
 #include "util/software_surface.hpp"
 
 class URL;
@@ -32,6 +33,11 @@ public:
   static bool get_size(const std::string& filename, Size& size);
   static SoftwareSurfacePtr load_from_file(const std::string& filename);
   static SoftwareSurfacePtr load_from_mem(void* data, int len);
+
+  /** Hand the image to \a sink row by row straight from the pixel
+      cache, without building a SoftwareSurface */
+  static void stream_from_file(const std::string& filename, ScanlineSink& sink);
+  static void stream_from_mem(void* data, int len, ScanlineSink& sink);
   static std::vector<std::string> get_supported_extensions();
 };
 
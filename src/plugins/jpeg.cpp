@@ -19,9 +19,9 @@
 #include <iostream>
 #include <sstream>
 #include <setjmp.h>
+#include <vector>
 
 #include "math/size.hpp"
-#include "plugins/exif.hpp"
 #include "plugins/file_jpeg_compressor.hpp"
 #include "plugins/file_jpeg_decompressor.hpp"
 #include "plugins/jpeg.hpp"
@@ -31,25 +31,87 @@
 
 namespace {
 
-Size apply_orientation(SoftwareSurface::Modifier modifier, const Size& size)
+/** Tile sized JPEGs are typically 10-30KB, so this avoids any growth
+    of the output buffer for the common case */
+const size_t kOutputBufferSize = 64 * 1024;
+
+/** Buffers larger than this are released after use, so that a
+    single large image doesn't keep memory around for the lifetime
+    of the thread */
+const size_t kMaxRetainedBufferSize = 4 * 1024 * 1024;
+
+/** Per thread libjpeg contexts and output buffer, libjpeg objects can
+    be reused for multiple images, which saves the setup and teardown
+    cost when handling lots of small tiles */
+struct JPEGThreadContext
+{
+  std::vector<uint8_t> buffer;
+  MemJPEGCompressor    compressor;
+  MemJPEGDecompressor  decompressor;
+
+  JPEGThreadContext() :
+    buffer(),
+    compressor(buffer),
+    decompressor(NULL, 0)
+  {
+    buffer.reserve(kOutputBufferSize);
+  }
+
+  void release_buffer()
+  {
+    if (buffer.capacity() > kMaxRetainedBufferSize)
+    {
+      std::vector<uint8_t>().swap(buffer);
+      buffer.reserve(kOutputBufferSize);
+    }
+  }
+};
+
+JPEGThreadContext& get_thread_context()
+{
+  thread_local JPEGThreadContext context;
+  return context;
+}
+
+SoftwareSurfacePtr apply_orientation(SoftwareSurface::Modifier modifier, const SoftwareSurfacePtr& surface)
 {
-  switch(modifier)
+  if (modifier == SoftwareSurface::kRot0)
+  {
+    return surface;
+  }
+  else
   {
-    case SoftwareSurface::kRot90:
-    case SoftwareSurface::kRot90Flip:
-    case SoftwareSurface::kRot270:
-    case SoftwareSurface::kRot270Flip:
-      return Size(size.height, size.width);
-
-    case SoftwareSurface::kRot0:
-    case SoftwareSurface::kRot0Flip:
-    case SoftwareSurface::kRot180:
-    case SoftwareSurface::kRot180Flip:
-    default:
-      return size;
+    return surface->transform(modifier);
   }
 }
 
+SoftwareSurfacePtr load(JPEGDecompressor& loader, int scale, Size* image_size)
+{
+  const JPEGInfo info = loader.read_info();
+  SoftwareSurfacePtr surface = loader.read_image(scale, NULL);
+
+  if (image_size)
+    *image_size = info.size;
+
+  return apply_orientation(info.orientation, surface);
+}
+
+SoftwareSurfacePtr load(JPEGDecompressor& loader,
+                        const std::function<int (const JPEGInfo&)>& choose_scale,
+                        JPEGInfo* out_info, bool oriented)
+{
+  const JPEGInfo info = loader.read_info();
+  SoftwareSurfacePtr surface = loader.read_image(choose_scale(info), NULL);
+
+  if (out_info)
+    *out_info = info;
+
+  if (oriented)
+    return apply_orientation(info.orientation, surface);
+  else
+    return surface;
+}
+
 } // namespace
 
 
@@ -66,18 +128,31 @@ JPEG::filename_is_jpeg(const std::string& filename)
 Size
 JPEG::get_size(const std::string& filename)
 {
-  FileJPEGDecompressor loader(filename);
-  Size size = loader.read_size();
-  return apply_orientation(EXIF::get_orientation(filename), size);
+  return probe(filename).size;
 }
 
 
 Size
 JPEG::get_size(const uint8_t* data, int len)
 {
-  MemJPEGDecompressor loader(data, len);
-  Size size = loader.read_size();
-  return apply_orientation(EXIF::get_orientation(data, len), size);
+  return probe(data, len).size;
+}
+
+
+JPEGInfo
+JPEG::probe(const std::string& filename)
+{
+  FileJPEGDecompressor loader(filename);
+  return loader.read_info();
+}
+
+
+JPEGInfo
+JPEG::probe(const uint8_t* data, int len)
+{
+  MemJPEGDecompressor& loader = get_thread_context().decompressor;
+  loader.reset(data, len);
+  return loader.read_info();
 }
 
 
@@ -85,43 +160,58 @@ SoftwareSurfacePtr
 JPEG::load_from_file(const std::string& filename, int scale, Size* image_size)
 {
   FileJPEGDecompressor loader(filename);
-  SoftwareSurfacePtr surface = loader.read_image(scale, image_size);
+  return load(loader, scale, image_size);
+}
 
-  SoftwareSurface::Modifier modifier = EXIF::get_orientation(filename);
 
-  if (image_size)
-    *image_size = apply_orientation(modifier, *image_size);
+SoftwareSurfacePtr
+JPEG::load_from_mem(const uint8_t* data, int len, int scale, Size* image_size)
+{
+  MemJPEGDecompressor& loader = get_thread_context().decompressor;
+  loader.reset(data, len);
+  return load(loader, scale, image_size);
+}
 
-  if (modifier == SoftwareSurface::kRot0)
-  {
-    return surface;
-  }
-  else
-  {
-    return surface->transform(modifier);
-  }
+
+SoftwareSurfacePtr
+JPEG::load_from_file(const std::string& filename,
+                     const std::function<int (const JPEGInfo&)>& choose_scale,
+                     JPEGInfo* info, bool oriented)
+{
+  FileJPEGDecompressor loader(filename);
+  return load(loader, choose_scale, info, oriented);
 }
 
 
 SoftwareSurfacePtr
-JPEG::load_from_mem(const uint8_t* data, int len, int scale, Size* image_size)
+JPEG::load_from_mem(const uint8_t* data, int len,
+                    const std::function<int (const JPEGInfo&)>& choose_scale,
+                    JPEGInfo* info, bool oriented)
 {
-  MemJPEGDecompressor loader(data, len);
-  SoftwareSurfacePtr surface = loader.read_image(scale, image_size);
+  MemJPEGDecompressor& loader = get_thread_context().decompressor;
+  loader.reset(data, len);
+  return load(loader, choose_scale, info, oriented);
+}
 
-  SoftwareSurface::Modifier modifier = EXIF::get_orientation(data, len);
 
-  if (image_size)
-    *image_size = apply_orientation(modifier, *image_size);
+void
+JPEG::stream_from_file(const std::string& filename,
+                       const std::function<int (const JPEGInfo&)>& choose_scale,
+                       ScanlineSink& sink)
+{
+  FileJPEGDecompressor loader(filename);
+  loader.read_image(choose_scale(loader.read_info()), sink);
+}
 
-  if (modifier == SoftwareSurface::kRot0)
-  {
-    return surface;
-  }
-  else
-  {
-    return surface->transform(modifier);
-  }
+
+void
+JPEG::stream_from_mem(const uint8_t* data, int len,
+                      const std::function<int (const JPEGInfo&)>& choose_scale,
+                      ScanlineSink& sink)
+{
+  MemJPEGDecompressor& loader = get_thread_context().decompressor;
+  loader.reset(data, len);
+  loader.read_image(choose_scale(loader.read_info()), sink);
 }
 
 
@@ -136,11 +226,14 @@ JPEG::save(const SoftwareSurfacePtr& surface, int quality, const std::string& fi
 BlobPtr
 JPEG::save(const SoftwareSurfacePtr& surface, int quality)
 {
-  std::vector<uint8_t> data;
-  MemJPEGCompressor compressor(data);
-  compressor.save(surface, quality);
-  // FIXME: Unneeded copy of data
-  return Blob::copy(data);
+  JPEGThreadContext& context = get_thread_context();
+
+  context.buffer.clear();
+  context.compressor.save(surface, quality);
+  BlobPtr blob = Blob::copy(context.buffer);
+  context.release_buffer();
+
+  return blob;
 }
   
 /* EOF */
@@ -23,6 +23,7 @@
 #include <jpeglib.h>
 #include <functional>
 
+#include "plugins/jpeg_decompressor.hpp"
 #include "util/software_surface.hpp"
 
 class JPEG
@@ -35,6 +36,11 @@ public:
   static Size get_size(const std::string& filename);
   static Size get_size(const uint8_t* data, int len);
 
+  /** Read size, EXIF orientation, colour space and progressive flag
+      with a single pass over the header */
+  static JPEGInfo probe(const std::string& filename);
+  static JPEGInfo probe(const uint8_t* data, int len);
+
   /** Load a SoftwareSurface from the filesystem
       
       @param[in]  filename Filename of the file to load
@@ -55,6 +61,32 @@ public:
    */
   static SoftwareSurfacePtr load_from_mem(const uint8_t* data, int len, int scale = 1, Size* size = NULL);
 
+  /** Load a JPEG with a scale picked from its header, the file is
+      opened and its header parsed only once
+
+      @param[in]  choose_scale  Gets the header info, returns 1,2,4 or 8
+      @param[out] info          The header info, may be NULL
+      @param[in]  oriented      Apply the EXIF orientation, if false the
+                                surface is returned as stored in the file
+                                and the caller has to handle info->orientation
+   */
+  static SoftwareSurfacePtr load_from_file(const std::string& filename,
+                                           const std::function<int (const JPEGInfo&)>& choose_scale,
+                                           JPEGInfo* info = NULL, bool oriented = true);
+  static SoftwareSurfacePtr load_from_mem(const uint8_t* data, int len,
+                                          const std::function<int (const JPEGInfo&)>& choose_scale,
+                                          JPEGInfo* info = NULL, bool oriented = true);
+
+  /** Decode a JPEG row by row into \a sink instead of building a
+      SoftwareSurface, the EXIF orientation is left to the sink and
+      can be picked up from the JPEGInfo in \a choose_scale */
+  static void stream_from_file(const std::string& filename,
+                               const std::function<int (const JPEGInfo&)>& choose_scale,
+                               ScanlineSink& sink);
+  static void stream_from_mem(const uint8_t* data, int len,
+                              const std::function<int (const JPEGInfo&)>& choose_scale,
+                              ScanlineSink& sink);
+
   static void save(const SoftwareSurfacePtr& surface, int quality, const std::string& filename);
   static BlobPtr save(const SoftwareSurfacePtr& surface, int quality);
 };
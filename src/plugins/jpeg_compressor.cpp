@@ -20,7 +20,8 @@
 
 JPEGCompressor::JPEGCompressor() :
   m_cinfo(),
-  m_jerr()
+  m_jerr(),
+  m_row_pointers()
 {
   jpeg_std_error(&m_jerr);
 
@@ -37,7 +38,10 @@ JPEGCompressor::~JPEGCompressor()
 void
 JPEGCompressor::save(SoftwareSurfacePtr surface_in, int quality)
 {
-  SoftwareSurfacePtr surface = surface_in->to_rgb();
+  // avoid the copy done by to_rgb() when the surface already is RGB
+  SoftwareSurfacePtr surface = (surface_in->get_format() == SoftwareSurface::RGB_FORMAT)
+    ? surface_in
+    : surface_in->to_rgb();
 
   m_cinfo.image_width  = surface->get_width();
   m_cinfo.image_height = surface->get_height();
@@ -50,16 +54,16 @@ JPEGCompressor::save(SoftwareSurfacePtr surface_in, int quality)
  
   jpeg_start_compress(&m_cinfo, TRUE);
 
-  std::unique_ptr<JSAMPROW[]> row_pointer(new JSAMPROW[surface->get_height()]);
+  m_row_pointers.resize(surface->get_height());
   
   for(int y = 0; y < surface->get_height(); ++y)
   {
-    row_pointer[y] = static_cast<JSAMPLE*>(surface->get_row_data(y));
+    m_row_pointers[y] = static_cast<JSAMPLE*>(surface->get_row_data(y));
   }
 
   while(m_cinfo.next_scanline < m_cinfo.image_height)
   {
-    jpeg_write_scanlines(&m_cinfo, &row_pointer[m_cinfo.next_scanline], 
+    jpeg_write_scanlines(&m_cinfo, &m_row_pointers[m_cinfo.next_scanline], 
                          surface->get_height() - m_cinfo.next_scanline);
   }
 
@@ -21,6 +21,7 @@
 
 #include <stdio.h>
 #include <jpeglib.h>
+#include <vector>
 
 #include "util/software_surface.hpp"
 
@@ -29,6 +30,7 @@ class JPEGCompressor
 protected:
   struct jpeg_compress_struct m_cinfo;
   struct jpeg_error_mgr m_jerr;
+  std::vector<JSAMPROW> m_row_pointers;
 
 protected:
   JPEGCompressor();
@@ -36,6 +38,8 @@ protected:
 public:
   virtual ~JPEGCompressor();
   
+  /** Compress \a surface_in, the compressor can be reused for
+      multiple images */
   void save(SoftwareSurfacePtr surface_in, int quality);
 
 private:
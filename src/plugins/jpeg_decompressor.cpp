@@ -18,13 +18,40 @@
 
 #include "plugins/jpeg_decompressor.hpp"
 
+#include <algorithm>
 #include <assert.h>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
+#include <string.h>
 
+#include "plugins/exif.hpp"
+#include "util/surface_scanline_sink.hpp"
 #include "util/raise_exception.hpp"
 
+namespace {
+
+Size apply_orientation(SoftwareSurface::Modifier modifier, const Size& size)
+{
+  switch(modifier)
+  {
+    case SoftwareSurface::kRot90:
+    case SoftwareSurface::kRot90Flip:
+    case SoftwareSurface::kRot270:
+    case SoftwareSurface::kRot270Flip:
+      return Size(size.height, size.width);
+
+    case SoftwareSurface::kRot0:
+    case SoftwareSurface::kRot0Flip:
+    case SoftwareSurface::kRot180:
+    case SoftwareSurface::kRot180Flip:
+    default:
+      return size;
+  }
+}
+
+} // namespace
+
 void
 JPEGDecompressor::fatal_error_handler(j_common_ptr cinfo)
 {
@@ -33,7 +60,10 @@ JPEGDecompressor::fatal_error_handler(j_common_ptr cinfo)
 
 JPEGDecompressor::JPEGDecompressor() :
   m_cinfo(),
-  m_err()
+  m_err(),
+  m_scanlines(),
+  m_rows(),
+  m_header_read(false)
 {
   jpeg_std_error(&m_err.pub);
 
@@ -42,6 +72,10 @@ JPEGDecompressor::JPEGDecompressor() :
   m_cinfo.err = &m_err.pub;
 
   jpeg_create_decompress(&m_cinfo);
+
+  // keep APP1 around, so the EXIF orientation comes out of the same
+  // pass over the header instead of reopening the file with libexif
+  jpeg_save_markers(&m_cinfo, JPEG_APP0 + 1, 0xffff);
 }
 
 JPEGDecompressor::~JPEGDecompressor()
@@ -63,15 +97,83 @@ JPEGDecompressor::read_size()
   }
   else
   {
-    jpeg_read_header(&m_cinfo, /*require_image*/ FALSE);
+    read_header();
 
     return Size(static_cast<int>(m_cinfo.image_width),
                 static_cast<int>(m_cinfo.image_height));
   }
 }
 
+void
+JPEGDecompressor::read_header()
+{
+  if (!m_header_read)
+  {
+    jpeg_read_header(&m_cinfo, /*require_image*/ FALSE);
+    m_header_read = true;
+  }
+}
+
+SoftwareSurface::Modifier
+JPEGDecompressor::get_exif_orientation() const
+{
+  for(jpeg_saved_marker_ptr marker = m_cinfo.marker_list; marker; marker = marker->next)
+  {
+    if (marker->marker == JPEG_APP0 + 1 &&
+        marker->data_length > 6 &&
+        memcmp(marker->data, "Exif\0\0", 6) == 0)
+    {
+      return EXIF::get_orientation(marker->data, static_cast<int>(marker->data_length));
+    }
+  }
+  return SoftwareSurface::kRot0;
+}
+
+JPEGInfo
+JPEGDecompressor::read_info()
+{
+  if (setjmp(m_err.setjmp_buffer))
+  {
+    char buffer[JMSG_LENGTH_MAX];
+    (m_cinfo.err->format_message)(reinterpret_cast<jpeg_common_struct*>(&m_cinfo), buffer);
+
+    std::ostringstream out;
+    out << "JPEG::read_info(): " << buffer;
+    raise_exception(std::runtime_error, out.str());
+  }
+  else
+  {
+    read_header();
+
+    JPEGInfo info;
+    info.image_size = Size(static_cast<int>(m_cinfo.image_width),
+                           static_cast<int>(m_cinfo.image_height));
+    info.orientation    = get_exif_orientation();
+    info.size           = apply_orientation(info.orientation, info.image_size);
+    info.color_space    = m_cinfo.jpeg_color_space;
+    info.num_components = m_cinfo.num_components;
+    info.progressive    = m_cinfo.progressive_mode != 0;
+    return info;
+  }
+}
+
 SoftwareSurfacePtr
 JPEGDecompressor::read_image(int scale, Size* image_size)
+{
+  SurfaceScanlineSink sink;
+  read_image(scale, sink);
+
+  if (image_size)
+  {
+    image_size->width  = static_cast<int>(m_cinfo.image_width);
+    image_size->height = static_cast<int>(m_cinfo.image_height);
+  }
+
+  return sink.get_surface();
+}
+
+void
+JPEGDecompressor::read_image(int scale, ScanlineSink& sink)
 {
   if (!(scale == 1 ||
         scale == 2 ||
@@ -93,13 +195,7 @@ JPEGDecompressor::read_image(int scale, Size* image_size)
   }
   else
   {
-    jpeg_read_header(&m_cinfo, /*require_image*/ FALSE);
-
-    if (image_size)
-    {
-      image_size->width = static_cast<int>(m_cinfo.image_width);
-      image_size->height = static_cast<int>(m_cinfo.image_height);
-    }
+    read_header();
 
     if (scale != 1) // scale the image down by \a scale
     {
@@ -113,96 +209,69 @@ JPEGDecompressor::read_image(int scale, Size* image_size)
 
     jpeg_start_decompress(&m_cinfo);
 
-    SoftwareSurfacePtr surface = SoftwareSurface::create(SoftwareSurface::RGB_FORMAT,
-                                                         Size(static_cast<int>(m_cinfo.output_width),
-                                                              static_cast<int>(m_cinfo.output_height)));
-
-    if (m_cinfo.out_color_space == JCS_RGB &&
-        m_cinfo.output_components == 3)
+    if (!((m_cinfo.out_color_space == JCS_RGB       && m_cinfo.output_components == 3) ||
+          (m_cinfo.out_color_space == JCS_GRAYSCALE && m_cinfo.output_components == 1) ||
+          (m_cinfo.out_color_space == JCS_CMYK      && m_cinfo.output_components == 4)))
     {
-      std::vector<JSAMPLE*> scanlines(m_cinfo.output_height);
-
-      for(JDIMENSION y = 0; y < m_cinfo.output_height; ++y)
-        scanlines[y] = surface->get_row_data(static_cast<int>(y));
-
-      while (m_cinfo.output_scanline < m_cinfo.output_height)
-      {
-        jpeg_read_scanlines(&m_cinfo, &scanlines[m_cinfo.output_scanline],
-                            m_cinfo.output_height - m_cinfo.output_scanline);
-      }
+      std::ostringstream str;
+      str << "JPEGDecompressor::read_image(): Unsupported colorspace: "
+          << m_cinfo.out_color_space << " components: " << m_cinfo.output_components;
+      raise_exception(std::runtime_error, str.str());
     }
-    else if (m_cinfo.out_color_space == JCS_GRAYSCALE &&
-             m_cinfo.output_components == 1)
-    {
-      std::vector<JSAMPLE*> scanlines(m_cinfo.output_height);
 
-      for(JDIMENSION y = 0; y < m_cinfo.output_height; ++y)
-        scanlines[y] = surface->get_row_data(static_cast<int>(y));
+    const int width = static_cast<int>(m_cinfo.output_width);
+    sink.begin(SoftwareSurface::RGB_FORMAT, Size(width, static_cast<int>(m_cinfo.output_height)));
 
-      while (m_cinfo.output_scanline < m_cinfo.output_height)
-      {
-        jpeg_read_scanlines(&m_cinfo, &scanlines[m_cinfo.output_scanline],
-                            m_cinfo.output_height - m_cinfo.output_scanline);
-      }
+    // room for as many rows as libjpeg hands out at once, each wide
+    // enough for the expanded RGB as well as the CMYK input
+    const int row_size = width * std::max(3, m_cinfo.output_components);
+    const int num_rows = std::max(1, m_cinfo.rec_outbuf_height);
+    m_rows.resize(static_cast<size_t>(row_size) * num_rows);
+    m_scanlines.resize(num_rows);
+    for(int i = 0; i < num_rows; ++i)
+      m_scanlines[i] = &m_rows[static_cast<size_t>(i) * row_size];
 
-      // Expand the greyscale data to RGB
-      // FIXME: Could be made faster if SoftwareSurface would support
-      // other color formats
-      for(int y = 0; y < surface->get_height(); ++y)
-      {
-        uint8_t* rowptr = surface->get_row_data(y);
-        for(int x = surface->get_width()-1; x >= 0; --x)
-        {
-          rowptr[3*x+0] = rowptr[x];
-          rowptr[3*x+1] = rowptr[x];
-          rowptr[3*x+2] = rowptr[x];
-        }
-      }
-    }
-    else if (m_cinfo.out_color_space == JCS_CMYK &&
-             m_cinfo.output_components == 4)
+    while (m_cinfo.output_scanline < m_cinfo.output_height)
     {
-      std::vector<JSAMPLE> output_data(m_cinfo.output_width * m_cinfo.output_height *
-                                       m_cinfo.output_components);
-      std::vector<JSAMPLE*> scanlines(m_cinfo.output_height);
+      JDIMENSION count = jpeg_read_scanlines(&m_cinfo, &m_scanlines[0], num_rows);
 
-      for(JDIMENSION y = 0; y < m_cinfo.output_height; ++y)
+      for(JDIMENSION i = 0; i < count; ++i)
       {
-        scanlines[y] = &output_data[y * m_cinfo.output_width * m_cinfo.output_components];
-      }
-
-      while (m_cinfo.output_scanline < m_cinfo.output_height)
-      {
-        jpeg_read_scanlines(&m_cinfo, &scanlines[m_cinfo.output_scanline],
-                            m_cinfo.output_height - m_cinfo.output_scanline);
-      }
+        uint8_t* rowptr = m_scanlines[i];
 
-      for(int y = 0; y < surface->get_height(); ++y)
-      {
-        uint8_t* jpegptr = &output_data[y * m_cinfo.output_width * m_cinfo.output_components];
-        uint8_t* rowptr = surface->get_row_data(y);
-        for(int x = surface->get_width()-1; x >= 0; --x)
+        if (m_cinfo.out_color_space == JCS_GRAYSCALE)
+        {
+          // Expand the greyscale data to RGB
+          // FIXME: Could be made faster if SoftwareSurface would support
+          // other color formats
+          for(int x = width-1; x >= 0; --x)
+          {
+            rowptr[3*x+0] = rowptr[x];
+            rowptr[3*x+1] = rowptr[x];
+            rowptr[3*x+2] = rowptr[x];
+          }
+        }
+        else if (m_cinfo.out_color_space == JCS_CMYK)
         {
-          uint8_t const cmyk_c = jpegptr[4*x + 0];
-          uint8_t const cmyk_m = jpegptr[4*x + 1];
-          uint8_t const cmyk_y = jpegptr[4*x + 2];
-          uint8_t const cmyk_k = jpegptr[4*x + 3];
-
-          rowptr[3*x+0] = static_cast<uint8_t>((cmyk_c * cmyk_k) / 255);
-          rowptr[3*x+1] = static_cast<uint8_t>((cmyk_m * cmyk_k) / 255);
-          rowptr[3*x+2] = static_cast<uint8_t>((cmyk_y * cmyk_k) / 255);
+          // RGB is narrower than CMYK, so this can be done in place
+          for(int x = 0; x < width; ++x)
+          {
+            uint8_t const cmyk_c = rowptr[4*x + 0];
+            uint8_t const cmyk_m = rowptr[4*x + 1];
+            uint8_t const cmyk_y = rowptr[4*x + 2];
+            uint8_t const cmyk_k = rowptr[4*x + 3];
+
+            rowptr[3*x+0] = static_cast<uint8_t>((cmyk_c * cmyk_k) / 255);
+            rowptr[3*x+1] = static_cast<uint8_t>((cmyk_m * cmyk_k) / 255);
+            rowptr[3*x+2] = static_cast<uint8_t>((cmyk_y * cmyk_k) / 255);
+          }
         }
+
+        sink.add_row(rowptr);
       }
     }
-    else
-    {
-      std::ostringstream str;
-      str << "JPEGDecompressor::read_image(): Unsupported colorspace: "
-          << m_cinfo.out_color_space << " components: " << m_cinfo.output_components;
-      raise_exception(std::runtime_error, str.str());
-    }
 
-    return surface;
+    sink.end();
   }
 }
 
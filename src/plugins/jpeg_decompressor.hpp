@@ -22,10 +22,36 @@
 #include <stdio.h>
 #include <jpeglib.h>
 #include <setjmp.h>
+#include <vector>
 
 #include "math/size.hpp"
+#include "util/scanline_sink.hpp"
 #include "util/software_surface.hpp"
 
+/** Everything the header of a JPEG tells about the image */
+struct JPEGInfo
+{
+  /** Size as stored in the file */
+  Size image_size;
+
+  /** Size after the EXIF orientation is applied */
+  Size size;
+
+  SoftwareSurface::Modifier orientation;
+  J_COLOR_SPACE color_space;
+  int  num_components;
+  bool progressive;
+
+  JPEGInfo() :
+    image_size(),
+    size(),
+    orientation(SoftwareSurface::kRot0),
+    color_space(JCS_UNKNOWN),
+    num_components(0),
+    progressive(false)
+  {}
+};
+
 class JPEGDecompressor
 {
 protected:
@@ -38,6 +64,12 @@ protected:
 protected:
   struct jpeg_decompress_struct  m_cinfo;
   struct ErrorMgr m_err;
+  std::vector<JSAMPLE*> m_scanlines;
+  std::vector<JSAMPLE>  m_rows;
+
+  /** Set once jpeg_read_header() ran for the current image, so that
+      read_info() and read_image() can share a single header pass */
+  bool m_header_read;
 
 protected:
   JPEGDecompressor();
@@ -46,9 +78,25 @@ public:
   virtual ~JPEGDecompressor();
   
   Size read_size();
+
+  /** Reads the header, including the EXIF orientation from the APP1
+      marker, without touching the image data */
+  JPEGInfo read_info();
+
+  /** Decodes the image, the EXIF orientation is *not* applied,
+      read_info() can be called before or after to get it without
+      reading the header again */
   SoftwareSurfacePtr read_image(int scale, Size* image_size);
 
+  /** Decodes the image a few scanlines at a time and passes them on
+      as RGB rows to \a sink, only a handful of rows are held in
+      memory at once, the EXIF orientation is not applied */
+  void read_image(int scale, ScanlineSink& sink);
+
 private:
+  void read_header();
+  SoftwareSurface::Modifier get_exif_orientation() const;
+
   static void fatal_error_handler(j_common_ptr cinfo);
   
 private:
@@ -19,36 +19,43 @@
 #include "plugins/jpeg_memory_dest.hpp"
 
 #define OUTPUT_BUF_SIZE 4096
-
+
 struct jpeg_memory_destination_mgr 
 {
   struct jpeg_destination_mgr pub;
 
-  JOCTET buffer[OUTPUT_BUF_SIZE];
   std::vector<uint8_t>* data;
+  size_t start;
 };
-
+
+// The compressed data is written directly into the std::vector. It is
+// only ever resized by OUTPUT_BUF_SIZE at a time, as resize()
+// zero-fills the new elements, the reallocations are left to the
+// vector, so if it comes with enough reserved capacity no
+// reallocation happens at all
+
 void jpeg_memory_init_destination(j_compress_ptr cinfo)
 {
   struct jpeg_memory_destination_mgr* mgr = (struct jpeg_memory_destination_mgr*)cinfo->dest;
 
-  cinfo->dest->next_output_byte = mgr->buffer;
-  cinfo->dest->free_in_buffer   = OUTPUT_BUF_SIZE;
+  mgr->start = mgr->data->size();
+  mgr->data->resize(mgr->start + OUTPUT_BUF_SIZE);
+
+  cinfo->dest->next_output_byte = mgr->data->data() + mgr->start;
+  cinfo->dest->free_in_buffer   = mgr->data->size() - mgr->start;
 }
 
 boolean jpeg_memory_empty_output_buffer(j_compress_ptr cinfo)
 {
   struct jpeg_memory_destination_mgr* mgr = (struct jpeg_memory_destination_mgr*)cinfo->dest;
   
-  // This function always gets OUTPUT_BUF_SIZE bytes,
+  // This function is only called when the buffer is completly full,
   // cinfo->dest->free_in_buffer *must* be ignored
-  for(size_t i = 0; i < OUTPUT_BUF_SIZE; ++i) 
-  { // FIXME: Little slow maybe?
-    mgr->data->push_back(mgr->buffer[i]);
-  }
+  size_t used = mgr->data->size();
+  mgr->data->resize(used + OUTPUT_BUF_SIZE);
 
-  cinfo->dest->next_output_byte = mgr->buffer;
-  cinfo->dest->free_in_buffer   = OUTPUT_BUF_SIZE;
+  cinfo->dest->next_output_byte = mgr->data->data() + used;
+  cinfo->dest->free_in_buffer   = mgr->data->size() - used;
 
   return TRUE;
 }
@@ -56,14 +63,10 @@ boolean jpeg_memory_empty_output_buffer(j_compress_ptr cinfo)
 void jpeg_memory_term_destination(j_compress_ptr cinfo)
 {
   struct jpeg_memory_destination_mgr* mgr = (struct jpeg_memory_destination_mgr*)cinfo->dest;
-  size_t datacount = OUTPUT_BUF_SIZE - cinfo->dest->free_in_buffer;
 
-  for(size_t i = 0; i < datacount; ++i)
-  { // FIXME: Little slow maybe?
-    mgr->data->push_back(mgr->buffer[i]);
-  }
+  mgr->data->resize(mgr->data->size() - cinfo->dest->free_in_buffer);
 }
-
+
 void jpeg_memory_dest(j_compress_ptr cinfo, std::vector<uint8_t>* data)
 {
   if (cinfo->dest == NULL) 
@@ -29,4 +29,12 @@ MemJPEGDecompressor::~MemJPEGDecompressor()
 {
 }
 
+void
+MemJPEGDecompressor::reset(const uint8_t* data, int len)
+{
+  jpeg_abort_decompress(&m_cinfo);
+  m_header_read = false;
+  jpeg_memory_src(&m_cinfo, data, len);
+}
+
 /* EOF */
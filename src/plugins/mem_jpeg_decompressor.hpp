@@ -28,6 +28,10 @@ public:
   MemJPEGDecompressor(const uint8_t* data, int len);
   ~MemJPEGDecompressor();
 
+  /** Discard any previous decoding state and start reading from \a
+      data, allows reuse of the decompressor for multiple images */
+  void reset(const uint8_t* data, int len);
+
 private:
   MemJPEGDecompressor(const MemJPEGDecompressor&);
   MemJPEGDecompressor& operator=(const MemJPEGDecompressor&);
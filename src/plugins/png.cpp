@@ -22,8 +22,81 @@
 #include <png.h>
 #include <stdexcept>
 #include <string.h>
+#include <vector>
 
 #include "util/log.hpp"
+
+namespace {
+
+/** Initial size of the per thread output buffer, large enough for
+    most 256x256 tiles */
+const size_t kOutputBufferSize = 128 * 1024;
+
+/** Buffers larger than this are released after use */
+const size_t kMaxRetainedBufferSize = 4 * 1024 * 1024;
+
+/** libpng doesn't allow reuse of its read/write structs, but the
+    output buffer and row pointers can be kept around per thread */
+struct PNGThreadContext
+{
+  std::vector<uint8_t>   buffer;
+  std::vector<png_bytep> row_pointers;
+  std::vector<uint8_t>   row;
+
+  /** Whole image for interlaced streaming */
+  std::vector<uint8_t>   image;
+
+  PNGThreadContext() :
+    buffer(),
+    row_pointers(),
+    row(),
+    image()
+  {
+    buffer.reserve(kOutputBufferSize);
+  }
+
+  png_bytep* get_row_pointers(const SoftwareSurfacePtr& surface)
+  {
+    row_pointers.resize(surface->get_height());
+    for (int y = 0; y < surface->get_height(); ++y)
+      row_pointers[y] = surface->get_row_data(y);
+    return row_pointers.data();
+  }
+
+  void release_buffer()
+  {
+    if (buffer.capacity() > kMaxRetainedBufferSize)
+    {
+      std::vector<uint8_t>().swap(buffer);
+      buffer.reserve(kOutputBufferSize);
+    }
+  }
+
+  png_bytep* get_image_row_pointers(int height, size_t pitch)
+  {
+    image.resize(pitch * height);
+    row_pointers.resize(height);
+    for (int y = 0; y < height; ++y)
+      row_pointers[y] = image.data() + pitch * y;
+    return row_pointers.data();
+  }
+
+  void release_image()
+  {
+    if (image.capacity() > kMaxRetainedBufferSize)
+    {
+      std::vector<uint8_t>().swap(image);
+    }
+  }
+};
+
+PNGThreadContext& get_thread_context()
+{
+  thread_local PNGThreadContext context;
+  return context;
+}
+
+} // namespace
 
 struct PNGReadMemory
 {
@@ -47,6 +120,73 @@ void readPNGMemory(png_structp png_ptr, png_bytep data, png_size_t length)
   }
 }
 
+namespace {
+
+/** Reads the header and sets up libpng to hand out 8bit RGB or RGBA
+    rows, then passes the rows on to \a sink one at a time. Interlaced
+    images are only complete after the last pass, those are decoded
+    as a whole first. */
+void read_rows(png_structp png_ptr, png_infop info_ptr, ScanlineSink& sink)
+{
+  png_read_info(png_ptr, info_ptr);
+
+  const bool interlaced = (png_get_interlace_type(png_ptr, info_ptr) != PNG_INTERLACE_NONE);
+  if (interlaced)
+  {
+    png_set_interlace_handling(png_ptr);
+  }
+
+  // Convert all formats to either RGB or RGBA so we don't have to
+  // handle them all seperatly
+  png_set_strip_16(png_ptr);
+  png_set_expand_gray_1_2_4_to_8(png_ptr);
+  png_set_palette_to_rgb(png_ptr);
+  png_set_expand(png_ptr);
+  png_set_tRNS_to_alpha(png_ptr);
+  png_set_gray_to_rgb(png_ptr);
+
+  png_read_update_info(png_ptr, info_ptr);
+
+  const Size size(static_cast<int>(png_get_image_width(png_ptr, info_ptr)),
+                  static_cast<int>(png_get_image_height(png_ptr, info_ptr)));
+  const SoftwareSurface::Format format = (png_get_color_type(png_ptr, info_ptr) == PNG_COLOR_TYPE_RGBA)
+    ? SoftwareSurface::RGBA_FORMAT
+    : SoftwareSurface::RGB_FORMAT;
+
+  PNGThreadContext& context = get_thread_context();
+  if (interlaced)
+  {
+    // libpng longjmp()s out of here on errors, which would skip the
+    // destructor of a SoftwareSurfacePtr, so the image is decoded into
+    // the thread's buffer instead
+    png_bytep* rows = context.get_image_row_pointers(size.height, png_get_rowbytes(png_ptr, info_ptr));
+    png_read_image(png_ptr, rows);
+
+    sink.begin(format, size);
+    for(int y = 0; y < size.height; ++y)
+    {
+      sink.add_row(rows[y]);
+    }
+    sink.end();
+
+    context.release_image();
+  }
+  else
+  {
+    context.row.resize(png_get_rowbytes(png_ptr, info_ptr));
+
+    sink.begin(format, size);
+    for(int y = 0; y < size.height; ++y)
+    {
+      png_read_row(png_ptr, context.row.data(), NULL);
+      sink.add_row(context.row.data());
+    }
+    sink.end();
+  }
+}
+
+} // namespace
+
 bool
 PNG::get_size(void* data, int len, Size& size)
 { 
@@ -238,24 +378,14 @@ PNG::load_from_mem(const uint8_t* data, int len)
     case PNG_COLOR_TYPE_RGBA:
     {
       surface = SoftwareSurface::create(SoftwareSurface::RGBA_FORMAT, Size(width, height));
-
-      std::unique_ptr<png_bytep[]> row_pointers(new png_bytep[height]);
-      for (int y = 0; y < height; ++y)
-        row_pointers[y] = surface->get_row_data(y);
-            
-      png_read_image(png_ptr, row_pointers.get());
+      png_read_image(png_ptr, get_thread_context().get_row_pointers(surface));
     }
     break;           
 
     case PNG_COLOR_TYPE_RGB:
     {
       surface = SoftwareSurface::create(SoftwareSurface::RGB_FORMAT, Size(width, height));
-          
-      std::unique_ptr<png_bytep[]> row_pointers(new png_bytep[height]);
-      for (int y = 0; y < height; ++y)
-        row_pointers[y] = surface->get_row_data(y);
-            
-      png_read_image(png_ptr, row_pointers.get());
+      png_read_image(png_ptr, get_thread_context().get_row_pointers(surface));
     }
     break;
   }
@@ -265,6 +395,74 @@ PNG::load_from_mem(const uint8_t* data, int len)
   return surface;
 }
 
+void
+PNG::stream_from_file(const std::string& filename, ScanlineSink& sink)
+{
+  FILE* in = fopen(filename.c_str(), "rb");
+  if (!in)
+  {
+    throw std::runtime_error("PNG::stream_from_file(): Couldn't open " + filename);
+  }
+
+  png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  png_infop info_ptr  = png_create_info_struct(png_ptr);
+
+  if (setjmp(png_jmpbuf(png_ptr)))
+  {
+    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+    fclose(in);
+    throw std::runtime_error("PNG::stream_from_file(): setjmp: Couldn't load " + filename);
+  }
+
+  png_init_io(png_ptr, in);
+
+  try
+  {
+    read_rows(png_ptr, info_ptr, sink);
+  }
+  catch(...)
+  {
+    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+    fclose(in);
+    throw;
+  }
+
+  png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+  fclose(in);
+}
+
+void
+PNG::stream_from_mem(const uint8_t* data, int len, ScanlineSink& sink)
+{
+  png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  png_infop info_ptr  = png_create_info_struct(png_ptr);
+
+  PNGReadMemory png_memory;
+  png_memory.data = data;
+  png_memory.len  = len;
+  png_memory.pos  = 0;
+
+  if (setjmp(png_jmpbuf(png_ptr)))
+  {
+    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+    throw std::runtime_error("PNG::stream_from_mem(): setjmp: Couldn't load from mem");
+  }
+
+  png_set_read_fn(png_ptr, &png_memory, &readPNGMemory);
+
+  try
+  {
+    read_rows(png_ptr, info_ptr, sink);
+  }
+  catch(...)
+  {
+    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+    throw;
+  }
+
+  png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+}
+
 void
 PNG::save(const SoftwareSurfacePtr& surface, const std::string& filename)
 {
@@ -310,20 +508,10 @@ PNG::save(const SoftwareSurfacePtr& surface, const std::string& filename)
   }
 }
 
-class PNGWriteMemory
-{
-public:
-  std::vector<uint8_t> data;
-
-  PNGWriteMemory() :
-    data()
-  {}
-};
-
 void writePNGMemory(png_structp png_ptr, png_bytep data, png_size_t length)
 {
-  PNGWriteMemory* mem = static_cast<PNGWriteMemory*>(png_get_io_ptr(png_ptr));
-  std::copy(data, data+length, std::back_inserter(mem->data));
+  std::vector<uint8_t>* mem = static_cast<std::vector<uint8_t>*>(png_get_io_ptr(png_ptr));
+  mem->insert(mem->end(), data, data + length);
 }
 
 BlobPtr
@@ -340,8 +528,9 @@ PNG::save(const SoftwareSurfacePtr& surface)
     throw std::runtime_error("PNG::save(): setjmp: Couldn't save to Blob");
   }
 
-  PNGWriteMemory mem;
-  png_set_write_fn(png_ptr, &mem, &writePNGMemory, NULL);
+  PNGThreadContext& context = get_thread_context();
+  context.buffer.clear();
+  png_set_write_fn(png_ptr, &context.buffer, &writePNGMemory, NULL);
 
   png_set_IHDR(png_ptr, info_ptr, 
                surface->get_width(), surface->get_height(), 8,
@@ -359,7 +548,10 @@ PNG::save(const SoftwareSurfacePtr& surface)
 
   png_destroy_write_struct(&png_ptr, &info_ptr);
 
-  return Blob::copy(mem.data);
+  BlobPtr blob = Blob::copy(context.buffer);
+  context.release_buffer();
+
+  return blob;
 }
 
 
@@ -22,6 +22,7 @@
 #include <string>
 
 #include "math/size.hpp"
+#include "util/scanline_sink.hpp"
 #include "util/software_surface.hpp"
 
 class PNG
@@ -34,6 +35,11 @@ public:
   static SoftwareSurfacePtr load_from_file(const std::string& filename);
   static SoftwareSurfacePtr load_from_mem(const uint8_t* data, int len);
 
+  /** Decode the PNG row by row into \a sink, only interlaced PNGs
+      are held in memory as a whole */
+  static void stream_from_file(const std::string& filename, ScanlineSink& sink);
+  static void stream_from_mem(const uint8_t* data, int len, ScanlineSink& sink);
+
   static void save(const SoftwareSurfacePtr& surface, const std::string& filename);
   static BlobPtr save(const SoftwareSurfacePtr& surface);
 };
@@ -0,0 +1,302 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "plugins/qoi.hpp"
+
+#include <stdexcept>
+#include <string.h>
+#include <vector>
+
+#include "math/size.hpp"
+
+namespace {
+
+const uint8_t QOI_OP_INDEX = 0x00;
+const uint8_t QOI_OP_DIFF  = 0x40;
+const uint8_t QOI_OP_LUMA  = 0x80;
+const uint8_t QOI_OP_RUN   = 0xc0;
+const uint8_t QOI_OP_RGB   = 0xfe;
+const uint8_t QOI_OP_RGBA  = 0xff;
+const uint8_t QOI_MASK_2   = 0xc0;
+
+const int QOI_HEADER_SIZE = 14;
+const uint8_t qoi_padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+struct Pixel
+{
+  uint8_t r, g, b, a;
+
+  bool operator==(const Pixel& rhs) const
+  {
+    return r == rhs.r && g == rhs.g && b == rhs.b && a == rhs.a;
+  }
+
+  bool operator!=(const Pixel& rhs) const
+  {
+    return !(*this == rhs);
+  }
+};
+
+inline int qoi_hash(const Pixel& px)
+{
+  return (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64;
+}
+
+inline void write_32(uint8_t*& p, uint32_t v)
+{
+  *p++ = static_cast<uint8_t>(v >> 24);
+  *p++ = static_cast<uint8_t>(v >> 16);
+  *p++ = static_cast<uint8_t>(v >>  8);
+  *p++ = static_cast<uint8_t>(v >>  0);
+}
+
+inline uint32_t read_32(const uint8_t* p)
+{
+  return
+    (static_cast<uint32_t>(p[0]) << 24) |
+    (static_cast<uint32_t>(p[1]) << 16) |
+    (static_cast<uint32_t>(p[2]) <<  8) |
+    (static_cast<uint32_t>(p[3]) <<  0);
+}
+
+} // namespace
+
+bool
+QOI::is_qoi(const uint8_t* data, int len)
+{
+  return len >= QOI_HEADER_SIZE && memcmp(data, "qoif", 4) == 0;
+}
+
+SoftwareSurfacePtr
+QOI::load_from_mem(const uint8_t* data, int len)
+{
+  if (!is_qoi(data, len))
+  {
+    throw std::runtime_error("QOI::load_from_mem(): not a QOI image");
+  }
+
+  const int width    = static_cast<int>(read_32(data + 4));
+  const int height   = static_cast<int>(read_32(data + 8));
+  const int channels = data[12];
+
+  if (width <= 0 || height <= 0 || (channels != 3 && channels != 4))
+  {
+    throw std::runtime_error("QOI::load_from_mem(): invalid header");
+  }
+
+  SoftwareSurfacePtr surface = SoftwareSurface::create(channels == 4
+                                                       ? SoftwareSurface::RGBA_FORMAT
+                                                       : SoftwareSurface::RGB_FORMAT,
+                                                       Size(width, height));
+
+  Pixel index[64];
+  memset(index, 0, sizeof(index));
+
+  Pixel px = { 0, 0, 0, 255 };
+  int run = 0;
+
+  const uint8_t* p   = data + QOI_HEADER_SIZE;
+  const uint8_t* end = data + len - sizeof(qoi_padding);
+
+  uint8_t* out = surface->get_data();
+  const int px_len = width * height;
+  for(int i = 0; i < px_len; ++i)
+  {
+    if (run > 0)
+    {
+      run -= 1;
+    }
+    else
+    {
+      if (p >= end)
+      {
+        throw std::runtime_error("QOI::load_from_mem(): unexpected end of data");
+      }
+
+      const uint8_t b1 = *p++;
+      if (b1 == QOI_OP_RGB)
+      {
+        if (end - p < 3)
+          throw std::runtime_error("QOI::load_from_mem(): unexpected end of data");
+        px.r = *p++;
+        px.g = *p++;
+        px.b = *p++;
+      }
+      else if (b1 == QOI_OP_RGBA)
+      {
+        if (end - p < 4)
+          throw std::runtime_error("QOI::load_from_mem(): unexpected end of data");
+        px.r = *p++;
+        px.g = *p++;
+        px.b = *p++;
+        px.a = *p++;
+      }
+      else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX)
+      {
+        px = index[b1];
+      }
+      else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF)
+      {
+        px.r = static_cast<uint8_t>(px.r + ((b1 >> 4) & 0x03) - 2);
+        px.g = static_cast<uint8_t>(px.g + ((b1 >> 2) & 0x03) - 2);
+        px.b = static_cast<uint8_t>(px.b + ((b1 >> 0) & 0x03) - 2);
+      }
+      else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA)
+      {
+        if (p >= end)
+          throw std::runtime_error("QOI::load_from_mem(): unexpected end of data");
+        const uint8_t b2 = *p++;
+        const int vg = (b1 & 0x3f) - 32;
+        px.r = static_cast<uint8_t>(px.r + vg - 8 + ((b2 >> 4) & 0x0f));
+        px.g = static_cast<uint8_t>(px.g + vg);
+        px.b = static_cast<uint8_t>(px.b + vg - 8 + ((b2 >> 0) & 0x0f));
+      }
+      else // QOI_OP_RUN
+      {
+        run = b1 & 0x3f;
+      }
+
+      index[qoi_hash(px)] = px;
+    }
+
+    *out++ = px.r;
+    *out++ = px.g;
+    *out++ = px.b;
+    if (channels == 4)
+    {
+      *out++ = px.a;
+    }
+  }
+
+  return surface;
+}
+
+BlobPtr
+QOI::save(const SoftwareSurfacePtr& surface)
+{
+  const int width    = surface->get_width();
+  const int height   = surface->get_height();
+  const int channels = surface->get_bytes_per_pixel();
+  const int px_len   = width * height;
+
+  // worst case: every pixel needs a full QOI_OP_RGB(A) chunk
+  std::vector<uint8_t> data(QOI_HEADER_SIZE + px_len * (channels + 1) + sizeof(qoi_padding));
+  uint8_t* p = data.data();
+
+  memcpy(p, "qoif", 4);
+  p += 4;
+  write_32(p, width);
+  write_32(p, height);
+  *p++ = static_cast<uint8_t>(channels);
+  *p++ = 0; // sRGB with linear alpha
+
+  Pixel index[64];
+  memset(index, 0, sizeof(index));
+
+  Pixel px_prev = { 0, 0, 0, 255 };
+  Pixel px = px_prev;
+  int run = 0;
+
+  const uint8_t* in = surface->get_data();
+  for(int i = 0; i < px_len; ++i)
+  {
+    px.r = *in++;
+    px.g = *in++;
+    px.b = *in++;
+    if (channels == 4)
+    {
+      px.a = *in++;
+    }
+
+    if (px == px_prev)
+    {
+      run += 1;
+      if (run == 62 || i == px_len - 1)
+      {
+        *p++ = static_cast<uint8_t>(QOI_OP_RUN | (run - 1));
+        run = 0;
+      }
+    }
+    else
+    {
+      if (run > 0)
+      {
+        *p++ = static_cast<uint8_t>(QOI_OP_RUN | (run - 1));
+        run = 0;
+      }
+
+      const int idx = qoi_hash(px);
+      if (index[idx] == px)
+      {
+        *p++ = static_cast<uint8_t>(QOI_OP_INDEX | idx);
+      }
+      else
+      {
+        index[idx] = px;
+
+        if (px.a == px_prev.a)
+        {
+          const int vr = static_cast<int8_t>(px.r - px_prev.r);
+          const int vg = static_cast<int8_t>(px.g - px_prev.g);
+          const int vb = static_cast<int8_t>(px.b - px_prev.b);
+
+          const int vg_r = vr - vg;
+          const int vg_b = vb - vg;
+
+          if (vr > -3 && vr < 2 &&
+              vg > -3 && vg < 2 &&
+              vb > -3 && vb < 2)
+          {
+            *p++ = static_cast<uint8_t>(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+          }
+          else if (vg_r >  -9 && vg_r <  8 &&
+                   vg   > -33 && vg   < 32 &&
+                   vg_b >  -9 && vg_b <  8)
+          {
+            *p++ = static_cast<uint8_t>(QOI_OP_LUMA | (vg + 32));
+            *p++ = static_cast<uint8_t>((vg_r + 8) << 4 | (vg_b + 8));
+          }
+          else
+          {
+            *p++ = QOI_OP_RGB;
+            *p++ = px.r;
+            *p++ = px.g;
+            *p++ = px.b;
+          }
+        }
+        else
+        {
+          *p++ = QOI_OP_RGBA;
+          *p++ = px.r;
+          *p++ = px.g;
+          *p++ = px.b;
+          *p++ = px.a;
+        }
+      }
+    }
+
+    px_prev = px;
+  }
+
+  memcpy(p, qoi_padding, sizeof(qoi_padding));
+  p += sizeof(qoi_padding);
+
+  return Blob::copy(data.data(), static_cast<int>(p - data.data()));
+}
+
+/* EOF */
@@ -0,0 +1,44 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_PLUGINS_QOI_HPP
+#define HEADER_GALAPIX_PLUGINS_QOI_HPP
+
+#include <stdint.h>
+
+#include "util/software_surface.hpp"
+
+/** Minimal implementation of the "Quite OK Image" format, a lossless
+    format that encodes and decodes an order of magnitude faster than
+    PNG at a moderately larger size, see http://qoiformat.org/ */
+class QOI
+{
+public:
+  static bool is_qoi(const uint8_t* data, int len);
+
+  static SoftwareSurfacePtr load_from_mem(const uint8_t* data, int len);
+  static BlobPtr save(const SoftwareSurfacePtr& surface);
+
+private:
+  QOI(const QOI&);
+  QOI& operator=(const QOI&);
+};
+
+#endif
+
+/* EOF */
@@ -405,6 +405,10 @@ SDLViewer::process_event(const SDL_Event& event)
           m_viewer.toggle_trackball_mode();
           break;
 
+        case SDLK_o:
+          m_viewer.toggle_stats_overlay();
+          break;
+
         case SDLK_UP:
         case SDLK_DOWN:
           m_viewer.reset_view_rotation();
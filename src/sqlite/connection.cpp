@@ -29,6 +29,16 @@ static int busy_callback(void* , int)
   usleep(1000*10);
   return 1;
 }
+
+static int collect_rows_callback(void* data, int argc, char** argv, char** )
+{
+  std::vector<std::string>& rows = *static_cast<std::vector<std::string>*>(data);
+  for(int i = 0; i < argc; ++i)
+  {
+    rows.push_back(argv[i] ? argv[i] : "");
+  }
+  return 0;
+}
 
 SQLiteConnection::SQLiteConnection(const std::string& filename)
   : db(0)
@@ -78,6 +88,36 @@ void
 SQLiteConnection::vacuum()
 {
   exec("VACUUM;");
+  // in WAL mode the vacuumed copy would otherwise linger in the log
+  exec("PRAGMA wal_checkpoint(TRUNCATE);");
+}
+
+bool
+SQLiteConnection::integrity_check(std::vector<std::string>& errors_out)
+{
+  std::vector<std::string> rows;
+  char* errmsg;
+
+  if (sqlite3_exec(db, "PRAGMA integrity_check;", &collect_rows_callback, &rows, &errmsg) != SQLITE_OK)
+  {
+    std::ostringstream out;
+    out << "SQLiteConnection::integrity_check(): " << errmsg;
+
+    sqlite3_free(errmsg);
+    errmsg = 0;
+
+    throw SQLiteError(out.str());
+  }
+
+  if (rows.size() == 1 && rows[0] == "ok")
+  {
+    return true;
+  }
+  else
+  {
+    errors_out.insert(errors_out.end(), rows.begin(), rows.end());
+    return false;
+  }
 }
 
 std::string
@@ -21,6 +21,7 @@
 
 #include <sqlite3.h>
 #include <string>
+#include <vector>
 
 class SQLiteConnection
 {
@@ -37,6 +38,10 @@ public:
       call can take quite a while (~1min) for larger databases, since
       the whole database gets copied in the process */
   void vacuum();
+
+  /** Runs "PRAGMA integrity_check", returns true if the database is
+      fine, otherwise the problems found are placed in \a errors_out */
+  bool integrity_check(std::vector<std::string>& errors_out);
   
   std::string get_error_msg();
 
@@ -39,6 +39,7 @@ protected:
   
 public:
   static C& current() { assert(s_current); return *s_current; }
+  static bool has_current() { return s_current != 0; }
 };
 
 template<class C> C* Currenton<C>::s_current = 0;
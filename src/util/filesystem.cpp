@@ -298,6 +298,45 @@ Filesystem::get_size(const std::string& filename)
   return stat_buf.st_size; // Is this reliable? or should be use fopen() and ftell()?
 }
 
+bool
+Filesystem::has_same_content(const std::string& lhs, const std::string& rhs)
+{
+  if (get_size(lhs) != get_size(rhs))
+  {
+    return false;
+  }
+
+  std::ifstream lhs_in(lhs, std::ios::binary);
+  if (!lhs_in)
+  {
+    raise_exception(std::runtime_error, lhs << ": " << strerror(errno));
+  }
+
+  std::ifstream rhs_in(rhs, std::ios::binary);
+  if (!rhs_in)
+  {
+    raise_exception(std::runtime_error, rhs << ": " << strerror(errno));
+  }
+
+  std::vector<char> lhs_buf(64 * 1024);
+  std::vector<char> rhs_buf(lhs_buf.size());
+  while(true)
+  {
+    lhs_in.read(lhs_buf.data(), lhs_buf.size());
+    rhs_in.read(rhs_buf.data(), rhs_buf.size());
+
+    std::streamsize len = lhs_in.gcount();
+    if (len != rhs_in.gcount() || memcmp(lhs_buf.data(), rhs_buf.data(), len) != 0)
+    {
+      return false;
+    }
+    else if (len == 0)
+    {
+      return true;
+    }
+  }
+}
+
 unsigned int
 Filesystem::get_mtime(const std::string& filename)
 {
@@ -56,6 +56,10 @@ public:
 
   static unsigned int get_mtime(const std::string& filename);
   static unsigned int get_size(const std::string& filename);
+
+  /** Compares the sizes of both files and then their content chunk
+      by chunk, so that neither file has to be in memory as a whole */
+  static bool has_same_content(const std::string& lhs, const std::string& rhs);
   
   /** Generate a recursive list of all images in pathname */
   static void generate_image_file_list(const std::string& pathname, std::vector<URL>& file_list);
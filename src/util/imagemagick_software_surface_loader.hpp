@@ -58,6 +58,18 @@ public:
     return Imagemagick::load_from_mem(data, len);
   }
 
+  bool supports_streaming() const { return true; }
+
+  void stream_from_file(const std::string& filename, ScanlineSink& sink) const
+  {
+    Imagemagick::stream_from_file(filename, sink);
+  }
+
+  void stream_from_mem(uint8_t* data, int len, ScanlineSink& sink) const
+  {
+    Imagemagick::stream_from_mem(data, len, sink);
+  }
+
 private:
   ImagemagickSoftwareSurfaceLoader(const ImagemagickSoftwareSurfaceLoader&);
   ImagemagickSoftwareSurfaceLoader& operator=(const ImagemagickSoftwareSurfaceLoader&);
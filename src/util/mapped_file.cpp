@@ -0,0 +1,75 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "util/mapped_file.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& filename, Access access) :
+  m_fd(-1),
+  m_data(0),
+  m_size(0)
+{
+  m_fd = open(filename.c_str(), O_RDONLY);
+  if (m_fd < 0)
+  {
+    throw std::runtime_error("MappedFile: " + filename + ": " + strerror(errno));
+  }
+
+  struct stat st;
+  if (fstat(m_fd, &st) < 0)
+  {
+    const int err = errno;
+    close(m_fd);
+    throw std::runtime_error("MappedFile: " + filename + ": " + strerror(err));
+  }
+
+  m_size = static_cast<size_t>(st.st_size);
+
+  // mmap() refuses zero sized mappings, an empty file is simply no data
+  if (m_size > 0)
+  {
+    void* data = mmap(0, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (data == MAP_FAILED)
+    {
+      const int err = errno;
+      close(m_fd);
+      throw std::runtime_error("MappedFile: " + filename + ": " + strerror(err));
+    }
+    m_data = static_cast<uint8_t*>(data);
+
+    madvise(m_data, m_size, access == kSequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+  }
+}
+
+MappedFile::~MappedFile()
+{
+  if (m_data)
+  {
+    munmap(m_data, m_size);
+  }
+  close(m_fd);
+}
+
+/* EOF */
@@ -0,0 +1,54 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_UTIL_MAPPED_FILE_HPP
+#define HEADER_GALAPIX_UTIL_MAPPED_FILE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/** A read-only memory mapping of a whole file, the mapping is
+    released when the object is destroyed */
+class MappedFile
+{
+private:
+  int m_fd;
+  uint8_t* m_data;
+  size_t m_size;
+
+public:
+  enum Access { kSequential, kRandom };
+
+public:
+  /** Throws std::runtime_error if the file can't be opened or mapped,
+      \a access is passed on to the kernel as read ahead hint */
+  MappedFile(const std::string& filename, Access access = kSequential);
+  ~MappedFile();
+
+  const uint8_t* get_data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+};
+
+#endif
+
+/* EOF */
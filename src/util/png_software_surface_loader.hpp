@@ -56,6 +56,18 @@ public:
     return PNG::load_from_mem(data, len);
   }
 
+  bool supports_streaming() const { return true; }
+
+  void stream_from_file(const std::string& filename, ScanlineSink& sink) const
+  {
+    PNG::stream_from_file(filename, sink);
+  }
+
+  void stream_from_mem(uint8_t* data, int len, ScanlineSink& sink) const
+  {
+    PNG::stream_from_mem(data, len, sink);
+  }
+
 private:
   PNGSoftwareSurfaceLoader(const PNGSoftwareSurfaceLoader&);
   PNGSoftwareSurfaceLoader& operator=(const PNGSoftwareSurfaceLoader&);
@@ -0,0 +1,62 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_UTIL_SCANLINE_SINK_HPP
+#define HEADER_GALAPIX_UTIL_SCANLINE_SINK_HPP
+
+#include "math/size.hpp"
+#include "util/software_surface.hpp"
+
+/** Receives an image row by row from top to bottom, so that decoders
+    can hand out the image without ever holding all of it in memory */
+class ScanlineSink
+{
+public:
+  ScanlineSink() {}
+  virtual ~ScanlineSink() {}
+
+  /** Called once before the first row */
+  virtual void begin(SoftwareSurface::Format format, const Size& size) =0;
+
+  /** \a row holds size.width pixels in the format given to begin(),
+      it is only valid for the duration of the call */
+  virtual void add_row(const uint8_t* row) =0;
+
+  /** Called after the last row */
+  virtual void end() =0;
+
+  /** Passes a complete surface on row by row, for decoders that
+      can't do any better */
+  void write_surface(const SoftwareSurfacePtr& surface)
+  {
+    begin(surface->get_format(), surface->get_size());
+    for(int y = 0; y < surface->get_height(); ++y)
+    {
+      add_row(surface->get_row_data(y));
+    }
+    end();
+  }
+
+private:
+  ScanlineSink(const ScanlineSink&);
+  ScanlineSink& operator=(const ScanlineSink&);
+};
+
+#endif
+
+/* EOF */
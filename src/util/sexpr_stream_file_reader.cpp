@@ -0,0 +1,376 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "util/sexpr_stream_file_reader.hpp"
+
+#include <stdexcept>
+#include <string.h>
+
+#include "math/rect.hpp"
+#include "math/rgba.hpp"
+#include "math/vector3f.hpp"
+#include "util/file_reader_impl.hpp"
+#include "util/mapped_file.hpp"
+#include "util/sexpr_tokenizer.hpp"
+
+namespace {
+
+/** A list in the buffer, begin is right behind its '(' and end is at
+    its ')' */
+struct Span
+{
+  const char* begin;
+  const char* end;
+  int line;
+
+  Span(const char* begin_, const char* end_, int line_) :
+    begin(begin_),
+    end(end_),
+    line(line_)
+  {}
+};
+
+class SExprStreamFileReaderImpl : public FileReaderImpl
+{
+private:
+  std::shared_ptr<MappedFile> m_file;
+  Span m_span;
+  std::string m_name;
+
+  struct Child
+  {
+    Span span;
+    const char* name_begin;
+    size_t name_length;
+
+    Child(const Span& span_, const char* name_begin_, size_t name_length_) :
+      span(span_),
+      name_begin(name_begin_),
+      name_length(name_length_)
+    {}
+  };
+
+  std::vector<Child> m_children;
+
+public:
+  SExprStreamFileReaderImpl(std::shared_ptr<MappedFile> file, const Span& span) :
+    m_file(file),
+    m_span(span),
+    m_name(),
+    m_children()
+  {
+    // most sections only have a handful of entries, avoid regrowing
+    m_children.reserve(8);
+
+    SExprTokenizer tokenizer(m_span.begin, m_span.end, m_span.line);
+
+    if (tokenizer.next() == SExprTokenizer::TOKEN_SYMBOL)
+    {
+      m_name = tokenizer.get_string();
+    }
+
+    // remember where the sublists are, everything else on this level
+    // isn't reachable through the FileReader interface anyway
+    while(tokenizer.get_type() != SExprTokenizer::TOKEN_EOF)
+    {
+      if (tokenizer.get_type() == SExprTokenizer::TOKEN_OPEN_PAREN)
+      {
+        const char* begin = tokenizer.get_pos();
+        const int line = tokenizer.get_line_number();
+
+        const char* name_begin = 0;
+        size_t name_length = 0;
+        if (tokenizer.next() == SExprTokenizer::TOKEN_SYMBOL)
+        {
+          name_begin  = tokenizer.get_begin();
+          name_length = tokenizer.get_length();
+        }
+
+        if (tokenizer.get_type() != SExprTokenizer::TOKEN_CLOSE_PAREN)
+        {
+          if (tokenizer.get_type() == SExprTokenizer::TOKEN_OPEN_PAREN)
+            tokenizer.skip_list();
+          tokenizer.skip_list();
+        }
+
+        m_children.push_back(Child(Span(begin, tokenizer.get_begin(), line), name_begin, name_length));
+      }
+      tokenizer.next();
+    }
+  }
+
+  std::string get_name() const 
+  {
+    return m_name;
+  }
+
+  bool read_int(const char* name, int& v) const 
+  {
+    return read_values(name, [&](const SExprTokenizer& t, int) -> bool {
+        if (t.get_type() == SExprTokenizer::TOKEN_INTEGER)
+        {
+          v = t.get_int();
+          return true;
+        }
+        return false;
+      }, 1);
+  }
+
+  bool read_float(const char* name, float& v) const 
+  {
+    return read_values(name, [&](const SExprTokenizer& t, int) -> bool {
+        return read_number(t, v);
+      }, 1);
+  }
+
+  bool read_bool(const char* name, bool& v) const 
+  {
+    return read_values(name, [&](const SExprTokenizer& t, int) -> bool {
+        switch(t.get_type())
+        {
+          case SExprTokenizer::TOKEN_TRUE:    v = true;  return true;
+          case SExprTokenizer::TOKEN_FALSE:   v = false; return true;
+          case SExprTokenizer::TOKEN_INTEGER: v = t.get_int() != 0; return true;
+          default: return false;
+        }
+      }, 1);
+  }
+
+  bool read_string(const char* name, std::string& v) const 
+  {
+    const Child* child = find_child(name);
+    if (child)
+    {
+      v = "";
+      SExprTokenizer tokenizer(child->span.begin, child->span.end, child->span.line);
+      tokenizer.next(); // name
+      while(tokenizer.next() != SExprTokenizer::TOKEN_EOF)
+      {
+        if (tokenizer.get_type() == SExprTokenizer::TOKEN_STRING ||
+            tokenizer.get_type() == SExprTokenizer::TOKEN_SYMBOL)
+        {
+          v += tokenizer.get_string();
+        }
+        else if (tokenizer.get_type() == SExprTokenizer::TOKEN_OPEN_PAREN)
+        {
+          tokenizer.skip_list();
+        }
+      }
+      return true;
+    }
+    return false;
+  }
+
+  bool read_vector(const char* name, Vector3f& v) const
+  {
+    float values[3];
+    if (read_floats(name, values, 3))
+    {
+      v = Vector3f(values[0], values[1], values[2]);
+      return true;
+    }
+    return false;
+  }
+
+  bool read_size(const char* name, Size& v) const
+  {
+    float values[2];
+    if (read_floats(name, values, 2))
+    {
+      v.width  = static_cast<int>(values[0]);
+      v.height = static_cast<int>(values[1]);
+      return true;
+    }
+    return false;
+  }
+
+  bool read_vector2i(const char* name, Vector2i& v) const
+  {
+    float values[2];
+    if (read_floats(name, values, 2))
+    {
+      v.x = static_cast<int>(values[0]);
+      v.y = static_cast<int>(values[1]);
+      return true;
+    }
+    return false;
+  }
+
+  bool read_vector2f(const char* name, Vector2f& v) const
+  {
+    float values[2];
+    if (read_floats(name, values, 2))
+    {
+      v.x = values[0];
+      v.y = values[1];
+      return true;
+    }
+    return false;
+  }
+
+  bool read_rect(const char* name, Rect& rect) const
+  {
+    float values[4];
+    if (read_floats(name, values, 4))
+    {
+      rect.left   = static_cast<int>(values[0]);
+      rect.top    = static_cast<int>(values[1]);
+      rect.right  = static_cast<int>(values[2]);
+      rect.bottom = static_cast<int>(values[3]);
+      return true;
+    }
+    return false;
+  }
+
+  bool read_rgba(const char* name, RGBA& v) const
+  {
+    float values[4];
+    if (read_floats(name, values, 4))
+    {
+      v = RGBA(static_cast<uint8_t>(values[0] * 255),
+               static_cast<uint8_t>(values[1] * 255),
+               static_cast<uint8_t>(values[2] * 255),
+               static_cast<uint8_t>(values[3] * 255));
+      return true;
+    }
+    return false;
+  }
+
+  bool read_section(const char* name, FileReader& v) const 
+  {
+    const Child* child = find_child(name);
+    if (child)
+    {
+      v = FileReader(std::shared_ptr<FileReaderImpl>(new SExprStreamFileReaderImpl(m_file, child->span)));
+      return true;
+    }
+    return false;
+  }
+
+  std::vector<FileReader> get_sections() const 
+  {
+    std::vector<FileReader> lst;
+    lst.reserve(m_children.size());
+    for(std::vector<Child>::const_iterator i = m_children.begin(); i != m_children.end(); ++i)
+    {
+      lst.push_back(FileReader(std::shared_ptr<FileReaderImpl>(new SExprStreamFileReaderImpl(m_file, i->span))));
+    }
+    return lst;
+  }
+
+  std::vector<std::string> get_section_names() const 
+  {
+    std::vector<std::string> lst;
+    for(std::vector<Child>::const_iterator i = m_children.begin(); i != m_children.end(); ++i)
+    {
+      lst.push_back(std::string(i->name_begin, i->name_length));
+    }
+    return lst;
+  }
+
+private:
+  const Child* find_child(const char* name) const
+  {
+    const size_t len = strlen(name);
+    for(std::vector<Child>::const_iterator i = m_children.begin(); i != m_children.end(); ++i)
+    {
+      if (i->name_length == len && memcmp(i->name_begin, name, len) == 0)
+        return &*i;
+    }
+    return 0;
+  }
+
+  static bool read_number(const SExprTokenizer& t, float& v)
+  {
+    if (t.get_type() == SExprTokenizer::TOKEN_REAL)
+    {
+      v = t.get_float();
+      return true;
+    }
+    else if (t.get_type() == SExprTokenizer::TOKEN_INTEGER)
+    {
+      v = static_cast<float>(t.get_int());
+      return true;
+    }
+    return false;
+  }
+
+  /** Calls \a func for each value of the section \a name, fails unless
+      there are exactly \a count values and \a func accepts them all */
+  template<typename Func>
+  bool read_values(const char* name, Func func, int count) const
+  {
+    const Child* child = find_child(name);
+    if (!child)
+      return false;
+
+    SExprTokenizer tokenizer(child->span.begin, child->span.end, child->span.line);
+    tokenizer.next(); // name
+
+    int i = 0;
+    while(tokenizer.next() != SExprTokenizer::TOKEN_EOF)
+    {
+      if (i >= count || !func(tokenizer, i))
+        return false;
+      ++i;
+    }
+    return i == count;
+  }
+
+  bool read_floats(const char* name, float* values, int count) const
+  {
+    return read_values(name, [values](const SExprTokenizer& t, int i) -> bool {
+        return read_number(t, values[i]);
+      }, count);
+  }
+
+private:
+  SExprStreamFileReaderImpl(const SExprStreamFileReaderImpl&);
+  SExprStreamFileReaderImpl& operator=(const SExprStreamFileReaderImpl&);
+};
+
+} // namespace
+
+FileReader
+SExprStreamFileReader::parse(const std::string& filename)
+{
+  std::shared_ptr<MappedFile> file(new MappedFile(filename));
+
+  const char* begin = reinterpret_cast<const char*>(file->get_data());
+  const char* end   = begin + file->size();
+
+  SExprTokenizer tokenizer(begin, end);
+  if (tokenizer.next() != SExprTokenizer::TOKEN_OPEN_PAREN)
+  {
+    throw std::runtime_error("SExprStreamFileReader::parse(): " + filename + ": file doesn't start with '('");
+  }
+
+  const char* root_begin = tokenizer.get_pos();
+  const int   root_line  = tokenizer.get_line_number();
+  tokenizer.skip_list();
+  const char* root_end = tokenizer.get_begin();
+
+  if (tokenizer.next() != SExprTokenizer::TOKEN_EOF)
+  {
+    throw std::runtime_error("SExprStreamFileReader::parse(): " + filename + ": extra tokens at end of file");
+  }
+
+  return FileReader(std::shared_ptr<FileReaderImpl>(new SExprStreamFileReaderImpl(file, Span(root_begin, root_end, root_line))));
+}
+
+/* EOF */
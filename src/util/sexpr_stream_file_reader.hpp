@@ -0,0 +1,41 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_UTIL_SEXPR_STREAM_FILE_READER_HPP
+#define HEADER_GALAPIX_UTIL_SEXPR_STREAM_FILE_READER_HPP
+
+#include <string>
+
+#include "util/file_reader.hpp"
+
+/** FileReader for large s-expression documents. The file is mmapped
+    and each section only remembers where its children are in the
+    buffer, values are tokenized on demand, so no lisp::Lisp tree is
+    ever built. For small config files FileReader::parse() is just as
+    good. */
+class SExprStreamFileReader : public FileReader
+{
+public:
+  /** Throws std::runtime_error if the file can't be read or isn't a
+      well formed s-expression */
+  static FileReader parse(const std::string& filename);
+};
+
+#endif
+
+/* EOF */
@@ -0,0 +1,298 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "util/sexpr_tokenizer.hpp"
+
+#include <algorithm>
+#include <ctype.h>
+#include <sstream>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+bool is_delimiter(char c)
+{
+  return isspace(static_cast<unsigned char>(c)) || c == '"' || c == '(' || c == ')' || c == ';';
+}
+
+} // namespace
+
+SExprTokenizer::SExprTokenizer(const char* begin, const char* end, int line) :
+  m_pos(begin),
+  m_end(end),
+  m_line(line),
+  m_type(TOKEN_EOF),
+  m_token_begin(begin),
+  m_token_end(begin),
+  m_escaped(false)
+{
+}
+
+void
+SExprTokenizer::error(const char* message) const
+{
+  std::ostringstream msg;
+  msg << "Parse error in line " << m_line << ": " << message;
+  throw std::runtime_error(msg.str());
+}
+
+SExprTokenizer::TokenType
+SExprTokenizer::next()
+{
+  // skip whitespace and comments
+  while(m_pos != m_end)
+  {
+    if (*m_pos == '\n')
+    {
+      ++m_line;
+      ++m_pos;
+    }
+    else if (isspace(static_cast<unsigned char>(*m_pos)))
+    {
+      ++m_pos;
+    }
+    else if (*m_pos == ';')
+    {
+      while(m_pos != m_end && *m_pos != '\n')
+        ++m_pos;
+    }
+    else
+    {
+      break;
+    }
+  }
+
+  m_escaped = false;
+  m_token_begin = m_pos;
+
+  if (m_pos == m_end)
+  {
+    m_token_end = m_pos;
+    return (m_type = TOKEN_EOF);
+  }
+
+  switch(*m_pos)
+  {
+    case '(':
+      m_token_end = ++m_pos;
+      return (m_type = TOKEN_OPEN_PAREN);
+
+    case ')':
+      m_token_end = ++m_pos;
+      return (m_type = TOKEN_CLOSE_PAREN);
+
+    case '"':
+    {
+      ++m_pos;
+      m_token_begin = m_pos;
+      while(true)
+      {
+        if (m_pos == m_end)
+        {
+          error("EOF while parsing string.");
+        }
+        else if (*m_pos == '"')
+        {
+          break;
+        }
+        else if (*m_pos == '\\')
+        {
+          m_escaped = true;
+          ++m_pos;
+          if (m_pos == m_end)
+            error("EOF while parsing string.");
+        }
+
+        if (*m_pos == '\n')
+          ++m_line;
+        ++m_pos;
+      }
+      m_token_end = m_pos;
+      ++m_pos;
+      return (m_type = TOKEN_STRING);
+    }
+
+    case '#':
+    {
+      ++m_pos;
+      m_token_begin = m_pos;
+      while(m_pos != m_end && (isalnum(static_cast<unsigned char>(*m_pos)) || *m_pos == '_'))
+        ++m_pos;
+      m_token_end = m_pos;
+
+      if (equals("t"))
+        return (m_type = TOKEN_TRUE);
+      if (equals("f"))
+        return (m_type = TOKEN_FALSE);
+
+      // we only handle #t and #f constants at the moment...
+      error("Unknown constant.");
+      return (m_type = TOKEN_EOF);
+    }
+
+    default:
+    {
+      bool have_nondigits = false;
+      bool have_digits = false;
+      int have_floating_point = 0;
+      const bool numeric = isdigit(static_cast<unsigned char>(*m_pos)) || *m_pos == '-' || *m_pos == '.';
+
+      do
+      {
+        const unsigned char c = static_cast<unsigned char>(*m_pos);
+        if (isdigit(c))
+          have_digits = true;
+        else if (c == '.')
+          ++have_floating_point;
+        else if (isalnum(c) || c == '_')
+          have_nondigits = true;
+        ++m_pos;
+      }
+      while(m_pos != m_end && !is_delimiter(*m_pos));
+
+      m_token_end = m_pos;
+
+      if (!numeric || have_nondigits || !have_digits || have_floating_point > 1)
+        return (m_type = TOKEN_SYMBOL);
+      else if (have_floating_point == 1)
+        return (m_type = TOKEN_REAL);
+      else
+        return (m_type = TOKEN_INTEGER);
+    }
+  }
+}
+
+void
+SExprTokenizer::skip_list()
+{
+  // only parentheses, strings and comments matter here, so this runs
+  // over the raw characters instead of classifying every token
+  int depth = 1;
+  while(m_pos != m_end)
+  {
+    switch(*m_pos++)
+    {
+      case '(':
+        ++depth;
+        break;
+
+      case ')':
+        if (--depth == 0)
+        {
+          m_escaped = false;
+          m_token_begin = m_pos - 1;
+          m_token_end = m_pos;
+          m_type = TOKEN_CLOSE_PAREN;
+          return;
+        }
+        break;
+
+      case '"':
+        while(m_pos != m_end && *m_pos != '"')
+        {
+          if (*m_pos == '\\' && m_pos+1 != m_end)
+            ++m_pos;
+          if (*m_pos == '\n')
+            ++m_line;
+          ++m_pos;
+        }
+        if (m_pos == m_end)
+          error("EOF while parsing string.");
+        ++m_pos;
+        break;
+
+      case ';':
+        while(m_pos != m_end && *m_pos != '\n')
+          ++m_pos;
+        break;
+
+      case '\n':
+        ++m_line;
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  error("Expected ')' token, got EOF");
+}
+
+bool
+SExprTokenizer::equals(const char* str) const
+{
+  const size_t len = strlen(str);
+  return len == get_length() && memcmp(m_token_begin, str, len) == 0;
+}
+
+std::string
+SExprTokenizer::get_string() const
+{
+  if (!m_escaped)
+  {
+    return std::string(m_token_begin, m_token_end);
+  }
+  else
+  {
+    std::string result;
+    result.reserve(get_length());
+    for(const char* c = m_token_begin; c != m_token_end; ++c)
+    {
+      if (*c == '\\' && c+1 != m_token_end)
+      {
+        ++c;
+        switch(*c)
+        {
+          case 'n': result += '\n'; break;
+          case 't': result += '\t'; break;
+          default:  result += *c;   break;
+        }
+      }
+      else
+      {
+        result += *c;
+      }
+    }
+    return result;
+  }
+}
+
+int
+SExprTokenizer::get_int() const
+{
+  // tokens aren't NUL terminated, numbers are short enough for the stack
+  char buf[64];
+  const size_t len = std::min(get_length(), sizeof(buf) - 1);
+  memcpy(buf, m_token_begin, len);
+  buf[len] = '\0';
+  return static_cast<int>(strtol(buf, 0, 10));
+}
+
+float
+SExprTokenizer::get_float() const
+{
+  char buf[64];
+  const size_t len = std::min(get_length(), sizeof(buf) - 1);
+  memcpy(buf, m_token_begin, len);
+  buf[len] = '\0';
+  return strtof(buf, 0);
+}
+
+/* EOF */
@@ -0,0 +1,96 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_UTIL_SEXPR_TOKENIZER_HPP
+#define HEADER_GALAPIX_UTIL_SEXPR_TOKENIZER_HPP
+
+#include <stddef.h>
+#include <string>
+
+/** Pull tokenizer for s-expressions over an in-memory buffer. Unlike
+    lisp::Lexer it doesn't copy tokens anywhere, the current token is
+    a [begin, end) range into the buffer, which must outlive the
+    tokenizer. The token classification follows lisp::Lexer. */
+class SExprTokenizer
+{
+public:
+  enum TokenType {
+    TOKEN_EOF,
+    TOKEN_OPEN_PAREN,
+    TOKEN_CLOSE_PAREN,
+    TOKEN_SYMBOL,
+    TOKEN_STRING,
+    TOKEN_INTEGER,
+    TOKEN_REAL,
+    TOKEN_TRUE,
+    TOKEN_FALSE
+  };
+
+private:
+  const char* m_pos;
+  const char* m_end;
+  int m_line;
+
+  TokenType   m_type;
+  const char* m_token_begin;
+  const char* m_token_end;
+
+  /** Set when a string token contains backslash escapes */
+  bool m_escaped;
+
+public:
+  SExprTokenizer(const char* begin, const char* end, int line = 1);
+
+  /** Advance to the next token and return its type, throws
+      std::runtime_error on malformed input */
+  TokenType next();
+
+  /** After TOKEN_OPEN_PAREN was returned, skip forward to the
+      matching TOKEN_CLOSE_PAREN */
+  void skip_list();
+
+  TokenType get_type() const { return m_type; }
+
+  /** Text of the current token, for strings without the quotes and
+      with escapes not yet resolved */
+  const char* get_begin() const { return m_token_begin; }
+  const char* get_end() const { return m_token_end; }
+  size_t get_length() const { return static_cast<size_t>(m_token_end - m_token_begin); }
+
+  /** Position right behind the current token */
+  const char* get_pos() const { return m_pos; }
+
+  int get_line_number() const { return m_line; }
+
+  bool equals(const char* str) const;
+
+  std::string get_string() const;
+  int   get_int() const;
+  float get_float() const;
+
+private:
+  void error(const char* message) const;
+
+private:
+  SExprTokenizer(const SExprTokenizer&);
+  SExprTokenizer& operator=(const SExprTokenizer&);
+};
+
+#endif
+
+/* EOF */
@@ -18,7 +18,9 @@
 
 #include "util/software_surface.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <stddef.h>
 #include <string.h>
 #include <boost/scoped_array.hpp>
 
@@ -31,24 +33,73 @@
 
 namespace {
 
-inline
-void copy_pixel_rgb(SoftwareSurface& dst, int dst_x, int dst_y,
-                    SoftwareSurface& src, int src_x, int src_y)
+/** Maps the pixel (ox, oy) of a transformed image back to the pixel
+    (x0 + ox*xdx + oy*ydx, y0 + ox*xdy + oy*ydy) of the source image */
+struct PixelMapping
 {
-  uint8_t* const d = dst.get_row_data(dst_y) + 3*dst_x;
-  uint8_t* const s = src.get_row_data(src_y) + 3*src_x;
-  d[0] = s[0];
-  d[1] = s[1];
-  d[2] = s[2];
+  int x0, y0;
+  int xdx, xdy;
+  int ydx, ydy;
+};
+
+PixelMapping get_pixel_mapping(SoftwareSurface::Modifier mod, const Size& src)
+{
+  const int w = src.width  - 1;
+  const int h = src.height - 1;
+
+  switch(mod)
+  {
+    case SoftwareSurface::kRot90:      return { 0, h,  0, -1,  1,  0 };
+    case SoftwareSurface::kRot180:     return { w, h, -1,  0,  0, -1 };
+    case SoftwareSurface::kRot270:     return { w, 0,  0,  1, -1,  0 };
+    case SoftwareSurface::kRot0Flip:   return { 0, h,  1,  0,  0, -1 };
+    case SoftwareSurface::kRot90Flip:  return { w, h,  0, -1, -1,  0 };
+    case SoftwareSurface::kRot180Flip: return { w, 0, -1,  0,  0,  1 };
+    case SoftwareSurface::kRot270Flip: return { 0, 0,  0,  1,  1,  0 };
+    case SoftwareSurface::kRot0:
+    default:                           return { 0, 0,  1,  0,  0,  1 };
+  }
 }
 
-inline
-void copy_pixel_rgba(SoftwareSurface& dst, int dst_x, int dst_y,
-                     SoftwareSurface& src, int src_x, int src_y)
+bool swaps_axes(SoftwareSurface::Modifier mod)
 {
-  uint32_t* const d = reinterpret_cast<uint32_t*>(dst.get_row_data(dst_y) + 4*dst_x);
-  uint32_t* const s = reinterpret_cast<uint32_t*>(src.get_row_data(src_y) + 4*src_x);
-  *d = *s;
+  return (mod == SoftwareSurface::kRot90     || mod == SoftwareSurface::kRot270 ||
+          mod == SoftwareSurface::kRot90Flip || mod == SoftwareSurface::kRot270Flip);
+}
+
+/** Copies pixels along a constant source stride, one output block at
+    a time, so that for the rotations both the rows read from the
+    source and the rows written to the destination stay in cache */
+template<int BPP>
+void transform_blocked(const uint8_t* src, int src_pitch,
+                       uint8_t* dst, int dst_pitch, const Size& dst_size,
+                       const PixelMapping& m)
+{
+  const int block = 64;
+
+  const ptrdiff_t step_x = m.xdx * BPP + m.xdy * src_pitch;
+  const ptrdiff_t step_y = m.ydx * BPP + m.ydy * src_pitch;
+  const uint8_t* const origin = src + m.y0 * src_pitch + m.x0 * BPP;
+
+  for(int by = 0; by < dst_size.height; by += block)
+  {
+    const int ey = std::min(by + block, dst_size.height);
+    for(int bx = 0; bx < dst_size.width; bx += block)
+    {
+      const int ex = std::min(bx + block, dst_size.width);
+      for(int y = by; y < ey; ++y)
+      {
+        const uint8_t* s = origin + bx * step_x + y * step_y;
+        uint8_t* d = dst + y * dst_pitch + bx * BPP;
+        for(int x = bx; x < ex; ++x)
+        {
+          memcpy(d, s, BPP);
+          s += step_x;
+          d += BPP;
+        }
+      }
+    }
+  }
 }
 
 } // namespace
@@ -262,162 +313,87 @@ SoftwareSurface::clone()
 SoftwareSurfacePtr
 SoftwareSurface::transform(Modifier mod)
 {
-  switch(mod)
+  if (mod == kRot0)
   {
-    case kRot0:
-      return clone();
-
-    case kRot90:
-      return rotate90();
+    return clone();
+  }
+  else if (mod == kRot0Flip)
+  {
+    return vflip();
+  }
+  else
+  {
+    SoftwareSurfacePtr out = SoftwareSurface::create(impl->format, transform_size(mod, impl->size));
+    const PixelMapping mapping = get_pixel_mapping(mod, impl->size);
 
-    case kRot180:
-      return rotate180();
+    switch(impl->format)
+    {
+      case SoftwareSurface::RGB_FORMAT:
+        transform_blocked<3>(impl->pixels.get(), impl->pitch,
+                             out->get_data(), out->get_pitch(), out->get_size(), mapping);
+        break;
 
-    case kRot270:
-      return rotate270();
+      case SoftwareSurface::RGBA_FORMAT:
+        transform_blocked<4>(impl->pixels.get(), impl->pitch,
+                             out->get_data(), out->get_pitch(), out->get_size(), mapping);
+        break;
+    }
 
-    case kRot0Flip:
-      return vflip();
+    return out;
+  }
+}
 
-    case kRot90Flip:
-      // FIXME: Could be made faster
-      return rotate90()->vflip();
+Size
+SoftwareSurface::transform_size(Modifier mod, const Size& size)
+{
+  if (swaps_axes(mod))
+  {
+    return Size(size.height, size.width);
+  }
+  else
+  {
+    return size;
+  }
+}
 
-    case kRot180Flip:
-      return hflip();
+Rect
+SoftwareSurface::transform_rect_inverse(Modifier mod, const Size& src_size, const Rect& rect)
+{
+  // map two opposite corner pixels back, the mapping is axis aligned
+  // so they span the whole source rect
+  const PixelMapping m = get_pixel_mapping(mod, src_size);
 
-    case kRot270Flip:
-      // FIXME: Could be made faster
-      return rotate270()->vflip();
+  const int ax = m.x0 + rect.left      * m.xdx + rect.top        * m.ydx;
+  const int ay = m.y0 + rect.left      * m.xdy + rect.top        * m.ydy;
+  const int bx = m.x0 + (rect.right-1) * m.xdx + (rect.bottom-1) * m.ydx;
+  const int by = m.y0 + (rect.right-1) * m.xdy + (rect.bottom-1) * m.ydy;
 
-    default:
-      assert(!"never reached");
-      return clone();
-  }
+  return Rect(std::min(ax, bx), std::min(ay, by),
+              std::max(ax, bx) + 1, std::max(ay, by) + 1);
 }
 
 SoftwareSurfacePtr
 SoftwareSurface::rotate90()
 {
-  SoftwareSurfacePtr out = SoftwareSurface::create(impl->format, Size(impl->size.height, impl->size.width));
-
-  switch(impl->format)
-  {
-    case SoftwareSurface::RGB_FORMAT:
-      for(int y = 0; y < impl->size.height; ++y)
-        for(int x = 0; x < impl->size.width; ++x)
-        {
-          copy_pixel_rgb(*out, impl->size.height - y - 1, x,
-                         *this, x, y);
-        }
-      break;
-
-    case SoftwareSurface::RGBA_FORMAT:
-      for(int y = 0; y < impl->size.height; ++y)
-      {
-        for(int x = 0; x < impl->size.width; ++x)
-        {
-          copy_pixel_rgba(*out, impl->size.height - y - 1, x,
-                          *this, x, y);
-        }
-      }
-      break;
-  }
-
-  return out;
+  return transform(kRot90);
 }
 
 SoftwareSurfacePtr
 SoftwareSurface::rotate180()
 {
-  SoftwareSurfacePtr out = SoftwareSurface::create(impl->format, impl->size);
-
-  switch(impl->format)
-  {
-    case SoftwareSurface::RGB_FORMAT:
-      for(int y = 0; y < impl->size.height; ++y)
-        for(int x = 0; x < impl->size.width; ++x)
-        {
-          copy_pixel_rgb(*out, impl->size.width - x - 1, impl->size.height - 1 - y,
-                         *this, x, y);
-        }
-      break;
-
-    case SoftwareSurface::RGBA_FORMAT:
-      for(int y = 0; y < impl->size.height; ++y)
-      {
-        for(int x = 0; x < impl->size.width; ++x)
-        {
-          copy_pixel_rgba(*out, impl->size.width - x - 1, impl->size.height - 1 - y,
-                          *this, x, y);
-        }
-      }
-      break;
-  }
-
-  return out; 
+  return transform(kRot180);
 }
 
 SoftwareSurfacePtr
 SoftwareSurface::rotate270()
 {
-  SoftwareSurfacePtr out = SoftwareSurface::create(impl->format, Size(impl->size.height, impl->size.width));
-
-  switch(impl->format)
-  {
-    case SoftwareSurface::RGB_FORMAT:
-      for(int y = 0; y < impl->size.height; ++y)
-        for(int x = 0; x < impl->size.width; ++x)
-        {
-          copy_pixel_rgb(*out, y, impl->size.width - 1 - x,
-                         *this, x, y);
-        }
-      break;
-
-    case SoftwareSurface::RGBA_FORMAT:
-      for(int y = 0; y < impl->size.height; ++y)
-      {
-        for(int x = 0; x < impl->size.width; ++x)
-        {
-          copy_pixel_rgba(*out, y, impl->size.width - 1 - x,
-                          *this, x, y);
-        }
-      }
-      break;
-  }
-
-  return out; 
+  return transform(kRot270);
 }
 
 SoftwareSurfacePtr
 SoftwareSurface::hflip()
 {
-  SoftwareSurfacePtr out = SoftwareSurface::create(impl->format, impl->size);
-
-  switch(impl->format)
-  {
-    case SoftwareSurface::RGB_FORMAT:
-      for(int y = 0; y < impl->size.height; ++y)
-        for(int x = 0; x < impl->size.width; ++x)
-        {
-          copy_pixel_rgb(*out, impl->size.width - 1 - x, y,
-                         *this, x, y);
-        }
-      break;
-
-    case SoftwareSurface::RGBA_FORMAT:
-      for(int y = 0; y < impl->size.height; ++y)
-      {
-        for(int x = 0; x < impl->size.width; ++x)
-        {
-          copy_pixel_rgba(*out, impl->size.width - 1 - x, y,
-                          *this, x, y);
-        }
-      }
-      break;
-  }
-
-  return out; 
+  return transform(kRot180Flip);
 }
 
 SoftwareSurfacePtr
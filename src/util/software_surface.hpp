@@ -71,7 +71,17 @@ public:
   SoftwareSurfacePtr scale(const Size& size);
   SoftwareSurfacePtr crop(const Rect& rect);
 
+  /** Rotates and flips the image, uses a cache blocked copy */
   SoftwareSurfacePtr transform(Modifier mod);
+
+  /** Size of a \a size sized surface after transform(\a mod) */
+  static Size transform_size(Modifier mod, const Size& size);
+
+  /** Returns the rect of a \a src_size sized surface that ends up as
+      \a rect after transform(\a mod), so parts of a transformed image
+      can be produced without transforming all of it */
+  static Rect transform_rect_inverse(Modifier mod, const Size& src_size, const Rect& rect);
+
   SoftwareSurfacePtr rotate90();
   SoftwareSurfacePtr rotate180();
   SoftwareSurfacePtr rotate270();
@@ -289,4 +289,27 @@ SoftwareSurfaceFactory::from_url(const URL& url) const
   }
 }
 
+void
+SoftwareSurfaceFactory::stream_from_url(const URL& url, ScanlineSink& sink) const
+{
+  if (url.has_stdio_name())
+  {
+    const std::string filename = url.get_stdio_name();
+    const SoftwareSurfaceLoader* loader = find_loader_by_filename(filename);
+    if (loader && loader->supports_streaming())
+    {
+      // rows might already be handed out when a loader fails, so the
+      // retry by magic of from_file() has to happen up front
+      const SoftwareSurfaceLoader* magic_loader = find_loader_by_magic(Filesystem::get_magic(filename));
+      if (!magic_loader || magic_loader == loader)
+      {
+        loader->stream_from_file(filename, sink);
+        return;
+      }
+    }
+  }
+
+  sink.write_surface(from_url(url));
+}
+
 /* EOF */
@@ -25,6 +25,7 @@
 #include "util/currenton.hpp"
 #include "util/software_surface.hpp"
 
+class ScanlineSink;
 class SoftwareSurfaceLoader;
 class URL;
 
@@ -63,6 +64,11 @@ public:
   SoftwareSurfacePtr from_file(const std::string& filename) const;
   SoftwareSurfacePtr from_file(const std::string& filename, const SoftwareSurfaceLoader* loader) const;
 
+  /** Same as from_url(), but hands the image to \a sink row by row.
+      Loaders that support streaming never hold the whole image in
+      memory, for all others the surface is loaded and passed on. */
+  void stream_from_url(const URL& url, ScanlineSink& sink) const;
+
 private:
   SoftwareSurfaceFactory(const SoftwareSurfaceFactory&);
   SoftwareSurfaceFactory& operator=(const SoftwareSurfaceFactory&);
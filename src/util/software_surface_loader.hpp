@@ -19,6 +19,7 @@
 #ifndef HEADER_GALAPIX_UTIL_SOFTWARE_SURFACE_LOADER_HPP
 #define HEADER_GALAPIX_UTIL_SOFTWARE_SURFACE_LOADER_HPP
 
+#include "util/scanline_sink.hpp"
 #include "util/software_surface.hpp"
 
 class SoftwareSurfaceFactory;
@@ -39,6 +40,19 @@ public:
   virtual bool supports_from_mem() const =0;
   virtual SoftwareSurfacePtr from_mem(uint8_t* data, int len) const =0;
 
+  /** Loaders that can decode row by row return true and override
+      stream_from_file()/stream_from_mem(), the default ones load the
+      whole surface and pass it on */
+  virtual bool supports_streaming() const { return false; }
+  virtual void stream_from_file(const std::string& filename, ScanlineSink& sink) const
+  {
+    sink.write_surface(from_file(filename));
+  }
+  virtual void stream_from_mem(uint8_t* data, int len, ScanlineSink& sink) const
+  {
+    sink.write_surface(from_mem(data, len));
+  }
+
 private:
   SoftwareSurfaceLoader(const SoftwareSurfaceLoader&);
   SoftwareSurfaceLoader& operator=(const SoftwareSurfaceLoader&);
@@ -18,6 +18,20 @@
 
 #include "string_util.hpp"
 
+namespace {
+
+unsigned char to_uchar(char c)
+{
+  return static_cast<unsigned char>(c);
+}
+
+bool is_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+} // namespace
+
 bool
 StringUtil::has_suffix(const std::string& data, const std::string& suffix)
 {
@@ -34,20 +48,23 @@ StringUtil::has_suffix(const std::string& data, const std::string& suffix)
 bool
 StringUtil::numeric_less(const std::string& lhs, const std::string& rhs)
 {
+  // characters are compared as unsigned char, the same way
+  // std::string compares the keys from numeric_sort_key(), so that
+  // both agree on names with UTF-8 or other non-ASCII bytes
   std::string::size_type i = 0;
   std::string::size_type min_len = std::min(lhs.size(), rhs.size());
 
   while(i < min_len)
   {
-    if (isdigit(lhs[i]) && isdigit(rhs[i]))
+    if (is_digit(lhs[i]) && is_digit(rhs[i]))
     {
       // have two digits, so check which number is smaller
       std::string::size_type li = i+1;
       std::string::size_type ri = i+1;
 
       // find the end of the number in both strings
-      while(li < lhs.size() && isdigit(lhs[li])) { li += 1; }
-      while(ri < rhs.size() && isdigit(rhs[ri])) { ri += 1; }
+      while(li < lhs.size() && is_digit(lhs[li])) { li += 1; }
+      while(ri < rhs.size() && is_digit(rhs[ri])) { ri += 1; }
 
       if (li == ri)
       {
@@ -57,7 +74,7 @@ StringUtil::numeric_less(const std::string& lhs, const std::string& rhs)
         {
           if (lhs[j] != rhs[j])
           {
-            return lhs[j] < rhs[j];
+            return to_uchar(lhs[j]) < to_uchar(rhs[j]);
           }
         }
 
@@ -76,7 +93,7 @@ StringUtil::numeric_less(const std::string& lhs, const std::string& rhs)
       // do normal character comparism
       if (lhs[i] != rhs[i])
       {
-        return lhs[i] < rhs[i];
+        return to_uchar(lhs[i]) < to_uchar(rhs[i]);
       }
       else
       {
@@ -89,4 +106,42 @@ StringUtil::numeric_less(const std::string& lhs, const std::string& rhs)
   return lhs.size() < rhs.size();
 }
 
+std::string
+StringUtil::numeric_sort_key(const std::string& str)
+{
+  std::string key;
+  key.reserve(str.size() + 16);
+
+  std::string::size_type i = 0;
+  while(i < str.size())
+  {
+    if (is_digit(str[i]))
+    {
+      std::string::size_type end = i+1;
+      while(end < str.size() && is_digit(str[end])) { end += 1; }
+
+      // A number is encoded as '0', its number of digits and the
+      // digits themselves. The '0' sorts against other characters the
+      // same way any digit does, the length makes numbers with less
+      // digits sort first, just like in numeric_less()
+      std::string::size_type len = end - i;
+      key += '0';
+      key += static_cast<char>((len >> 24) & 0xff);
+      key += static_cast<char>((len >> 16) & 0xff);
+      key += static_cast<char>((len >>  8) & 0xff);
+      key += static_cast<char>((len >>  0) & 0xff);
+      key.append(str, i, len);
+
+      i = end;
+    }
+    else
+    {
+      key += str[i];
+      i += 1;
+    }
+  }
+
+  return key;
+}
+
 /* EOF */
@@ -27,6 +27,11 @@ public:
   /** Compare two strings according to their numeric value, similar to
       what 'sort -n' does. */
   static bool numeric_less(const std::string& lhs, const std::string& rhs);
+
+  /** Returns a key for which plain string comparison gives the same
+      order as numeric_less(), so that it can be computed once and
+      sorting only needs memcmp() */
+  static std::string numeric_sort_key(const std::string& str);
 };
 
 #endif
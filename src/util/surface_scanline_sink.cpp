@@ -0,0 +1,52 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "util/surface_scanline_sink.hpp"
+
+#include <string.h>
+
+SurfaceScanlineSink::SurfaceScanlineSink() :
+  m_surface(),
+  m_row(0)
+{
+}
+
+void
+SurfaceScanlineSink::begin(SoftwareSurface::Format format, const Size& size)
+{
+  m_surface = SoftwareSurface::create(format, size);
+  m_row = 0;
+}
+
+void
+SurfaceScanlineSink::add_row(const uint8_t* row)
+{
+  if (m_row < m_surface->get_height())
+  {
+    memcpy(m_surface->get_row_data(m_row), row,
+           m_surface->get_width() * m_surface->get_bytes_per_pixel());
+    m_row += 1;
+  }
+}
+
+void
+SurfaceScanlineSink::end()
+{
+}
+
+/* EOF */
@@ -0,0 +1,48 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_UTIL_SURFACE_SCANLINE_SINK_HPP
+#define HEADER_GALAPIX_UTIL_SURFACE_SCANLINE_SINK_HPP
+
+#include "util/scanline_sink.hpp"
+
+/** Collects the rows into a SoftwareSurface, for the places that
+    need the whole image after all */
+class SurfaceScanlineSink : public ScanlineSink
+{
+private:
+  SoftwareSurfacePtr m_surface;
+  int m_row;
+
+public:
+  SurfaceScanlineSink();
+
+  void begin(SoftwareSurface::Format format, const Size& size);
+  void add_row(const uint8_t* row);
+  void end();
+
+  SoftwareSurfacePtr get_surface() const { return m_surface; }
+
+private:
+  SurfaceScanlineSink(const SurfaceScanlineSink&);
+  SurfaceScanlineSink& operator=(const SurfaceScanlineSink&);
+};
+
+#endif
+
+/* EOF */
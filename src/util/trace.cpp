@@ -0,0 +1,357 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "util/trace.hpp"
+
+#include <assert.h>
+#include <chrono>
+#include <condition_variable>
+#include <errno.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct TraceEvent
+{
+  const char* category;
+  const char* name;
+  int64_t start;
+  int64_t dur;
+};
+
+/** Ring buffer of a single thread, only that thread writes to it */
+struct ThreadBuffer
+{
+  std::vector<TraceEvent> events;
+  std::atomic<uint64_t> count;
+  int tid;
+  const char* name;
+
+  ThreadBuffer(int tid_, const char* name_) :
+    events(1 << 16),
+    count(0),
+    tid(tid_),
+    name(name_)
+  {}
+};
+
+struct TraceRegistry
+{
+  std::mutex mutex;
+  std::vector<std::shared_ptr<ThreadBuffer> > buffers;
+  std::map<std::string, std::unique_ptr<TraceCounter> > counters;
+  std::map<std::string, std::unique_ptr<TraceHistogram> > histograms;
+
+  std::mutex stats_mutex;
+  std::condition_variable stats_cond;
+  std::thread stats_thread;
+  bool stats_quit;
+
+  TraceRegistry() :
+    mutex(),
+    buffers(),
+    counters(),
+    histograms(),
+    stats_mutex(),
+    stats_cond(),
+    stats_thread(),
+    stats_quit(false)
+  {}
+};
+
+/** Intentionally leaked, so that threads still running during static
+    destruction can keep recording */
+TraceRegistry& get_registry()
+{
+  static TraceRegistry* registry = new TraceRegistry;
+  return *registry;
+}
+
+/** The buffer is only allocated with the first span the thread
+    records, the name is kept until then */
+thread_local ThreadBuffer* t_buffer = 0;
+thread_local const char* t_thread_name = 0;
+
+ThreadBuffer& get_thread_buffer()
+{
+  if (!t_buffer)
+  {
+    TraceRegistry& registry = get_registry();
+    std::unique_lock<std::mutex> lock(registry.mutex);
+    registry.buffers.push_back(std::make_shared<ThreadBuffer>(static_cast<int>(registry.buffers.size()) + 1,
+                                                              t_thread_name));
+    t_buffer = registry.buffers.back().get();
+  }
+  return *t_buffer;
+}
+
+void write_json_string(std::ostream& out, const char* str)
+{
+  out << '"';
+  for(const char* c = str; *c; ++c)
+  {
+    if (*c == '"' || *c == '\\')
+    {
+      out << '\\';
+    }
+    out << *c;
+  }
+  out << '"';
+}
+
+} // namespace
+
+std::atomic<bool> Trace::s_enabled(false);
+
+TraceHistogram::TraceHistogram(const char* name) :
+  m_name(name),
+  m_count(0),
+  m_sum(0),
+  m_buckets()
+{
+  for(int i = 0; i < 64; ++i)
+  {
+    m_buckets[i] = 0;
+  }
+}
+
+void
+TraceHistogram::record(int64_t value)
+{
+  int bucket = 0;
+  for(uint64_t v = static_cast<uint64_t>(value > 0 ? value : 0); v != 0 && bucket < 63; v >>= 1)
+  {
+    bucket += 1;
+  }
+
+  m_count.fetch_add(1, std::memory_order_relaxed);
+  m_sum.fetch_add(value, std::memory_order_relaxed);
+  m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+int64_t
+TraceHistogram::get_percentile(float p) const
+{
+  int64_t target = static_cast<int64_t>(p * static_cast<float>(get_count()));
+  int64_t seen = 0;
+  for(int i = 0; i < 64; ++i)
+  {
+    seen += m_buckets[i].load(std::memory_order_relaxed);
+    if (seen > target)
+    {
+      return (i == 0) ? 0 : ((int64_t(1) << i) - 1);
+    }
+  }
+  return INT64_MAX;
+}
+
+void
+Trace::enable(bool enabled)
+{
+  s_enabled = enabled;
+}
+
+void
+Trace::set_thread_name(const char* name)
+{
+  t_thread_name = name;
+
+  if (t_buffer)
+  {
+    t_buffer->name = name;
+  }
+}
+
+int64_t
+Trace::now_ns()
+{
+  static const std::chrono::steady_clock::time_point base = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - base).count();
+}
+
+void
+Trace::record_span(const char* category, const char* name, int64_t start_ns, int64_t dur_ns)
+{
+  ThreadBuffer& buffer = get_thread_buffer();
+  uint64_t count = buffer.count.load(std::memory_order_relaxed);
+  TraceEvent& event = buffer.events[count % buffer.events.size()];
+  event.category = category;
+  event.name  = name;
+  event.start = start_ns;
+  event.dur   = dur_ns;
+  buffer.count.store(count + 1, std::memory_order_release);
+}
+
+TraceCounter&
+Trace::counter(const char* name)
+{
+  TraceRegistry& registry = get_registry();
+  std::unique_lock<std::mutex> lock(registry.mutex);
+  std::unique_ptr<TraceCounter>& counter = registry.counters[name];
+  if (!counter)
+  {
+    counter.reset(new TraceCounter(name));
+  }
+  return *counter;
+}
+
+TraceHistogram&
+Trace::histogram(const char* name)
+{
+  TraceRegistry& registry = get_registry();
+  std::unique_lock<std::mutex> lock(registry.mutex);
+  std::unique_ptr<TraceHistogram>& histogram = registry.histograms[name];
+  if (!histogram)
+  {
+    histogram.reset(new TraceHistogram(name));
+  }
+  return *histogram;
+}
+
+void
+Trace::write_chrome_trace(std::ostream& out)
+{
+  TraceRegistry& registry = get_registry();
+  std::unique_lock<std::mutex> lock(registry.mutex);
+
+  out << "{\"traceEvents\":[";
+  bool first = true;
+  for(std::vector<std::shared_ptr<ThreadBuffer> >::const_iterator i = registry.buffers.begin();
+      i != registry.buffers.end(); ++i)
+  {
+    const ThreadBuffer& buffer = **i;
+
+    if (buffer.name)
+    {
+      out << (first ? "\n" : ",\n")
+          << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer.tid
+          << ",\"args\":{\"name\":";
+      write_json_string(out, buffer.name);
+      out << "}}";
+      first = false;
+    }
+
+    // spans that are older than the ring buffer are lost
+    uint64_t count = buffer.count.load(std::memory_order_acquire);
+    uint64_t begin = (count > buffer.events.size()) ? count - buffer.events.size() : 0;
+    for(uint64_t j = begin; j < count; ++j)
+    {
+      const TraceEvent& event = buffer.events[j % buffer.events.size()];
+      out << (first ? "\n" : ",\n") << "{\"ph\":\"X\",\"cat\":";
+      write_json_string(out, event.category);
+      out << ",\"name\":";
+      write_json_string(out, event.name);
+      out << ",\"pid\":1,\"tid\":" << buffer.tid
+          << ",\"ts\":" << event.start / 1000 << "." << std::setfill('0') << std::setw(3) << event.start % 1000
+          << ",\"dur\":" << event.dur / 1000 << "." << std::setw(3) << event.dur % 1000 << std::setfill(' ')
+          << "}";
+      first = false;
+    }
+  }
+  out << "\n]}" << std::endl;
+}
+
+void
+Trace::write_chrome_trace(const std::string& filename)
+{
+  std::ofstream out(filename.c_str());
+  write_chrome_trace(out);
+  if (!out)
+  {
+    throw std::runtime_error("Trace::write_chrome_trace(): " + filename + ": " + strerror(errno));
+  }
+}
+
+void
+Trace::write_stats(std::ostream& out)
+{
+  TraceRegistry& registry = get_registry();
+  std::unique_lock<std::mutex> lock(registry.mutex);
+
+  for(std::map<std::string, std::unique_ptr<TraceCounter> >::const_iterator i = registry.counters.begin();
+      i != registry.counters.end(); ++i)
+  {
+    out << "  " << std::left << std::setw(40) << i->first << std::right << std::setw(12) << i->second->get_value() << '\n';
+  }
+
+  for(std::map<std::string, std::unique_ptr<TraceHistogram> >::const_iterator i = registry.histograms.begin();
+      i != registry.histograms.end(); ++i)
+  {
+    const TraceHistogram& histogram = *i->second;
+    int64_t count = histogram.get_count();
+    if (count > 0)
+    {
+      out << "  " << std::left << std::setw(40) << i->first << std::right
+          << std::setw(12) << count
+          << "  mean " << std::setw(8) << histogram.get_sum() / count
+          << "  p50 <" << std::setw(8) << histogram.get_percentile(0.5f)
+          << "  p99 <" << std::setw(8) << histogram.get_percentile(0.99f)
+          << '\n';
+    }
+  }
+  out << std::flush;
+}
+
+void
+Trace::start_stats_dump(float interval)
+{
+  TraceRegistry& registry = get_registry();
+  assert(!registry.stats_thread.joinable());
+
+  registry.stats_quit = false;
+  registry.stats_thread = std::thread([&registry, interval]{
+      std::unique_lock<std::mutex> lock(registry.stats_mutex);
+      while(!registry.stats_cond.wait_for(lock, std::chrono::duration<float>(interval),
+                                          [&registry]{ return registry.stats_quit; }))
+      {
+        // goes to stderr in one piece, on a line of its own, so that it
+        // doesn't end up in the middle of the progress line on stdout
+        std::ostringstream out;
+        out << "\nTrace::stats: (span durations in microseconds)\n";
+        write_stats(out);
+        std::cerr << out.str() << std::flush;
+      }
+    });
+}
+
+void
+Trace::stop_stats_dump()
+{
+  TraceRegistry& registry = get_registry();
+  if (registry.stats_thread.joinable())
+  {
+    {
+      std::unique_lock<std::mutex> lock(registry.stats_mutex);
+      registry.stats_quit = true;
+    }
+    registry.stats_cond.notify_all();
+    registry.stats_thread.join();
+  }
+}
+
+/* EOF */
@@ -0,0 +1,190 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_UTIL_TRACE_HPP
+#define HEADER_GALAPIX_UTIL_TRACE_HPP
+
+#include <atomic>
+#include <iosfwd>
+#include <stdint.h>
+#include <string>
+
+/** A counter that can be incremented from any thread */
+class TraceCounter
+{
+private:
+  const char* m_name;
+  std::atomic<int64_t> m_value;
+
+public:
+  TraceCounter(const char* name) : m_name(name), m_value(0) {}
+
+  void add(int64_t n) { m_value.fetch_add(n, std::memory_order_relaxed); }
+
+  const char* get_name() const { return m_name; }
+  int64_t get_value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+  TraceCounter(const TraceCounter&);
+  TraceCounter& operator=(const TraceCounter&);
+};
+
+/** A histogram with power of two buckets, good enough to tell the
+    median from the tail without any locking */
+class TraceHistogram
+{
+private:
+  const char* m_name;
+  std::atomic<int64_t> m_count;
+  std::atomic<int64_t> m_sum;
+  std::atomic<int64_t> m_buckets[64];
+
+public:
+  TraceHistogram(const char* name);
+
+  void record(int64_t value);
+
+  const char* get_name() const { return m_name; }
+  int64_t get_count() const { return m_count.load(std::memory_order_relaxed); }
+  int64_t get_sum() const { return m_sum.load(std::memory_order_relaxed); }
+
+  /** Returns the upper bound of the bucket containing the given
+      percentile, \a p is in the range [0,1] */
+  int64_t get_percentile(float p) const;
+
+private:
+  TraceHistogram(const TraceHistogram&);
+  TraceHistogram& operator=(const TraceHistogram&);
+};
+
+/** Collects timed spans into per-thread ring buffers, which can be
+    exported in the Chrome trace event format (chrome://tracing or
+    ui.perfetto.dev), as well as named counters and histograms. Names
+    and categories are stored as plain pointers and must outlive the
+    Trace, so only string literals should be used. Recording is off
+    until enable() is called, when off a span costs a single atomic
+    load. */
+class Trace
+{
+public:
+  static void enable(bool enabled);
+  static bool is_enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+  /** Name under which the calling thread shows up in the trace */
+  static void set_thread_name(const char* name);
+
+  /** Record a span that started at \a start_ns and lasted \a dur_ns */
+  static void record_span(const char* category, const char* name, int64_t start_ns, int64_t dur_ns);
+
+  static int64_t now_ns();
+
+  /** Returns the counter or histogram registered under \a name,
+      creating it on first use, the result stays valid forever */
+  static TraceCounter&   counter(const char* name);
+  static TraceHistogram& histogram(const char* name);
+
+  /** Write all recorded spans as Chrome trace JSON */
+  static void write_chrome_trace(std::ostream& out);
+  static void write_chrome_trace(const std::string& filename);
+
+  /** Write a human readable summary of all counters and histograms */
+  static void write_stats(std::ostream& out);
+
+  /** Dump the stats to stderr every \a interval seconds from a
+      background thread, until stop_stats_dump() is called */
+  static void start_stats_dump(float interval);
+  static void stop_stats_dump();
+
+private:
+  static std::atomic<bool> s_enabled;
+};
+
+/** Records the time between construction and destruction as span,
+    if a histogram is given the duration in microseconds is added to
+    it as well */
+class TraceSpan
+{
+private:
+  const char* m_category;
+  const char* m_name;
+  TraceHistogram* m_histogram;
+  int64_t m_start;
+
+public:
+  TraceSpan(const char* category, const char* name, TraceHistogram* histogram = 0) :
+    m_category(category),
+    m_name(name),
+    m_histogram(histogram),
+    m_start(Trace::is_enabled() ? Trace::now_ns() : -1)
+  {}
+
+  ~TraceSpan()
+  {
+    if (m_start >= 0)
+    {
+      int64_t dur = Trace::now_ns() - m_start;
+      Trace::record_span(m_category, m_name, m_start, dur);
+      if (m_histogram)
+      {
+        m_histogram->record(dur / 1000);
+      }
+    }
+  }
+
+private:
+  TraceSpan(const TraceSpan&);
+  TraceSpan& operator=(const TraceSpan&);
+};
+
+#define GALAPIX_TRACE_CONCAT2(a, b) a ## b
+#define GALAPIX_TRACE_CONCAT(a, b) GALAPIX_TRACE_CONCAT2(a, b)
+
+#ifdef HAVE_TRACING
+/** Time the rest of the scope, \a name also names the histogram the
+    duration goes to, it must be a string literal */
+#  define TRACE_SPAN(category, name)                                    \
+  static TraceHistogram& GALAPIX_TRACE_CONCAT(trace_histogram_, __LINE__) = Trace::histogram(category "/" name); \
+  TraceSpan GALAPIX_TRACE_CONCAT(trace_span_, __LINE__)(category, name, &GALAPIX_TRACE_CONCAT(trace_histogram_, __LINE__))
+
+/** Time the rest of the scope under a name only known at runtime,
+    the name must still live forever (e.g. typeid().name()) */
+#  define TRACE_SPAN_DYNAMIC(category, name)                            \
+  TraceSpan GALAPIX_TRACE_CONCAT(trace_span_, __LINE__)(category, name)
+
+#  define TRACE_COUNT(name, n)                                          \
+  do { if (Trace::is_enabled()) {                                       \
+      static TraceCounter& trace_counter = Trace::counter(name);       \
+      trace_counter.add(n); } } while(0)
+
+#  define TRACE_VALUE(name, value)                                      \
+  do { if (Trace::is_enabled()) {                                       \
+      static TraceHistogram& trace_histogram = Trace::histogram(name); \
+      trace_histogram.record(value); } } while(0)
+
+#  define TRACE_THREAD_NAME(name) Trace::set_thread_name(name)
+#else
+#  define TRACE_SPAN(category, name)
+#  define TRACE_SPAN_DYNAMIC(category, name)
+#  define TRACE_COUNT(name, n)
+#  define TRACE_VALUE(name, value)
+#  define TRACE_THREAD_NAME(name)
+#endif
+
+#endif
+
+/* EOF */
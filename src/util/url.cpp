@@ -19,8 +19,10 @@
 #include "util/url.hpp"
 
 #include <assert.h>
+#include <mutex>
 #include <stdexcept>
 #include <ostream>
+#include <unordered_map>
 
 #include "plugins/rar.hpp"
 #include "plugins/zip.hpp"
@@ -28,12 +30,104 @@
 #include "plugins/tar.hpp"
 #include "plugins/curl.hpp"
 #include "util/filesystem.hpp"
-
+#include "util/string_util.hpp"
+
+struct URL::Data
+{
+  std::string protocol;
+  std::string payload;
+  std::string plugin;
+  std::string plugin_payload;
+
+  std::string  str;
+  std::string  sort_key;
+  size_t       hash;
+  unsigned int id;
+
+  Data(const std::string& protocol_,
+       const std::string& payload_,
+       const std::string& plugin_,
+       const std::string& plugin_payload_,
+       const std::string& str_,
+       unsigned int id_) :
+    protocol(protocol_),
+    payload(payload_),
+    plugin(plugin_),
+    plugin_payload(plugin_payload_),
+    str(str_),
+    sort_key(StringUtil::numeric_sort_key(str_)),
+    hash(std::hash<std::string>()(str_)),
+    id(id_)
+  {}
+};
+
+namespace {
+
+std::string make_url_string(const std::string& protocol,
+                            const std::string& payload,
+                            const std::string& plugin,
+                            const std::string& plugin_payload)
+{
+  std::string url = protocol + "://" + payload;
+  if (!plugin.empty())
+  {
+    return url + "//" + plugin + ":" + plugin_payload;
+  }
+  else
+  {
+    return url;
+  }
+}
+
+} // namespace
+
+std::shared_ptr<const URL::Data>
+URL::intern(const std::string& protocol,
+            const std::string& payload,
+            const std::string& plugin,
+            const std::string& plugin_payload)
+{
+  typedef std::unordered_map<std::string, std::weak_ptr<const Data> > Table;
+
+  // never destroyed, as URLs might still be in use by other static
+  // objects during shutdown
+  static std::mutex& mutex = *new std::mutex;
+  static Table& table = *new Table;
+  static unsigned int next_id = 0;
+
+  std::string url = make_url_string(protocol, payload, plugin, plugin_payload);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  Table::iterator it = table.find(url);
+  if (it != table.end())
+  {
+    std::shared_ptr<const Data> data = it->second.lock();
+    if (data)
+    {
+      return data;
+    }
+  }
+
+  // the entry leaves the table along with the last URL referring to
+  // it, unless the URL got interned again in the meantime
+  std::shared_ptr<const Data> data(new Data(protocol, payload, plugin, plugin_payload, url, next_id++),
+                                   [](const Data* data_) {
+                                     {
+                                       std::unique_lock<std::mutex> lock_(mutex);
+                                       Table::iterator it_ = table.find(data_->str);
+                                       if (it_ != table.end() && it_->second.expired())
+                                       {
+                                         table.erase(it_);
+                                       }
+                                     }
+                                     delete data_;
+                                   });
+  table[url] = data;
+  return data;
+}
+
 URL::URL() :
-  m_protocol(),
-  m_payload(),
-  m_plugin(),
-  m_plugin_payload()
+  m_data(intern(std::string(), std::string(), std::string(), std::string()))
 {
 }
 
@@ -45,62 +139,75 @@ URL
 URL::from_filename(const std::string& filename)
 {
   URL url;
-  url.m_protocol = "file";
-  url.m_payload  = Filesystem::realpath(filename);
+  url.m_data = intern("file", Filesystem::realpath(filename), std::string(), std::string());
   return url;
 }
 
 URL
 URL::from_string(const std::string& url)
 {
-  URL ret;
-
   std::string::size_type i = url.find_first_of("//");
   assert(i != std::string::npos);
 
-  ret.m_protocol = url.substr(0, i-1);
+  std::string protocol = url.substr(0, i-1);
+  std::string payload;
+  std::string plugin;
+  std::string plugin_payload;
+
   std::string::size_type j = url.find("//", i+2);
   if (j == std::string::npos)
   { // no plugin given
-    ret.m_payload = url.substr(i+2);
+    payload = url.substr(i+2);
   }
   else
   {
-    ret.m_payload  = url.substr(i+2, j-i-2);
+    payload  = url.substr(i+2, j-i-2);
     std::string::size_type k = url.find(":", j+2);
-    ret.m_plugin          = url.substr(j+2, k-j-2);
-    ret.m_plugin_payload  = url.substr(k+1);
+    plugin          = url.substr(j+2, k-j-2);
+    plugin_payload  = url.substr(k+1);
     //std::cout << "'" << protocol << "' '" << payload << "' '" << plugin << "' " << plugin_payload << std::endl;
   }
-  
+
+  URL ret;
+  ret.m_data = intern(protocol, payload, plugin, plugin_payload);
   return ret;
 }
 
-std::string
+const std::string&
 URL::str() const
 {
-  std::string url = m_protocol + "://" + m_payload;
-  if (!m_plugin.empty())
-  {
-    return url + "//" + m_plugin + ":" + m_plugin_payload;
-  }
-  else
-  {
-    return url;
-  }
+  return m_data->str;
+}
+
+const std::string&
+URL::get_sort_key() const
+{
+  return m_data->sort_key;
+}
+
+size_t
+URL::get_hash() const
+{
+  return m_data->hash;
+}
+
+unsigned int
+URL::get_id() const
+{
+  return m_data->id;
 }
 
 std::string
 URL::get_stdio_name() const
 {
   assert(has_stdio_name());
-  return m_payload;
+  return m_data->payload;
 }
 
 bool
 URL::has_stdio_name() const
 {
-  if (m_protocol == "file" && m_plugin.empty())
+  if (m_data->protocol == "file" && m_data->plugin.empty())
     return true;
   else
     return false;
@@ -109,52 +216,52 @@ URL::has_stdio_name() const
 std::string
 URL::get_protocol() const
 {
-  return m_protocol;
+  return m_data->protocol;
 }
 
 std::string
 URL::get_payload() const
 {
-  return m_payload;
+  return m_data->payload;
 }
 
 BlobPtr
 URL::get_blob(std::string* mime_type) const
 {
-  if (m_protocol == "file")
+  if (m_data->protocol == "file")
   {
-    if (m_plugin.empty())
+    if (m_data->plugin.empty())
     {
-      return Blob::from_file(m_payload);
+      return Blob::from_file(m_data->payload);
     }
-    else if (m_plugin == "rar")
+    else if (m_data->plugin == "rar")
     {
-      return Rar::get_file(m_payload, m_plugin_payload);
+      return Rar::get_file(m_data->payload, m_data->plugin_payload);
     }
-    else if (m_plugin == "zip")
+    else if (m_data->plugin == "zip")
     {
-      return Zip::get_file(m_payload, m_plugin_payload);
+      return Zip::get_file(m_data->payload, m_data->plugin_payload);
     }
-    else if (m_plugin == "7zip")
+    else if (m_data->plugin == "7zip")
     {
-      return SevenZip::get_file(m_payload, m_plugin_payload);
+      return SevenZip::get_file(m_data->payload, m_data->plugin_payload);
     }
-    else if (m_plugin == "tar")
+    else if (m_data->plugin == "tar")
     {
-      return Tar::get_file(m_payload, m_plugin_payload);
+      return Tar::get_file(m_data->payload, m_data->plugin_payload);
     }
     else
     {
-      throw std::runtime_error("URL::get_blob(): Unhandled plugin: " + m_plugin);
+      throw std::runtime_error("URL::get_blob(): Unhandled plugin: " + m_data->plugin);
     }
   }
-  else if (m_protocol == "http" || m_protocol == "https" || m_protocol == "ftp")
+  else if (m_data->protocol == "http" || m_data->protocol == "https" || m_data->protocol == "ftp")
   {
     return CURLHandler::get_data(str(), mime_type);
   }
   else
   {
-    throw std::runtime_error("URL::get_blob(): Unhandled protocol: " + m_protocol);
+    throw std::runtime_error("URL::get_blob(): Unhandled protocol: " + m_data->protocol);
     return BlobPtr();
   }
 }
@@ -207,7 +314,7 @@ URL::is_url(const std::string& url)
 bool
 URL::is_remote() const
 {
-  return m_protocol != "file";
+  return m_data->protocol != "file";
 }
 
 std::ostream& operator<<(std::ostream& out, const URL& url)
@@ -220,12 +327,4 @@ bool operator<(const URL& lhs, const URL& rhs)
   return lhs.str() < rhs.str();
 }
 
-bool operator==(const URL& lhs, const URL& rhs)
-{
-  return (lhs.m_payload  == rhs.m_payload  &&
-          lhs.m_protocol == rhs.m_protocol &&
-          lhs.m_plugin   == rhs.m_plugin   &&
-          lhs.m_plugin_payload == rhs.m_plugin_payload);
-}
-
 /* EOF */
@@ -19,6 +19,8 @@
 #ifndef HEADER_GALAPIX_UTIL_URL_HPP
 #define HEADER_GALAPIX_UTIL_URL_HPP
 
+#include <functional>
+#include <memory>
 #include <string>
 
 #include "util/blob.hpp"
@@ -35,10 +37,17 @@ private:
   // Example:
   // http://www.example.com/foobar.jpg
   // file:///www.example.com/foobar.rar//rar:Filename.jpg
-  std::string m_protocol;
-  std::string m_payload;
-  std::string m_plugin;
-  std::string m_plugin_payload;
+
+  /** URLs are interned, each distinct URL is stored only once for as
+      long as any URL object refers to it, a URL object is just a
+      pointer to it */
+  struct Data;
+  std::shared_ptr<const Data> m_data;
+
+  static std::shared_ptr<const Data> intern(const std::string& protocol,
+                            const std::string& payload,
+                            const std::string& plugin,
+                            const std::string& plugin_payload);
 
 public:
   URL();
@@ -55,7 +64,19 @@ public:
   std::string get_payload() const;
 
   /** Get unique representation of this URL */
-  std::string str() const;
+  const std::string& str() const;
+
+  /** Key for sorting, comparing two keys gives the same result as
+      StringUtil::numeric_less() on str() */
+  const std::string& get_sort_key() const;
+
+  /** Hash of str(), computed once on interning */
+  size_t get_hash() const;
+
+  /** Id that is unique for each distinct URL within this process, ids
+      are handed out in the order the URLs are interned, a URL that
+      got dropped and is created again gets a new id */
+  unsigned int get_id() const;
 
   /** Get the filename in a form that can be used with the system */
   std::string get_stdio_name() const;
@@ -73,12 +94,25 @@ public:
   bool is_remote() const;
 
   static bool is_url(const std::string& url);
-  friend bool operator==(const URL& lhs, const URL& rhs);  
+  friend bool operator==(const URL& lhs, const URL& rhs)
+  {
+    // interned, so the same URL always has the same Data
+    return lhs.m_data == rhs.m_data;
+  }
 };
 
+namespace std {
+
+template<>
+struct hash<URL>
+{
+  size_t operator()(const URL& url) const { return url.get_hash(); }
+};
+
+} // namespace std
+
 std::ostream& operator<<(std::ostream& out, const URL& url);
 bool operator<(const URL& lhs, const URL& rhs);
-bool operator==(const URL& lhs, const URL& rhs);
 
 #endif
 
@@ -0,0 +1,210 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "util/xxhash64.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <string.h>
+
+namespace {
+
+const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+const uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+/** Unaligned little endian reads */
+inline uint64_t read64(const uint8_t* p)
+{
+  uint64_t v = 0;
+  for(int i = 7; i >= 0; --i)
+    v = (v << 8) | p[i];
+  return v;
+}
+
+inline uint32_t read32(const uint8_t* p)
+{
+  return
+    static_cast<uint32_t>(p[0])       |
+    static_cast<uint32_t>(p[1]) << 8  |
+    static_cast<uint32_t>(p[2]) << 16 |
+    static_cast<uint32_t>(p[3]) << 24;
+}
+
+inline uint64_t round(uint64_t acc, uint64_t input)
+{
+  acc += input * kPrime2;
+  acc  = rotl(acc, 31);
+  return acc * kPrime1;
+}
+
+inline uint64_t merge_round(uint64_t acc, uint64_t val)
+{
+  acc ^= round(0, val);
+  return acc * kPrime1 + kPrime4;
+}
+
+} // namespace
+
+uint64_t
+XXHash64::from_data(const void* data, size_t len, uint64_t seed)
+{
+  XXHash64 hash(seed);
+  hash.update(data, len);
+  return hash.digest();
+}
+
+uint64_t
+XXHash64::from_file(const std::string& filename, uint64_t seed)
+{
+  std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!in)
+  {
+    throw std::runtime_error("XXHash64::from_file(): Couldn't open file " + filename);
+  }
+  else
+  {
+    XXHash64 hash(seed);
+    char buf[65536];
+    while(!in.eof())
+    {
+      in.read(buf, sizeof(buf));
+      hash.update(buf, in.gcount());
+    }
+    return hash.digest();
+  }
+}
+
+XXHash64::XXHash64(uint64_t seed) :
+  m_acc(),
+  m_buffer(),
+  m_buffer_size(0),
+  m_total_size(0),
+  m_seed(seed)
+{
+  reset(seed);
+}
+
+void
+XXHash64::reset(uint64_t seed)
+{
+  m_seed   = seed;
+  m_acc[0] = seed + kPrime1 + kPrime2;
+  m_acc[1] = seed + kPrime2;
+  m_acc[2] = seed;
+  m_acc[3] = seed - kPrime1;
+  m_buffer_size = 0;
+  m_total_size  = 0;
+}
+
+void
+XXHash64::update(const void* data_in, size_t len)
+{
+  const uint8_t* data = static_cast<const uint8_t*>(data_in);
+  const uint8_t* end  = data + len;
+
+  m_total_size += len;
+
+  if (m_buffer_size + len < 32)
+  {
+    memcpy(m_buffer + m_buffer_size, data, len);
+    m_buffer_size += len;
+    return;
+  }
+
+  if (m_buffer_size)
+  {
+    const size_t fill = 32 - m_buffer_size;
+    memcpy(m_buffer + m_buffer_size, data, fill);
+    data += fill;
+
+    for(int i = 0; i < 4; ++i)
+      m_acc[i] = round(m_acc[i], read64(m_buffer + 8*i));
+    m_buffer_size = 0;
+  }
+
+  while(end - data >= 32)
+  {
+    for(int i = 0; i < 4; ++i)
+      m_acc[i] = round(m_acc[i], read64(data + 8*i));
+    data += 32;
+  }
+
+  m_buffer_size = end - data;
+  memcpy(m_buffer, data, m_buffer_size);
+}
+
+uint64_t
+XXHash64::digest() const
+{
+  uint64_t h;
+
+  if (m_total_size >= 32)
+  {
+    h = rotl(m_acc[0], 1) + rotl(m_acc[1], 7) + rotl(m_acc[2], 12) + rotl(m_acc[3], 18);
+    for(int i = 0; i < 4; ++i)
+      h = merge_round(h, m_acc[i]);
+  }
+  else
+  {
+    h = m_seed + kPrime5;
+  }
+
+  h += m_total_size;
+
+  const uint8_t* p   = m_buffer;
+  const uint8_t* end = m_buffer + m_buffer_size;
+
+  while(end - p >= 8)
+  {
+    h ^= round(0, read64(p));
+    h  = rotl(h, 27) * kPrime1 + kPrime4;
+    p += 8;
+  }
+
+  if (end - p >= 4)
+  {
+    h ^= static_cast<uint64_t>(read32(p)) * kPrime1;
+    h  = rotl(h, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+
+  while(p < end)
+  {
+    h ^= static_cast<uint64_t>(*p) * kPrime5;
+    h  = rotl(h, 11) * kPrime1;
+    ++p;
+  }
+
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+
+  return h;
+}
+
+/* EOF */
@@ -0,0 +1,60 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_UTIL_XXHASH64_HPP
+#define HEADER_GALAPIX_UTIL_XXHASH64_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/** Streaming implementation of the 64bit xxHash, a fast
+    non-cryptographic hash. It is used to recognize files and tiles
+    with identical content, not to guard against deliberate
+    collisions, so matches must be compared before they are relied on
+    where that matters. */
+class XXHash64
+{
+private:
+  uint64_t m_acc[4];
+  uint8_t  m_buffer[32];
+  size_t   m_buffer_size;
+  uint64_t m_total_size;
+  uint64_t m_seed;
+
+public:
+  static uint64_t from_data(const void* data, size_t len, uint64_t seed = 0);
+  static uint64_t from_file(const std::string& filename, uint64_t seed = 0);
+
+  XXHash64(uint64_t seed = 0);
+
+  void reset(uint64_t seed = 0);
+  void update(const void* data, size_t len);
+
+  /** Returns the hash of the data seen so far, further update()
+      calls are still possible */
+  uint64_t digest() const;
+
+private:
+  XXHash64(const XXHash64&);
+  XXHash64& operator=(const XXHash64&);
+};
+
+#endif
+
+/* EOF */
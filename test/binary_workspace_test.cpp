@@ -0,0 +1,122 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "galapix/binary_workspace.hpp"
+#include "galapix/image.hpp"
+#include "galapix/image_collection.hpp"
+
+#include "check.hpp"
+
+namespace {
+
+void write_file(const std::string& filename, const std::string& data)
+{
+  std::ofstream out(filename.c_str(), std::ios::binary);
+  out.write(data.data(), data.size());
+}
+
+bool load_throws(const std::string& filename)
+{
+  try
+  {
+    ImageCollection images;
+    BinaryWorkspace::load(filename, images);
+    return false;
+  }
+  catch(const std::exception& err)
+  {
+    return true;
+  }
+}
+
+} // namespace
+
+int main()
+{
+  ImageCollection images;
+  for(int i = 0; i < 100; ++i)
+  {
+    std::ostringstream url;
+    url << "file:///binary_workspace_test/image" << i << (i % 3 ? ".jpg" : ".archive.zip//zip:inner/file.png");
+
+    ImagePtr image = Image::create(URL::from_string(url.str()));
+    image->set_pos(Vector2f(static_cast<float>(i) * 1.5f, -static_cast<float>(i) * 0.25f));
+    image->set_scale(0.5f + static_cast<float>(i) / 64.0f);
+    image->set_angle(static_cast<float>(i % 4) * 90.0f);
+    images.add(image);
+  }
+
+  std::ostringstream out;
+  BinaryWorkspace::save(out, images);
+  std::string data = out.str();
+
+  char filename[] = "/tmp/binary_workspace_test.XXXXXX";
+  int fd = mkstemp(filename);
+  if (fd < 0)
+  {
+    std::cout << "couldn't create temporary file" << std::endl;
+    return EXIT_FAILURE;
+  }
+  close(fd);
+
+  write_file(filename, data);
+  check(BinaryWorkspace::is_binary(filename), "saved file is recognized as binary");
+
+  ImageCollection loaded;
+  BinaryWorkspace::load(filename, loaded);
+  check(loaded.size() == images.size(), "number of images survives the round trip");
+  for(size_t i = 0; i < loaded.size() && i < images.size(); ++i)
+  {
+    check(loaded[i]->get_url() == images[i]->get_url(), "url of image " + images[i]->get_url().str());
+    check(loaded[i]->get_pos().x == images[i]->get_pos().x &&
+          loaded[i]->get_pos().y == images[i]->get_pos().y, "position of image " + images[i]->get_url().str());
+    check(loaded[i]->get_scale() == images[i]->get_scale(), "scale of image " + images[i]->get_url().str());
+    check(loaded[i]->get_angle() == images[i]->get_angle(), "angle of image " + images[i]->get_url().str());
+  }
+
+  // an empty workspace round trips as well
+  std::ostringstream empty_out;
+  BinaryWorkspace::save(empty_out, ImageCollection());
+  write_file(filename, empty_out.str());
+  ImageCollection empty;
+  BinaryWorkspace::load(filename, empty);
+  check(empty.size() == 0, "empty workspace");
+
+  // truncated files are rejected instead of read past their end
+  const size_t cuts[] = { 0, 16, 40, data.size() / 2, data.size() - 1 };
+  for(size_t i = 0; i < sizeof(cuts) / sizeof(cuts[0]); ++i)
+  {
+    write_file(filename, data.substr(0, cuts[i]));
+    std::ostringstream what;
+    what << "file truncated to " << cuts[i] << " bytes is rejected";
+    check(load_throws(filename), what.str());
+  }
+
+  unlink(filename);
+
+  return check_result();
+}
+
+/* EOF */
@@ -0,0 +1,60 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HEADER_GALAPIX_TEST_CHECK_HPP
+#define HEADER_GALAPIX_TEST_CHECK_HPP
+
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+
+/** Shared by the tests that check more than a single thing: a
+    failed check() is reported and counted, the test goes on and
+    main() returns check_result() in the end. */
+namespace {
+
+int g_failures = 0;
+
+void check(bool condition, const std::string& what)
+{
+  if (!condition)
+  {
+    std::cout << "FAILED: " << what << std::endl;
+    g_failures += 1;
+  }
+}
+
+int check_result()
+{
+  if (g_failures)
+  {
+    std::cout << g_failures << " checks failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  else
+  {
+    std::cout << "all checks passed" << std::endl;
+    return EXIT_SUCCESS;
+  }
+}
+
+} // namespace
+
+#endif
+
+/* EOF */
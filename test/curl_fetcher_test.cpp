@@ -0,0 +1,425 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <netinet/in.h>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "plugins/curl_fetcher.hpp"
+
+#include "check.hpp"
+
+namespace {
+
+/** Minimal HTTP/1.1 server on 127.0.0.1 that serves a fixed set of
+    paths, so the fetcher can be tested without network access:
+
+    /etag        200 with an ETag, 304 when If-None-Match matches
+    /modified    200 with a Last-Modified, 304 when If-Modified-Since is sent
+    /chunked     200 without Content-Length, the connection is closed after
+    /truncated   announces 1000 bytes, sends 100 and closes the connection
+    /missing     404
+    /slow        200 after 200ms
+    /hang        doesn't answer until the server is stopped */
+class LocalHTTPServer
+{
+private:
+  int m_listen_fd;
+  int m_port;
+  std::atomic<bool> m_quit;
+  std::thread m_accept_thread;
+
+  std::mutex m_mutex;
+  std::condition_variable m_quit_cond;
+  std::vector<int> m_client_fds;
+  std::vector<std::thread> m_client_threads;
+
+  int m_active;
+
+public:
+  std::atomic<int> num_connections;
+  std::atomic<int> num_requests;
+  std::atomic<int> num_not_modified;
+  std::atomic<int> max_active;
+
+public:
+  LocalHTTPServer() :
+    m_listen_fd(socket(AF_INET, SOCK_STREAM, 0)),
+    m_port(0),
+    m_quit(false),
+    m_accept_thread(),
+    m_mutex(),
+    m_quit_cond(),
+    m_client_fds(),
+    m_client_threads(),
+    m_active(0),
+    num_connections(0),
+    num_requests(0),
+    num_not_modified(0),
+    max_active(0)
+  {
+    int one = 1;
+    setsockopt(m_listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = 0;
+
+    socklen_t len = sizeof(addr);
+    if (bind(m_listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(m_listen_fd, 16) != 0 ||
+        getsockname(m_listen_fd, reinterpret_cast<struct sockaddr*>(&addr), &len) != 0)
+    {
+      throw std::runtime_error("LocalHTTPServer: couldn't listen on 127.0.0.1");
+    }
+    m_port = ntohs(addr.sin_port);
+
+    m_accept_thread = std::thread(&LocalHTTPServer::accept_loop, this);
+  }
+
+  ~LocalHTTPServer()
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_quit = true;
+      for(std::vector<int>::iterator i = m_client_fds.begin(); i != m_client_fds.end(); ++i)
+      {
+        shutdown(*i, SHUT_RDWR);
+      }
+    }
+    m_quit_cond.notify_all();
+
+    shutdown(m_listen_fd, SHUT_RDWR);
+    close(m_listen_fd);
+    m_accept_thread.join();
+
+    for(std::vector<std::thread>::iterator i = m_client_threads.begin(); i != m_client_threads.end(); ++i)
+    {
+      i->join();
+    }
+  }
+
+  std::string url(const std::string& path) const
+  {
+    std::ostringstream str;
+    str << "http://127.0.0.1:" << m_port << path;
+    return str.str();
+  }
+
+private:
+  void accept_loop()
+  {
+    while(!m_quit)
+    {
+      int fd = accept(m_listen_fd, NULL, NULL);
+      if (fd < 0)
+        break;
+
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (m_quit)
+      {
+        close(fd);
+        break;
+      }
+      num_connections += 1;
+      m_client_fds.push_back(fd);
+      m_client_threads.push_back(std::thread(&LocalHTTPServer::serve, this, fd));
+    }
+  }
+
+  void send_all(int fd, const std::string& data)
+  {
+    size_t sent = 0;
+    while(sent < data.size())
+    {
+      ssize_t ret = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+      if (ret <= 0)
+        return;
+      sent += ret;
+    }
+  }
+
+  static std::string body_for(const std::string& path, size_t len)
+  {
+    std::string body;
+    for(size_t i = 0; i < len; ++i)
+    {
+      body += static_cast<char>('a' + (i + path.size()) % 26);
+    }
+    return body;
+  }
+
+  void serve(int fd)
+  {
+    std::string buffer;
+    char chunk[4096];
+    bool keep_alive = true;
+
+    while(keep_alive)
+    {
+      size_t header_end;
+      while((header_end = buffer.find("\r\n\r\n")) == std::string::npos)
+      {
+        ssize_t len = recv(fd, chunk, sizeof(chunk), 0);
+        if (len <= 0)
+        {
+          keep_alive = false;
+          break;
+        }
+        buffer.append(chunk, len);
+      }
+
+      if (!keep_alive)
+        break;
+
+      std::string header = buffer.substr(0, header_end);
+      buffer.erase(0, header_end + 4);
+
+      std::string::size_type path_start = header.find(' ') + 1;
+      std::string path = header.substr(path_start, header.find(' ', path_start) - path_start);
+
+      num_requests += 1;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_active += 1;
+        max_active = std::max(max_active.load(), m_active);
+      }
+
+      keep_alive = respond(fd, path, header);
+
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_active -= 1;
+      }
+    }
+
+    close(fd);
+  }
+
+  /** Returns false when the connection has to be closed */
+  bool respond(int fd, const std::string& path, const std::string& header)
+  {
+    if (path == "/etag")
+    {
+      if (header.find("If-None-Match: \"v1\"") != std::string::npos)
+      {
+        num_not_modified += 1;
+        send_all(fd, "HTTP/1.1 304 Not Modified\r\nETag: \"v1\"\r\n\r\n");
+      }
+      else
+      {
+        std::string body = body_for(path, 5000);
+        std::ostringstream out;
+        out << "HTTP/1.1 200 OK\r\nContent-Type: image/jpeg\r\nETag: \"v1\"\r\n"
+            << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+        send_all(fd, out.str());
+      }
+      return true;
+    }
+    else if (path == "/modified")
+    {
+      if (header.find("If-Modified-Since: ") != std::string::npos)
+      {
+        num_not_modified += 1;
+        send_all(fd, "HTTP/1.1 304 Not Modified\r\n\r\n");
+      }
+      else
+      {
+        std::string body = body_for(path, 3000);
+        std::ostringstream out;
+        out << "HTTP/1.1 200 OK\r\nContent-Type: image/png\r\n"
+            << "Last-Modified: Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+            << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+        send_all(fd, out.str());
+      }
+      return true;
+    }
+    else if (path == "/chunked")
+    {
+      send_all(fd, "HTTP/1.1 200 OK\r\nConnection: close\r\n\r\n" + body_for(path, 7000));
+      return false;
+    }
+    else if (path == "/truncated")
+    {
+      send_all(fd, "HTTP/1.1 200 OK\r\nContent-Length: 1000\r\n\r\n" + body_for(path, 100));
+      return false;
+    }
+    else if (path == "/slow")
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+      send_all(fd, "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\nslow");
+      return true;
+    }
+    else if (path == "/hang")
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_quit_cond.wait_for(lock, std::chrono::seconds(10), [this]{ return m_quit.load(); });
+      return false;
+    }
+    else
+    {
+      send_all(fd, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+      return true;
+    }
+  }
+
+private:
+  LocalHTTPServer(const LocalHTTPServer&);
+  LocalHTTPServer& operator=(const LocalHTTPServer&);
+};
+
+double get_time()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** Issues all \a urls at once and waits for all of them */
+std::vector<CURLFetcher::Response> fetch_all(CURLFetcher& fetcher, const std::vector<std::string>& urls)
+{
+  std::vector<CURLFetcher::Response> responses(urls.size());
+  std::mutex mutex;
+  std::condition_variable cond;
+  size_t pending = urls.size();
+
+  for(size_t i = 0; i < urls.size(); ++i)
+  {
+    fetcher.request(urls[i], [&, i](const CURLFetcher::Response& response) {
+        std::unique_lock<std::mutex> lock(mutex);
+        responses[i] = response;
+        pending -= 1;
+        cond.notify_one();
+      });
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  cond.wait(lock, [&]{ return pending == 0; });
+
+  return responses;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  if (curl_global_init(CURL_GLOBAL_ALL) != 0)
+  {
+    std::cout << "Couldn't init cURL" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  char cache_dir[] = "/tmp/curl_fetcher_test.XXXXXX";
+  if (!mkdtemp(cache_dir))
+  {
+    std::cout << "Couldn't create cache directory" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  {
+    LocalHTTPServer server;
+
+    {
+      CURLFetcher fetcher(8, cache_dir);
+
+      // plain downloads, with and without Content-Length
+      CURLFetcher::Response response = fetcher.get(server.url("/etag"));
+      check(response.ok() && response.data->size() == 5000 && !response.from_cache,
+            "download with Content-Length");
+      check(response.mime_type == "image/jpeg", "mime type");
+
+      response = fetcher.get(server.url("/chunked"));
+      check(response.ok() && response.data->size() == 7000, "download without Content-Length");
+
+      response = fetcher.get(server.url("/missing"));
+      check(!response.ok() && response.response_code == 404, "404 is an error");
+
+      response = fetcher.get(server.url("/truncated"));
+      check(!response.ok(), "truncated body is an error");
+
+      // conditional requests are answered from the cache
+      int not_modified = server.num_not_modified;
+      response = fetcher.get(server.url("/etag"));
+      check(response.ok() && response.from_cache && response.data->size() == 5000 &&
+            response.mime_type == "image/jpeg" && server.num_not_modified == not_modified + 1,
+            "ETag revalidation served from cache");
+
+      fetcher.get(server.url("/modified"));
+      response = fetcher.get(server.url("/modified"));
+      check(response.ok() && response.from_cache && response.data->size() == 3000 &&
+            server.num_not_modified == not_modified + 2,
+            "Last-Modified revalidation served from cache");
+
+      // parallel transfers
+      std::vector<std::string> urls(8, server.url("/slow"));
+      double start = get_time();
+      std::vector<CURLFetcher::Response> responses = fetch_all(fetcher, urls);
+      double duration = get_time() - start;
+
+      bool all_ok = true;
+      for(size_t i = 0; i < responses.size(); ++i)
+        all_ok = all_ok && responses[i].ok();
+      check(all_ok, "parallel downloads");
+      check(server.max_active > 1 && duration < 8 * 0.2, "downloads run in parallel");
+    }
+
+    // with a single connection and one transfer after the other, the
+    // second has to go over the connection left by the first
+    {
+      CURLFetcher fetcher(1);
+      int connections = server.num_connections;
+      bool ok = fetcher.get(server.url("/slow")).ok();
+      ok = fetcher.get(server.url("/slow")).ok() && ok;
+      check(ok && server.num_connections == connections + 1, "connections are reused");
+    }
+
+    // pending requests fail when the fetcher goes away
+    {
+      std::atomic<int> failed(0);
+      {
+        CURLFetcher fetcher(1);
+        for(int i = 0; i < 3; ++i)
+        {
+          fetcher.request(server.url("/hang"), [&failed](const CURLFetcher::Response& response) {
+              if (!response.ok() && response.error == "fetcher shut down")
+                failed += 1;
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+      check(failed == 3, "queued and running requests fail on shutdown");
+    }
+  }
+
+  curl_global_cleanup();
+
+  return check_result();
+}
+
+/* EOF */
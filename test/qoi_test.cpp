@@ -0,0 +1,150 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <string.h>
+
+#include "math/size.hpp"
+#include "plugins/qoi.hpp"
+#include "util/blob.hpp"
+
+namespace {
+
+void put(const SoftwareSurfacePtr& surface, int x, int y, int r, int g, int b, int a)
+{
+  uint8_t* p = surface->get_row_data(y) + x * surface->get_bytes_per_pixel();
+  p[0] = static_cast<uint8_t>(r);
+  p[1] = static_cast<uint8_t>(g);
+  p[2] = static_cast<uint8_t>(b);
+  if (surface->get_bytes_per_pixel() == 4)
+  {
+    p[3] = static_cast<uint8_t>(a);
+  }
+}
+
+/** Fills \a surface with rows that exercise every QOI op: a run
+    longer than the 62 pixel limit, two alternating colors (index
+    hits), small steps (diff), larger green-correlated steps (luma),
+    arbitrary colors (rgb) and, in RGBA surfaces, changing alpha */
+void fill(const SoftwareSurfacePtr& surface)
+{
+  const int width = surface->get_width();
+  for(int x = 0; x < width; ++x)
+  {
+    put(surface, x, 0, 10, 20, 30, 255);
+    if (x % 2)
+      put(surface, x, 1, 200, 10, 10, 255);
+    else
+      put(surface, x, 1, 10, 200, 10, 255);
+    put(surface, x, 2, 100 + x % 2, 100 - x % 2, 100, 255);
+    put(surface, x, 3, 50 + 10 * (x % 3), 50 + 12 * (x % 3), 50 + 9 * (x % 3), 255);
+    put(surface, x, 4, (x * 73) & 0xff, (x * 151) & 0xff, (x * 37) & 0xff, 255);
+    put(surface, x, 5, 10, 20, 30, (x * 17) & 0xff);
+  }
+}
+
+/** Walks the encoded ops and counts how often each was used: index,
+    diff, luma, run, rgb, rgba */
+void count_ops(const BlobPtr& blob, int counts[6])
+{
+  const uint8_t* p   = blob->get_data() + 14;
+  const uint8_t* end = blob->get_data() + blob->size() - 8;
+  while(p < end)
+  {
+    if (*p == 0xfe)
+    {
+      counts[4] += 1;
+      p += 4;
+    }
+    else if (*p == 0xff)
+    {
+      counts[5] += 1;
+      p += 5;
+    }
+    else
+    {
+      int op = *p >> 6;
+      counts[op] += 1;
+      p += (op == 2) ? 2 : 1;
+    }
+  }
+}
+
+bool roundtrip(SoftwareSurface::Format format, const char* name)
+{
+  SoftwareSurfacePtr surface = SoftwareSurface::create(format, Size(100, 6));
+  fill(surface);
+
+  BlobPtr blob = QOI::save(surface);
+
+  int counts[6] = { 0, 0, 0, 0, 0, 0 };
+  count_ops(blob, counts);
+  const char* op_names[6] = { "index", "diff", "luma", "run", "rgb", "rgba" };
+  for(int i = 0; i < 6; ++i)
+  {
+    if (counts[i] == 0 && !(i == 5 && format == SoftwareSurface::RGB_FORMAT))
+    {
+      std::cout << name << ": test image doesn't produce any " << op_names[i] << " op" << std::endl;
+      return false;
+    }
+  }
+  SoftwareSurfacePtr result = QOI::load_from_mem(blob->get_data(), blob->size());
+
+  if (result->get_format() != format || result->get_size() != surface->get_size())
+  {
+    std::cout << name << ": format or size mismatch" << std::endl;
+    return false;
+  }
+
+  for(int y = 0; y < surface->get_height(); ++y)
+  {
+    if (memcmp(surface->get_row_data(y), result->get_row_data(y),
+               surface->get_width() * surface->get_bytes_per_pixel()) != 0)
+    {
+      std::cout << name << ": pixel mismatch in row " << y << std::endl;
+      return false;
+    }
+  }
+
+  // a truncated image must be rejected instead of read past the end
+  try
+  {
+    QOI::load_from_mem(blob->get_data(), blob->size() / 2);
+    std::cout << name << ": truncated data not detected" << std::endl;
+    return false;
+  }
+  catch(const std::exception&)
+  {
+    // expected
+  }
+
+  std::cout << name << ": " << blob->size() << " bytes, ok" << std::endl;
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  bool ok = true;
+  ok = roundtrip(SoftwareSurface::RGB_FORMAT,  "rgb")  && ok;
+  ok = roundtrip(SoftwareSurface::RGBA_FORMAT, "rgba") && ok;
+  return ok ? 0 : 1;
+}
+
+/* EOF */
@@ -0,0 +1,89 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "util/string_util.hpp"
+#include "util/url.hpp"
+
+#include "check.hpp"
+
+namespace {
+
+/** numeric_less() and comparing numeric_sort_key()s must agree */
+void check_order(const std::string& lhs, const std::string& rhs)
+{
+  bool less     = StringUtil::numeric_less(lhs, rhs);
+  bool key_less = StringUtil::numeric_sort_key(lhs) < StringUtil::numeric_sort_key(rhs);
+  check(less == key_less, "'" + lhs + "' < '" + rhs + "': numeric_less and numeric_sort_key disagree");
+}
+
+} // namespace
+
+int main()
+{
+  check(StringUtil::numeric_less("img2.jpg", "img10.jpg"), "img2.jpg < img10.jpg");
+  check(!StringUtil::numeric_less("img10.jpg", "img2.jpg"), "!(img10.jpg < img2.jpg)");
+  check(!StringUtil::numeric_less("a", "a"), "!(a < a)");
+
+  // bytes above 0x7f are sorted after ASCII
+  check(StringUtil::numeric_less("photo_a.jpg", "photo_\xc3\xa9.jpg"), "photo_a.jpg < photo_\xc3\xa9.jpg");
+  check(!StringUtil::numeric_less("photo_\xc3\xa9.jpg", "photo_a.jpg"), "!(photo_\xc3\xa9.jpg < photo_a.jpg)");
+
+  std::vector<std::string> names;
+  names.push_back("photo_a.jpg");
+  names.push_back("photo_\xc3\xa9.jpg");
+  names.push_back("photo_\xc3\xa9" "2.jpg");
+  names.push_back("photo_\xc3\xa9" "10.jpg");
+  names.push_back("photo_2.jpg");
+  names.push_back("photo_10.jpg");
+  names.push_back("photo_010.jpg");
+  names.push_back("photo_.jpg");
+  names.push_back("\xe6\x97\xa5\xe6\x9c\xac.jpg");
+  names.push_back("Z.jpg");
+  names.push_back("");
+
+  for(std::vector<std::string>::const_iterator i = names.begin(); i != names.end(); ++i)
+  {
+    for(std::vector<std::string>::const_iterator j = names.begin(); j != names.end(); ++j)
+    {
+      check_order(*i, *j);
+    }
+  }
+
+  // sorting URLs by their key agrees with numeric_less() on str()
+  URL lhs = URL::from_string("file:///photo_\xc3\xa9.jpg");
+  URL rhs = URL::from_string("file:///photo_a.jpg");
+  check(rhs.get_sort_key() < lhs.get_sort_key(), "URL sort key of photo_a.jpg and photo_\xc3\xa9.jpg");
+
+  // interned URLs are shared as long as one of them is alive and
+  // dropped from the table along with the last one
+  URL copy = URL::from_string("file:///photo_\xc3\xa9.jpg");
+  check(copy == lhs, "interned URLs compare equal");
+  check(copy.get_id() == lhs.get_id(), "interned URLs share their id");
+
+  unsigned int id = URL::from_string("file:///temporary.jpg").get_id();
+  check(URL::from_string("file:///temporary.jpg").get_id() != id, "temporary URL got released");
+
+  return check_result();
+}
+
+/* EOF */
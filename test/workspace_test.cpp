@@ -0,0 +1,196 @@
+/*
+**  Galapix - an image viewer for large image collections
+**  Copyright (C) 2010 Ingo Ruhnke <grumbel@gmx.de>
+**
+**  This program is free software: you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation, either version 3 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License
+**  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+#include <vector>
+
+#include "galapix/image.hpp"
+#include "galapix/selection.hpp"
+#include "galapix/tile_provider.hpp"
+#include "galapix/workspace.hpp"
+
+#include "check.hpp"
+
+namespace {
+
+/** Provides nothing but the image size, which is all the layouters
+    look at */
+class SizeTileProvider : public TileProvider
+{
+private:
+  Size m_size;
+
+public:
+  SizeTileProvider(const Size& size) :
+    m_size(size)
+  {}
+
+  JobHandle request_tile(int tilescale, const Vector2i& pos,
+                         const std::function<void (Tile)>& callback)
+  {
+    return JobHandle::create();
+  }
+
+  int  get_max_scale() const { return 0; }
+  int  get_tilesize()  const { return 256; }
+  int  get_overlap()   const { return 0; }
+  Size get_size()      const { return m_size; }
+};
+
+ImagePtr add_image(Workspace& workspace, int width, int height)
+{
+  static int count = 0;
+  std::ostringstream url;
+  url << "file:///workspace_test/" << count++ << ".jpg";
+
+  ImagePtr image = Image::create(URL::from_string(url.str()),
+                                 TileProviderPtr(new SizeTileProvider(Size(width, height))));
+  workspace.add_image(image);
+  return image;
+}
+
+/** Streams in images the way the viewer does: add them and let
+    update() place them */
+void stream_images(Workspace& workspace, int num, int size = 100)
+{
+  for(int i = 0; i < num; ++i)
+  {
+    add_image(workspace, size + 37 * (i % 5), size + 53 * (i % 3));
+  }
+  workspace.update(0.0f);
+  workspace.finish_animation();
+}
+
+int count_overlaps(const ImageCollection& images)
+{
+  int overlaps = 0;
+  for(size_t i = 0; i < images.size(); ++i)
+  {
+    for(size_t j = i+1; j < images.size(); ++j)
+    {
+      if (images[i]->get_image_rect().is_overlapped(images[j]->get_image_rect()))
+      {
+        overlaps += 1;
+      }
+    }
+  }
+  return overlaps;
+}
+
+void test_vertical()
+{
+  Workspace workspace;
+  stream_images(workspace, 4);
+  workspace.layout_tight(4.0f, 3.0f);
+  workspace.finish_animation();
+
+  workspace.layout_vertical();
+  workspace.finish_animation();
+  stream_images(workspace, 4);
+
+  ImageCollection images = workspace.get_images(workspace.get_bounding_rect());
+  check(images.size() == 8, "vertical: all images placed");
+
+  // every image, streamed or not, sits in the column below the previous one
+  for(size_t i = 0; i < images.size(); ++i)
+  {
+    check(images[i]->get_scale() == 1.0f, "vertical: original size");
+    check(images[i]->get_pos().x == 0.0f, "vertical: single column");
+  }
+
+  check(count_overlaps(images) == 0, "vertical: streamed images don't overlap");
+  for(size_t i = 1; i < images.size(); ++i)
+  {
+    check(images[i]->get_pos().y > images[i-1]->get_pos().y, "vertical: streamed images continue the column");
+  }
+}
+
+void test_solve_overlaps()
+{
+  srand(0);
+
+  Workspace workspace;
+  stream_images(workspace, 16, 2000);
+  workspace.layout_random();
+  workspace.finish_animation();
+
+  workspace.solve_overlaps();
+  workspace.finish_animation();
+  ImageCollection solved = workspace.get_images(workspace.get_bounding_rect());
+  check(count_overlaps(solved) == 0, "solve_overlaps: no overlaps");
+
+  std::vector<Vector2f> solved_pos;
+  for(size_t i = 0; i < solved.size(); ++i)
+  {
+    solved_pos.push_back(solved[i]->get_pos());
+  }
+
+  stream_images(workspace, 16, 2000);
+  ImageCollection images = workspace.get_images(workspace.get_bounding_rect());
+  check(images.size() == 32, "solve_overlaps: all images placed");
+  check(count_overlaps(images) == 0, "solve_overlaps: streamed images don't overlap");
+
+  // only the streamed images get moved out of the way
+  for(size_t i = 0; i < solved.size(); ++i)
+  {
+    check(solved[i]->get_pos() == solved_pos[i], "solve_overlaps: placed images stay put");
+  }
+}
+
+void test_delete_selection()
+{
+  Workspace workspace;
+  workspace.layout_vertical();
+  stream_images(workspace, 6);
+
+  ImageCollection images = workspace.get_images(workspace.get_bounding_rect());
+  ImageCollection selection;
+  for(size_t i = 0; i < images.size(); i += 2)
+  {
+    selection.add(images[i]);
+  }
+  workspace.select_images(selection);
+  workspace.delete_selection();
+  stream_images(workspace, 1);
+
+  // without gaps, the column is no taller than its images
+  images = workspace.get_images(workspace.get_bounding_rect());
+  check(images.size() == 4, "delete_selection: all images placed");
+
+  float height = 0.0f;
+  for(size_t i = 0; i < images.size(); ++i)
+  {
+    height += images[i]->get_scaled_height() + 10.0f;
+  }
+  check(workspace.get_bounding_rect().get_height() <= height, "delete_selection: no gaps left behind");
+}
+
+} // namespace
+
+int main()
+{
+  test_vertical();
+  test_solve_overlaps();
+  test_delete_selection();
+
+  return check_result();
+}
+
+/* EOF */